@@ -0,0 +1,161 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+namespace Common
+{
+// Hash map with open addressing and linear probing, storing all entries in a single array.
+// Lookups touch one or two cache lines instead of chasing the nodes of a tree, and inserting or
+// erasing an entry doesn't allocate unless the table has to grow.
+//
+// Erasing shifts the following entries of the probe sequence back instead of leaving tombstones,
+// so lookups stay fast under heavy churn. This also means that erasing invalidates pointers to
+// other values, and that the map must not be modified from within ForEach.
+//
+// Key must be equality comparable, Value must be default constructible.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class FlatHashMap
+{
+public:
+  FlatHashMap() { Rehash(MIN_CAPACITY); }
+
+  size_t Size() const { return m_size; }
+  bool Empty() const { return m_size == 0; }
+
+  Value* Find(const Key& key)
+  {
+    for (size_t i = HomeSlot(key);; i = (i + 1) & m_mask)
+    {
+      Slot& slot = m_slots[i];
+      if (!slot.used)
+        return nullptr;
+      if (slot.key == key)
+        return &slot.value;
+    }
+  }
+
+  const Value* Find(const Key& key) const { return const_cast<FlatHashMap*>(this)->Find(key); }
+
+  // Returns the value for key, default constructing it first if there is none.
+  Value& operator[](const Key& key)
+  {
+    if ((m_size + 1) * 8 > m_slots.size() * 7)
+      Rehash(m_slots.size() * 2);
+
+    size_t i = HomeSlot(key);
+    for (; m_slots[i].used; i = (i + 1) & m_mask)
+    {
+      if (m_slots[i].key == key)
+        return m_slots[i].value;
+    }
+
+    Slot& slot = m_slots[i];
+    slot.key = key;
+    slot.used = true;
+    ++m_size;
+    return slot.value;
+  }
+
+  bool Erase(const Key& key)
+  {
+    size_t i = HomeSlot(key);
+    for (;; i = (i + 1) & m_mask)
+    {
+      if (!m_slots[i].used)
+        return false;
+      if (m_slots[i].key == key)
+        break;
+    }
+
+    // Move every following entry of the cluster that may be probed for through the now empty slot
+    // into it, so that probing can still stop at the first unused slot.
+    for (size_t j = (i + 1) & m_mask; m_slots[j].used; j = (j + 1) & m_mask)
+    {
+      const size_t home = HomeSlot(m_slots[j].key);
+      const bool home_in_gap = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+      if (home_in_gap)
+        continue;
+
+      m_slots[i].key = std::move(m_slots[j].key);
+      m_slots[i].value = std::move(m_slots[j].value);
+      i = j;
+    }
+
+    m_slots[i].used = false;
+    m_slots[i].value = Value();
+    --m_size;
+    return true;
+  }
+
+  void Clear()
+  {
+    m_slots.clear();
+    m_size = 0;
+    Rehash(MIN_CAPACITY);
+  }
+
+  // Calls f(const Key&, Value&) for every entry, in no particular order.
+  template <typename F>
+  void ForEach(F f)
+  {
+    for (Slot& slot : m_slots)
+    {
+      if (slot.used)
+        f(static_cast<const Key&>(slot.key), slot.value);
+    }
+  }
+
+private:
+  static constexpr size_t MIN_CAPACITY = 16;
+
+  struct Slot
+  {
+    Key key{};
+    Value value{};
+    bool used = false;
+  };
+
+  size_t HomeSlot(const Key& key) const
+  {
+    // Fibonacci hashing, so that keys which only differ in their low bits (like aligned
+    // addresses with an identity std::hash) still spread over the whole table.
+    const u64 hash = static_cast<u64>(Hash{}(key)) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<size_t>(hash >> m_shift);
+  }
+
+  void Rehash(size_t capacity)
+  {
+    std::vector<Slot> old_slots(capacity);
+    old_slots.swap(m_slots);
+    m_mask = capacity - 1;
+    m_shift = 64;
+    for (size_t i = capacity; i > 1; i >>= 1)
+      --m_shift;
+
+    for (Slot& old_slot : old_slots)
+    {
+      if (!old_slot.used)
+        continue;
+
+      size_t i = HomeSlot(old_slot.key);
+      while (m_slots[i].used)
+        i = (i + 1) & m_mask;
+      m_slots[i] = std::move(old_slot);
+    }
+  }
+
+  std::vector<Slot> m_slots;
+  size_t m_size = 0;
+  size_t m_mask = 0;
+  u32 m_shift = 64;
+};
+}  // namespace Common
@@ -67,13 +67,19 @@ static int AshmemCreateFileMapping(const char* name, size_t size)
 }
 #endif
 
-void MemArena::GrabSHMSegment(size_t size)
+void MemArena::GrabSHMSegment(size_t size, const std::string& export_name)
 {
+  m_export_name = export_name;
 #ifdef _WIN32
-  const std::string name = "dolphin-emu." + std::to_string(GetCurrentProcessId());
+  const std::string name = export_name.empty() ?
+                               "dolphin-emu." + std::to_string(GetCurrentProcessId()) :
+                               export_name;
   hMemoryMapping = CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
                                      static_cast<DWORD>(size), UTF8ToTStr(name).c_str());
 #elif defined(ANDROID)
+  if (!export_name.empty())
+    WARN_LOG_FMT(MEMMAP, "Exporting the memory arena is not supported on Android");
+  m_export_name.clear();
   fd = AshmemCreateFileMapping(("dolphin-emu." + std::to_string(getpid())).c_str(), size);
   if (fd < 0)
   {
@@ -81,14 +87,24 @@ void MemArena::GrabSHMSegment(size_t size)
     return;
   }
 #else
-  const std::string file_name = "/dolphin-emu." + std::to_string(getpid());
+  const std::string file_name =
+      export_name.empty() ? "/dolphin-emu." + std::to_string(getpid()) : export_name;
   fd = shm_open(file_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd == -1 && errno == EEXIST)
+  {
+    // The name contains our pid, so this was left behind by a crashed process with the same pid.
+    WARN_LOG_FMT(MEMMAP, "Removing stale shared memory object {}", file_name);
+    shm_unlink(file_name.c_str());
+    fd = shm_open(file_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  }
   if (fd == -1)
   {
     ERROR_LOG_FMT(MEMMAP, "shm_open failed: {}", strerror(errno));
+    m_export_name.clear();
     return;
   }
-  shm_unlink(file_name.c_str());
+  if (export_name.empty())
+    shm_unlink(file_name.c_str());
   if (ftruncate(fd, size) < 0)
     ERROR_LOG_FMT(MEMMAP, "Failed to allocate low memory space");
 #endif
@@ -101,7 +117,12 @@ void MemArena::ReleaseSHMSegment()
   hMemoryMapping = 0;
 #else
   close(fd);
+#ifndef ANDROID
+  if (!m_export_name.empty())
+    shm_unlink(m_export_name.c_str());
+#endif
 #endif
+  m_export_name.clear();
 }
 
 void* MemArena::CreateView(s64 offset, size_t size, void* base)
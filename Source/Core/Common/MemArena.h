@@ -5,6 +5,7 @@
 #pragma once
 
 #include <cstddef>
+#include <string>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -21,7 +22,9 @@ namespace Common
 class MemArena
 {
 public:
-  void GrabSHMSegment(size_t size);
+  // If export_name is not empty, the segment is created under that name and stays accessible
+  // to other processes (e.g. for read-only mappings) until ReleaseSHMSegment is called.
+  void GrabSHMSegment(size_t size, const std::string& export_name = "");
   void ReleaseSHMSegment();
   void* CreateView(s64 offset, size_t size, void* base = nullptr);
   void ReleaseView(void* view, size_t size);
@@ -35,6 +38,7 @@ private:
 #else
   int fd;
 #endif
+  std::string m_export_name;
 };
 
 }  // namespace Common
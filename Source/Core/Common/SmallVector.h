@@ -0,0 +1,126 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace Common
+{
+// Vector that stores up to N elements inside of itself, and only allocates when it grows beyond
+// that. Meant for the short lists of pointers that are kept in many objects, where a std::vector
+// or a node based container would cost an allocation and a cache miss each.
+//
+// STL-look-a-like interface, add features as needed.
+template <typename T, size_t N>
+class SmallVector
+{
+  static_assert(std::is_trivially_copyable_v<T>, "SmallVector only holds trivially copyable types");
+
+public:
+  SmallVector() = default;
+  SmallVector(const SmallVector& other) { *this = other; }
+  SmallVector(SmallVector&& other) noexcept { *this = std::move(other); }
+
+  SmallVector& operator=(const SmallVector& other)
+  {
+    if (this == &other)
+      return *this;
+
+    m_size = 0;
+    reserve(other.m_size);
+    std::copy(other.begin(), other.end(), data());
+    m_size = other.m_size;
+    return *this;
+  }
+
+  SmallVector& operator=(SmallVector&& other) noexcept
+  {
+    if (this == &other)
+      return *this;
+
+    if (other.m_heap)
+    {
+      m_heap = std::move(other.m_heap);
+      m_capacity = other.m_capacity;
+    }
+    else
+    {
+      m_heap.reset();
+      m_capacity = N;
+      std::copy(other.begin(), other.end(), m_inline.begin());
+    }
+    m_size = other.m_size;
+
+    other.m_size = 0;
+    other.m_capacity = N;
+    return *this;
+  }
+
+  T* data() { return m_heap ? m_heap.get() : m_inline.data(); }
+  const T* data() const { return m_heap ? m_heap.get() : m_inline.data(); }
+
+  T* begin() { return data(); }
+  T* end() { return data() + m_size; }
+  const T* begin() const { return data(); }
+  const T* end() const { return data() + m_size; }
+
+  T& operator[](size_t i) { return data()[i]; }
+  const T& operator[](size_t i) const { return data()[i]; }
+  T& front() { return data()[0]; }
+  const T& front() const { return data()[0]; }
+  T& back() { return data()[m_size - 1]; }
+  const T& back() const { return data()[m_size - 1]; }
+
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+  size_t capacity() const { return m_capacity; }
+
+  void reserve(size_t capacity)
+  {
+    if (capacity > m_capacity)
+      Grow(capacity);
+  }
+
+  void push_back(T value)
+  {
+    if (m_size == m_capacity)
+      Grow(m_capacity * 2);
+    data()[m_size++] = value;
+  }
+
+  void pop_back() { --m_size; }
+
+  // Keeps the order of the remaining elements. Returns the element following the erased one.
+  T* erase(const T* pos)
+  {
+    T* const first = data() + (pos - data());
+    std::copy(first + 1, end(), first);
+    --m_size;
+    return first;
+  }
+
+  // Keeps the memory that was allocated
+  void clear() { m_size = 0; }
+
+private:
+  void Grow(size_t capacity)
+  {
+    auto heap = std::make_unique<T[]>(capacity);
+    std::copy(begin(), end(), heap.get());
+    m_heap = std::move(heap);
+    m_capacity = capacity;
+  }
+
+  std::array<T, N> m_inline{};
+  std::unique_ptr<T[]> m_heap;
+  size_t m_size = 0;
+  size_t m_capacity = N;
+};
+}  // namespace Common
@@ -0,0 +1,106 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Common/WorkerPool.h"
+
+#include <algorithm>
+
+#include "Common/Thread.h"
+
+namespace Common
+{
+WorkerPool::~WorkerPool()
+{
+  Stop();
+}
+
+void WorkerPool::Start(const std::string& name, size_t num_threads)
+{
+  Stop();
+
+  m_stop = false;
+  for (size_t i = 0; i < num_threads; ++i)
+    m_threads.emplace_back(&WorkerPool::ThreadLoop, this, name);
+}
+
+void WorkerPool::Stop()
+{
+  {
+    std::lock_guard lk(m_mutex);
+    m_stop = true;
+  }
+  m_work_cv.notify_all();
+
+  for (std::thread& thread : m_threads)
+    thread.join();
+  m_threads.clear();
+}
+
+void WorkerPool::ParallelFor(size_t count, const std::function<void(size_t)>& function)
+{
+  if (count <= 1 || m_threads.empty())
+  {
+    for (size_t i = 0; i < count; ++i)
+      function(i);
+    return;
+  }
+
+  Loop loop{&function, count};
+
+  std::unique_lock lk(m_mutex);
+  m_loops.push_back(&loop);
+  if (count - 1 < m_threads.size())
+  {
+    for (size_t i = 0; i < count - 1; ++i)
+      m_work_cv.notify_one();
+  }
+  else
+  {
+    m_work_cv.notify_all();
+  }
+
+  while (loop.next < loop.count)
+  {
+    const size_t i = TakeIteration(&loop);
+    lk.unlock();
+    function(i);
+    lk.lock();
+    --loop.running;
+  }
+
+  m_done_cv.wait(lk, [&loop] { return loop.running == 0; });
+}
+
+size_t WorkerPool::TakeIteration(Loop* loop)
+{
+  const size_t i = loop->next++;
+  ++loop->running;
+  if (loop->next == loop->count)
+    m_loops.erase(std::find(m_loops.begin(), m_loops.end(), loop));
+  return i;
+}
+
+void WorkerPool::ThreadLoop(std::string name)
+{
+  Common::SetCurrentThreadName(name.c_str());
+
+  std::unique_lock lk(m_mutex);
+  while (true)
+  {
+    m_work_cv.wait(lk, [this] { return m_stop || !m_loops.empty(); });
+    if (m_stop)
+      return;
+
+    Loop* const loop = m_loops.front();
+    const size_t i = TakeIteration(loop);
+    lk.unlock();
+    (*loop->function)(i);
+    lk.lock();
+
+    // The loop may only be touched until the thread that started it sees it finish
+    if (--loop->running == 0 && loop->next == loop->count)
+      m_done_cv.notify_all();
+  }
+}
+}  // namespace Common
@@ -0,0 +1,63 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A set of threads that split up the iterations of loops between them.
+//
+// The thread calling ParallelFor works on its own loop too, so loops can be started from several
+// threads at once, and from within other loops, without waiting on each other. Without any
+// worker threads, loops simply run on the calling thread.
+
+namespace Common
+{
+class WorkerPool
+{
+public:
+  WorkerPool() = default;
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  // Must not be called while loops are running
+  void Start(const std::string& name, size_t num_threads);
+  void Stop();
+
+  size_t NumThreads() const { return m_threads.size(); }
+
+  // Calls function(i) for every i in [0, count), and returns once all calls have returned
+  void ParallelFor(size_t count, const std::function<void(size_t)>& function);
+
+private:
+  struct Loop
+  {
+    const std::function<void(size_t)>* function;
+    size_t count;
+    size_t next = 0;
+    size_t running = 0;
+  };
+
+  void ThreadLoop(std::string name);
+  // Starts the next iteration of the loop, which must have one left. Called with m_mutex held.
+  size_t TakeIteration(Loop* loop);
+
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_work_cv;
+  std::condition_variable m_done_cv;
+  // Loops with iterations that haven't been started yet
+  std::deque<Loop*> m_loops;
+  bool m_stop = false;
+};
+}  // namespace Common
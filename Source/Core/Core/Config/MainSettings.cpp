@@ -99,6 +99,14 @@ const Info<bool> MAIN_OVERCLOCK_ENABLE{{System::Main, "Core", "OverclockEnable"}
 const Info<bool> MAIN_RAM_OVERRIDE_ENABLE{{System::Main, "Core", "RAMOverrideEnable"}, false};
 const Info<u32> MAIN_MEM1_SIZE{{System::Main, "Core", "MEM1Size"}, Memory::MEM1_SIZE_RETAIL};
 const Info<u32> MAIN_MEM2_SIZE{{System::Main, "Core", "MEM2Size"}, Memory::MEM2_SIZE_RETAIL};
+const Info<bool> MAIN_RAM_EXPORT{{System::Main, "Core", "RAMExport"}, false};
+const Info<u32> MAIN_REWIND_SECONDS{{System::Main, "Core", "RewindSeconds"}, 0};
+const Info<u32> MAIN_REWIND_INTERVAL{{System::Main, "Core", "RewindInterval"}, 30};
+const Info<u32> MAIN_REWIND_MAX_SIZE_MB{{System::Main, "Core", "RewindMaxSizeMB"}, 512};
+const Info<bool> MAIN_SAVESTATE_ZSTD{{System::Main, "Core", "SavestateZstd"}, true};
+const Info<bool> MAIN_JIT_WARMUP_CACHE{{System::Main, "Core", "JITWarmupCache"}, false};
+const Info<bool> MAIN_JIT_TIERED{{System::Main, "Core", "JITTiered"}, false};
+const Info<bool> MAIN_JIT_TRACES{{System::Main, "Core", "JITTraces"}, false};
 const Info<std::string> MAIN_GFX_BACKEND{{System::Main, "Core", "GFXBackend"},
                                          VideoBackendBase::GetDefaultBackendName()};
 const Info<std::string> MAIN_GPU_DETERMINISM_MODE{{System::Main, "Core", "GPUDeterminismMode"},
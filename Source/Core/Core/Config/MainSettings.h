@@ -80,6 +80,20 @@ extern const Info<bool> MAIN_OVERCLOCK_ENABLE;
 extern const Info<bool> MAIN_RAM_OVERRIDE_ENABLE;
 extern const Info<u32> MAIN_MEM1_SIZE;
 extern const Info<u32> MAIN_MEM2_SIZE;
+// Expose MEM1/MEM2 to other processes through shared memory, see RAMExport.
+extern const Info<bool> MAIN_RAM_EXPORT;
+// In-memory rewind buffer, see Rewind.h. 0 seconds disables it, the interval is in fields.
+extern const Info<u32> MAIN_REWIND_SECONDS;
+extern const Info<u32> MAIN_REWIND_INTERVAL;
+extern const Info<u32> MAIN_REWIND_MAX_SIZE_MB;
+// Save states with zstd on all cores instead of LZO, which older Dolphin builds can't load.
+extern const Info<bool> MAIN_SAVESTATE_ZSTD;
+// Remember the blocks of each game and compile them ahead of time, see JitWarmupCache.
+extern const Info<bool> MAIN_JIT_WARMUP_CACHE;
+// Run blocks in the cached interpreter until they are hot enough to be compiled by the JIT.
+extern const Info<bool> MAIN_JIT_TIERED;
+// In tiered mode, compile hot blocks as traces along the branches they usually take.
+extern const Info<bool> MAIN_JIT_TRACES;
 // Should really be part of System::GFX, but again, we're stuck with past mistakes.
 extern const Info<std::string> MAIN_GFX_BACKEND;
 extern const Info<std::string> MAIN_GPU_DETERMINISM_MODE;
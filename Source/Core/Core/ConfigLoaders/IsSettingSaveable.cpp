@@ -33,7 +33,7 @@ bool IsSettingSaveable(const Config::Location& config_location)
     }
   }
 
-  static constexpr std::array<const Config::Location*, 17> s_setting_saveable = {
+  static constexpr std::array<const Config::Location*, 25> s_setting_saveable = {
       // Main.Core
 
       &Config::MAIN_DEFAULT_ISO.location,
@@ -46,6 +46,14 @@ bool IsSettingSaveable(const Config::Location& config_location)
       &Config::MAIN_RAM_OVERRIDE_ENABLE.location,
       &Config::MAIN_MEM1_SIZE.location,
       &Config::MAIN_MEM2_SIZE.location,
+      &Config::MAIN_RAM_EXPORT.location,
+      &Config::MAIN_REWIND_SECONDS.location,
+      &Config::MAIN_REWIND_INTERVAL.location,
+      &Config::MAIN_REWIND_MAX_SIZE_MB.location,
+      &Config::MAIN_SAVESTATE_ZSTD.location,
+      &Config::MAIN_JIT_WARMUP_CACHE.location,
+      &Config::MAIN_JIT_TIERED.location,
+      &Config::MAIN_JIT_TRACES.location,
       &Config::MAIN_GFX_BACKEND.location,
       &Config::MAIN_ENABLE_SAVESTATES.location,
       &Config::MAIN_FALLBACK_REGION.location,
@@ -39,9 +39,12 @@
 #include "Core/Analytics.h"
 #include "Core/Boot/Boot.h"
 #include "Core/BootManager.h"
+#include "Core/Config/GraphicsSettings.h"
+#include "Core/Config/MainSettings.h"
 #include "Core/ConfigManager.h"
 #include "Core/CoreTiming.h"
 #include "Core/DSPEmulator.h"
+#include "Core/DolphinWatch.h"
 #include "Core/FifoPlayer/FifoPlayer.h"
 #include "Core/HLE/HLE.h"
 #include "Core/HW/CPU.h"
@@ -50,6 +53,7 @@
 #include "Core/HW/GCKeyboard.h"
 #include "Core/HW/GCPad.h"
 #include "Core/HW/HW.h"
+#include "Core/HW/Memmap.h"
 #include "Core/HW/SystemTimers.h"
 #include "Core/HW/VideoInterface.h"
 #include "Core/HW/Wiimote.h"
@@ -62,6 +66,8 @@
 #include "Core/PatchEngine.h"
 #include "Core/PowerPC/JitInterface.h"
 #include "Core/PowerPC/PowerPC.h"
+#include "Core/PowerPC/SamplingProfiler.h"
+#include "Core/Rewind.h"
 #include "Core/State.h"
 #include "Core/WiiRoot.h"
 
@@ -71,6 +77,7 @@
 
 #ifdef USE_MEMORYWATCHER
 #include "Core/MemoryWatcher.h"
+#include "Core/RAMExport.h"
 #endif
 
 #include "InputCommon/ControlReference/ControlReference.h"
@@ -113,6 +120,7 @@ static std::atomic<bool> s_stop_frame_step;
 
 #ifdef USE_MEMORYWATCHER
 static std::unique_ptr<MemoryWatcher> s_memory_watcher;
+static std::unique_ptr<RAMExport> s_ram_export;
 #endif
 
 struct HostJob
@@ -149,7 +157,12 @@ void OnFrameEnd()
 #ifdef USE_MEMORYWATCHER
   if (s_memory_watcher)
     s_memory_watcher->Step();
+  if (s_ram_export)
+    s_ram_export->Step();
 #endif
+  Rewind::OnFrameEnd();
+  SamplingProfiler::OnFrameEnd();
+  DolphinWatch::OnFrameEnd();
 }
 
 // Display messages and return values
@@ -338,12 +351,23 @@ static void CpuThread(const std::optional<std::string>& savestate_path, bool del
   static_cast<void>(IDCache::GetEnvForThread());
 #endif
 
-  if (_CoreParameter.bFastmem)
+  // Write tracking needs the exception handler for the video thread too. Besides textures, it lets
+  // incremental savestates skip the parts of RAM that weren't written to, so it's enabled whenever
+  // the handler is installed anyway. Nothing is write protected until someone asks for it.
+  const bool write_tracking =
+      EMM::HandlesAllThreads() &&
+      (_CoreParameter.bFastmem || Config::Get(Config::GFX_HACK_TEXTURE_WRITE_TRACKING));
+  if (_CoreParameter.bFastmem || write_tracking)
     EMM::InstallExceptionHandler();  // Let's run under memory watch
+  if (write_tracking)
+    Memory::EnableWriteTracking();
 
 #ifdef USE_MEMORYWATCHER
   s_memory_watcher = std::make_unique<MemoryWatcher>();
+  if (Config::Get(Config::MAIN_RAM_EXPORT))
+    s_ram_export = std::make_unique<RAMExport>();
 #endif
+  Rewind::Init();
 
   if (savestate_path)
   {
@@ -377,11 +401,16 @@ static void CpuThread(const std::optional<std::string>& savestate_path, bool del
 
 #ifdef USE_MEMORYWATCHER
   s_memory_watcher.reset();
+  s_ram_export.reset();
 #endif
+  Rewind::Shutdown();
+  SamplingProfiler::Shutdown();
 
   s_is_started = false;
 
-  if (_CoreParameter.bFastmem)
+  if (write_tracking)
+    Memory::DisableWriteTracking();
+  if (_CoreParameter.bFastmem || write_tracking)
     EMM::UninstallExceptionHandler();
 }
 
@@ -24,6 +24,7 @@
 
 using namespace Gen;
 
+#define LOCAL_OFFSETOF(t, m) reinterpret_cast<size_t>(&reinterpret_cast<t*>(0)->m)
 namespace DSP::JIT::x64
 {
 constexpr size_t COMPILED_CODE_SIZE = 2097152;
@@ -475,12 +476,12 @@ Gen::OpArg DSPEmitter::M_SDSP_external_interrupt_waiting()
 
 Gen::OpArg DSPEmitter::M_SDSP_r_st(size_t index)
 {
-  return MDisp(R15, static_cast<int>(offsetof(SDSP, r.st[index])));
+  return MDisp(R15, static_cast<int>(LOCAL_OFFSETOF(SDSP, r.st[index])));
 }
 
 Gen::OpArg DSPEmitter::M_SDSP_reg_stack_ptrs(size_t index)
 {
-  return MDisp(R15, static_cast<int>(offsetof(SDSP, reg_stack_ptrs[index])));
+  return MDisp(R15, static_cast<int>(LOCAL_OFFSETOF(SDSP, reg_stack_ptrs[index])));
 }
 
 }  // namespace DSP::JIT::x64
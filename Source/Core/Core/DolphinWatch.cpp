@@ -1,4 +1,6 @@
 
+#include <algorithm>
+#include <cstring>
 #include <thread>
 #include <atomic>
 
@@ -8,6 +10,10 @@
 #include "Core/HW/WiimoteEmu/WiimoteEmu.h"
 #include "InputCommon/InputConfig.h"
 #include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/SystemTimers.h"
+#include "Core/PowerPC/SamplingProfiler.h"
+#include "Core/Rewind.h"
 #include "Core/State.h"
 #include "Common/StringUtil.h"
 #include "Common/Thread.h"
@@ -26,14 +32,18 @@ namespace DolphinWatch {
 
   static sf::TcpListener server;
   static std::vector<Client> clients;
-  static char cbuf[1024];
+  static char cbuf[16 * 1024];
 
-  static std::thread thrMemory, thrRecv;
+  static std::thread thrRecv;
   static std::atomic<bool> running;
   static std::mutex client_mtx;
+  // the socket thread waits on this as well, so other threads can wake it up to flush output
+  static sf::UdpSocket wakeup;
 
   static std::tuple<int, u16> hijacksWii[NUM_WIIMOTES];
   static int hijacksGC[NUM_GCPADS];
+  // in emulated time, so that time spent paused or frame advancing doesn't count
+  static u64 lastHijackCheck;
 
   static std::locale locale = std::locale::classic();
 
@@ -87,13 +97,13 @@ namespace DolphinWatch {
     hijacksGC[i_pad] = HIJACK_TIMEOUT;
   }
 
-  void CheckHijacks() {
+  void CheckHijacks(u32 elapsed_ms) {
     if (!Core::IsRunning() || Core::GetState() != Core::State::Running) {
       return;
     }
     for (int i = 0; i < NUM_WIIMOTES; ++i) {
       if (std::get<0>(hijacksWii[i]) <= 0) continue;
-      std::get<0>(hijacksWii[i]) -= WATCH_TIMEOUT;
+      std::get<0>(hijacksWii[i]) -= static_cast<int>(elapsed_ms);
       if (std::get<0>(hijacksWii[i]) <= 0)
       {
         std::get<0>(hijacksWii[i]) = 0;
@@ -101,7 +111,7 @@ namespace DolphinWatch {
     }
     for (int i = 0; i < NUM_GCPADS; ++i) {
       if (hijacksGC[i] <= 0) continue;
-      hijacksGC[i] -= WATCH_TIMEOUT;
+      hijacksGC[i] -= static_cast<int>(elapsed_ms);
       if (hijacksGC[i] <= 0) {
         hijacksGC[i] = 0;
         GCPadStatus status;
@@ -117,21 +127,13 @@ namespace DolphinWatch {
 
     memset(hijacksWii, 0, sizeof(hijacksWii));
     memset(hijacksGC, 0, sizeof(hijacksGC));
+    lastHijackCheck = 0;
 
-    // thread to monitor memory
-    thrMemory = std::thread([]() {
-      while (running) {
-        {
-          if (!Memory::IsInitialized()) continue;
-          for (Client& client : clients) {
-            // check subscriptions
-            CheckSubs(client);
-          }
-        }
-        Common::SleepCurrentThread(WATCH_TIMEOUT);
-        CheckHijacks();
-      }
-    });
+    wakeup.setBlocking(false);
+    wakeup.bind(sf::Socket::AnyPort, sf::IpAddress::LocalHost);
+
+    // Subscriptions are not polled by a thread of their own anymore,
+    // they get evaluated by the CPU thread at every field boundary, see OnFrameEnd().
 
     // thread to handle incoming data.
     thrRecv = std::thread([]() {
@@ -141,18 +143,34 @@ namespace DolphinWatch {
     });
   }
 
+  static void WakeSocketThread() {
+    char c = 0;
+    wakeup.send(&c, 1, sf::IpAddress::LocalHost, wakeup.getLocalPort());
+  }
+
   void Poll() {
     sf::SocketSelector selector;
+    bool pending = false;
     {
       std::lock_guard<std::mutex> locked(client_mtx);
       selector.add(server);
+      selector.add(wakeup);
       for (Client& client : clients) {
         selector.add(*client.socket);
+        pending |= !client.txbuf.empty();
       }
     }
-    bool timeout = !selector.wait(sf::seconds(1));
+    // there's no waiting for a socket to become writable, so retry soon while output is pending
+    bool timeout = !selector.wait(pending ? sf::milliseconds(5) : sf::seconds(1));
     std::lock_guard<std::mutex> locked(client_mtx);
     if (!timeout) {
+      if (selector.isReady(wakeup)) {
+        char c;
+        size_t received;
+        sf::IpAddress sender;
+        unsigned short port;
+        while (wakeup.receive(&c, 1, received, sender, port) == sf::Socket::Done) {}
+      }
       for (Client& client : clients) {
         if (selector.isReady(*client.socket)) {
           // poll incoming data from clients, then process
@@ -163,12 +181,16 @@ namespace DolphinWatch {
         // poll for new clients
         auto socket = std::make_shared<sf::TcpSocket>();
         if (server.accept(*socket) == sf::Socket::Done) {
+          socket->setBlocking(false);
           DEBUG_LOG(DOLPHINWATCH, "Client connected: %s:%d", socket->getRemoteAddress().toString().c_str(), socket->getRemotePort());
           Client client(socket);
           clients.push_back(client);
         }
       }
     }
+    for (Client& client : clients) {
+      Flush(client);
+    }
     // remove disconnected clients
     auto new_end = remove_if(clients.begin(), clients.end(), [](Client& c) {
       return c.disconnected;
@@ -178,11 +200,36 @@ namespace DolphinWatch {
 
   void Shutdown() {
     running = false;
-    if (thrMemory.joinable()) thrMemory.join();
+    WakeSocketThread();
     if (thrRecv.joinable()) thrRecv.join();
+    wakeup.unbind();
     // socket closing is implicit for sfml library during destruction
   }
 
+  void OnFrameEnd() {
+    if (!running) return;
+
+    // the ticks go backwards when a savestate gets loaded or a new game boots, don't count that
+    u64 now = CoreTiming::GetTicks();
+    u64 elapsed = now > lastHijackCheck ? now - lastHijackCheck : 0;
+    CheckHijacks(static_cast<u32>(elapsed * 1000 / SystemTimers::GetTicksPerSecond()));
+    lastHijackCheck = now;
+
+    // never wait for the receive thread, it might be waiting for the CPU thread itself.
+    // the subscriptions simply get checked at the next field boundary then.
+    std::unique_lock<std::mutex> locked(client_mtx, std::try_to_lock);
+    if (!locked.owns_lock()) return;
+    for (Client& client : clients) {
+      CheckSubs(client);
+    }
+  }
+
+  // Whether reads of [addr, addr + size) resolve to RAM, see PowerPC::HostIsRAMAddress.
+  static bool IsRAMRange(u32 addr, u32 size) {
+    return size != 0 && u64(addr) + size <= 0x100000000 && PowerPC::HostIsRAMAddress(addr) &&
+           PowerPC::HostIsRAMAddress(addr + size - 1);
+  }
+
   void Process(Client& client, std::string& line) {
     // turn line into another stream
     std::istringstream parts(line);
@@ -285,7 +332,7 @@ namespace DolphinWatch {
       message.imbue(locale);
       message << "MEM " << addr << " " << val << std::endl;
       std::string messagestr = message.str();
-      Send(*(client.socket), messagestr);
+      Reply(client, messagestr);
 
     }
     else if (cmd == "SUBSCRIBE") {
@@ -333,6 +380,11 @@ namespace DolphinWatch {
         }
       }
 
+      if (Memory::IsInitialized() && !IsRAMRange(addr, size)) {
+        ERROR_LOG(DOLPHINWATCH, "Address range not in RAM, can't subscribe: %s", line.c_str());
+        return;
+      }
+
       client.subsMulti.push_back(SubscriptionMulti(addr, size));
 
     }
@@ -431,7 +483,7 @@ namespace DolphinWatch {
       }
       ProcessorInterface::ResetButton_Tap();
     }
-    else if (cmd == "SAVE") {
+    else if (cmd == "SAVE" || cmd == "SAVE_BASE" || cmd == "SAVE_INCREMENTAL") {
 
       if (!Core::IsRunning()) {
         ERROR_LOG(DOLPHINWATCH, "Core not running, can't save savestate: %s", line.c_str());
@@ -446,7 +498,9 @@ namespace DolphinWatch {
         return;
       }
 
-      State::SaveAs(file);
+      if (cmd == "SAVE_BASE") State::SaveBaseAs(file);
+      else if (cmd == "SAVE_INCREMENTAL") State::SaveIncrementalAs(file);
+      else State::SaveAs(file);
 
     }
     else if (cmd == "LOAD") {
@@ -472,6 +526,60 @@ namespace DolphinWatch {
       }
       SendFeedback(client, success);
 
+    }
+    else if (cmd == "REWIND") {
+
+      u32 steps;
+
+      if (!(parts >> steps) || steps == 0) {
+        ERROR_LOG(DOLPHINWATCH, "Invalid command line: %s", line.c_str());
+        SendFeedback(client, false);
+        return;
+      }
+
+      if (!Core::IsRunning()) {
+        ERROR_LOG(DOLPHINWATCH, "Core not running, can't rewind: %s", line.c_str());
+        SendFeedback(client, false);
+        return;
+      }
+
+      bool success = Rewind::RewindSteps(steps);
+      if (!success) {
+        ERROR_LOG(DOLPHINWATCH, "Could not rewind %u steps, %u states available", steps,
+                  Rewind::GetNumEntries());
+      }
+      SendFeedback(client, success);
+
+    }
+    else if (cmd == "PROFILE") {
+
+      u32 frequency = SamplingProfiler::DEFAULT_FREQUENCY;
+      parts >> frequency;
+
+      if (!SamplingProfiler::IsSupported()) {
+        ERROR_LOG(DOLPHINWATCH, "Sampling profiler not supported on this platform: %s", line.c_str());
+        return;
+      }
+      SamplingProfiler::Start(frequency);
+
+    }
+    else if (cmd == "PROFILE_WRITE") {
+
+      std::string file;
+      getline(parts, file);
+      file = StripSpaces(file);
+      if (file.empty() || file.find_first_of("?\"<>|") != std::string::npos) {
+        ERROR_LOG(DOLPHINWATCH, "Invalid filename for writing profile: %s", line.c_str());
+        SendFeedback(client, false);
+        return;
+      }
+
+      bool success = SamplingProfiler::StopAndWrite(file);
+      if (!success) {
+        ERROR_LOG(DOLPHINWATCH, "Could not write profile: %s", file.c_str());
+      }
+      SendFeedback(client, success);
+
     }
     else if (cmd == "VOLUME") {
 
@@ -507,6 +615,13 @@ namespace DolphinWatch {
       //BootManager::Stop();
       Core::Stop();
     }
+    else if (cmd == "BINARY") {
+      if (client.binary) return;
+      // acknowledge in text, everything after this line is binary, see BinaryOp
+      std::string messagestr = "BINARY\n";
+      Send(client, messagestr);
+      client.binary = true;
+    }
     else if (cmd == "INSERT") {
       std::string file;
       getline(parts, file);
@@ -533,96 +648,424 @@ namespace DolphinWatch {
     else msg << "FAIL";
     msg << std::endl;
     std::string messagestr = msg.str();
-    Send(*(client.socket), messagestr);
+    Reply(client, messagestr);
+  }
+
+  static void PutU8(std::string& out, u8 val) {
+    out.push_back(static_cast<char>(val));
+  }
+
+  static void PutU32(std::string& out, u32 val) {
+    PutU8(out, static_cast<u8>(val >> 24));
+    PutU8(out, static_cast<u8>(val >> 16));
+    PutU8(out, static_cast<u8>(val >> 8));
+    PutU8(out, static_cast<u8>(val));
+  }
+
+  static void PutValue(std::string& out, u32 width, u32 val) {
+    for (u32 i = width; i > 0; --i) {
+      PutU8(out, static_cast<u8>(val >> ((i - 1) * 8)));
+    }
+  }
+
+  static u32 ReadWidth(u32 addr, u32 width) {
+    switch (width) {
+    case 1: return PowerPC::HostRead_U8(addr);
+    case 2: return PowerPC::HostRead_U16(addr);
+    default: return PowerPC::HostRead_U32(addr);
+    }
+  }
+
+  static void WriteWidth(u32 addr, u32 width, u32 val) {
+    switch (width) {
+    case 1: PowerPC::HostWrite_U8(val, addr); break;
+    case 2: PowerPC::HostWrite_U16(val, addr); break;
+    default: PowerPC::HostWrite_U32(val, addr); break;
+    }
+  }
+
+  static bool IsValidWidth(u32 width) {
+    return width == 1 || width == 2 || width == 4;
   }
 
   void CheckSubs(Client& client) {
     if (!Memory::IsInitialized()) return;
+    if (client.subs.empty() && client.subsMulti.empty()) return;
+
+    // all changes of this field get batched into a single message
+    std::ostringstream message;
+    message.imbue(locale);
+    std::string payload, payloadMulti;
+    u32 count = 0, countMulti = 0;
+
     for (Subscription& sub : client.subs) {
-      u32 val = 0;
-            if (sub.mode == 8) val = PowerPC::HostRead_U8(sub.addr);
-            else if (sub.mode == 16) val = PowerPC::HostRead_U16(sub.addr);
-            else if (sub.mode == 32) val = PowerPC::HostRead_U32(sub.addr);
+      u32 val = ReadWidth(sub.addr, sub.mode / 8);
       if (val != sub.prev) {
         sub.prev = val;
-        std::ostringstream message;
-        message.imbue(locale);
-        message << "MEM " << sub.addr << " " << val << std::endl;
-        std::string messagestr = message.str();
-        Send(*(client.socket), messagestr);
+        if (client.binary) {
+          PutU32(payload, sub.addr);
+          PutU8(payload, static_cast<u8>(sub.mode / 8));
+          PutValue(payload, sub.mode / 8, val);
+        }
+        else {
+          message << "MEM " << sub.addr << " " << val << std::endl;
+        }
+        ++count;
       }
     }
+    std::vector<Patch> patches;
     for (SubscriptionMulti& sub : client.subsMulti) {
-      std::vector<u32> val(sub.size, 0);
-            for (u32 i = 0; i < sub.size; ++i) {
-                val.at(i) = PowerPC::HostRead_U8(sub.addr + i);
-            }
-      if (val != sub.prev) {
-        sub.prev = val;
-        std::ostringstream message;
-        message.imbue(locale);
+      if (!DiffBlock(sub, patches)) continue;
+      if (client.binary) {
+        PutU32(payloadMulti, sub.addr);
+        PutU32(payloadMulti, static_cast<u32>(patches.size()));
+        for (const Patch& patch : patches) {
+          PutU32(payloadMulti, patch.offset);
+          PutU32(payloadMulti, patch.size);
+          payloadMulti.append(reinterpret_cast<const char*>(sub.prev.data() + patch.offset), patch.size);
+        }
+      }
+      else {
         message << "MEM_MULTI " << sub.addr << " ";
-        for (size_t i = 0; i < val.size(); ++i) {
+        for (size_t i = 0; i < sub.prev.size(); ++i) {
           if (i != 0) message << " ";
-          message << val.at(i);
+          message << u32(sub.prev[i]);
         }
         message << std::endl;
-        std::string messagestr = message.str();
-        Send(*(client.socket), messagestr);
       }
+      ++countMulti;
+    }
+
+    if (count == 0 && countMulti == 0) return;
+    if (client.binary) {
+      std::string frame;
+      PutU32(frame, count);
+      frame += payload;
+      PutU32(frame, countMulti);
+      frame += payloadMulti;
+      SendBinary(client, BinaryOp::UPDATE, 0, frame);
+    }
+    else {
+      std::string messagestr = message.str();
+      Send(client, messagestr);
     }
   }
 
-  void PollClient(Client& client) {
-    // clean the client's buffer.
-    // By default a stringbuffer keeps already read data.
-    // a deque would do what we want, by not keeping that data, but then we would not have
-    // access to nice stream-features like <</>> operators and getline(), so we do this manually.
-
-    std::string s;
-    client.buf.clear(); // reset eol flag
-    getline(client.buf, s, '\0'); // read everything
-    client.buf.clear(); // reset eol flag again
-    client.buf.str(""); // empty stringstream
-    client.buf << s; // insert rest at beginning again
+  // Returns the host pointer backing the effective addresses [addr, addr + size) if they
+  // translate to one contiguous range completely within MEM1 or MEM2.
+  static const u8* GetRAMPointer(u32 addr, u32 size) {
+    if (size == 0 || u64(addr) + size > 0x100000000) return nullptr;
+    auto first = PowerPC::HostTranslateAddress(addr);
+    auto last = PowerPC::HostTranslateAddress(addr + size - 1);
+    if (!first.valid || !last.valid || last.address - first.address != size - 1) return nullptr;
+    // page table translations may map the pages in between anywhere
+    if (!first.from_bat && (addr >> 12) != ((addr + size - 1) >> 12)) return nullptr;
+
+    u32 phys = first.address;
+    if ((phys >> 28) == 0x0 && u64(phys) + size <= Memory::GetRamSizeReal())
+      return Memory::m_pRAM + phys;
+    if (Memory::m_pEXRAM && (phys >> 28) == 0x1 && u64(phys & 0x0FFFFFFF) + size <= Memory::GetExRamSizeReal())
+      return Memory::m_pEXRAM + (phys & 0x0FFFFFFF);
+    return nullptr;
+  }
 
-    size_t received = 0;
-    auto status = client.socket->receive(cbuf, sizeof(cbuf) - 1, received);
-    if ((status == sf::Socket::Disconnected) || (status == sf::Socket::Error)) {
-      DEBUG_LOG(DOLPHINWATCH, "Client disconnected: %s:%d", client.socket->getRemoteAddress().toString().c_str(), client.socket->getRemotePort());
-      client.disconnected = true;
+  bool DiffBlock(SubscriptionMulti& sub, std::vector<Patch>& patches) {
+    // compare in cache-line-sized chunks
+    constexpr u32 CHUNK_SIZE = 64;
+
+    patches.clear();
+    std::vector<u8> scratch;
+    const u8* cur = GetRAMPointer(sub.addr, sub.size);
+    if (!cur) {
+      // not plain RAM (or crossing the end of it), fall back to the slow path,
+      // which goes through the MMU for every byte
+      scratch.resize(sub.size);
+      for (u32 i = 0; i < sub.size; ++i) scratch[i] = PowerPC::HostRead_U8(sub.addr + i);
+      cur = scratch.data();
     }
-    else if (status == sf::Socket::Done) {
-      // add nullterminator, then add to client's buffer
-      cbuf[received] = '\0';
-      client.buf << cbuf;
-
-      // process the client's buffer
-      size_t posg = 0;
-      while (getline(client.buf, s)) {
-        if (client.buf.eof()) {
-          client.buf.clear();
-          client.buf.seekg(posg);
-          break;
-        }
-        posg = client.buf.tellg();
 
-        // Might contain semicolons to further split several commands.
-        // Doing that ensures that those commands are executed at once / in the same emulated frame.
-        // TODO not guaranteed in the same emulation frame, since we don't pause the emulation and it's concurrent
-        std::string s2;
+    u8* prev = sub.prev.data();
+    if (!sub.reported) {
+      sub.reported = true;
+      std::memcpy(prev, cur, sub.size);
+      patches.push_back({0, sub.size});
+      return true;
+    }
+
+    u32 offset = 0;
+    while (offset < sub.size) {
+      u32 len = std::min(CHUNK_SIZE, sub.size - offset);
+      if (std::memcmp(cur + offset, prev + offset, len) == 0) {
+        offset += len;
+        continue;
+      }
+      // extend the run over all directly following chunks that changed too
+      u32 end = offset + len;
+      while (end < sub.size) {
+        u32 next = std::min(CHUNK_SIZE, sub.size - end);
+        if (std::memcmp(cur + end, prev + end, next) == 0) break;
+        end += next;
+      }
+      // trim unchanged bytes at both ends of the run, the chunks containing them did change
+      u32 start = offset;
+      while (cur[start] == prev[start]) ++start;
+      u32 last = end - 1;
+      while (cur[last] == prev[last]) --last;
+      std::memcpy(prev + start, cur + start, last + 1 - start);
+      patches.push_back({start, last + 1 - start});
+      offset = end;
+    }
+    return !patches.empty();
+  }
+
+  // Bounds-checked big endian reader for binary request payloads.
+  class PayloadReader {
+  public:
+    PayloadReader(const u8* data, size_t size) : m_data(data), m_size(size) {}
+    bool Read(u32 width, u32* val) {
+      if (m_size - m_pos < width) return false;
+      *val = 0;
+      for (u32 i = 0; i < width; ++i) *val = (*val << 8) | m_data[m_pos++];
+      return true;
+    }
+    size_t Remaining() const { return m_size - m_pos; }
+  private:
+    const u8* m_data;
+    size_t m_size;
+    size_t m_pos = 0;
+  };
+
+  static void SendError(Client& client, BinaryOp op, const char* message) {
+    ERROR_LOG(DOLPHINWATCH, "Invalid binary request %u (seq %u): %s", static_cast<u32>(op), client.seq, message);
+    SendBinary(client, BinaryOp::ERROR, client.seq, message);
+  }
+
+  void ProcessBinary(Client& client, BinaryOp op, const u8* data, size_t size) {
+    PayloadReader reader(data, size);
+    std::string reply;
+    u32 count;
+
+    if (op == BinaryOp::TEXT) {
+      client.textReply.clear();
+      std::string text(reinterpret_cast<const char*>(data), size);
+      std::istringstream lines(text);
+      lines.imbue(locale);
+      std::string s;
+      while (getline(lines, s)) {
         std::istringstream subcmds(s);
         subcmds.imbue(locale);
+        std::string s2;
         while (getline(subcmds, s2, ';')) {
-                  if (!s2.empty()) Process(client, s2);
+          if (!s2.empty()) Process(client, s2);
+        }
+      }
+      SendBinary(client, op, client.seq, client.textReply);
+      client.textReply.clear();
+      return;
+    }
+
+    if (op != BinaryOp::READ && op != BinaryOp::WRITE && op != BinaryOp::SUBSCRIBE && op != BinaryOp::UNSUBSCRIBE) {
+      SendError(client, op, "unknown opcode");
+      return;
+    }
+    if (!reader.Read(4, &count)) {
+      SendError(client, op, "missing count");
+      return;
+    }
+    if ((op == BinaryOp::READ || op == BinaryOp::WRITE) && !Memory::IsInitialized()) {
+      SendError(client, op, "PowerPC memory not initialized");
+      return;
+    }
+
+    if (op == BinaryOp::READ) {
+      // validate everything first, so a malformed request doesn't produce a partial reply
+      if (reader.Remaining() != size_t(count) * 5) {
+        SendError(client, op, "size mismatch");
+        return;
+      }
+      PutU32(reply, count);
+      for (u32 i = 0; i < count; ++i) {
+        u32 addr = 0, width = 0;
+        if (!reader.Read(4, &addr) || !reader.Read(1, &width)) {
+          SendError(client, op, "truncated request");
+          return;
+        }
+        if (!IsValidWidth(width)) {
+          SendError(client, op, "width must be 1, 2 or 4");
+          return;
+        }
+        PutValue(reply, width, ReadWidth(addr, width));
+      }
+    }
+    else if (op == BinaryOp::WRITE) {
+      std::vector<std::tuple<u32, u32, u32>> writes;
+      writes.reserve(std::min<size_t>(count, reader.Remaining() / 6));
+      for (u32 i = 0; i < count; ++i) {
+        u32 addr, width, val;
+        if (!reader.Read(4, &addr) || !reader.Read(1, &width)) {
+          SendError(client, op, "truncated request");
+          return;
+        }
+        if (!IsValidWidth(width)) {
+          SendError(client, op, "width must be 1, 2 or 4");
+          return;
+        }
+        if (!reader.Read(width, &val)) {
+          SendError(client, op, "truncated request");
+          return;
+        }
+        writes.emplace_back(addr, width, val);
+      }
+      for (const auto& write : writes) {
+        WriteWidth(std::get<0>(write), std::get<1>(write), std::get<2>(write));
+      }
+    }
+    else if (op == BinaryOp::SUBSCRIBE) {
+      if (reader.Remaining() != size_t(count) * 5) {
+        SendError(client, op, "size mismatch");
+        return;
+      }
+      for (u32 i = 0; i < count; ++i) {
+        u32 addr = 0, width = 0;
+        if (!reader.Read(4, &addr) || !reader.Read(1, &width)) {
+          SendError(client, op, "truncated request");
+          return;
+        }
+        if (!IsValidWidth(width)) {
+          SendError(client, op, "width must be 1, 2 or 4");
+          return;
+        }
+        auto it = std::find_if(client.subs.begin(), client.subs.end(), [addr](const Subscription& sub) {
+          return sub.addr == addr;
+        });
+        if (it == client.subs.end()) client.subs.push_back(Subscription(addr, width * 8));
+      }
+    }
+    else if (op == BinaryOp::UNSUBSCRIBE) {
+      if (reader.Remaining() != size_t(count) * 4) {
+        SendError(client, op, "size mismatch");
+        return;
+      }
+      for (u32 i = 0; i < count; ++i) {
+        u32 addr = 0;
+        if (!reader.Read(4, &addr)) {
+          SendError(client, op, "truncated request");
+          return;
         }
+        auto new_end = std::remove_if(client.subs.begin(), client.subs.end(), [addr](const Subscription& sub) {
+          return sub.addr == addr;
+        });
+        client.subs.erase(new_end, client.subs.end());
       }
     }
+
+    SendBinary(client, op, client.seq, reply);
+  }
+
+  void PollClientBinary(Client& client) {
+    // process all complete frames, keep a trailing partial one for the next receive
+    size_t pos = 0;
+    std::vector<u8>& rx = client.rxbuf;
+    while (rx.size() - pos >= 4) {
+      u32 size = (u32(rx[pos]) << 24) | (u32(rx[pos + 1]) << 16) | (u32(rx[pos + 2]) << 8) | rx[pos + 3];
+      if (size < 5 || size > BINARY_MAX_FRAME_SIZE) {
+        ERROR_LOG(DOLPHINWATCH, "Invalid binary frame size %u, disconnecting client", size);
+        client.disconnected = true;
+        rx.clear();
+        return;
+      }
+      if (rx.size() - pos - 4 < size) break;
+      const u8* frame = rx.data() + pos + 4;
+      client.seq = (u32(frame[0]) << 24) | (u32(frame[1]) << 16) | (u32(frame[2]) << 8) | frame[3];
+      ProcessBinary(client, static_cast<BinaryOp>(frame[4]), frame + 5, size - 5);
+      pos += 4 + size_t(size);
+    }
+    rx.erase(rx.begin(), rx.begin() + pos);
+  }
+
+  void PollClientText(Client& client) {
+    // process all complete lines, keep a trailing partial one for the next receive
+    size_t pos = 0;
+    std::vector<u8>& rx = client.rxbuf;
+    while (!client.binary) {
+      auto eol = std::find(rx.begin() + pos, rx.end(), '\n');
+      if (eol == rx.end()) break;
+      std::string s(rx.begin() + pos, eol);
+      pos = eol - rx.begin() + 1;
+
+      // Might contain semicolons to further split several commands.
+      // Doing that ensures that those commands are executed at once / in the same emulated frame.
+      // TODO not guaranteed in the same emulation frame, since we don't pause the emulation and it's concurrent
+      std::string s2;
+      std::istringstream subcmds(s);
+      subcmds.imbue(locale);
+      while (getline(subcmds, s2, ';')) {
+        if (!s2.empty()) Process(client, s2);
+        if (client.binary) break;
+      }
+    }
+    // after switching to the binary protocol, whatever else was received already is binary
+    rx.erase(rx.begin(), rx.begin() + pos);
+  }
+
+  void PollClient(Client& client) {
+    size_t received = 0;
+    auto status = client.socket->receive(cbuf, sizeof(cbuf), received);
+    if ((status == sf::Socket::Disconnected) || (status == sf::Socket::Error)) {
+      DEBUG_LOG(DOLPHINWATCH, "Client disconnected: %s:%d", client.socket->getRemoteAddress().toString().c_str(), client.socket->getRemotePort());
+      client.disconnected = true;
+    }
+    else if (status == sf::Socket::Done) {
+      // raw bytes, binary frames may contain any byte including 0
+      client.rxbuf.insert(client.rxbuf.end(), cbuf, cbuf + received);
+      if (!client.binary) PollClientText(client);
+      if (client.binary) PollClientBinary(client);
+    }
   }
 
-  void Send(sf::TcpSocket& socket, std::string& message) {
+  void Send(Client& client, const std::string& message) {
     DEBUG_LOG(DOLPHINWATCH, "Sending: %s", message.c_str());
-    socket.send(message.c_str(), message.size());
+    if (client.disconnected) return;
+    // never block the caller, which is the CPU thread for subscription updates
+    if (client.txbuf.size() + message.size() > MAX_PENDING_OUTPUT) {
+      ERROR_LOG(DOLPHINWATCH, "Client doesn't read its output, disconnecting: %s:%d", client.socket->getRemoteAddress().toString().c_str(), client.socket->getRemotePort());
+      client.disconnected = true;
+      client.txbuf.clear();
+      return;
+    }
+    client.txbuf += message;
+    WakeSocketThread();
+  }
+
+  void Flush(Client& client) {
+    while (!client.txbuf.empty() && !client.disconnected) {
+      size_t sent = 0;
+      auto status = client.socket->send(client.txbuf.data(), client.txbuf.size(), sent);
+      client.txbuf.erase(0, sent);
+      if ((status == sf::Socket::Disconnected) || (status == sf::Socket::Error)) {
+        client.disconnected = true;
+      }
+      else if (status != sf::Socket::Done) {
+        // the socket's send buffer is full, try again later
+        break;
+      }
+    }
+  }
+
+  void SendBinary(Client& client, BinaryOp op, u32 seq, const std::string& payload) {
+    std::string frame;
+    frame.reserve(9 + payload.size());
+    PutU32(frame, static_cast<u32>(payload.size() + 5));
+    PutU32(frame, seq);
+    PutU8(frame, static_cast<u8>(op));
+    frame += payload;
+    Send(client, frame);
+  }
+
+  void Reply(Client& client, std::string& message) {
+    // binary clients get the text wrapped into the reply to their TEXT request
+    if (client.binary) client.textReply += message;
+    else Send(client, message);
   }
 
   void SetVolume(int v) {
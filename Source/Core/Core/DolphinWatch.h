@@ -9,8 +9,11 @@
 #include "Core/HW/GCPadEmu.h"
 #include "Core/HW/GCPad.h"
 
-#define WATCH_TIMEOUT 50 // update 20 times per second.
 #define HIJACK_TIMEOUT 500
+// Upper bound for a single binary frame, larger frames are treated as a protocol error.
+#define BINARY_MAX_FRAME_SIZE (16 * 1024 * 1024)
+// Upper bound for the output queued for a client that doesn't read it, the client gets disconnected.
+#define MAX_PENDING_OUTPUT (64 * 1024 * 1024)
 #define NUM_WIIMOTES 4
 #define NUM_GCPADS 4
 
@@ -18,6 +21,30 @@ namespace DolphinWatch {
 
   typedef uint32_t u32;
 
+  // Opcodes of the binary protocol, which a client can switch to by sending "BINARY".
+  // Every frame is <u32 size> <u32 seq> <u8 op> <payload>, with size counting all bytes
+  // following the size field. All integers are big endian, like the emulated memory.
+  // Each request is answered by exactly one frame carrying the same seq and op (or ERROR),
+  // so clients can pipeline requests without waiting for replies.
+  enum class BinaryOp : u8 {
+    // <u32 count> count * (<u32 addr> <u8 width>) -> <u32 count> count * <value[width]>
+    READ = 0x01,
+    // <u32 count> count * (<u32 addr> <u8 width> <value[width]>) -> empty reply
+    WRITE = 0x02,
+    // <u32 count> count * (<u32 addr> <u8 width>) -> empty reply
+    SUBSCRIBE = 0x03,
+    // <u32 count> count * <u32 addr> -> empty reply
+    UNSUBSCRIBE = 0x04,
+    // text commands (as in the text protocol) -> text the commands would have answered
+    TEXT = 0x05,
+    // server push with seq 0, once per field if any subscription changed:
+    // <u32 count> count * (<u32 addr> <u8 width> <value[width]>)
+    // <u32 count> count * (<u32 addr> <u32 patches> patches * (<u32 offset> <u32 size> <bytes[size]>))
+    UPDATE = 0x80,
+    // reply to a malformed request: error message as text
+    ERROR = 0xff,
+  };
+
   struct Subscription {
     u32 addr;
     u32 mode;
@@ -35,15 +62,17 @@ namespace DolphinWatch {
   struct SubscriptionMulti {
     u32 addr;
     u32 size;
-    std::vector<u32> prev;
-    SubscriptionMulti(u32 val, u32 len) : addr(val), size(len), prev(len, 0xdeadbeef) {}
+    // last reported contents, only valid after the first report
+    std::vector<u8> prev;
+    bool reported = false;
+    SubscriptionMulti(u32 val, u32 len) : addr(val), size(len), prev(len, 0) {}
     bool operator==(const SubscriptionMulti& other) const { return other.addr == addr && other.size == size; }
-    SubscriptionMulti& operator=(const SubscriptionMulti& other) {
-      addr = other.addr;
-      size = other.size;
-      prev = other.prev;
-      return *this;
-    }
+  };
+
+  // A run of changed bytes within a SubscriptionMulti, relative to its address.
+  struct Patch {
+    u32 offset;
+    u32 size;
   };
 
   struct Client {
@@ -51,38 +80,41 @@ namespace DolphinWatch {
     std::vector<Subscription> subs;
     std::vector<SubscriptionMulti> subsMulti;
     bool disconnected = false;
-    std::stringstream buf;
+    // received bytes not processed yet, a partial line or binary frame
+    std::vector<u8> rxbuf;
+    // binary protocol state, see BinaryOp
+    bool binary = false;
+    u32 seq = 0;
+    std::string textReply;
+    // output not sent yet, flushed by the socket thread without blocking
+    std::string txbuf;
     // some stl algorithm support
     bool operator==(const Client& other) const {
       return socket->getRemoteAddress() == other.socket->getRemoteAddress()
       && socket->getRemotePort() == other.socket->getRemotePort();
     }
     Client(std::shared_ptr<sf::TcpSocket> sock) : socket(sock) {}
-    // explicit copy semantics for smart pointer socket and stringstream
-    Client(const Client& other) {
-      socket = other.socket;
-      buf = std::stringstream();
-      buf << other.buf.rdbuf();
-    }
-    // operator= gets implicitly deleted with copy operator overwritten
-    Client& operator=(const Client& other) {
-      socket = other.socket;
-      subs = other.subs;
-      subsMulti = other.subsMulti;
-      disconnected = other.disconnected;
-      buf = std::stringstream();
-      buf << other.buf.rdbuf();
-      return *this;
-    }
   };
 
   void Init(unsigned short port);
   void Shutdown();
+  // Called on the CPU thread at every emulated field boundary (see Core::OnFrameEnd).
+  // Evaluates all subscriptions and sends at most one batched message per client.
+  void OnFrameEnd();
   void Process(Client& client, std::string& line);
+  void ProcessBinary(Client& client, BinaryOp op, const u8* data, size_t size);
   void CheckSubs(Client& client);
+  bool DiffBlock(SubscriptionMulti& sub, std::vector<Patch>& patches);
   void PollClient(Client& client);
+  void PollClientText(Client& client);
+  void PollClientBinary(Client& client);
   void Poll();
-  void Send(sf::TcpSocket& socket, std::string& message);
+  // Queues a message for the client, see Flush.
+  void Send(Client& client, const std::string& message);
+  // Sends as much of the queued output as the socket takes without blocking.
+  void Flush(Client& client);
+  void SendBinary(Client& client, BinaryOp op, u32 seq, const std::string& payload);
+  void Reply(Client& client, std::string& message);
   void SetVolume(int v);
   void SendFeedback(Client& client, bool success);
 
@@ -91,6 +123,6 @@ namespace DolphinWatch {
   void PerformWiiInputManip(WiimoteCommon::DataReportBuilder& rpt, int controller_id, int ext,
                             const WiimoteEmu::EncryptionKey& key);
   void SendButtonsGC(int i_pad, u16 _buttons, float stickX, float stickY, float substickX, float substickY);
-  void CheckHijacks();
+  void CheckHijacks(u32 elapsed_ms);
 
 }
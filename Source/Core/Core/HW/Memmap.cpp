@@ -11,13 +11,17 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstring>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "Common/ChunkFile.h"
 #include "Common/CommonTypes.h"
 #include "Common/Logging/Log.h"
 #include "Common/MemArena.h"
+#include "Common/MemoryUtil.h"
 #include "Common/Swap.h"
 #include "Core/Config/MainSettings.h"
 #include "Core/ConfigManager.h"
@@ -33,6 +37,9 @@
 #include "Core/HW/WII_IPC.h"
 #include "Core/PowerPC/JitCommon/JitBase.h"
 #include "Core/PowerPC/PowerPC.h"
+#ifdef USE_MEMORYWATCHER
+#include "Core/RAMExport.h"
+#endif
 #include "VideoCommon/CommandProcessor.h"
 #include "VideoCommon/PixelEngine.h"
 
@@ -180,6 +187,7 @@ struct LogicalMemoryView
 {
   void* mapped_pointer;
   u32 mapped_size;
+  u32 shm_position;
 };
 
 // Dolphin allocates memory to represent four regions:
@@ -226,6 +234,47 @@ static std::array<PhysicalMemoryRegion, 4> physical_regions;
 
 static std::vector<LogicalMemoryView> logical_mapped_entries;
 
+// Write tracking state. Everything except s_write_tracking_enabled is only accessed with
+// s_write_tracking_lock held, which is a spin lock since the exception handler takes it too.
+static std::atomic_flag s_write_tracking_lock = ATOMIC_FLAG_INIT;
+static std::atomic<bool> s_write_tracking_enabled{false};
+static size_t s_page_size;
+static u64 s_write_count = 0;
+static u32 s_host_writes = 0;
+// By host page of the shared memory segment
+static std::vector<u64> s_page_last_write;
+static std::vector<bool> s_page_protected;
+
+namespace
+{
+class WriteTrackingLock
+{
+public:
+  WriteTrackingLock()
+  {
+    while (s_write_tracking_lock.test_and_set(std::memory_order_acquire))
+    {
+    }
+  }
+  ~WriteTrackingLock() { s_write_tracking_lock.clear(std::memory_order_release); }
+
+  WriteTrackingLock(const WriteTrackingLock&) = delete;
+  WriteTrackingLock& operator=(const WriteTrackingLock&) = delete;
+};
+}  // namespace
+
+static void ApplyWriteTracking(u8* view, u32 shm_position, u32 size);
+
+u32 GetRamSHMPosition()
+{
+  return physical_regions[0].shm_position;
+}
+
+u32 GetExRamSHMPosition()
+{
+  return physical_regions[3].shm_position;
+}
+
 static u32 GetFlags()
 {
   bool wii = SConfig::GetInstance().bWii;
@@ -287,7 +336,12 @@ void Init()
     region.shm_position = mem_size;
     mem_size += region.size;
   }
-  g_arena.GrabSHMSegment(mem_size);
+  std::string export_name;
+#ifdef USE_MEMORYWATCHER
+  if (Config::Get(Config::MAIN_RAM_EXPORT))
+    export_name = RAMExport::GetArenaName();
+#endif
+  g_arena.GrabSHMSegment(mem_size, export_name);
 
   // Create an anonymous view of the physical memory
   for (PhysicalMemoryRegion& region : physical_regions)
@@ -317,6 +371,7 @@ void Init()
 
 bool InitFastmemArena()
 {
+  WriteTrackingLock lock;
   u32 flags = GetFlags();
   physical_base = Common::MemArena::FindMemoryBase();
 
@@ -335,6 +390,7 @@ bool InitFastmemArena()
     {
       return false;
     }
+    ApplyWriteTracking(view, region.shm_position, region.size);
   }
 
 #ifndef _ARCH_32
@@ -350,6 +406,7 @@ void UpdateLogicalMemory(const PowerPC::BatTable& dbat_table)
   if (!is_fastmem_arena_initialized)
     return;
 
+  WriteTrackingLock lock;
   for (auto& entry : logical_mapped_entries)
   {
     g_arena.ReleaseView(entry.mapped_pointer, entry.mapped_size);
@@ -382,7 +439,8 @@ void UpdateLogicalMemory(const PowerPC::BatTable& dbat_table)
             PanicAlertFmt("MemoryMap_Setup: Failed finding a memory base.");
             exit(0);
           }
-          logical_mapped_entries.push_back({mapped_pointer, mapped_size});
+          ApplyWriteTracking(static_cast<u8*>(mapped_pointer), position, mapped_size);
+          logical_mapped_entries.push_back({mapped_pointer, mapped_size, position});
         }
       }
     }
@@ -391,20 +449,23 @@ void UpdateLogicalMemory(const PowerPC::BatTable& dbat_table)
 
 void DoState(PointerWrap& p)
 {
-  bool wii = SConfig::GetInstance().bWii;
-  p.DoArray(m_pRAM, GetRamSize());
   p.DoArray(m_pL1Cache, GetL1CacheSize());
-  p.DoMarker("Memory RAM");
+  p.DoMarker("Memory L1Cache");
   if (m_pFakeVMEM)
     p.DoArray(m_pFakeVMEM, GetFakeVMemSize());
   p.DoMarker("Memory FakeVMEM");
-  if (wii)
+}
+
+void DoRAMState(PointerWrap& p)
+{
+  p.DoArray(m_pRAM, GetRamSize());
+  if (SConfig::GetInstance().bWii)
     p.DoArray(m_pEXRAM, GetExRamSize());
-  p.DoMarker("Memory EXRAM");
 }
 
 void Shutdown()
 {
+  DisableWriteTracking();
   ShutdownFastmemArena();
 
   m_IsInitialized = false;
@@ -426,6 +487,7 @@ void ShutdownFastmemArena()
   if (!is_fastmem_arena_initialized)
     return;
 
+  WriteTrackingLock lock;
   u32 flags = GetFlags();
   for (PhysicalMemoryRegion& region : physical_regions)
   {
@@ -460,6 +522,228 @@ void Clear()
     memset(m_pEXRAM, 0, GetExRamSize());
 }
 
+// Calls f(view, shm_position, size) for every view of the shared memory segment
+template <typename F>
+static void ForEachView(F f)
+{
+  for (const PhysicalMemoryRegion& region : physical_regions)
+  {
+    if (!region.out_pointer || !*region.out_pointer)
+      continue;
+
+    f(*region.out_pointer, region.shm_position, region.size);
+    if (is_fastmem_arena_initialized)
+      f(physical_base + region.physical_address, region.shm_position, region.size);
+  }
+
+  for (const LogicalMemoryView& entry : logical_mapped_entries)
+    f(static_cast<u8*>(entry.mapped_pointer), entry.shm_position, entry.mapped_size);
+}
+
+// Calls f(first_page, end_page) for every run of pages in [first_page, end_page) that are
+// write protected if is_protected is true, or writable otherwise
+template <typename F>
+static void ForEachRun(size_t first_page, size_t end_page, bool is_protected, F f)
+{
+  size_t page = first_page;
+  while (page < end_page)
+  {
+    if (s_page_protected[page] != is_protected)
+    {
+      ++page;
+      continue;
+    }
+
+    const size_t run_start = page;
+    while (page < end_page && s_page_protected[page] == is_protected)
+      ++page;
+    f(run_start, page);
+  }
+}
+
+static void SetViewProtection(u8* view, u32 shm_position, u32 size, size_t first_page,
+                              size_t end_page, bool write_protect)
+{
+  const size_t start = std::max<size_t>(first_page * s_page_size, shm_position);
+  const size_t end = std::min<size_t>(end_page * s_page_size, size_t(shm_position) + size);
+  if (start >= end)
+    return;
+
+  u8* const pointer = view + (start - shm_position);
+  if (write_protect)
+    Common::WriteProtectMemory(pointer, end - start);
+  else
+    Common::UnWriteProtectMemory(pointer, end - start);
+}
+
+static void SetPageProtection(size_t first_page, size_t end_page, bool write_protect)
+{
+  ForEachView([&](u8* view, u32 shm_position, u32 size) {
+    SetViewProtection(view, shm_position, size, first_page, end_page, write_protect);
+  });
+  for (size_t page = first_page; page < end_page; ++page)
+    s_page_protected[page] = write_protect;
+}
+
+// Makes the pages writable, counting it as a write to the ones that were protected
+static void UnprotectPages(size_t first_page, size_t end_page)
+{
+  ++s_write_count;
+  ForEachRun(first_page, end_page, true, [](size_t run_start, size_t run_end) {
+    SetPageProtection(run_start, run_end, false);
+    std::fill(s_page_last_write.begin() + run_start, s_page_last_write.begin() + run_end,
+              s_write_count);
+  });
+}
+
+// Protects the pages of a newly created view that are protected in the other views
+static void ApplyWriteTracking(u8* view, u32 shm_position, u32 size)
+{
+  if (!s_write_tracking_enabled)
+    return;
+
+  const size_t first_page = shm_position / s_page_size;
+  const size_t end_page = (size_t(shm_position) + size + s_page_size - 1) / s_page_size;
+  ForEachRun(first_page, end_page, true, [&](size_t run_start, size_t run_end) {
+    SetViewProtection(view, shm_position, size, run_start, run_end, true);
+  });
+}
+
+// Returns the pages of the shared memory segment backing the physical range
+static std::optional<std::pair<size_t, size_t>> GetTrackedPages(u32 address, u32 size)
+{
+  if (size == 0)
+    return std::nullopt;
+
+  address &= 0x3FFFFFFF;
+  size_t shm_start;
+  if (u64(address) + size <= GetRamSizeReal())
+  {
+    shm_start = physical_regions[0].shm_position + address;
+  }
+  else if (m_pEXRAM && (address >> 28) == 0x1 &&
+           u64(address & 0x0fffffff) + size <= GetExRamSizeReal())
+  {
+    shm_start = physical_regions[3].shm_position + (address & 0x0fffffff);
+  }
+  else
+  {
+    return std::nullopt;
+  }
+
+  return std::make_pair(shm_start / s_page_size, (shm_start + size - 1) / s_page_size + 1);
+}
+
+void EnableWriteTracking()
+{
+  WriteTrackingLock lock;
+  if (s_write_tracking_enabled)
+    return;
+
+  size_t arena_size = 0;
+  for (const PhysicalMemoryRegion& region : physical_regions)
+  {
+    if (region.out_pointer && *region.out_pointer)
+      arena_size = std::max(arena_size, size_t(region.shm_position) + region.size);
+  }
+
+  s_page_size = Common::MemPageSize();
+  const size_t page_count = (arena_size + s_page_size - 1) / s_page_size;
+  // Counts from before this was enabled have to be seen as outdated
+  ++s_write_count;
+  s_page_last_write.assign(page_count, s_write_count);
+  s_page_protected.assign(page_count, false);
+  s_write_tracking_enabled = true;
+}
+
+void DisableWriteTracking()
+{
+  WriteTrackingLock lock;
+  if (!s_write_tracking_enabled)
+    return;
+
+  UnprotectPages(0, s_page_protected.size());
+  s_page_last_write.clear();
+  s_page_protected.clear();
+  s_write_tracking_enabled = false;
+}
+
+std::optional<u64> TrackWrites(u32 address, u32 size)
+{
+  if (!s_write_tracking_enabled)
+    return std::nullopt;
+
+  WriteTrackingLock lock;
+  if (!s_write_tracking_enabled || s_host_writes != 0)
+    return std::nullopt;
+
+  const auto pages = GetTrackedPages(address, size);
+  if (!pages)
+    return std::nullopt;
+
+  ForEachRun(pages->first, pages->second, false, [](size_t run_start, size_t run_end) {
+    SetPageProtection(run_start, run_end, true);
+  });
+  return s_write_count;
+}
+
+bool WrittenSince(u32 address, u32 size, u64 write_count)
+{
+  WriteTrackingLock lock;
+  if (!s_write_tracking_enabled)
+    return true;
+
+  const auto pages = GetTrackedPages(address, size);
+  if (!pages)
+    return true;
+
+  // Pages only become writable through UnprotectPages, so checking the counts is enough
+  return std::any_of(s_page_last_write.begin() + pages->first,
+                     s_page_last_write.begin() + pages->second,
+                     [write_count](u64 last_write) { return last_write > write_count; });
+}
+
+bool HandleWriteFault(uintptr_t host_address)
+{
+  if (!s_write_tracking_enabled)
+    return false;
+
+  WriteTrackingLock lock;
+  if (!s_write_tracking_enabled)
+    return false;
+
+  std::optional<size_t> shm_offset;
+  ForEachView([&](u8* view, u32 shm_position, u32 size) {
+    const uintptr_t view_start = reinterpret_cast<uintptr_t>(view);
+    if (host_address >= view_start && host_address < view_start + size)
+      shm_offset = shm_position + (host_address - view_start);
+  });
+  if (!shm_offset)
+    return false;
+
+  // If the page is already writable, another thread got to it first, and the write can be retried
+  const size_t page = *shm_offset / s_page_size;
+  UnprotectPages(page, page + 1);
+  return true;
+}
+
+ScopedHostWrite::ScopedHostWrite(u32 address, u32 size)
+{
+  WriteTrackingLock lock;
+  ++s_host_writes;
+  if (!s_write_tracking_enabled)
+    return;
+
+  if (const auto pages = GetTrackedPages(address, size))
+    UnprotectPages(pages->first, pages->second);
+}
+
+ScopedHostWrite::~ScopedHostWrite()
+{
+  WriteTrackingLock lock;
+  --s_host_writes;
+}
+
 static inline u8* GetPointerForRange(u32 address, size_t size)
 {
   // Make sure we don't have a range spanning 2 separate banks
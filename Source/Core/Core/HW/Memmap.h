@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 
 #include "Common/CommonTypes.h"
@@ -48,6 +50,9 @@ u32 GetIOSize();
 u32 GetExRamSizeReal();
 u32 GetExRamSize();
 u32 GetExRamMask();
+// Position of MEM1/MEM2 within the shared memory segment backing the memory arena
+u32 GetRamSHMPosition();
+u32 GetExRamSHMPosition();
 
 constexpr u32 MEM1_BASE_ADDR = 0x80000000U;
 constexpr u32 MEM2_BASE_ADDR = 0x90000000U;
@@ -66,11 +71,42 @@ void Shutdown();
 bool InitFastmemArena();
 void ShutdownFastmemArena();
 void DoState(PointerWrap& p);
+// MEM1 followed by MEM2 on Wii, with nothing in between. Not part of DoState, so that savestates
+// can handle it separately.
+void DoRAMState(PointerWrap& p);
 
 void UpdateLogicalMemory(const PowerPC::BatTable& dbat_table);
 
 void Clear();
 
+// Write tracking lets other threads find out whether a range of MEM1/MEM2 was written to since
+// they last looked at it, without reading it again. The host pages backing the range are write
+// protected in all views of the memory, and the first write to one of them is caught by the
+// exception handler, which counts the write and makes the page writable again.
+//
+// Must only be enabled while EMM's exception handler is installed for all threads.
+void EnableWriteTracking();
+void DisableWriteTracking();
+// Write protects the pages of the physical range. Returns the number of writes counted so far,
+// to pass to WrittenSince later, or nothing if the range can't be tracked.
+std::optional<u64> TrackWrites(u32 address, u32 size);
+// Whether the range may have been written to after TrackWrites returned write_count
+bool WrittenSince(u32 address, u32 size, u64 write_count);
+// Called by the exception handler. Returns true if the fault was a write to a tracked page.
+bool HandleWriteFault(uintptr_t host_address);
+
+// Writes by the host OS to protected pages (e.g. reading a file into emulated memory) fail
+// instead of faulting, so they have to be done while one of these exists for the range.
+class ScopedHostWrite
+{
+public:
+  ScopedHostWrite(u32 address, u32 size);
+  ~ScopedHostWrite();
+
+  ScopedHostWrite(const ScopedHostWrite&) = delete;
+  ScopedHostWrite& operator=(const ScopedHostWrite&) = delete;
+};
+
 // Routines to access physically addressed memory, designed for use by
 // emulated hardware outside the CPU. Use "Device_" prefix.
 std::string GetString(u32 em_address, size_t size = 0);
@@ -238,6 +238,7 @@ IPCCommandResult FS::Read(const ReadWriteRequest& request)
   // Simulate the FS read logic to estimate ticks. Note: this must be done before reading.
   const u64 ticks = EstimateTicksForReadWrite(handle, request);
 
+  const Memory::ScopedHostWrite host_write(request.buffer, request.size);
   const Result<u32> result = m_ios.GetFS()->ReadBytesFromFile(
       handle.fs_fd, Memory::GetPointer(request.buffer), request.size);
   LogResult(result, "Read({}, 0x{:08x}, {})", handle.name.data(), request.buffer, request.size);
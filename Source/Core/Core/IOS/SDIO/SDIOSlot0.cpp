@@ -255,6 +255,7 @@ s32 SDIOSlot0::ExecuteCommand(const Request& request, u32 buffer_in, u32 buffer_
       if (!m_card.Seek(address, SEEK_SET))
         ERROR_LOG_FMT(IOS_SD, "Seek failed WTF");
 
+      const Memory::ScopedHostWrite host_write(req.addr, size);
       if (m_card.ReadBytes(Memory::GetPointer(req.addr), size))
       {
         DEBUG_LOG_FMT(IOS_SD, "Outbuffer size {} got {}", rw_buffer_size, size);
@@ -14,6 +14,7 @@
 #include "Common/MsgHandler.h"
 #include "Common/Thread.h"
 
+#include "Core/HW/Memmap.h"
 #include "Core/MachineContext.h"
 #include "Core/PowerPC/JitInterface.h"
 
@@ -44,6 +45,9 @@ static LONG NTAPI Handler(PEXCEPTION_POINTERS pPtrs)
     uintptr_t badAddress = (uintptr_t)pPtrs->ExceptionRecord->ExceptionInformation[1];
     CONTEXT* ctx = pPtrs->ContextRecord;
 
+    if (accessType == 1 && Memory::HandleWriteFault(badAddress))
+      return (DWORD)EXCEPTION_CONTINUE_EXECUTION;
+
     if (JitInterface::HandleFault(badAddress, ctx))
     {
       return (DWORD)EXCEPTION_CONTINUE_EXECUTION;
@@ -98,6 +102,11 @@ void UninstallExceptionHandler()
 {
 }
 
+bool HandlesAllThreads()
+{
+  return true;
+}
+
 #elif defined(__APPLE__) && !defined(USE_SIGACTION_ON_APPLE)
 
 static void CheckKR(const char* name, kern_return_t kr)
@@ -230,6 +239,12 @@ void UninstallExceptionHandler()
 {
 }
 
+bool HandlesAllThreads()
+{
+  // Only the thread that installed the handler gets its exception port set
+  return false;
+}
+
 #elif defined(_POSIX_VERSION) && !defined(_M_GENERIC)
 
 static struct sigaction old_sa_segv;
@@ -257,6 +272,10 @@ static void sigsegv_handler(int sig, siginfo_t* info, void* raw_context)
 #else
   mcontext_t* ctx = &context->uc_mcontext;
 #endif
+  // Pages protected for write tracking only fault on writes
+  if (Memory::HandleWriteFault(bad_address))
+    return;
+
   // assume it's not a write
   if (!JitInterface::HandleFault(bad_address,
 #ifdef __APPLE__
@@ -338,6 +357,12 @@ void UninstallExceptionHandler()
   sigaction(SIGBUS, &old_sa_bus, nullptr);
 #endif
 }
+
+bool HandlesAllThreads()
+{
+  return true;
+}
+
 #else  // _M_GENERIC or unsupported platform
 
 void InstallExceptionHandler()
@@ -346,6 +371,10 @@ void InstallExceptionHandler()
 void UninstallExceptionHandler()
 {
 }
+bool HandlesAllThreads()
+{
+  return false;
+}
 
 #endif
 
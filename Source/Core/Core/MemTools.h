@@ -8,4 +8,6 @@ namespace EMM
 {
 void InstallExceptionHandler();
 void UninstallExceptionHandler();
+// Whether the handler also handles faults of threads other than the one that installed it
+bool HandlesAllThreads();
 }  // namespace EMM
@@ -3,9 +3,12 @@
 // Refer to the license.txt file included.
 
 #include <fstream>
-#include <iostream>
+#include <iterator>
 #include <sstream>
 #include <unistd.h>
+#include <unordered_set>
+
+#include <fmt/format.h>
 
 #include "Common/FileUtil.h"
 #include "Core/HW/Memmap.h"
@@ -38,23 +41,34 @@ bool MemoryWatcher::LoadAddresses(const std::string& path)
   if (!locations)
     return false;
 
+  std::unordered_set<std::string> seen;
   std::string line;
   while (std::getline(locations, line))
-    ParseLine(line);
+  {
+    if (seen.insert(line).second)
+      ParseLine(line);
+  }
 
-  return !m_values.empty();
+  return !m_watches.empty();
 }
 
 void MemoryWatcher::ParseLine(const std::string& line)
 {
-  m_values[line] = 0;
-  m_addresses[line] = std::vector<u32>();
+  Watch watch{static_cast<u32>(m_offsets.size()), 0, 0};
 
   std::istringstream offsets(line);
   offsets >> std::hex;
   u32 offset;
   while (offsets >> offset)
-    m_addresses[line].push_back(offset);
+    m_offsets.push_back(offset);
+
+  watch.num_offsets = static_cast<u32>(m_offsets.size()) - watch.first_offset;
+  // A line without any address can never change, there's no point in watching it
+  if (watch.num_offsets == 0)
+    return;
+
+  m_watches.push_back(watch);
+  m_addresses.push_back(line);
 }
 
 bool MemoryWatcher::OpenSocket(const std::string& path)
@@ -66,38 +80,34 @@ bool MemoryWatcher::OpenSocket(const std::string& path)
   return m_fd >= 0;
 }
 
-u32 MemoryWatcher::ChasePointer(const std::string& line)
+u32 MemoryWatcher::ChasePointer(const Watch& watch) const
 {
   u32 value = 0;
-  for (u32 offset : m_addresses[line])
+  const u32* offset = m_offsets.data() + watch.first_offset;
+  for (u32 i = 0; i < watch.num_offsets; ++i)
   {
-    value = Memory::Read_U32(value + offset);
+    value = Memory::Read_U32(value + offset[i]);
     if (!PowerPC::HostIsRAMAddress(value))
       break;
   }
   return value;
 }
 
-std::string MemoryWatcher::ComposeMessages()
+void MemoryWatcher::ComposeMessages()
 {
-  std::ostringstream message_stream;
-  message_stream << std::hex;
+  m_message.clear();
 
-  for (auto& entry : m_values)
+  for (size_t i = 0; i < m_watches.size(); ++i)
   {
-    std::string address = entry.first;
-    u32& current_value = entry.second;
-
-    u32 new_value = ChasePointer(address);
-    if (new_value != current_value)
+    Watch& watch = m_watches[i];
+    const u32 new_value = ChasePointer(watch);
+    if (new_value != watch.value)
     {
       // Update the value
-      current_value = new_value;
-      message_stream << address << '\n' << new_value << '\n';
+      watch.value = new_value;
+      fmt::format_to(std::back_inserter(m_message), "{}\n{:x}\n", m_addresses[i], new_value);
     }
   }
-
-  return message_stream.str();
 }
 
 void MemoryWatcher::Step()
@@ -105,7 +115,10 @@ void MemoryWatcher::Step()
   if (!m_running)
     return;
 
-  std::string message = ComposeMessages();
-  sendto(m_fd, message.c_str(), message.size() + 1, 0, reinterpret_cast<sockaddr*>(&m_addr),
+  ComposeMessages();
+  if (m_message.empty())
+    return;
+
+  sendto(m_fd, m_message.c_str(), m_message.size() + 1, 0, reinterpret_cast<sockaddr*>(&m_addr),
          sizeof(m_addr));
 }
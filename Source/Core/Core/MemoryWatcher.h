@@ -4,11 +4,13 @@
 
 #pragma once
 
-#include <map>
+#include <string>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <vector>
 
+#include "Common/CommonTypes.h"
+
 // MemoryWatcher reads a file containing in-game memory addresses and outputs
 // changes to those memory addresses to a unix domain socket as the game runs.
 //
@@ -25,20 +27,32 @@ public:
   void Step();
 
 private:
+  // A watched address, compiled into a pointer chain program within m_offsets.
+  // Its index is shared with m_addresses.
+  struct Watch
+  {
+    u32 first_offset;
+    u32 num_offsets;
+    u32 value;
+  };
+
   bool LoadAddresses(const std::string& path);
   bool OpenSocket(const std::string& path);
 
   void ParseLine(const std::string& line);
-  u32 ChasePointer(const std::string& line);
-  std::string ComposeMessages();
+  u32 ChasePointer(const Watch& watch) const;
+  void ComposeMessages();
 
   bool m_running = false;
 
   int m_fd;
   sockaddr_un m_addr{};
 
-  // Address as stored in the file -> list of offsets to follow
-  std::map<std::string, std::vector<u32>> m_addresses;
-  // Address as stored in the file -> current value
-  std::map<std::string, u32> m_values;
+  std::vector<Watch> m_watches;
+  // Address as stored in the file, used to identify the watch in messages
+  std::vector<std::string> m_addresses;
+  // Offsets to follow for all watches, back to back
+  std::vector<u32> m_offsets;
+  // Reused between steps to avoid allocations
+  std::string m_message;
 };
@@ -0,0 +1,447 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/PowerPC/CachedInterpreter/InterpreterCode.h"
+
+#include <type_traits>
+
+#include "Common/BitUtils.h"
+#include "Common/CommonTypes.h"
+#include "Core/ConfigManager.h"
+#include "Core/CoreTiming.h"
+#include "Core/HLE/HLE.h"
+#include "Core/HW/CPU.h"
+#include "Core/PowerPC/Gekko.h"
+#include "Core/PowerPC/Interpreter/Interpreter.h"
+#include "Core/PowerPC/Jit64Common/Jit64Constants.h"
+#include "Core/PowerPC/MMU.h"
+#include "Core/PowerPC/PPCTables.h"
+#include "Core/PowerPC/PowerPC.h"
+
+struct InterpreterCode::Instruction
+{
+  // Runs the instruction and returns the next one, or nullptr to leave the block.
+  using Handler = const Instruction* (*)(const Instruction& instruction);
+  using CommonCallback = void (*)(UGeckoInstruction);
+
+  Instruction() {}
+  Instruction(const Handler h, u32 d) : handler(h), data(d) {}
+  Instruction(const CommonCallback c, UGeckoInstruction i)
+      : handler(RunCommon), common_callback(c), data(i.hex)
+  {
+  }
+
+  static const Instruction* Abort(const Instruction&) { return nullptr; }
+
+  static const Instruction* RunCommon(const Instruction& instruction)
+  {
+    instruction.common_callback(UGeckoInstruction(instruction.data));
+    return &instruction + 1;
+  }
+
+  Handler handler = Abort;
+
+  union
+  {
+    CommonCallback common_callback = nullptr;
+    // Operands of superinstructions
+    u32 imm[2];
+  };
+
+  u32 data = 0;
+  u8 reg[4] = {};
+};
+
+using Instruction = InterpreterCode::Instruction;
+
+InterpreterCode::InterpreterCode() = default;
+
+InterpreterCode::~InterpreterCode() = default;
+
+void InterpreterCode::Init()
+{
+  m_code.reserve(CODE_SIZE / sizeof(Instruction));
+}
+
+void InterpreterCode::Clear()
+{
+  m_code.clear();
+}
+
+bool InterpreterCode::IsAlmostFull() const
+{
+  return m_code.size() >= CODE_SIZE / sizeof(Instruction) - 0x1000;
+}
+
+u8* InterpreterCode::GetCodePtr()
+{
+  return reinterpret_cast<u8*>(m_code.data() + m_code.size());
+}
+
+void InterpreterCode::Execute(const u8* entry)
+{
+  // Each instruction dispatches to the next one itself, there is no central switch.
+  const Instruction* code = reinterpret_cast<const Instruction*>(entry);
+  while (code)
+    code = code->handler(*code);
+}
+
+static const Instruction* EndBlock(const Instruction& instruction)
+{
+  PC = NPC;
+  PowerPC::ppcState.downcount -= instruction.data;
+  return &instruction + 1;
+}
+
+static const Instruction* WritePC(const Instruction& instruction)
+{
+  PC = instruction.data;
+  NPC = instruction.data + 4;
+  return &instruction + 1;
+}
+
+static const Instruction* WriteBrokenBlockNPC(const Instruction& instruction)
+{
+  NPC = instruction.data;
+  return &instruction + 1;
+}
+
+static const Instruction* CheckFPU(const Instruction& instruction)
+{
+  if (!MSR.FP)
+  {
+    PowerPC::ppcState.Exceptions |= EXCEPTION_FPU_UNAVAILABLE;
+    PowerPC::CheckExceptions();
+    PowerPC::ppcState.downcount -= instruction.data;
+    return nullptr;
+  }
+  return &instruction + 1;
+}
+
+static const Instruction* CheckDSI(const Instruction& instruction)
+{
+  if (PowerPC::ppcState.Exceptions & EXCEPTION_DSI)
+  {
+    PowerPC::CheckExceptions();
+    PowerPC::ppcState.downcount -= instruction.data;
+    return nullptr;
+  }
+  return &instruction + 1;
+}
+
+static const Instruction* CheckBreakpoint(const Instruction& instruction)
+{
+  PowerPC::CheckBreakPoints();
+  if (CPU::GetState() != CPU::State::Running)
+  {
+    PowerPC::ppcState.downcount -= instruction.data;
+    return nullptr;
+  }
+  return &instruction + 1;
+}
+
+static const Instruction* CheckIdle(const Instruction& instruction)
+{
+  if (PowerPC::ppcState.npc == instruction.data)
+  {
+    CoreTiming::Idle();
+  }
+  return &instruction + 1;
+}
+
+// The superinstructions below behave exactly like the interpreter running the instructions they
+// replace one after another.
+
+// li, lis: reg[0] = imm[0]
+static const Instruction* LoadImmediate(const Instruction& instruction)
+{
+  rGPR[instruction.reg[0]] = instruction.imm[0];
+  return &instruction + 1;
+}
+
+// addi, addis: reg[0] = reg[1] + imm[0]
+static const Instruction* AddImmediate(const Instruction& instruction)
+{
+  rGPR[instruction.reg[0]] = rGPR[instruction.reg[1]] + instruction.imm[0];
+  return &instruction + 1;
+}
+
+// rlwinm: reg[0] = rotl(reg[1], data) & imm[0]
+static const Instruction* RotateAndMask(const Instruction& instruction)
+{
+  rGPR[instruction.reg[0]] = Common::RotateLeft(rGPR[instruction.reg[1]], instruction.data) &
+                             instruction.imm[0];
+  return &instruction + 1;
+}
+
+// rlwinm, rlwinm: reg[0] = rotl(reg[1], data & 0xff) & imm[0],
+//                 reg[2] = rotl(reg[0], data >> 8) & imm[1]
+static const Instruction* RotateAndMaskTwice(const Instruction& instruction)
+{
+  const u32 value =
+      Common::RotateLeft(rGPR[instruction.reg[1]], instruction.data & 0xff) & instruction.imm[0];
+  rGPR[instruction.reg[0]] = value;
+  rGPR[instruction.reg[2]] = Common::RotateLeft(value, instruction.data >> 8) & instruction.imm[1];
+  return &instruction + 1;
+}
+
+// lwz: reg[0] = [reg[1] + imm[0]]
+static const Instruction* LoadWord(const Instruction& instruction)
+{
+  const u32 value = PowerPC::Read_U32(rGPR[instruction.reg[1]] + instruction.imm[0]);
+  if (!(PowerPC::ppcState.Exceptions & EXCEPTION_DSI))
+    rGPR[instruction.reg[0]] = value;
+  return &instruction + 1;
+}
+
+// lwz, addi: reg[0] = [reg[1] + imm[0]], reg[1] = reg[1] + imm[1]
+static const Instruction* LoadWordAndAdd(const Instruction& instruction)
+{
+  const u32 value = PowerPC::Read_U32(rGPR[instruction.reg[1]] + instruction.imm[0]);
+  if (!(PowerPC::ppcState.Exceptions & EXCEPTION_DSI))
+    rGPR[instruction.reg[0]] = value;
+  rGPR[instruction.reg[1]] += instruction.imm[1];
+  return &instruction + 1;
+}
+
+// stw: [reg[1] + imm[0]] = reg[0]
+static const Instruction* StoreWord(const Instruction& instruction)
+{
+  PowerPC::Write_U32(rGPR[instruction.reg[0]], rGPR[instruction.reg[1]] + instruction.imm[0]);
+  return &instruction + 1;
+}
+
+// cmp, bc: compares reg[0] to reg[1] or imm[1] into the CR field reg[2], then branches to imm[0]
+// from data if the bit (reg[3] & 3) of the field is (reg[3] >> 2).
+template <bool is_signed, bool has_immediate>
+static const Instruction* CompareAndBranch(const Instruction& instruction)
+{
+  using T = std::conditional_t<is_signed, s32, u32>;
+  const T a = static_cast<T>(rGPR[instruction.reg[0]]);
+  const T b = static_cast<T>(has_immediate ? instruction.imm[1] : rGPR[instruction.reg[1]]);
+
+  u32 field;
+  if (a < b)
+    field = 0x8;
+  else if (a > b)
+    field = 0x4;
+  else
+    field = 0x2;
+  if (PowerPC::GetXER_SO())
+    field |= 0x1;
+  PowerPC::ppcState.cr.SetField(instruction.reg[2], field);
+
+  const u32 bit = (field >> (3 - (instruction.reg[3] & 3))) & 1;
+  NPC = bit == (instruction.reg[3] >> 2) ? instruction.imm[0] : instruction.data + 4;
+  return &instruction + 1;
+}
+
+bool InterpreterCode::HandleFunctionHooking(u32 address, u32 downcount)
+{
+  return HLE::ReplaceFunctionIfPossible(address, [&](u32 hook_index, HLE::HookType type) {
+    m_code.emplace_back(WritePC, address);
+    m_code.emplace_back(Interpreter::HLEFunction, hook_index);
+
+    if (type != HLE::HookType::Replace)
+      return false;
+
+    m_code.emplace_back(EndBlock, downcount);
+    m_code.emplace_back();
+    return true;
+  });
+}
+
+u32 InterpreterCode::AddSuperinstruction(const PPCAnalyst::CodeOp& op,
+                                         const PPCAnalyst::CodeOp* next)
+{
+  const UGeckoInstruction inst = op.inst;
+  Instruction instruction;
+
+  switch (inst.OPCD)
+  {
+  case 10:  // cmpli
+  case 11:  // cmpi
+  case 31:  // cmp, cmpl
+  {
+    if (inst.OPCD == 31 && inst.SUBOP10 != 0 && inst.SUBOP10 != 32)
+      return 0;
+
+    // Only a branch on the result is worth fusing, the interpreter compares just as quickly.
+    if (!next)
+      return 0;
+    const UGeckoInstruction branch = next->inst;
+    if (branch.OPCD != 16 || !(branch.BO & BO_DONT_DECREMENT_FLAG) ||
+        (branch.BO & BO_DONT_CHECK_CONDITION) || branch.LK || branch.BI >> 2 != inst.CRFD ||
+        next->branchIsIdleLoop)
+    {
+      return 0;
+    }
+
+    if (inst.OPCD == 10)
+      instruction.handler = CompareAndBranch<false, true>;
+    else if (inst.OPCD == 11)
+      instruction.handler = CompareAndBranch<true, true>;
+    else if (inst.SUBOP10 == 32)
+      instruction.handler = CompareAndBranch<false, false>;
+    else
+      instruction.handler = CompareAndBranch<true, false>;
+
+    instruction.data = next->address;
+    instruction.imm[0] = next->branchTo;
+    instruction.imm[1] = inst.OPCD == 10 ? inst.UIMM : static_cast<u32>(inst.SIMM_16);
+    instruction.reg[0] = inst.RA;
+    instruction.reg[1] = inst.RB;
+    instruction.reg[2] = inst.CRFD;
+    instruction.reg[3] = (branch.BI & 3) | (branch.BO & BO_BRANCH_IF_TRUE ? 4 : 0);
+    m_code.push_back(instruction);
+    return 2;
+  }
+
+  case 14:  // addi
+  case 15:  // addis
+    instruction.handler = inst.RA == 0 ? LoadImmediate : AddImmediate;
+    instruction.imm[0] = inst.OPCD == 14 ? inst.SIMM_16 : static_cast<u32>(inst.SIMM_16) << 16;
+    instruction.reg[0] = inst.RD;
+    instruction.reg[1] = inst.RA;
+    m_code.push_back(instruction);
+    return 1;
+
+  case 21:  // rlwinm
+  {
+    if (inst.Rc)
+      return 0;
+
+    instruction.handler = RotateAndMask;
+    instruction.data = inst.SH;
+    instruction.imm[0] = MakeRotationMask(inst.MB, inst.ME);
+    instruction.reg[0] = inst.RA;
+    instruction.reg[1] = inst.RS;
+
+    const bool chained =
+        next && next->inst.OPCD == 21 && !next->inst.Rc && next->inst.RS == inst.RA;
+    if (chained)
+    {
+      instruction.handler = RotateAndMaskTwice;
+      instruction.data |= next->inst.SH << 8;
+      instruction.imm[1] = MakeRotationMask(next->inst.MB, next->inst.ME);
+      instruction.reg[2] = next->inst.RA;
+    }
+    m_code.push_back(instruction);
+    return chained ? 2 : 1;
+  }
+
+  case 32:  // lwz
+  {
+    if (inst.RA == 0)
+      return 0;
+
+    instruction.handler = LoadWord;
+    instruction.imm[0] = inst.SIMM_16;
+    instruction.reg[0] = inst.RD;
+    instruction.reg[1] = inst.RA;
+
+    // Walking through arrays
+    const bool add = next && next->inst.OPCD == 14 && next->inst.RD == inst.RA &&
+                     next->inst.RA == inst.RA;
+    if (add)
+    {
+      instruction.handler = LoadWordAndAdd;
+      instruction.imm[1] = next->inst.SIMM_16;
+    }
+    m_code.push_back(instruction);
+    return add ? 2 : 1;
+  }
+
+  case 36:  // stw
+    if (inst.RA == 0)
+      return 0;
+
+    instruction.handler = StoreWord;
+    instruction.imm[0] = inst.SIMM_16;
+    instruction.reg[0] = inst.RS;
+    instruction.reg[1] = inst.RA;
+    m_code.push_back(instruction);
+    return 1;
+
+  default:
+    return 0;
+  }
+}
+
+void InterpreterCode::AddBlock(const PPCAnalyst::CodeBlock& block,
+                               const PPCAnalyst::CodeBuffer& buffer, u32 block_start,
+                               u32 next_pc, bool memcheck)
+{
+  bool first_fp_instruction_found = false;
+  u32 downcount = 0;
+
+  for (u32 i = 0; i < block.m_num_instructions; i++)
+  {
+    const PPCAnalyst::CodeOp& op = buffer[i];
+
+    downcount += op.opinfo->numCycles;
+
+    if (HandleFunctionHooking(op.address, downcount))
+      break;
+
+    if (!op.skip)
+    {
+      const bool breakpoint = SConfig::GetInstance().bEnableDebugging &&
+                              PowerPC::breakpoints.IsAddressBreakPoint(op.address);
+      const bool check_fpu = (op.opinfo->flags & FL_USE_FPU) && !first_fp_instruction_found;
+      const bool endblock = (op.opinfo->flags & FL_ENDBLOCK) != 0;
+      const bool check_dsi = (op.opinfo->flags & FL_LOADSTORE) && memcheck;
+      const bool idle_loop = op.branchIsIdleLoop;
+
+      if (breakpoint)
+      {
+        m_code.emplace_back(WritePC, op.address);
+        m_code.emplace_back(CheckBreakpoint, downcount);
+      }
+
+      if (check_fpu)
+      {
+        m_code.emplace_back(WritePC, op.address);
+        m_code.emplace_back(CheckFPU, downcount);
+        first_fp_instruction_found = true;
+      }
+
+      // The next instruction can only be fused if nothing has to happen in between.
+      const PPCAnalyst::CodeOp* next = nullptr;
+      if (i + 1 < block.m_num_instructions && !buffer[i + 1].skip &&
+          !SConfig::GetInstance().bEnableDebugging &&
+          HLE::GetHookByFunctionAddress(buffer[i + 1].address) == 0)
+      {
+        next = &buffer[i + 1];
+      }
+
+      const u32 covered = endblock || check_dsi ? 0 : AddSuperinstruction(op, next);
+      if (covered == 2)
+      {
+        i++;
+        downcount += next->opinfo->numCycles;
+        if (next->opinfo->flags & FL_ENDBLOCK)
+          m_code.emplace_back(EndBlock, downcount);
+      }
+      else if (covered == 0)
+      {
+        if (endblock || check_dsi)
+          m_code.emplace_back(WritePC, op.address);
+        m_code.emplace_back(PPCTables::GetInterpreterOp(op.inst), op.inst);
+        if (check_dsi)
+          m_code.emplace_back(CheckDSI, downcount);
+        if (idle_loop)
+          m_code.emplace_back(CheckIdle, block_start);
+        if (endblock)
+          m_code.emplace_back(EndBlock, downcount);
+      }
+    }
+  }
+  if (block.m_broken)
+  {
+    m_code.emplace_back(WriteBrokenBlockNPC, next_pc);
+    m_code.emplace_back(EndBlock, downcount);
+  }
+  m_code.emplace_back();
+}
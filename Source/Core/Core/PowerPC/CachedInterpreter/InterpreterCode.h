@@ -0,0 +1,45 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Core/PowerPC/PPCAnalyst.h"
+
+// Blocks translated into lists of calls to the interpreter. The CachedInterpreter runs all code
+// this way, and Jit64 runs blocks like this in tiered mode until they are worth compiling.
+class InterpreterCode
+{
+public:
+  InterpreterCode();
+  ~InterpreterCode();
+
+  // Blocks point into the buffer, so all space is reserved up front and never moves.
+  void Init();
+  void Clear();
+  bool IsAlmostFull() const;
+
+  u8* GetCodePtr();
+
+  // Appends the analyzed block at GetCodePtr().
+  void AddBlock(const PPCAnalyst::CodeBlock& block, const PPCAnalyst::CodeBuffer& buffer,
+                u32 block_start, u32 next_pc, bool memcheck);
+
+  // Runs the block starting at the given entry point.
+  static void Execute(const u8* entry);
+
+  // Only defined in the source file, along with the handlers running each kind of instruction.
+  struct Instruction;
+
+private:
+  bool HandleFunctionHooking(u32 address, u32 downcount);
+
+  // Adds a handler running op with pre-decoded operands, fused with the next instruction if
+  // possible. Returns how many instructions the handler covers, 0 if op needs the interpreter.
+  u32 AddSuperinstruction(const PPCAnalyst::CodeOp& op, const PPCAnalyst::CodeOp* next);
+
+  std::vector<Instruction> m_code;
+};
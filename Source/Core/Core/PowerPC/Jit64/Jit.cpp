@@ -5,6 +5,7 @@
 #include "Core/PowerPC/Jit64/Jit.h"
 
 #include <map>
+#include <optional>
 #include <sstream>
 #include <string>
 
@@ -18,13 +19,16 @@
 
 #include "Common/CommonTypes.h"
 #include "Common/File.h"
+#include "Common/FileUtil.h"
 #include "Common/GekkoDisassembler.h"
 #include "Common/Logging/Log.h"
 #include "Common/MemoryUtil.h"
 #include "Common/PerformanceCounter.h"
 #include "Common/StringUtil.h"
 #include "Common/Swap.h"
+#include "Common/Timer.h"
 #include "Common/x64ABI.h"
+#include "Core/Config/MainSettings.h"
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
 #include "Core/HLE/HLE.h"
@@ -360,6 +364,23 @@ void Jit64::Init()
                               !SConfig::GetInstance().bEnableDebugging;
   m_cleanup_after_stackfault = false;
 
+  // Breakpoints and single stepping change the blocks, they shouldn't end up in the cache.
+  m_enable_warmup_cache =
+      Config::Get(Config::MAIN_JIT_WARMUP_CACHE) && !SConfig::GetInstance().bEnableDebugging;
+  m_warmup_game_id.clear();
+
+  // The cached interpreter can't stop at breakpoints the way compiled blocks do.
+  m_enable_tiered =
+      Config::Get(Config::MAIN_JIT_TIERED) && !SConfig::GetInstance().bEnableDebugging;
+  m_tier_up_window_start = 0;
+  m_tier_up_time = 0;
+  if (m_enable_tiered)
+    m_cold_code.Init();
+
+  // Only the cold blocks of tiered mode collect a branch profile.
+  m_enable_traces = m_enable_tiered && Config::Get(Config::MAIN_JIT_TRACES);
+  analyzer.SetBranchProfile(m_enable_traces ? &m_branch_profile : nullptr);
+
   m_stack = nullptr;
   if (m_enable_blr_optimization)
     AllocStack();
@@ -388,6 +409,9 @@ void Jit64::ClearCache()
   trampolines.ClearCodeSpace();
   m_far_code.ClearCodeSpace();
   m_const_pool.Clear();
+  m_cold_code.Clear();
+  m_cold_blocks.clear();
+  m_branch_profile.Clear();
   ClearCodeSpace();
   Clear();
   UpdateMemoryOptions();
@@ -405,6 +429,9 @@ void Jit64::ResetFreeMemoryRanges()
 
 void Jit64::Shutdown()
 {
+  blocks.GetWarmupCache().Save();
+  blocks.GetWarmupCache().Clear();
+
   FreeStack();
   FreeCodeSpace();
 
@@ -761,6 +788,9 @@ void Jit64::Jit(u32 em_address, bool clear_cache_and_retry_on_failure)
     ClearCache();
   }
 
+  if (m_cold_code.IsAlmostFull())
+    ClearCache();
+
   // Check if any code blocks have been freed in the block cache and transfer this information to
   // the local rangesets to allow overwriting them with new code.
   for (auto range : blocks.GetRangesToFreeNear())
@@ -769,6 +799,9 @@ void Jit64::Jit(u32 em_address, bool clear_cache_and_retry_on_failure)
     m_free_ranges_far.insert(range.first, range.second);
   blocks.ClearRangesToFree();
 
+  if (m_enable_warmup_cache)
+    UpdateWarmupCache();
+
   std::size_t block_size = m_code_buffer.size();
 
   if (SConfig::GetInstance().bEnableDebugging)
@@ -791,15 +824,26 @@ void Jit64::Jit(u32 em_address, bool clear_cache_and_retry_on_failure)
         analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_CROR_MERGE);
         analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_CARRY_MERGE);
         analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_BRANCH_FOLLOW);
+        analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_LOAD_FORWARD);
+        analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_CONSTANT_PROPAGATION);
+        analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_FLAG_ELIMINATION);
+        analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_DEAD_CODE_ELIMINATION);
       }
       Trace();
     }
   }
 
+  // In tiered mode, a block is only compiled when its cold block asks for it. Cold blocks use the
+  // blocks of the cached interpreter, which mustn't be reordered or continue after branches.
+  const bool cold = m_enable_tiered && !jo.profile_blocks &&
+                    !blocks.GetBlockFromStartAddress(em_address, MSR.Hex);
+  const u64 start_time = m_enable_tiered ? Common::Timer::GetTimeUs() : 0;
+
   // Analyze the block, collect all instructions it is made of (including inlining,
   // if that is enabled), reorder instructions for optimal performance, and join joinable
   // instructions.
-  const u32 nextPC = analyzer.Analyze(em_address, &code_block, &m_code_buffer, block_size);
+  PPCAnalyst::PPCAnalyzer& block_analyzer = cold ? m_cold_analyzer : analyzer;
+  const u32 nextPC = block_analyzer.Analyze(em_address, &code_block, &m_code_buffer, block_size);
 
   if (code_block.m_memory_exception)
   {
@@ -811,34 +855,21 @@ void Jit64::Jit(u32 em_address, bool clear_cache_and_retry_on_failure)
     return;
   }
 
-  if (SetEmitterStateToFreeCodeRegion())
+  if (cold)
   {
-    u8* near_start = GetWritableCodePtr();
-    u8* far_start = m_far_code.GetWritableCodePtr();
-
-    JitBlock* b = blocks.AllocateBlock(em_address);
-    if (DoJit(em_address, b, nextPC))
-    {
-      // Code generation succeeded.
-
-      // Mark the memory regions that this code block uses as used in the local rangesets.
-      u8* near_end = GetWritableCodePtr();
-      if (near_start != near_end)
-        m_free_ranges_near.erase(near_start, near_end);
-      u8* far_end = m_far_code.GetWritableCodePtr();
-      if (far_start != far_end)
-        m_free_ranges_far.erase(far_start, far_end);
-
-      // Store the used memory regions in the block so we know what to mark as unused when the
-      // block gets invalidated.
-      b->near_begin = near_start;
-      b->near_end = near_end;
-      b->far_begin = far_start;
-      b->far_end = far_end;
-
-      blocks.FinalizeBlock(*b, jo.enableBlocklink, code_block.m_physical_addresses);
+    if (CompileColdBlock(em_address, nextPC))
       return;
+  }
+  else if (JitBlock* b = CompileAnalyzedBlock(em_address, nextPC))
+  {
+    if (m_enable_tiered)
+      m_tier_up_time += Common::Timer::GetTimeUs() - start_time;
+    if (m_enable_warmup_cache)
+    {
+      AddWarmupBlock(*b);
+      CompileWarmupBlocks();
     }
+    return;
   }
 
   if (clear_cache_and_retry_on_failure)
@@ -857,6 +888,230 @@ void Jit64::Jit(u32 em_address, bool clear_cache_and_retry_on_failure)
   std::exit(-1);
 }
 
+JitBlock* Jit64::CompileAnalyzedBlock(u32 em_address, u32 nextPC)
+{
+  if (!SetEmitterStateToFreeCodeRegion())
+    return nullptr;
+
+  u8* near_start = GetWritableCodePtr();
+  u8* far_start = m_far_code.GetWritableCodePtr();
+
+  JitBlock* b = blocks.AllocateBlock(em_address);
+  if (!DoJit(em_address, b, nextPC))
+  {
+    blocks.DiscardBlock(*b);
+    return nullptr;
+  }
+
+  // Code generation succeeded.
+
+  // Mark the memory regions that this code block uses as used in the local rangesets.
+  u8* near_end = GetWritableCodePtr();
+  if (near_start != near_end)
+    m_free_ranges_near.erase(near_start, near_end);
+  u8* far_end = m_far_code.GetWritableCodePtr();
+  if (far_start != far_end)
+    m_free_ranges_far.erase(far_start, far_end);
+
+  // Store the used memory regions in the block so we know what to mark as unused when the
+  // block gets invalidated.
+  b->near_begin = near_start;
+  b->near_end = near_end;
+  b->far_begin = far_start;
+  b->far_end = far_end;
+
+  blocks.FinalizeBlock(*b, jo.enableBlocklink, code_block.m_physical_addresses);
+  return b;
+}
+
+JitBlock* Jit64::CompileColdBlock(u32 em_address, u32 nextPC)
+{
+  if (!SetEmitterStateToFreeCodeRegion())
+    return nullptr;
+
+  ColdBlock& cold_block = m_cold_blocks.emplace_back();
+  cold_block.code = m_cold_code.GetCodePtr();
+  cold_block.executions = 0;
+  cold_block.branch_address = UINT32_MAX;
+  cold_block.branch_target = UINT32_MAX;
+  if (m_enable_traces && !code_block.m_broken)
+  {
+    // Cold blocks end at the first branch. Only branches that traces can follow are profiled.
+    const PPCAnalyst::CodeOp& op = m_code_buffer[code_block.m_num_instructions - 1];
+    if (op.inst.OPCD == 16 && !op.inst.LK && (op.inst.BO & BO_DONT_DECREMENT_FLAG) &&
+        !(op.inst.BO & BO_DONT_CHECK_CONDITION))
+    {
+      cold_block.branch_address = op.address;
+      cold_block.branch_target = op.branchTo;
+    }
+  }
+  m_cold_code.AddBlock(code_block, m_code_buffer, em_address, nextPC, jo.memcheck);
+
+  u8* near_start = GetWritableCodePtr();
+  JitBlock* b = blocks.AllocateBlock(em_address);
+  b->checkedEntry = near_start;
+  b->normalEntry = near_start;
+
+  // The cold block returns where to continue: the dispatcher, or the compiler once it is hot.
+  MOV(64, R(ABI_PARAM1), ImmPtr(this));
+  MOV(64, R(ABI_PARAM2), ImmPtr(&cold_block));
+  ABI_PushRegistersAndAdjustStack({}, 0);
+  ABI_CallFunction(RunColdBlock);
+  ABI_PopRegistersAndAdjustStack({}, 0);
+  // The dispatcher expects the flags of the downcount update.
+  CMP(32, PPCSTATE(downcount), Imm8(0));
+  JMPptr(R(ABI_RETURN));
+
+  if (HasWriteFailed())
+  {
+    WARN_LOG_FMT(POWERPC, "JIT ran out of space in near code region during code generation.");
+    return nullptr;
+  }
+
+  u8* near_end = GetWritableCodePtr();
+  m_free_ranges_near.erase(near_start, near_end);
+  b->near_begin = near_start;
+  b->near_end = near_end;
+  b->codeSize = static_cast<u32>(near_end - near_start);
+  b->originalSize = code_block.m_num_instructions;
+
+  blocks.FinalizeBlock(*b, jo.enableBlocklink, code_block.m_physical_addresses);
+  return b;
+}
+
+const u8* Jit64::RunColdBlock(Jit64& jit, ColdBlock& block)
+{
+  if (++block.executions >= TIER_UP_THRESHOLD)
+  {
+    // PC still points at this block, so the compiler replaces it.
+    if (jit.HasTierUpBudget())
+      return jit.asm_routines.do_compile;
+    block.executions -= TIER_UP_RETRY_INTERVAL;
+  }
+
+  InterpreterCode::Execute(block.code);
+
+  if (block.branch_address != UINT32_MAX)
+  {
+    // Exceptions leave the block elsewhere.
+    if (PC == block.branch_target)
+      jit.m_branch_profile.AddOutcome(block.branch_address, true);
+    else if (PC == block.branch_address + 4)
+      jit.m_branch_profile.AddOutcome(block.branch_address, false);
+  }
+
+  return jit.asm_routines.dispatcher;
+}
+
+bool Jit64::HasTierUpBudget()
+{
+  const u64 now = Common::Timer::GetTimeUs();
+  if (now - m_tier_up_window_start >= TIER_UP_BUDGET_WINDOW_US)
+  {
+    m_tier_up_window_start = now;
+    m_tier_up_time = 0;
+  }
+  return m_tier_up_time < TIER_UP_BUDGET_US;
+}
+
+void Jit64::UpdateWarmupCache()
+{
+  // The game can change without a restart of the JIT, e.g. when the Wii menu launches a title.
+  const std::string& game_id = SConfig::GetInstance().GetGameID();
+  if (game_id == m_warmup_game_id)
+    return;
+
+  JitWarmupCache& cache = blocks.GetWarmupCache();
+  cache.Save();
+  cache.Clear();
+  m_warmup_game_id = game_id;
+  if (game_id.empty())
+    return;
+
+  const u32 options = (SConfig::GetInstance().bJITFollowBranch ? 1 : 0) |
+                      (SConfig::GetInstance().bMMU ? 2 : 0);
+  cache.Load(File::GetUserPath(D_CACHE_IDX) + game_id + ".jitwarmup", options);
+}
+
+void Jit64::AddWarmupBlock(const JitBlock& block)
+{
+  JitWarmupCache::Entry entry{};
+  entry.effective_address = block.effectiveAddress;
+  entry.msr_bits = block.msrBits;
+  entry.num_instructions = code_block.m_num_instructions;
+  entry.hash = JitWarmupCache::HashBlock(code_block, m_code_buffer);
+  if (js.pairedQuantizeAddresses.count(block.effectiveAddress))
+    entry.flags |= JitWarmupCache::FLAG_NO_PAIRED_QUANTIZE;
+  if (js.noSpeculativeConstantsAddresses.count(block.effectiveAddress))
+    entry.flags |= JitWarmupCache::FLAG_NO_SPECULATIVE_CONSTANTS;
+  blocks.GetWarmupCache().AddBlock(entry);
+}
+
+bool Jit64::HasCodeSpaceForWarmup()
+{
+  // Compiling blocks ahead of time must never be the reason for a cache flush.
+  const auto free_near = m_free_ranges_near.by_size_begin();
+  const auto free_far = m_free_ranges_far.by_size_begin();
+  return free_near != m_free_ranges_near.by_size_end() &&
+         free_far != m_free_ranges_far.by_size_end() &&
+         static_cast<size_t>(free_near.to() - free_near.from()) >= WARMUP_MIN_FREE_NEAR_CODE &&
+         static_cast<size_t>(free_far.to() - free_far.from()) >= WARMUP_MIN_FREE_FAR_CODE &&
+         !trampolines.IsAlmostFull();
+}
+
+void Jit64::CompileWarmupBlocks()
+{
+  JitWarmupCache& cache = blocks.GetWarmupCache();
+  const u32 msr_bits = MSR.Hex & JitBaseBlockCache::JIT_CACHE_MSR_MASK;
+  const u64 deadline = Common::Timer::GetTimeUs() + WARMUP_TIME_BUDGET_US;
+
+  while (Common::Timer::GetTimeUs() < deadline && HasCodeSpaceForWarmup())
+  {
+    const std::optional<JitWarmupCache::Entry> entry = cache.PopPending(msr_bits);
+    if (!entry)
+      return;
+
+    const u32 address = entry->effective_address;
+    // Looking up and allocating blocks goes through the TLB, so only code which is mapped by a
+    // BAT (or isn't translated) can be compiled before the CPU reaches it.
+    const PowerPC::TryReadInstResult first = PowerPC::HostTryReadInstruction(address);
+    if (!first.valid || !first.from_bat)
+    {
+      cache.Park(*entry);
+      continue;
+    }
+    if (blocks.GetBlockFromStartAddress(address, MSR.Hex))
+      continue;
+
+    // The game may not have loaded this code yet, or something else is there now. The CPU hasn't
+    // fetched it yet either, so reading it must not change the emulated icache or TLB.
+    analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_HOST_FETCH);
+    const u32 nextPC = analyzer.Analyze(address, &code_block, &m_code_buffer, m_code_buffer.size());
+    analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_HOST_FETCH);
+    if (code_block.m_memory_exception ||
+        code_block.m_num_instructions != entry->num_instructions ||
+        JitWarmupCache::HashBlock(code_block, m_code_buffer) != entry->hash)
+    {
+      cache.Park(*entry);
+      continue;
+    }
+
+    if (entry->flags & JitWarmupCache::FLAG_NO_PAIRED_QUANTIZE)
+      js.pairedQuantizeAddresses.insert(address);
+    if (entry->flags & JitWarmupCache::FLAG_NO_SPECULATIVE_CONSTANTS)
+      js.noSpeculativeConstantsAddresses.insert(address);
+
+    JitBlock* b = CompileAnalyzedBlock(address, nextPC);
+    if (!b)
+    {
+      // Out of code space after all. Leave the flush to the next regular compile, if it needs one.
+      cache.Park(*entry);
+      return;
+    }
+    b->precompiled = true;
+  }
+}
+
 bool Jit64::SetEmitterStateToFreeCodeRegion()
 {
   // Find the largest free memory blocks and set code emitters to point at them.
@@ -1226,6 +1481,10 @@ void Jit64::EnableOptimization()
   analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_CROR_MERGE);
   analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_CARRY_MERGE);
   analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_BRANCH_FOLLOW);
+  analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_LOAD_FORWARD);
+  analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_CONSTANT_PROPAGATION);
+  analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_FLAG_ELIMINATION);
+  analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_DEAD_CODE_ELIMINATION);
 }
 
 void Jit64::IntializeSpeculativeConstants()
@@ -18,11 +18,15 @@
 // ----------
 #pragma once
 
+#include <deque>
+#include <string>
+
 #include <rangeset/rangesizeset.h>
 
 #include "Common/CommonTypes.h"
 #include "Common/x64ABI.h"
 #include "Common/x64Emitter.h"
+#include "Core/PowerPC/CachedInterpreter/InterpreterCode.h"
 #include "Core/PowerPC/Jit64/JitAsm.h"
 #include "Core/PowerPC/Jit64/RegCache/FPURegCache.h"
 #include "Core/PowerPC/Jit64/RegCache/GPRRegCache.h"
@@ -60,6 +64,9 @@ public:
   void Jit(u32 em_address) override;
   void Jit(u32 em_address, bool clear_cache_and_retry_on_failure);
   bool DoJit(u32 em_address, JitBlock* b, u32 nextPC);
+  // Compiles the block in code_block and adds it to the block cache. Returns nullptr if there
+  // isn't enough code space left.
+  JitBlock* CompileAnalyzedBlock(u32 em_address, u32 nextPC);
 
   // Finds a free memory region and sets the near and far code emitters to point at that region.
   // Returns false if no free memory region can be found for either of the two.
@@ -252,6 +259,39 @@ private:
 
   void ResetFreeMemoryRanges();
 
+  // See JitWarmupCache.
+  void UpdateWarmupCache();
+  void AddWarmupBlock(const JitBlock& block);
+  bool HasCodeSpaceForWarmup();
+  void CompileWarmupBlocks();
+
+  // Bounds the time a block cache miss spends on compiling blocks of earlier sessions.
+  static constexpr u64 WARMUP_TIME_BUDGET_US = 2000;
+  static constexpr size_t WARMUP_MIN_FREE_NEAR_CODE = 4 * 1024 * 1024;
+  static constexpr size_t WARMUP_MIN_FREE_FAR_CODE = 1024 * 1024;
+
+  // In tiered mode, blocks first run in the cached interpreter. They are compiled once they ran
+  // often enough to pay for it, and only as long as compiling doesn't take up too much time.
+  struct ColdBlock
+  {
+    const u8* code;
+    u32 executions;
+    // The conditional branch ending the block, whose outcomes go to the branch profile, or
+    // UINT32_MAX.
+    u32 branch_address;
+    u32 branch_target;
+  };
+
+  static const u8* RunColdBlock(Jit64& jit, ColdBlock& block);
+  JitBlock* CompileColdBlock(u32 em_address, u32 nextPC);
+  bool HasTierUpBudget();
+
+  static constexpr u32 TIER_UP_THRESHOLD = 64;
+  // How many more times a hot block runs in the cached interpreter when the budget is used up.
+  static constexpr u32 TIER_UP_RETRY_INTERVAL = 16;
+  static constexpr u64 TIER_UP_BUDGET_US = 2000;
+  static constexpr u64 TIER_UP_BUDGET_WINDOW_US = 16000;
+
   JitBlockCache blocks{*this};
   TrampolineCache trampolines{*this};
 
@@ -262,10 +302,25 @@ private:
 
   bool m_enable_blr_optimization;
   bool m_cleanup_after_stackfault;
+  bool m_enable_warmup_cache;
+  std::string m_warmup_game_id;
+  bool m_enable_tiered;
+  bool m_enable_traces;
+  u64 m_tier_up_window_start;
+  u64 m_tier_up_time;
   u8* m_stack;
 
   HyoutaUtilities::RangeSizeSet<u8*> m_free_ranges_near;
   HyoutaUtilities::RangeSizeSet<u8*> m_free_ranges_far;
+
+  // Unlike blocks in the block cache, the code of cold blocks is only freed by ClearCache, as
+  // the block which invalidates them may still be running.
+  PPCAnalyst::PPCAnalyzer m_cold_analyzer;
+  InterpreterCode m_cold_code;
+  std::deque<ColdBlock> m_cold_blocks;
+  // Collected by the cold blocks, so that hot blocks are compiled as traces along the paths
+  // their branches take.
+  PPCAnalyst::BranchProfile m_branch_profile;
 };
 
 void LogGeneratedX86(size_t size, const PPCAnalyst::CodeBuffer& code_buffer, const u8* normalEntry,
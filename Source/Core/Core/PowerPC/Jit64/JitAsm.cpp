@@ -177,6 +177,7 @@ void Jit64AsmRoutineManager::Generate()
   JMPptr(R(ABI_RETURN));
 
   SetJumpTarget(no_block_available);
+  do_compile = GetCodePtr();
 
   // We reset the stack because Jit might clear the code cache.
   // Also if we are in the middle of disabling BLR optimization on windows
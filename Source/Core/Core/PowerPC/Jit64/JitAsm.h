@@ -41,6 +41,9 @@ public:
 
   void ResetStack(Gen::X64CodeBlock& emitter);
 
+  // Compiles the block at PC, even if the block cache has one already, and dispatches to it.
+  const u8* do_compile;
+
 private:
   void Generate();
   void GenerateCommon();
@@ -147,6 +147,22 @@ void Jit64::bcx(UGeckoInstruction inst)
     return;
   }
 
+  if (js.op->followTaken)
+  {
+    // The block continues at the branch target, so not taking the branch leaves it.
+    SwitchToFarCode();
+    SetJumpTarget(pConditionDontBranch);
+    {
+      RCForkGuard gpr_guard = gpr.Fork();
+      RCForkGuard fpr_guard = fpr.Fork();
+      gpr.Flush();
+      fpr.Flush();
+      WriteExit(js.compilerPC + 4);
+    }
+    SwitchToNearCode();
+    return;
+  }
+
   {
     RCForkGuard gpr_guard = gpr.Fork();
     RCForkGuard fpr_guard = fpr.Fork();
@@ -426,6 +426,24 @@ void Jit64::DoMergedBranchCondition()
   else  // SO bit, do not branch (we don't emulate SO for cmp).
     pDontBranch = J(true);
 
+  if (js.op[1].followTaken)
+  {
+    // The block continues at the branch target, so not taking the branch leaves it.
+    SwitchToFarCode();
+    SetJumpTarget(pDontBranch);
+    {
+      RCForkGuard gpr_guard = gpr.Fork();
+      RCForkGuard fpr_guard = fpr.Fork();
+
+      gpr.Flush();
+      fpr.Flush();
+
+      WriteExit(nextPC + 4);
+    }
+    SwitchToNearCode();
+    return;
+  }
+
   {
     RCForkGuard gpr_guard = gpr.Fork();
     RCForkGuard fpr_guard = fpr.Fork();
@@ -467,7 +485,16 @@ void Jit64::DoMergedBranchImmediate(s64 val)
   else  // SO bit, do not branch (we don't emulate SO for cmp).
     branch = false;
 
-  if (branch)
+  if (js.op[1].followTaken)
+  {
+    if (!branch)
+    {
+      gpr.Flush();
+      fpr.Flush();
+      WriteExit(nextPC + 4);
+    }
+  }
+  else if (branch)
   {
     gpr.Flush();
     fpr.Flush();
@@ -13,9 +13,9 @@
 #include <array>
 #include <cstring>
 #include <functional>
-#include <map>
 #include <set>
 #include <utility>
+#include <vector>
 
 #include "Common/CommonTypes.h"
 #include "Common/JitRegister.h"
@@ -34,8 +34,8 @@ using namespace Gen;
 
 bool JitBlock::OverlapsPhysicalRange(u32 address, u32 length) const
 {
-  return physical_addresses.lower_bound(address) !=
-         physical_addresses.lower_bound(address + length);
+  const auto it = std::lower_bound(physical_addresses.begin(), physical_addresses.end(), address);
+  return it != physical_addresses.end() && *it - address < length;
 }
 
 JitBaseBlockCache::JitBaseBlockCache(JitBase& jit) : m_jit{jit}
@@ -65,13 +65,12 @@ void JitBaseBlockCache::Clear()
 #endif
   m_jit.js.fifoWriteAddresses.clear();
   m_jit.js.pairedQuantizeAddresses.clear();
-  for (auto& e : block_map)
-  {
-    DestroyBlock(e.second);
-  }
-  block_map.clear();
-  links_to.clear();
-  block_range_map.clear();
+  block_map.ForEach([this](const BlockKey&, JitBlock* block) { DestroyBlock(*block); });
+  block_map.Clear();
+  links_to.Clear();
+  block_range_map.Clear();
+  block_storage.clear();
+  free_blocks.clear();
 
   valid_block.ClearAll();
 
@@ -91,19 +90,43 @@ JitBlock** JitBaseBlockCache::GetFastBlockMap()
 
 void JitBaseBlockCache::RunOnBlocks(std::function<void(const JitBlock&)> f)
 {
-  for (const auto& e : block_map)
-    f(e.second);
+  block_map.ForEach([&f](const BlockKey&, const JitBlock* block) { f(*block); });
 }
 
 JitBlock* JitBaseBlockCache::AllocateBlock(u32 em_address)
 {
   u32 physicalAddress = PowerPC::JitCache_TranslateAddress(em_address).address;
-  JitBlock& b = block_map.emplace(physicalAddress, JitBlock())->second;
+  const u32 msr_bits = MSR.Hex & JIT_CACHE_MSR_MASK;
+
+  JitBlock*& entry = block_map[{physicalAddress, em_address, msr_bits}];
+  if (entry)
+  {
+    // The existing block would shadow the new one, so get rid of it.
+    RemoveBlockFromRanges(*entry);
+    DestroyBlock(*entry);
+    free_blocks.push_back(entry);
+  }
+
+  if (free_blocks.empty())
+  {
+    entry = &block_storage.emplace_back();
+  }
+  else
+  {
+    entry = free_blocks.back();
+    free_blocks.pop_back();
+  }
+
+  JitBlock& b = *entry;
+  static_cast<JitBlockData&>(b) = {};
   b.effectiveAddress = em_address;
   b.physicalAddress = physicalAddress;
-  b.msrBits = MSR.Hex & JIT_CACHE_MSR_MASK;
+  b.msrBits = msr_bits;
   b.linkData.clear();
+  b.physical_addresses.clear();
+  b.profile_data = {};
   b.fast_block_map_index = 0;
+  b.precompiled = false;
   return &b;
 }
 
@@ -114,20 +137,26 @@ void JitBaseBlockCache::FinalizeBlock(JitBlock& block, bool block_link,
   fast_block_map[index] = &block;
   block.fast_block_map_index = index;
 
-  block.physical_addresses = physical_addresses;
+  block.physical_addresses.assign(physical_addresses.begin(), physical_addresses.end());
 
-  u32 range_mask = ~(BLOCK_RANGE_MAP_ELEMENTS - 1);
-  for (u32 addr : physical_addresses)
+  // The addresses are sorted, so all addresses of a macro block are next to each other.
+  u32 last_range = UINT32_MAX;
+  for (u32 addr : block.physical_addresses)
   {
     valid_block.Set(addr / 32);
-    block_range_map[addr & range_mask].insert(&block);
+    const u32 range = addr / BLOCK_RANGE_MAP_ELEMENTS;
+    if (range != last_range)
+      block_range_map[range].push_back(&block);
+    last_range = range;
   }
 
   if (block_link)
   {
     for (const auto& e : block.linkData)
     {
-      links_to.emplace(e.exitAddress, &block);
+      std::vector<JitBlock*>& sources = links_to[e.exitAddress];
+      if (std::find(sources.begin(), sources.end(), &block) == sources.end())
+        sources.push_back(&block);
     }
 
     LinkBlock(block);
@@ -160,15 +189,8 @@ JitBlock* JitBaseBlockCache::GetBlockFromStartAddress(u32 addr, u32 msr)
     translated_addr = translated.address;
   }
 
-  auto iter = block_map.equal_range(translated_addr);
-  for (; iter.first != iter.second; iter.first++)
-  {
-    JitBlock& b = iter.first->second;
-    if (b.effectiveAddress == addr && b.msrBits == (msr & JIT_CACHE_MSR_MASK))
-      return &b;
-  }
-
-  return nullptr;
+  JitBlock* const* block = block_map.Find({translated_addr, addr, msr & JIT_CACHE_MSR_MASK});
+  return block ? *block : nullptr;
 }
 
 const u8* JitBaseBlockCache::Dispatch()
@@ -186,6 +208,9 @@ const u8* JitBaseBlockCache::Dispatch()
 
 void JitBaseBlockCache::InvalidateICache(u32 address, u32 length, bool forced)
 {
+  // New code may have been loaded where a block of an earlier session was.
+  m_warmup_cache.Rearm(address, length);
+
   auto translated = PowerPC::JitCache_TranslateAddress(address);
   if (!translated.valid)
     return;
@@ -223,51 +248,113 @@ void JitBaseBlockCache::InvalidateICache(u32 address, u32 length, bool forced)
 
 void JitBaseBlockCache::ErasePhysicalRange(u32 address, u32 length)
 {
-  // Iterate over all macro blocks which overlap the given range.
-  u32 range_mask = ~(BLOCK_RANGE_MAP_ELEMENTS - 1);
-  auto start = block_range_map.lower_bound(address & range_mask);
-  auto end = block_range_map.lower_bound(address + length);
-  while (start != end)
+  if (length == 0)
+    return;
+
+  const u32 first = address / BLOCK_RANGE_MAP_ELEMENTS;
+  const u32 last = static_cast<u32>((u64(address) + length - 1) / BLOCK_RANGE_MAP_ELEMENTS);
+
+  // The usual invalidation of a single cache line only touches one macro block.
+  if (first == last)
   {
-    // Iterate over all blocks in the macro block.
-    auto iter = start->second.begin();
-    while (iter != start->second.end())
+    EraseFromMacroBlock(first, address, length);
+    return;
+  }
+
+  // Erasing blocks modifies block_range_map, so collect the overlapping macro blocks first.
+  // For large ranges, scanning all macro blocks is cheaper than probing each one in the range.
+  std::vector<u32> ranges;
+  if (last - first < block_range_map.Size())
+  {
+    for (u32 range = first; range != last + 1; ++range)
     {
-      JitBlock* block = *iter;
-      if (block->OverlapsPhysicalRange(address, length))
-      {
-        // If the block overlaps, also remove all other occupied slots in the other macro blocks.
-        // This will leak empty macro blocks, but they may be reused or cleared later on.
-        for (u32 addr : block->physical_addresses)
-          if ((addr & range_mask) != start->first)
-            block_range_map[addr & range_mask].erase(block);
-
-        // And remove the block.
-        DestroyBlock(*block);
-        auto block_map_iter = block_map.equal_range(block->physicalAddress);
-        while (block_map_iter.first != block_map_iter.second)
-        {
-          if (&block_map_iter.first->second == block)
-          {
-            block_map.erase(block_map_iter.first);
-            break;
-          }
-          block_map_iter.first++;
-        }
-        iter = start->second.erase(iter);
-      }
-      else
-      {
-        iter++;
-      }
+      if (block_range_map.Find(range))
+        ranges.push_back(range);
     }
+  }
+  else
+  {
+    block_range_map.ForEach([&](u32 range, const std::vector<JitBlock*>&) {
+      if (range >= first && range <= last)
+        ranges.push_back(range);
+    });
+  }
 
-    // If the macro block is empty, drop it.
-    if (start->second.empty())
-      start = block_range_map.erase(start);
-    else
-      start++;
+  for (u32 range : ranges)
+    EraseFromMacroBlock(range, address, length);
+}
+
+void JitBaseBlockCache::EraseFromMacroBlock(u32 index, u32 address, u32 length)
+{
+  std::vector<JitBlock*>* blocks = block_range_map.Find(index);
+  if (!blocks)
+    return;
+
+  // Iterate over all blocks in the macro block.
+  for (size_t i = 0; i < blocks->size();)
+  {
+    JitBlock* block = (*blocks)[i];
+    if (!block->OverlapsPhysicalRange(address, length))
+    {
+      i++;
+      continue;
+    }
+
+    // If the block overlaps, also remove all other occupied slots in the other macro blocks.
+    // This moves the last block of this macro block to index i. It will leak empty macro
+    // blocks elsewhere, but they may be reused or cleared later on.
+    RemoveBlockFromRanges(*block);
+    EraseBlock(*block);
   }
+
+  // If the macro block is empty, drop it.
+  if (blocks->empty())
+    block_range_map.Erase(index);
+}
+
+void JitBaseBlockCache::RemoveBlockFromRanges(const JitBlock& block)
+{
+  u32 last_range = UINT32_MAX;
+  for (u32 addr : block.physical_addresses)
+  {
+    const u32 range = addr / BLOCK_RANGE_MAP_ELEMENTS;
+    if (range == last_range)
+      continue;
+    last_range = range;
+
+    std::vector<JitBlock*>* blocks = block_range_map.Find(range);
+    if (!blocks)
+      continue;
+    const auto it = std::find(blocks->begin(), blocks->end(), &block);
+    if (it != blocks->end())
+    {
+      *it = blocks->back();
+      blocks->pop_back();
+    }
+  }
+}
+
+void JitBaseBlockCache::DiscardBlock(JitBlock& block)
+{
+  // Nothing but block_map knows about a block before FinalizeBlock.
+  const BlockKey key{block.physicalAddress, block.effectiveAddress, block.msrBits};
+  JitBlock** entry = block_map.Find(key);
+  if (entry && *entry == &block)
+    block_map.Erase(key);
+
+  free_blocks.push_back(&block);
+}
+
+void JitBaseBlockCache::EraseBlock(JitBlock& block)
+{
+  DestroyBlock(block);
+
+  const BlockKey key{block.physicalAddress, block.effectiveAddress, block.msrBits};
+  JitBlock** entry = block_map.Find(key);
+  if (entry && *entry == &block)
+    block_map.Erase(key);
+
+  free_blocks.push_back(&block);
 }
 
 u32* JitBaseBlockCache::GetBlockBitSet() const
@@ -304,13 +391,14 @@ void JitBaseBlockCache::LinkBlockExits(JitBlock& block)
 void JitBaseBlockCache::LinkBlock(JitBlock& block)
 {
   LinkBlockExits(block);
-  auto ppp = links_to.equal_range(block.effectiveAddress);
+  const std::vector<JitBlock*>* sources = links_to.Find(block.effectiveAddress);
+  if (!sources)
+    return;
 
-  for (auto iter = ppp.first; iter != ppp.second; ++iter)
+  for (JitBlock* b2 : *sources)
   {
-    JitBlock& b2 = *iter->second;
-    if (block.msrBits == b2.msrBits)
-      LinkBlockExits(b2);
+    if (block.msrBits == b2->msrBits)
+      LinkBlockExits(*b2);
   }
 }
 
@@ -323,14 +411,16 @@ void JitBaseBlockCache::UnlinkBlock(const JitBlock& block)
   }
 
   // Unlink all exits of other blocks which points to this block
-  auto ppp = links_to.equal_range(block.effectiveAddress);
-  for (auto iter = ppp.first; iter != ppp.second; ++iter)
+  const std::vector<JitBlock*>* sources = links_to.Find(block.effectiveAddress);
+  if (!sources)
+    return;
+
+  for (JitBlock* sourceBlock : *sources)
   {
-    JitBlock& sourceBlock = *iter->second;
-    if (sourceBlock.msrBits != block.msrBits)
+    if (sourceBlock->msrBits != block.msrBits)
       continue;
 
-    for (auto& e : sourceBlock.linkData)
+    for (auto& e : sourceBlock->linkData)
     {
       if (e.exitAddress == block.effectiveAddress)
       {
@@ -351,14 +441,18 @@ void JitBaseBlockCache::DestroyBlock(JitBlock& block)
   // Delete linking addresses
   for (const auto& e : block.linkData)
   {
-    auto it = links_to.equal_range(e.exitAddress);
-    while (it.first != it.second)
+    std::vector<JitBlock*>* sources = links_to.Find(e.exitAddress);
+    if (!sources)
+      continue;
+
+    const auto it = std::find(sources->begin(), sources->end(), &block);
+    if (it != sources->end())
     {
-      if (it.first->second == &block)
-        it.first = links_to.erase(it.first);
-      else
-        it.first++;
+      *it = sources->back();
+      sources->pop_back();
     }
+    if (sources->empty())
+      links_to.Erase(e.exitAddress);
   }
 
   // Raise an signal if we are going to call this block again
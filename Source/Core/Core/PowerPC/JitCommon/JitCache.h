@@ -7,14 +7,16 @@
 #include <array>
 #include <bitset>
 #include <cstring>
+#include <deque>
 #include <functional>
-#include <map>
 #include <memory>
 #include <set>
 #include <type_traits>
 #include <vector>
 
 #include "Common/CommonTypes.h"
+#include "Common/FlatHashMap.h"
+#include "Core/PowerPC/JitCommon/JitWarmupCache.h"
 
 class JitBase;
 
@@ -39,8 +41,8 @@ struct JitBlockData
   // The MSR bits expected for this block to be valid; see JIT_CACHE_MSR_MASK.
   u32 msrBits;
   // The physical address of the code represented by this block.
-  // Various maps in the cache are indexed by this (block_map
-  // and valid_block in particular). This is useful because of
+  // Various maps in the cache are indexed by this (block_map,
+  // block_range_map and valid_block in particular). This is useful because of
   // of the way the instruction cache works on PowerPC.
   u32 physicalAddress;
   // The number of bytes of JIT'ed code contained in this block. Mostly
@@ -77,8 +79,11 @@ struct JitBlock : public JitBlockData
   };
   std::vector<LinkData> linkData;
 
-  // This set stores all physical addresses of all occupied instructions.
-  std::set<u32> physical_addresses;
+  // The physical addresses of all occupied instructions, sorted.
+  std::vector<u32> physical_addresses;
+
+  // Compiled ahead of time from the warmup cache rather than when the game jumped to it.
+  bool precompiled = false;
 
   // Block profiling data, structure is inlined in Jit.cpp
   struct ProfileData
@@ -147,6 +152,8 @@ public:
 
   JitBlock* AllocateBlock(u32 em_address);
   void FinalizeBlock(JitBlock& block, bool block_link, const std::set<u32>& physical_addresses);
+  // Returns a block which failed to compile, and so was never finalized, to the free list.
+  void DiscardBlock(JitBlock& block);
 
   // Look for the block in the slow but accurate way.
   // This function shall be used if FastLookupIndexForAddress() failed.
@@ -164,6 +171,8 @@ public:
 
   u32* GetBlockBitSet() const;
 
+  JitWarmupCache& GetWarmupCache() { return m_warmup_cache; }
+
 protected:
   virtual void DestroyBlock(JitBlock& block);
 
@@ -179,22 +188,55 @@ private:
 
   JitBlock* MoveBlockIntoFastCache(u32 em_address, u32 msr);
 
+  void EraseFromMacroBlock(u32 index, u32 address, u32 length);
+  void RemoveBlockFromRanges(const JitBlock& block);
+  // Destroys the block and returns it to free_blocks.
+  void EraseBlock(JitBlock& block);
+
   // Fast but risky block lookup based on fast_block_map.
   size_t FastLookupIndexForAddress(u32 address);
 
+  // Everything GetBlockFromStartAddress needs to identify a block.
+  struct BlockKey
+  {
+    u32 physical_address;
+    u32 effective_address;
+    u32 msr_bits;
+
+    bool operator==(const BlockKey& other) const
+    {
+      return physical_address == other.physical_address &&
+             effective_address == other.effective_address && msr_bits == other.msr_bits;
+    }
+  };
+
+  struct BlockKeyHash
+  {
+    size_t operator()(const BlockKey& key) const
+    {
+      return ((u64(key.physical_address) << 32) | key.effective_address) ^
+             (u64(key.msr_bits) << 56);
+    }
+  };
+
   // links_to hold all exit points of all valid blocks in a reverse way.
   // It is used to query all blocks which links to an address.
-  std::multimap<u32, JitBlock*> links_to;  // destination_PC -> number
+  Common::FlatHashMap<u32, std::vector<JitBlock*>> links_to;  // destination_PC -> sources
 
-  // Map indexed by the physical address of the entry point.
-  // This is used to query the block based on the current PC in a slow way.
-  std::multimap<u32, JitBlock> block_map;  // start_addr -> block
+  // Map indexed by the physical address of the entry point, together with the effective address
+  // and MSR bits. This is used to query the block based on the current PC in a slow way.
+  Common::FlatHashMap<BlockKey, JitBlock*, BlockKeyHash> block_map;
 
-  // Range of overlapping code indexed by a masked physical address.
-  // This is used for invalidation of memory regions. The range is grouped
+  // Owns all blocks. A deque never moves its elements, so pointers to blocks stay valid.
+  // Destroyed blocks are kept in free_blocks for reuse until the next Clear().
+  std::deque<JitBlock> block_storage;
+  std::vector<JitBlock*> free_blocks;
+
+  // Range of overlapping code indexed by the physical address divided by the size of a
+  // macro block. This is used for invalidation of memory regions. The range is grouped
   // in macro blocks of each 0x100 bytes.
   static constexpr u32 BLOCK_RANGE_MAP_ELEMENTS = 0x100;
-  std::map<u32, std::set<JitBlock*>> block_range_map;
+  Common::FlatHashMap<u32, std::vector<JitBlock*>> block_range_map;
 
   // This bitsets shows which cachelines overlap with any blocks.
   // It is used to provide a fast way to query if no icache invalidation is needed.
@@ -203,4 +245,7 @@ private:
   // This array is indexed with the masked PC and likely holds the correct block id.
   // This is used as a fast cache of block_map used in the assembly dispatcher.
   std::array<JitBlock*, FAST_BLOCK_MAP_ELEMENTS> fast_block_map;  // start_addr & mask -> number
+
+  // Blocks of earlier sessions. Unlike the blocks above, it survives clearing the cache.
+  JitWarmupCache m_warmup_cache;
 };
@@ -0,0 +1,124 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/PowerPC/JitCommon/JitWarmupCache.h"
+
+#include <limits>
+
+#include <xxhash.h>
+
+#include "Common/File.h"
+#include "Common/Logging/Log.h"
+
+u64 JitWarmupCache::HashBlock(const PPCAnalyst::CodeBlock& block,
+                              const PPCAnalyst::CodeBuffer& buffer)
+{
+  std::vector<u32> instructions(block.m_num_instructions);
+  for (u32 i = 0; i < block.m_num_instructions; ++i)
+    instructions[i] = buffer[i].inst.hex;
+  return XXH64(instructions.data(), instructions.size() * sizeof(u32), 0);
+}
+
+void JitWarmupCache::Load(const std::string& path, u32 options)
+{
+  Clear();
+  m_path = path;
+  m_options = options;
+
+  File::IOFile file(path, "rb");
+  FileHeader header;
+  if (!file.ReadArray(&header, 1) || header.magic != MAGIC || header.version != VERSION ||
+      header.options != m_options || header.num_entries > MAX_ENTRIES)
+  {
+    return;
+  }
+
+  std::vector<Entry> entries(header.num_entries);
+  if (!file.ReadArray(entries.data(), entries.size()))
+  {
+    WARN_LOG_FMT(DYNA_REC, "JIT warmup cache {} is truncated", path);
+    return;
+  }
+
+  for (const Entry& entry : entries)
+  {
+    if (!m_entries.emplace(Key(entry.effective_address, entry.msr_bits), entry).second)
+      continue;
+    m_pending[(entry.msr_bits >> 4) & 3].push_back(entry);
+  }
+
+  INFO_LOG_FMT(DYNA_REC, "Loaded {} blocks from the JIT warmup cache {}", m_entries.size(), path);
+}
+
+void JitWarmupCache::Save()
+{
+  if (m_path.empty() || m_entries.empty())
+    return;
+
+  std::vector<Entry> entries;
+  entries.reserve(m_entries.size());
+  for (const auto& [key, entry] : m_entries)
+    entries.push_back(entry);
+
+  FileHeader header{MAGIC, VERSION, m_options, static_cast<u32>(entries.size())};
+  File::IOFile file(m_path, "wb");
+  if (!file.WriteArray(&header, 1) || !file.WriteArray(entries.data(), entries.size()))
+    ERROR_LOG_FMT(DYNA_REC, "Failed to write the JIT warmup cache {}", m_path);
+}
+
+void JitWarmupCache::Clear()
+{
+  m_path.clear();
+  m_entries.clear();
+  for (std::vector<Entry>& pending : m_pending)
+    pending.clear();
+  m_parked.clear();
+}
+
+void JitWarmupCache::AddBlock(const Entry& entry)
+{
+  const u64 key = Key(entry.effective_address, entry.msr_bits);
+  const auto it = m_entries.find(key);
+  if (it != m_entries.end())
+  {
+    // The exception addresses of the JIT are forgotten when its cache is cleared
+    const u32 flags = it->second.hash == entry.hash ? it->second.flags : 0;
+    it->second = entry;
+    it->second.flags |= flags;
+  }
+  else if (m_entries.size() < MAX_ENTRIES)
+    m_entries.emplace(key, entry);
+
+  m_parked.erase(key);
+}
+
+std::optional<JitWarmupCache::Entry> JitWarmupCache::PopPending(u32 msr_bits)
+{
+  std::vector<Entry>& pending = m_pending[(msr_bits >> 4) & 3];
+  if (pending.empty())
+    return std::nullopt;
+
+  const Entry entry = pending.back();
+  pending.pop_back();
+  return entry;
+}
+
+void JitWarmupCache::Park(const Entry& entry)
+{
+  m_parked.emplace(Key(entry.effective_address, entry.msr_bits), entry);
+}
+
+void JitWarmupCache::Rearm(u32 effective_address, u32 length)
+{
+  if (m_parked.empty())
+    return;
+
+  const u64 end = u64(effective_address) + length;
+  const auto first = m_parked.lower_bound(Key(effective_address, 0));
+  const auto last = end > std::numeric_limits<u32>::max() ? m_parked.end() :
+                                                            m_parked.lower_bound(end << 32);
+  for (auto it = first; it != last; ++it)
+    m_pending[(it->second.msr_bits >> 4) & 3].push_back(it->second);
+  m_parked.erase(first, last);
+}
@@ -0,0 +1,89 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Core/PowerPC/PPCAnalyst.h"
+
+// Remembers which blocks a game ran in earlier sessions, so that the JIT can compile them again
+// before the game first jumps to them instead of compiling everything on demand after each boot.
+//
+// Host code isn't stored: it contains absolute addresses of the host process and depends on the
+// state of the code space. Entries hold the guest address of a block and a hash of its
+// instructions instead. An entry is only compiled once the analyzer finds the same instructions
+// at that address again.
+class JitWarmupCache
+{
+public:
+  enum : u32
+  {
+    // The block ran into a wrong guess of the GQR values or speculative constants.
+    FLAG_NO_PAIRED_QUANTIZE = 1 << 0,
+    FLAG_NO_SPECULATIVE_CONSTANTS = 1 << 1,
+  };
+
+  struct Entry
+  {
+    u32 effective_address;
+    u32 msr_bits;
+    u32 flags;
+    u32 num_instructions;
+    u64 hash;
+  };
+
+  static u64 HashBlock(const PPCAnalyst::CodeBlock& block, const PPCAnalyst::CodeBuffer& buffer);
+
+  // Reads the entries of the last session and queues them for compilation. The cache keeps the
+  // path and writes all entries back to it in Save().
+  void Load(const std::string& path, u32 options);
+  void Save();
+  void Clear();
+
+  const std::string& GetPath() const { return m_path; }
+  bool IsEmpty() const { return m_entries.empty(); }
+
+  void AddBlock(const Entry& entry);
+
+  // Returns the next queued entry which can be compiled with the given MSR bits.
+  std::optional<Entry> PopPending(u32 msr_bits);
+  // Queues the entry again once its code is invalidated, for blocks whose code wasn't loaded yet.
+  void Park(const Entry& entry);
+  void Rearm(u32 effective_address, u32 length);
+
+private:
+  static constexpr u32 MAGIC = 0x4357544A;  // "JTWC"
+  static constexpr u32 VERSION = 1;
+  // Bounds the file size for games whose code keeps changing.
+  static constexpr size_t MAX_ENTRIES = 0x40000;
+
+  struct FileHeader
+  {
+    u32 magic;
+    u32 version;
+    u32 options;
+    u32 num_entries;
+  };
+
+  static u64 Key(u32 effective_address, u32 msr_bits)
+  {
+    return (u64(effective_address) << 32) | msr_bits;
+  }
+
+  std::string m_path;
+  u32 m_options = 0;
+
+  // All known blocks, including the ones compiled in this session.
+  std::map<u64, Entry> m_entries;
+  // Blocks of the last session which weren't compiled yet, indexed by MSR.IR and MSR.DR.
+  std::array<std::vector<Entry>, 4> m_pending;
+  // Blocks whose code didn't match, waiting for an icache invalidation of their address.
+  std::map<u64, Entry> m_parked;
+};
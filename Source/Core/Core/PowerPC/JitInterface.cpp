@@ -153,6 +153,12 @@ void GetProfileResults(Profiler::ProfileStats* prof_stats)
     Core::SetState(Core::State::Running);
 }
 
+void RunOnBlocks(const std::function<void(const JitBlock&)>& f)
+{
+  if (g_jit)
+    g_jit->GetBlockCache()->RunOnBlocks(f);
+}
+
 int GetHostCode(u32* address, const u8** code, u32* code_size)
 {
   if (!g_jit)
@@ -252,6 +258,18 @@ void CompileExceptionCheck(ExceptionType type)
 
   if (PC != 0 && (exception_addresses->find(PC)) == (exception_addresses->end()))
   {
+    if (type != ExceptionType::FIFOWrite)
+    {
+      // Blocks compiled ahead of time guessed from the state at that time instead of the state
+      // the block is entered with, so give them a second chance.
+      const JitBlock* block = g_jit->GetBlockCache()->GetBlockFromStartAddress(PC, MSR.Hex);
+      if (block && block->precompiled)
+      {
+        g_jit->GetBlockCache()->InvalidateICache(PC, 4, true);
+        return;
+      }
+    }
+
     if (type == ExceptionType::FIFOWrite)
     {
       // Check in case the code has been replaced since: do we need to do this?
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <functional>
 #include <string>
 
 #include "Common/CommonTypes.h"
@@ -12,6 +13,7 @@
 class CPUCoreBase;
 class PointerWrap;
 class JitBase;
+struct JitBlock;
 
 namespace PowerPC
 {
@@ -48,6 +50,8 @@ void SetProfilingState(ProfilingState state);
 void WriteProfileResults(const std::string& filename);
 void GetProfileResults(Profiler::ProfileStats* prof_stats);
 int GetHostCode(u32* address, const u8** code, u32* code_size);
+// Calls f for every block in the block cache. Does nothing if no JIT is running.
+void RunOnBlocks(const std::function<void(const JitBlock&)>& f);
 
 // Memory Utilities
 bool HandleFault(uintptr_t access_address, SContext* ctx);
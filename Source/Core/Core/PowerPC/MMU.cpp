@@ -434,6 +434,27 @@ TryReadInstResult TryReadInstruction(u32 address)
   return TryReadInstResult{true, from_bat, hex, address};
 }
 
+TryReadInstResult HostTryReadInstruction(u32 address)
+{
+  bool from_bat = true;
+  if (MSR.IR)
+  {
+    auto tlb_addr = TranslateAddress<XCheckTLBFlag::OpcodeNoException>(address);
+    if (!tlb_addr.Success())
+      return TryReadInstResult{false, false, 0, 0};
+
+    address = tlb_addr.address;
+    from_bat = tlb_addr.result == TranslateAddressResult::BAT_TRANSLATED;
+  }
+
+  u32 hex;
+  if (Memory::m_pFakeVMEM && ((address & 0xFE000000) == 0x7E000000))
+    hex = Common::swap32(&Memory::m_pFakeVMEM[address & Memory::GetFakeVMemMask()]);
+  else
+    hex = PowerPC::ppcState.iCache.PeekInstruction(address);
+  return TryReadInstResult{true, from_bat, hex, address};
+}
+
 u32 HostRead_Instruction(const u32 address)
 {
   return ReadFromHardware<XCheckTLBFlag::OpcodeNoException, u32>(address);
@@ -858,6 +879,19 @@ TranslateResult JitCache_TranslateAddress(u32 address)
   return TranslateResult{true, from_bat, tlb_addr.address};
 }
 
+TranslateResult HostTranslateAddress(u32 address)
+{
+  if (!MSR.DR)
+    return TranslateResult{true, true, address};
+
+  auto tlb_addr = TranslateAddress<XCheckTLBFlag::NoException>(address);
+  if (!tlb_addr.Success())
+    return TranslateResult{false, false, 0};
+
+  bool from_bat = tlb_addr.result == TranslateAddressResult::BAT_TRANSLATED;
+  return TranslateResult{true, from_bat, tlb_addr.address};
+}
+
 // *********************************************************************************
 // Warning: Test Area
 //
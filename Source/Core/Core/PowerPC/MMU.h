@@ -52,6 +52,8 @@ struct TryReadInstResult
   u32 physical_address;
 };
 TryReadInstResult TryReadInstruction(u32 address);
+// Same as TryReadInstruction, but leaves the instruction cache and the TLB untouched.
+TryReadInstResult HostTryReadInstruction(u32 address);
 
 u8 Read_U8(u32 address);
 u16 Read_U16(u32 address);
@@ -102,6 +104,8 @@ struct TranslateResult
   u32 address;
 };
 TranslateResult JitCache_TranslateAddress(u32 address);
+// Translates a data address given the current CPU state, like a host access would.
+TranslateResult HostTranslateAddress(u32 address);
 
 constexpr int BAT_INDEX_SHIFT = 17;
 constexpr u32 BAT_PAGE_SIZE = 1 << BAT_INDEX_SHIFT;
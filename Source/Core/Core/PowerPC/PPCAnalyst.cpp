@@ -5,7 +5,9 @@
 #include "Core/PowerPC/PPCAnalyst.h"
 
 #include <algorithm>
+#include <array>
 #include <map>
+#include <optional>
 #include <queue>
 #include <string>
 #include <vector>
@@ -13,6 +15,7 @@
 #include <fmt/format.h>
 
 #include "Common/Assert.h"
+#include "Common/BitUtils.h"
 #include "Common/CommonTypes.h"
 #include "Common/Logging/Log.h"
 #include "Common/StringUtil.h"
@@ -41,6 +44,14 @@ namespace PPCAnalyst
 // 0 does not perform block merging
 constexpr u32 BRANCH_FOLLOWING_THRESHOLD = 2;
 
+// Conditional branches followed along the hot path of a block.
+constexpr u32 TRACE_FOLLOWING_THRESHOLD = 4;
+
+// A branch is only followed after this many outcomes, if it is taken at least this many times
+// as often as it is not.
+constexpr u32 BRANCH_PROFILE_MIN_SAMPLES = 16;
+constexpr u32 BRANCH_PROFILE_TAKEN_RATIO = 8;
+
 constexpr u32 INVALID_BRANCH_TARGET = 0xFFFFFFFF;
 
 static u32 EvaluateBranchTarget(UGeckoInstruction instr, u32 pc)
@@ -357,6 +368,26 @@ static void FindFunctionsAfterReturnInstruction(PPCSymbolDB* func_db)
   }
 }
 
+void BranchProfile::AddOutcome(u32 address, bool taken)
+{
+  Counts& counts = m_counts[address];
+  if (taken)
+    counts.taken++;
+  else
+    counts.not_taken++;
+}
+
+bool BranchProfile::IsMostlyTaken(u32 address) const
+{
+  const auto it = m_counts.find(address);
+  if (it == m_counts.end())
+    return false;
+
+  const Counts& counts = it->second;
+  return counts.taken + counts.not_taken >= BRANCH_PROFILE_MIN_SAMPLES &&
+         counts.taken >= counts.not_taken * BRANCH_PROFILE_TAKEN_RATIO;
+}
+
 void FindFunctions(u32 startAddr, u32 endAddr, PPCSymbolDB* func_db)
 {
   // Step 1: Find all functions
@@ -519,6 +550,285 @@ void PPCAnalyzer::ReorderInstructions(u32 instructions, CodeOp* code)
     ReorderInstructionsCore(instructions, code, false, ReorderType::CMP);
 }
 
+// Integer instructions which can't leave the block or raise exceptions, so only the following
+// instructions of the block can see the registers they write.
+static bool HasOnlyRegisterEffects(const CodeOp& op)
+{
+  return op.opinfo->type == OpType::Integer && !op.canEndBlock &&
+         !(op.opinfo->flags & (FL_EVIL | FL_TIMER | FL_LOADSTORE | FL_USE_FPU));
+}
+
+void PPCAnalyzer::ForwardStoredValues(CodeBlock* block, CodeOp* code)
+{
+  // Loads must still hit watchpoints, and the debugger shows the original instructions.
+  if (SConfig::GetInstance().bEnableDebugging || PowerPC::memchecks.HasAny())
+    return;
+
+  // Only the stack is known to be RAM, other stores may go to MMIO registers which read back
+  // something else.
+  constexpr u32 STACK_POINTER = 1;
+
+  for (u32 i = 0; i < block->m_num_instructions; ++i)
+  {
+    const UGeckoInstruction store = code[i].inst;
+    u32 first_kept_bit;
+    switch (store.OPCD)
+    {
+    case 36:  // stw
+      first_kept_bit = 0;
+      break;
+    case 44:  // sth
+      first_kept_bit = 16;
+      break;
+    case 38:  // stb
+      first_kept_bit = 24;
+      break;
+    default:
+      continue;
+    }
+    if (store.RA != STACK_POINTER)
+      continue;
+
+    // lwz, lhz and lbz are 4 below the matching store.
+    const u32 load_opcd = store.OPCD - 4;
+    BitSet32 sources;
+    sources[STACK_POINTER] = true;
+    sources[store.RS] = true;
+
+    for (u32 j = i + 1; j < block->m_num_instructions; ++j)
+    {
+      CodeOp& op = code[j];
+      if (op.inst.OPCD == load_opcd && op.inst.RA == STACK_POINTER &&
+          op.inst.SIMM_16 == store.SIMM_16)
+      {
+        UGeckoInstruction move(0);
+        if (first_kept_bit == 0)
+        {
+          // mr rD, rS
+          move.OPCD = 31;
+          move.SUBOP10 = 444;
+          move.RB = store.RS;
+        }
+        else
+        {
+          // clrlwi rD, rS, first_kept_bit
+          move.OPCD = 21;
+          move.MB = first_kept_bit;
+          move.ME = 31;
+        }
+        move.RS = store.RS;
+        move.RA = op.inst.RD;
+
+        op.inst = move;
+        op.opinfo = PPCTables::GetOpInfo(move);
+        SetInstructionStats(block, &op, op.opinfo, j);
+      }
+      else if (!HasOnlyRegisterEffects(op) && op.opinfo->type != OpType::Load)
+      {
+        // Anything else may write memory.
+        break;
+      }
+
+      if (op.regsOut & sources)
+        break;
+    }
+  }
+}
+
+void PPCAnalyzer::EliminateDeadCode(u32 instructions, CodeOp* code) const
+{
+  // The registers can be seen by exception handlers and the debugger.
+  if (SConfig::GetInstance().bEnableDebugging)
+    return;
+
+  // Registers which may be read before the next instruction overwriting them.
+  BitSet32 live = BitSet32::AllTrue(32);
+  for (int i = static_cast<int>(instructions) - 1; i >= 0; i--)
+  {
+    CodeOp& op = code[i];
+    if (!HasOnlyRegisterEffects(op))
+    {
+      live = BitSet32::AllTrue(32);
+      continue;
+    }
+
+    // Only the "o" forms like addo have FL_SET_OE, so plain arithmetic like add, subf, mullw and
+    // neg is removed too. Flag writes aren't tracked here, so ops writing CR0, CA or OV are kept;
+    // EliminateDeadFlags runs first and clears the Rc bit of those whose CR0 result is dead.
+    if (op.regsOut.Count() == 1 && !(op.regsOut & live) && !op.outputCR0 && !op.outputCR1 &&
+        !op.outputCA && !(op.opinfo->flags & FL_SET_OE))
+    {
+      op.skip = true;
+      continue;
+    }
+
+    live &= ~op.regsOut;
+    live |= op.regsIn;
+  }
+}
+
+// Computes the result of an instruction that writes one GPR from nothing but known GPRs.
+static std::optional<u32> EvaluateConstant(UGeckoInstruction inst, const std::array<u32, 32>& gpr)
+{
+  const u32 a = inst.RA == 0 ? 0 : gpr[inst.RA];
+  switch (inst.OPCD)
+  {
+  case 7:  // mulli
+    return gpr[inst.RA] * u32(s32(inst.SIMM_16));
+  case 14:  // addi
+    return a + u32(s32(inst.SIMM_16));
+  case 15:  // addis
+    return a + (inst.UIMM << 16);
+  case 20:  // rlwimix
+  {
+    const u32 mask = MakeRotationMask(inst.MB, inst.ME);
+    return (Common::RotateLeft(gpr[inst.RS], inst.SH) & mask) | (gpr[inst.RA] & ~mask);
+  }
+  case 21:  // rlwinmx
+    return Common::RotateLeft(gpr[inst.RS], inst.SH) & MakeRotationMask(inst.MB, inst.ME);
+  case 23:  // rlwnmx
+    return Common::RotateLeft(gpr[inst.RS], gpr[inst.RB] & 0x1F) &
+           MakeRotationMask(inst.MB, inst.ME);
+  case 24:  // ori
+    return gpr[inst.RS] | inst.UIMM;
+  case 25:  // oris
+    return gpr[inst.RS] | (inst.UIMM << 16);
+  case 26:  // xori
+    return gpr[inst.RS] ^ inst.UIMM;
+  case 27:  // xoris
+    return gpr[inst.RS] ^ (inst.UIMM << 16);
+  case 31:
+    break;
+  default:
+    return std::nullopt;
+  }
+
+  const u32 s = gpr[inst.RS];
+  const u32 b = gpr[inst.RB];
+  switch (inst.SUBOP10)
+  {
+  case 266:  // addx
+    return gpr[inst.RA] + b;
+  case 40:  // subfx
+    return b - gpr[inst.RA];
+  case 104:  // negx
+    return 0 - gpr[inst.RA];
+  case 235:  // mullwx
+    return gpr[inst.RA] * b;
+  case 28:  // andx
+    return s & b;
+  case 60:  // andcx
+    return s & ~b;
+  case 124:  // norx
+    return ~(s | b);
+  case 284:  // eqvx
+    return ~(s ^ b);
+  case 316:  // xorx
+    return s ^ b;
+  case 412:  // orcx
+    return s | ~b;
+  case 444:  // orx
+    return s | b;
+  case 476:  // nandx
+    return ~(s & b);
+  case 24:  // slwx
+    return (b & 0x20) ? 0 : s << (b & 0x1F);
+  case 536:  // srwx
+    return (b & 0x20) ? 0 : s >> (b & 0x1F);
+  case 922:  // extshx
+    return u32(s32(s16(s)));
+  case 954:  // extsbx
+    return u32(s32(s8(s)));
+  default:
+    return std::nullopt;
+  }
+}
+
+void PPCAnalyzer::PropagateConstants(CodeBlock* block, CodeOp* code)
+{
+  // The debugger shows the original instructions.
+  if (SConfig::GetInstance().bEnableDebugging)
+    return;
+
+  std::array<u32, 32> values{};
+  BitSet32 known;
+  for (u32 i = 0; i < block->m_num_instructions; ++i)
+  {
+    CodeOp& op = code[i];
+    // Only instructions that write nothing but a GPR can be replaced by li or lis.
+    const bool foldable = HasOnlyRegisterEffects(op) && op.regsOut.Count() == 1 &&
+                          !(op.regsIn & ~known) && !op.outputCR0 && !op.outputCR1 &&
+                          !op.outputCA && !op.wantsCA && !(op.opinfo->flags & FL_SET_OE);
+    const std::optional<u32> result =
+        foldable ? EvaluateConstant(op.inst, values) : std::nullopt;
+    if (!result)
+    {
+      known &= ~op.regsOut;
+      continue;
+    }
+
+    const u32 reg = static_cast<u32>(*op.regsOut.begin());
+    values[reg] = *result;
+    known[reg] = true;
+
+    // Values that don't fit in the immediate of li or lis stay as they are, but are still known
+    // to the instructions after them.
+    UGeckoInstruction constant(0);
+    constant.RD = reg;
+    if (s32(*result) == s32(s16(*result)))
+    {
+      constant.OPCD = 14;  // li rD, result
+      constant.SIMM_16 = static_cast<s16>(*result);
+    }
+    else if ((*result & 0xFFFF) == 0)
+    {
+      constant.OPCD = 15;  // lis rD, result >> 16
+      constant.SIMM_16 = static_cast<s16>(*result >> 16);
+    }
+    else
+    {
+      continue;
+    }
+
+    if (op.inst.hex != constant.hex)
+    {
+      op.inst = constant;
+      op.opinfo = PPCTables::GetOpInfo(constant);
+      SetInstructionStats(block, &op, op.opinfo, i);
+    }
+  }
+}
+
+void PPCAnalyzer::EliminateDeadFlags(CodeBlock* block, CodeOp* code)
+{
+  // The debugger shows the original instructions.
+  if (SConfig::GetInstance().bEnableDebugging)
+    return;
+
+  // Whether CR0 is completely overwritten before anything can read it. Only integer instructions
+  // are known not to read CR, and any other instruction might leave the block.
+  bool cr0_overwritten = false;
+  for (int i = static_cast<int>(block->m_num_instructions) - 1; i >= 0; i--)
+  {
+    CodeOp& op = code[i];
+    if (!HasOnlyRegisterEffects(op))
+    {
+      cr0_overwritten = false;
+      continue;
+    }
+
+    if (cr0_overwritten && op.outputCR0 && (op.opinfo->flags & FL_RC_BIT))
+    {
+      op.inst.Rc = 0;
+      SetInstructionStats(block, &op, op.opinfo, i);
+    }
+
+    // All of them write the whole of CR0.
+    if (op.outputCR0)
+      cr0_overwritten = true;
+  }
+}
+
 void PPCAnalyzer::SetInstructionStats(CodeBlock* block, CodeOp* code, const GekkoOPInfo* opinfo,
                                       u32 index)
 {
@@ -755,13 +1065,15 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, std:
   bool found_call = false;
   size_t caller = 0;
   u32 numFollows = 0;
+  u32 numTraceFollows = 0;
   u32 num_inst = 0;
 
   const bool enable_follow = SConfig::GetInstance().bJITFollowBranch;
 
   for (std::size_t i = 0; i < block_size; ++i)
   {
-    auto result = PowerPC::TryReadInstruction(address);
+    auto result = HasOption(OPTION_HOST_FETCH) ? PowerPC::HostTryReadInstruction(address) :
+                                                 PowerPC::TryReadInstruction(address);
     if (!result.valid)
     {
       if (i == 0)
@@ -875,6 +1187,16 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, std:
       }
     }
 
+    if (conditional_continue && m_branch_profile && inst.OPCD == 16 && !inst.LK &&
+        (inst.BO & BO_DONT_DECREMENT_FLAG) && numTraceFollows < TRACE_FOLLOWING_THRESHOLD &&
+        m_branch_profile->IsMostlyTaken(code[i].address))
+    {
+      // Loops are left to block linking, the trace only goes forward.
+      const u32 target = code[i].branchTo;
+      code[i].followTaken = std::none_of(
+          code, code + i + 1, [target](const CodeOp& op) { return op.address == target; });
+    }
+
     code[i].branchIsIdleLoop =
         code[i].branchTo == block->m_address && IsBusyWaitLoop(block, code, i);
 
@@ -884,6 +1206,13 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, std:
       numFollows++;
       address = code[i].branchTo;
     }
+    else if (code[i].followTaken)
+    {
+      // Follow the hot path of the conditional branch, the other one becomes an exit.
+      numTraceFollows++;
+      found_call = false;
+      address = code[i].branchTo;
+    }
     else
     {
       // Just pick the next instruction
@@ -905,7 +1234,17 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, std:
   block->m_num_instructions = num_inst;
 
   if (block->m_num_instructions > 1)
+  {
+    if (HasOption(OPTION_LOAD_FORWARD))
+      ForwardStoredValues(block, code);
+    if (HasOption(OPTION_CONSTANT_PROPAGATION))
+      PropagateConstants(block, code);
+    if (HasOption(OPTION_FLAG_ELIMINATION))
+      EliminateDeadFlags(block, code);
+    if (HasOption(OPTION_DEAD_CODE_ELIMINATION))
+      EliminateDeadCode(block->m_num_instructions, code);
     ReorderInstructions(block->m_num_instructions, code);
+  }
 
   if ((!found_exit && num_inst > 0) || block_size == 1)
   {
@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <cstddef>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 #include "Common/BitSet.h"
@@ -47,6 +48,7 @@ struct CodeOp  // 16B
   bool canEndBlock;
   bool skipLRStack;
   bool skip;  // followed BL-s for example
+  bool followTaken;  // the block continues at branchTo, not taking the branch leaves it
   // which registers are still needed after this instruction in this block
   BitSet32 fprInUse;
   BitSet32 gprInUse;
@@ -156,6 +158,24 @@ struct CodeBlock
   std::set<u32> m_physical_addresses;
 };
 
+// How often conditional branches were taken at runtime, by address of the branch.
+class BranchProfile
+{
+public:
+  void AddOutcome(u32 address, bool taken);
+  bool IsMostlyTaken(u32 address) const;
+  void Clear() { m_counts.clear(); }
+
+private:
+  struct Counts
+  {
+    u32 taken = 0;
+    u32 not_taken = 0;
+  };
+
+  std::unordered_map<u32, Counts> m_counts;
+};
+
 class PPCAnalyzer
 {
 public:
@@ -195,14 +215,43 @@ public:
 
     // Reorder cror instructions next to their associated fcmp.
     OPTION_CROR_MERGE = (1 << 6),
+
+    // Replace loads from stack slots which were stored earlier in the block with register moves.
+    OPTION_LOAD_FORWARD = (1 << 7),
+
+    // Skip integer instructions whose results are overwritten before anything can read them.
+    OPTION_DEAD_CODE_ELIMINATION = (1 << 8),
+
+    // Fetch instructions without touching the emulated instruction cache and TLB, for analyzing
+    // code the CPU hasn't reached yet.
+    OPTION_HOST_FETCH = (1 << 9),
+
+    // Replace integer instructions whose inputs are all known constants with li or lis.
+    OPTION_CONSTANT_PROPAGATION = (1 << 10),
+
+    // Clear the Rc bit of integer instructions whose CR0 result is overwritten before anything
+    // can read it.
+    OPTION_FLAG_ELIMINATION = (1 << 11),
   };
 
   // Option setting/getting
   void SetOption(AnalystOption option) { m_options |= option; }
   void ClearOption(AnalystOption option) { m_options &= ~(option); }
   bool HasOption(AnalystOption option) const { return !!(m_options & option); }
+
+  // With a profile and OPTION_CONDITIONAL_CONTINUE, blocks follow conditional branches that are
+  // mostly taken, forming traces along the hot path.
+  void SetBranchProfile(const BranchProfile* profile) { m_branch_profile = profile; }
+
   u32 Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, std::size_t block_size);
 
+  // Passes run by Analyze, which are usable on their own for testing.
+  void SetInstructionStats(CodeBlock* block, CodeOp* code, const GekkoOPInfo* opinfo, u32 index);
+  void ForwardStoredValues(CodeBlock* block, CodeOp* code);
+  void PropagateConstants(CodeBlock* block, CodeOp* code);
+  void EliminateDeadFlags(CodeBlock* block, CodeOp* code);
+  void EliminateDeadCode(u32 instructions, CodeOp* code) const;
+
 private:
   enum class ReorderType
   {
@@ -213,11 +262,12 @@ private:
 
   void ReorderInstructionsCore(u32 instructions, CodeOp* code, bool reverse, ReorderType type);
   void ReorderInstructions(u32 instructions, CodeOp* code);
-  void SetInstructionStats(CodeBlock* block, CodeOp* code, const GekkoOPInfo* opinfo, u32 index);
   bool IsBusyWaitLoop(CodeBlock* block, CodeOp* code, size_t instructions);
 
   // Options
   u32 m_options = 0;
+
+  const BranchProfile* m_branch_profile = nullptr;
 };
 
 void FindFunctions(u32 startAddr, u32 endAddr, PPCSymbolDB* func_db);
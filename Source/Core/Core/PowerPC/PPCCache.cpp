@@ -196,6 +196,25 @@ u32 InstructionCache::ReadInstruction(u32 addr)
   return res;
 }
 
+u32 InstructionCache::PeekInstruction(u32 addr) const
+{
+  if (!HID0.ICE)  // instruction cache is disabled
+    return Memory::Read_U32(addr);
+
+  u32 t;
+  if (addr & ICACHE_VMEM_BIT)
+    t = lookup_table_vmem[(addr >> 5) & 0xfffff];
+  else if (addr & ICACHE_EXRAM_BIT)
+    t = lookup_table_ex[(addr >> 5) & 0x1fffff];
+  else
+    t = lookup_table[(addr >> 5) & 0xfffff];
+
+  // Not cached yet, so fetching it would load the line from memory
+  if (t == 0xff)
+    return Memory::Read_U32(addr);
+  return Common::swap32(data[(addr >> 5) & 0x7f][t][(addr >> 2) & 7]);
+}
+
 void InstructionCache::DoState(PointerWrap& p)
 {
   p.DoArray(data);
@@ -0,0 +1,310 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/PowerPC/SamplingProfiler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "Common/File.h"
+#include "Common/Logging/Log.h"
+#include "Common/SymbolDB.h"
+#include "Core/Core.h"
+#include "Core/PowerPC/JitCommon/JitCache.h"
+#include "Core/PowerPC/JitInterface.h"
+#include "Core/PowerPC/PPCSymbolDB.h"
+#include "Core/PowerPC/PowerPC.h"
+
+#ifdef __linux__
+#include <csignal>
+#include <ctime>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "Core/MachineContext.h"
+
+// Older glibc versions don't define this
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+#endif
+
+namespace SamplingProfiler
+{
+// Samples that weren't mapped to JIT blocks yet. Written by the signal handler, which only runs on
+// the CPU thread, and read by the CPU thread or while the CPU thread is paused.
+struct Sample
+{
+  u64 host_pc;
+  u32 pc;
+  u32 lr;
+};
+constexpr u32 SAMPLE_BUFFER_SIZE = 1 << 14;
+static std::array<Sample, SAMPLE_BUFFER_SIZE> s_samples;
+static std::atomic<u32> s_samples_written{0};
+// Published by the consumer with release, so the signal handler only reuses a slot after it was
+// read. Accessed from the signal handler, so it has to be lock-free.
+static std::atomic<u32> s_samples_read{0};
+static_assert(std::atomic<u32>::is_always_lock_free);
+static std::atomic<u32> s_samples_dropped{0};
+
+// Aggregated samples, keyed by caller address, function address and block address (0 for
+// samples outside of JIT code).
+using SampleKey = std::tuple<u32, u32, u32>;
+static std::map<SampleKey, u64> s_counts;
+static std::mutex s_counts_mutex;
+
+// Requested frequency, picked up by the CPU thread at the next field boundary
+static std::atomic<u32> s_pending_frequency{0};
+static u32 s_fields_until_resolve = 0;
+constexpr u32 RESOLVE_INTERVAL_FIELDS = 60;
+
+struct CodeRange
+{
+  const u8* begin;
+  const u8* end;
+  u32 address;
+};
+
+// Maps all samples recorded so far to JIT blocks. Must be called on the CPU thread or while it is
+// paused, since the block cache is accessed.
+static void ResolveSamples()
+{
+  const u32 written = s_samples_written.load(std::memory_order_acquire);
+  u32 read = s_samples_read.load(std::memory_order_relaxed);
+  if (written == read)
+    return;
+
+  std::vector<CodeRange> ranges;
+  JitInterface::RunOnBlocks([&ranges](const JitBlock& block) {
+    if (block.near_begin != block.near_end)
+      ranges.push_back({block.near_begin, block.near_end, block.effectiveAddress});
+    else if (block.checkedEntry)
+      ranges.push_back(
+          {block.checkedEntry, block.checkedEntry + block.codeSize, block.effectiveAddress});
+    if (block.far_begin != block.far_end)
+      ranges.push_back({block.far_begin, block.far_end, block.effectiveAddress});
+  });
+  std::sort(ranges.begin(), ranges.end(),
+            [](const CodeRange& a, const CodeRange& b) { return a.begin < b.begin; });
+
+  std::lock_guard<std::mutex> lk(s_counts_mutex);
+  for (; read != written; ++read)
+  {
+    const Sample& sample = s_samples[read % SAMPLE_BUFFER_SIZE];
+    const u8* host_pc = reinterpret_cast<const u8*>(sample.host_pc);
+
+    const auto it =
+        std::upper_bound(ranges.begin(), ranges.end(), host_pc,
+                         [](const u8* pc, const CodeRange& range) { return pc < range.begin; });
+    u32 block = 0;
+    if (it != ranges.begin() && host_pc < std::prev(it)->end)
+      block = std::prev(it)->address;
+
+    // PC isn't updated when jumping between linked blocks, the block is more accurate
+    s_counts[{sample.lr, block ? block : sample.pc, block}]++;
+  }
+  s_samples_read.store(read, std::memory_order_release);
+}
+
+#ifdef __linux__
+static bool s_running = false;
+static timer_t s_timer;
+static struct sigaction s_old_sigaction;
+
+static void SignalHandler(int, siginfo_t*, void* raw_context)
+{
+  const u32 written = s_samples_written.load(std::memory_order_relaxed);
+  if (written - s_samples_read.load(std::memory_order_acquire) >= SAMPLE_BUFFER_SIZE)
+  {
+    s_samples_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  SContext* ctx = &static_cast<ucontext_t*>(raw_context)->uc_mcontext;
+  Sample& sample = s_samples[written % SAMPLE_BUFFER_SIZE];
+#if _M_X86_64
+  sample.host_pc = ctx->CTX_RIP;
+#elif _M_ARM_64
+  sample.host_pc = ctx->CTX_PC;
+#else
+  sample.host_pc = 0;
+#endif
+  sample.pc = PC;
+  sample.lr = LR;
+  s_samples_written.store(written + 1, std::memory_order_release);
+}
+
+// Must be called on the CPU thread, the timer measures its CPU time and interrupts only it.
+static void StartTimer(u32 frequency)
+{
+  struct sigaction sa = {};
+  sa.sa_sigaction = SignalHandler;
+  sa.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  if (sigaction(SIGPROF, &sa, &s_old_sigaction) != 0)
+  {
+    ERROR_LOG_FMT(POWERPC, "SamplingProfiler: sigaction failed");
+    return;
+  }
+
+  clockid_t clock;
+  if (pthread_getcpuclockid(pthread_self(), &clock) != 0)
+    clock = CLOCK_MONOTONIC;
+
+  struct sigevent sev = {};
+  sev.sigev_notify = SIGEV_THREAD_ID;
+  sev.sigev_signo = SIGPROF;
+  sev.sigev_notify_thread_id = static_cast<pid_t>(syscall(SYS_gettid));
+  if (timer_create(clock, &sev, &s_timer) != 0)
+  {
+    ERROR_LOG_FMT(POWERPC, "SamplingProfiler: timer_create failed");
+    sigaction(SIGPROF, &s_old_sigaction, nullptr);
+    return;
+  }
+
+  const long interval_ns = 1000000000L / std::max<u32>(frequency, 1);
+  struct itimerspec spec = {};
+  spec.it_interval.tv_sec = interval_ns / 1000000000L;
+  spec.it_interval.tv_nsec = interval_ns % 1000000000L;
+  spec.it_value = spec.it_interval;
+  timer_settime(s_timer, 0, &spec, nullptr);
+
+  s_running = true;
+  s_fields_until_resolve = RESOLVE_INTERVAL_FIELDS;
+  INFO_LOG_FMT(POWERPC, "SamplingProfiler: sampling at {} Hz", frequency);
+}
+
+static void StopTimer()
+{
+  if (!s_running)
+    return;
+
+  s_running = false;
+  timer_delete(s_timer);
+  sigaction(SIGPROF, &s_old_sigaction, nullptr);
+}
+
+bool IsSupported()
+{
+#if _M_X86_64 || _M_ARM_64
+  return true;
+#else
+  return false;
+#endif
+}
+#else
+static void StartTimer(u32)
+{
+  ERROR_LOG_FMT(POWERPC, "SamplingProfiler: not supported on this platform");
+}
+
+static void StopTimer()
+{
+}
+
+bool IsSupported()
+{
+  return false;
+}
+#endif
+
+void Start(u32 frequency)
+{
+  s_pending_frequency.store(std::max<u32>(frequency, 1));
+}
+
+void OnFrameEnd()
+{
+  const u32 frequency = s_pending_frequency.exchange(0);
+  if (frequency != 0)
+  {
+    StopTimer();
+    ResolveSamples();
+    std::lock_guard<std::mutex> lk(s_counts_mutex);
+    s_counts.clear();
+    s_samples_dropped.store(0);
+    if (IsSupported())
+      StartTimer(frequency);
+    return;
+  }
+
+  if (s_fields_until_resolve != 0 && --s_fields_until_resolve == 0)
+  {
+    s_fields_until_resolve = RESOLVE_INTERVAL_FIELDS;
+    ResolveSamples();
+  }
+}
+
+void Shutdown()
+{
+  StopTimer();
+  ResolveSamples();
+  s_fields_until_resolve = 0;
+}
+
+static std::string GetFrameName(u32 address)
+{
+  const Common::Symbol* symbol = g_symbolDB.GetSymbolFromAddr(address);
+  if (!symbol)
+    return fmt::format("{:08x}", address);
+  // Folded stacks use ';' as separator and ' ' before the count
+  std::string name = symbol->name;
+  std::replace(name.begin(), name.end(), ';', ':');
+  std::replace(name.begin(), name.end(), ' ', '_');
+  return name;
+}
+
+bool StopAndWrite(const std::string& filename)
+{
+  s_pending_frequency.store(0);
+  Core::RunOnCPUThread(
+      [] {
+        StopTimer();
+        ResolveSamples();
+        s_fields_until_resolve = 0;
+      },
+      true);
+
+  std::map<SampleKey, u64> counts;
+  {
+    std::lock_guard<std::mutex> lk(s_counts_mutex);
+    counts.swap(s_counts);
+  }
+  if (counts.empty())
+    return false;
+
+  // Different addresses of the same function end up in the same stack
+  std::map<std::string, u64> stacks;
+  for (const auto& [key, count] : counts)
+  {
+    const auto [lr, pc, block] = key;
+    const std::string function = GetFrameName(pc);
+    const std::string caller = GetFrameName(lr);
+
+    std::string stack = caller == function ? function : caller + ";" + function;
+    stack += block ? fmt::format(";blk_{:08x}", block) : ";[host]";
+    stacks[stack] += count;
+  }
+
+  File::IOFile f(filename, "w");
+  if (!f)
+    return false;
+  for (const auto& [stack, count] : stacks)
+    f.WriteString(fmt::format("{} {}\n", stack, count));
+
+  const u32 dropped = s_samples_dropped.load();
+  if (dropped != 0)
+    WARN_LOG_FMT(POWERPC, "SamplingProfiler: dropped {} samples", dropped);
+  return true;
+}
+}  // namespace SamplingProfiler
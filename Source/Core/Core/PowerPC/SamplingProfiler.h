@@ -0,0 +1,43 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// Sampling profiler for the emulated CPU.
+//
+// Unlike the block profiling of the JITs (see JitInterface::WriteProfileResults), nothing is
+// compiled into the blocks. Instead, a timer interrupts the CPU thread a given number of times per
+// second of its CPU time, and records the host PC as well as the guest PC and LR. Once per second
+// and when writing the results, host PCs are mapped back to the JIT blocks they belong to. With the
+// default frequency, the overhead stays well below 1%, so it can be left running in live sessions.
+//
+// The results are written as folded stacks ("caller;function;block count" per line), the input
+// format of flamegraph.pl and most other flame graph tools. The caller comes from LR, so it is only
+// accurate for leaf functions. Samples outside of JIT code (dispatcher, slow memory accesses,
+// interpreter) end in "[host]" instead of a block.
+//
+// Only available on Linux.
+
+#pragma once
+
+#include <string>
+
+#include "Common/CommonTypes.h"
+
+namespace SamplingProfiler
+{
+// Prime, so that the sampling doesn't run in lockstep with the emulated fields
+constexpr u32 DEFAULT_FREQUENCY = 997;
+
+bool IsSupported();
+
+// Can be called from any thread. The sampling starts at the next field boundary.
+void Start(u32 frequency = DEFAULT_FREQUENCY);
+// Stops sampling and writes all samples since Start. Returns false if nothing was recorded or the
+// file couldn't be written.
+bool StopAndWrite(const std::string& filename);
+
+// Called by the CPU thread at every field boundary.
+void OnFrameEnd();
+// Called by the CPU thread when the emulation stops.
+void Shutdown();
+}  // namespace SamplingProfiler
@@ -0,0 +1,175 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/RAMExport.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Common/Logging/Log.h"
+#include "Core/ConfigManager.h"
+#include "Core/HW/Memmap.h"
+
+// Write tracking is asked about one chunk at a time, which is cheaper than doing it for every page
+constexpr u32 SNAPSHOT_CHUNK_SIZE = 0x10000;
+
+// Creates and maps a shared memory object, or returns nullptr
+static void* MapObject(const std::string& name, size_t size)
+{
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd == -1)
+  {
+    ERROR_LOG_FMT(MEMMAP, "RAMExport: shm_open failed: {}", strerror(errno));
+    return nullptr;
+  }
+
+  void* pointer = MAP_FAILED;
+  if (ftruncate(fd, size) == 0)
+    pointer = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (pointer == MAP_FAILED)
+  {
+    ERROR_LOG_FMT(MEMMAP, "RAMExport: failed to map {}: {}", name, strerror(errno));
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+  return pointer;
+}
+
+RAMExport::RAMExport()
+{
+  const bool wii = SConfig::GetInstance().bWii;
+  const u32 mem1_size = Memory::GetRamSizeReal();
+  const u32 mem2_size = wii ? Memory::GetExRamSizeReal() : 0;
+
+  m_snapshot_size = size_t(mem1_size) + mem2_size;
+  void* snapshots = MapObject(GetSnapshotName(), m_snapshot_size * 2);
+  if (!snapshots)
+    return;
+
+  const std::string name = GetHeaderName();
+  void* header = MapObject(name, sizeof(RAMExportHeader));
+  if (!header)
+  {
+    munmap(snapshots, m_snapshot_size * 2);
+    shm_unlink(GetSnapshotName().c_str());
+    return;
+  }
+
+  m_snapshots = static_cast<u8*>(snapshots);
+  m_header = new (header) RAMExportHeader();
+  m_header->version = RAMExportHeader::VERSION;
+  m_header->seq.store(0, std::memory_order_relaxed);
+  m_header->wii = wii;
+  m_header->frame = 0;
+  m_header->mem1_offset = Memory::GetRamSHMPosition();
+  m_header->mem1_size = mem1_size;
+  m_header->mem2_offset = wii ? Memory::GetExRamSHMPosition() : 0;
+  m_header->mem2_size = mem2_size;
+  m_header->snapshot_index.store(0, std::memory_order_relaxed);
+  for (u32 i = 0; i < 2; ++i)
+  {
+    m_header->snapshots[i].seq.store(0, std::memory_order_relaxed);
+    m_header->snapshots[i].frame = 0;
+    m_header->snapshots[i].offset = m_snapshot_size * i;
+  }
+  // Publish the magic last, so readers never see a half initialized header.
+  std::atomic_thread_fence(std::memory_order_release);
+  m_header->magic = RAMExportHeader::MAGIC;
+
+  NOTICE_LOG_FMT(MEMMAP, "Exporting emulated RAM through {}, {} and {}", GetArenaName(),
+                 GetSnapshotName(), name);
+  m_running = true;
+}
+
+RAMExport::~RAMExport()
+{
+  if (!m_running)
+    return;
+
+  m_running = false;
+  m_header->magic = 0;
+  munmap(m_header, sizeof(RAMExportHeader));
+  munmap(m_snapshots, m_snapshot_size * 2);
+  shm_unlink(GetHeaderName().c_str());
+  shm_unlink(GetSnapshotName().c_str());
+}
+
+std::string RAMExport::GetArenaName()
+{
+  return "/dolphin-emu." + std::to_string(getpid()) + ".ram";
+}
+
+std::string RAMExport::GetSnapshotName()
+{
+  return "/dolphin-emu." + std::to_string(getpid()) + ".snapshot";
+}
+
+std::string RAMExport::GetHeaderName()
+{
+  return "/dolphin-emu." + std::to_string(getpid()) + ".info";
+}
+
+// Copies the chunks of a physical range that may have been written to since write_count,
+// or all of it if write_count is empty, and updates write_count.
+static void CopyRange(u8* dest, const u8* src, u32 address, u32 size,
+                      std::optional<u64>& write_count)
+{
+  // Protecting the range first makes sure that writes during the copy are caught next time
+  const std::optional<u64> new_write_count = Memory::TrackWrites(address, size);
+  if (!write_count || !new_write_count)
+  {
+    std::memcpy(dest, src, size);
+  }
+  else
+  {
+    for (u32 offset = 0; offset < size; offset += SNAPSHOT_CHUNK_SIZE)
+    {
+      const u32 len = std::min(SNAPSHOT_CHUNK_SIZE, size - offset);
+      if (Memory::WrittenSince(address + offset, len, *write_count))
+        std::memcpy(dest + offset, src + offset, len);
+    }
+  }
+  write_count = new_write_count;
+}
+
+void RAMExport::UpdateSnapshot(u32 index)
+{
+  u8* const snapshot = m_snapshots + m_snapshot_size * index;
+  CopyRange(snapshot, Memory::m_pRAM, 0, m_header->mem1_size, m_mem1_write_counts[index]);
+  if (m_header->wii)
+  {
+    CopyRange(snapshot + m_header->mem1_size, Memory::m_pEXRAM, 0x10000000, m_header->mem2_size,
+              m_mem2_write_counts[index]);
+  }
+}
+
+void RAMExport::Step()
+{
+  if (!m_running)
+    return;
+
+  // Only the CPU thread writes, so plain increments are enough on this side.
+  const u32 seq = m_header->seq.load(std::memory_order_relaxed);
+  m_header->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  const u64 frame = ++m_header->frame;
+  m_header->seq.store(seq + 2, std::memory_order_release);
+
+  // Update the snapshot readers aren't pointed at, then point them at it
+  const u32 index = m_header->snapshot_index.load(std::memory_order_relaxed) ^ 1;
+  RAMExportSnapshot& snapshot = m_header->snapshots[index];
+  const u32 snapshot_seq = snapshot.seq.load(std::memory_order_relaxed);
+  snapshot.seq.store(snapshot_seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  UpdateSnapshot(index);
+  snapshot.frame = frame;
+  snapshot.seq.store(snapshot_seq + 2, std::memory_order_release);
+  m_header->snapshot_index.store(index, std::memory_order_release);
+}
@@ -0,0 +1,89 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <optional>
+#include <string>
+
+#include "Common/CommonTypes.h"
+
+// RAMExport makes MEM1 and MEM2 readable by other processes on the same host through POSIX
+// shared memory, without any socket traffic or copying (unlike MemoryWatcher and DolphinWatch).
+//
+// When enabled (Core.RAMExport), three shared memory objects exist while the emulation runs,
+// <pid> being the process id of Dolphin:
+// - "/dolphin-emu.<pid>.ram" is the segment backing the emulated memory itself (see MemArena).
+//   Readers map it read-only and see the emulated RAM live.
+// - "/dolphin-emu.<pid>.snapshot" holds two copies of MEM1 followed by MEM2, which are updated
+//   alternately at the end of every emulated field.
+// - "/dolphin-emu.<pid>.info" contains a RAMExportHeader telling where MEM1 and MEM2 are
+//   located within the other two.
+//
+// The header's seq field counts emulated field boundaries: it is odd while the CPU thread is at
+// a boundary and is increased by 2 for every emulated field. It only guards the header, not the
+// live RAM, which the CPU thread keeps writing during the whole field.
+//
+// The snapshots are consistent copies of the RAM at the end of a field, each guarded by its own
+// seqlock. To read one, load snapshot_index, load the seq of that snapshot, copy the values, and
+// load the seq again; retry if it was odd or changed in between. Since the snapshot that is being
+// updated is never the one snapshot_index points to, readers only have to retry when they took
+// longer than a whole field. Only the pages that were written to since a snapshot was last updated
+// get copied into it again when memory write tracking is available, otherwise all of RAM is.
+struct RAMExportSnapshot
+{
+  std::atomic<u32> seq;
+  u32 padding;
+  // header frame at the end of which the snapshot was taken, 0 if it wasn't yet
+  u64 frame;
+  // relative to the start of the ".snapshot" object; MEM2 directly follows MEM1
+  u64 offset;
+};
+
+struct RAMExportHeader
+{
+  static constexpr u32 MAGIC = 0x4D415244;  // "DRAM" in little endian
+  static constexpr u32 VERSION = 2;
+
+  u32 magic;
+  u32 version;
+  std::atomic<u32> seq;
+  u32 wii;
+  // number of emulated fields since the export was started
+  u64 frame;
+  // offsets are relative to the start of the ".ram" object
+  u32 mem1_offset;
+  u32 mem1_size;
+  u32 mem2_offset;
+  u32 mem2_size;
+  // index of the snapshot that was updated last
+  std::atomic<u32> snapshot_index;
+  u32 padding;
+  RAMExportSnapshot snapshots[2];
+};
+
+class RAMExport final
+{
+public:
+  RAMExport();
+  ~RAMExport();
+  void Step();
+
+  static std::string GetArenaName();
+  static std::string GetSnapshotName();
+  static std::string GetHeaderName();
+
+private:
+  void UpdateSnapshot(u32 index);
+
+  bool m_running = false;
+  RAMExportHeader* m_header = nullptr;
+  u8* m_snapshots = nullptr;
+  size_t m_snapshot_size = 0;
+  // What Memory::TrackWrites returned when each snapshot was last updated, for MEM1 and MEM2
+  std::array<std::optional<u64>, 2> m_mem1_write_counts;
+  std::array<std::optional<u64>, 2> m_mem2_write_counts;
+};
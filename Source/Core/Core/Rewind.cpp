@@ -0,0 +1,262 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/Rewind.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <lzo/lzo1x.h>
+#include <mutex>
+#include <vector>
+
+#include "Common/Logging/Log.h"
+#include "Common/WorkQueueThread.h"
+#include "Core/Config/MainSettings.h"
+#include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/SystemTimers.h"
+#include "Core/State.h"
+
+namespace Rewind
+{
+struct Entry
+{
+  // LZO compressed XOR of this state and the next newer one
+  std::vector<u8> delta;
+  // size of the XOR before compression, which is the larger of both state sizes
+  size_t delta_size;
+  // size of this state
+  size_t size;
+  // emulated time of the capture of the next newer state
+  u64 newer_ticks;
+};
+
+struct Capture
+{
+  std::vector<u8> state;
+  u64 ticks;
+};
+
+static bool s_enabled = false;
+static u32 s_interval;
+static u64 s_max_ticks;
+static size_t s_max_size;
+static u32 s_fields_until_capture;
+
+// Guarded by s_mutex, the worker only holds it briefly around moving buffers in and out.
+// s_newest is only changed by the worker while a capture is pending, and by RewindSteps once the
+// worker is idle, so the worker may read it without the lock.
+static std::mutex s_mutex;
+static std::condition_variable s_idle_cv;
+static bool s_capture_queued = false;
+static u32 s_pending = 0;
+static std::vector<u8> s_newest;
+static u64 s_newest_ticks;
+static std::deque<Entry> s_entries;
+static size_t s_total_size;
+static std::vector<u8> s_work_memory;
+static Common::WorkQueueThread<Capture> s_worker;
+
+static void XorInto(std::vector<u8>& dest, const std::vector<u8>& src)
+{
+  if (dest.size() < src.size())
+    dest.resize(src.size());
+
+  // Plain loop over the bytes, which the compiler vectorizes
+  u8* d = dest.data();
+  const u8* s = src.data();
+  for (size_t i = 0; i < src.size(); ++i)
+    d[i] ^= s[i];
+}
+
+static void ProcessCapture(Capture capture)
+{
+  std::vector<u8> delta;
+  if (!s_newest.empty())
+  {
+    delta = s_newest;
+    XorInto(delta, capture.state);
+  }
+
+  if (delta.empty())
+  {
+    std::lock_guard<std::mutex> lk(s_mutex);
+    s_newest.swap(capture.state);
+    s_newest_ticks = capture.ticks;
+  }
+  else
+  {
+    Entry entry;
+    entry.delta_size = delta.size();
+    entry.size = s_newest.size();
+    entry.delta.resize(delta.size() + delta.size() / 16 + 64 + 3);
+    lzo_uint out_len = 0;
+    if (lzo1x_1_compress(delta.data(), delta.size(), entry.delta.data(), &out_len,
+                         s_work_memory.data()) != LZO_E_OK)
+    {
+      ERROR_LOG_FMT(CORE, "Rewind: compression failed");
+      out_len = 0;
+    }
+    entry.delta.resize(out_len);
+    entry.delta.shrink_to_fit();
+
+    std::lock_guard<std::mutex> lk(s_mutex);
+    s_newest.swap(capture.state);
+    s_newest_ticks = capture.ticks;
+    if (out_len != 0)
+    {
+      entry.newer_ticks = s_newest_ticks;
+      s_total_size += entry.delta.size();
+      s_entries.push_back(std::move(entry));
+    }
+    else
+    {
+      // a gap in the chain makes all older entries unreachable
+      s_entries.clear();
+      s_total_size = 0;
+    }
+
+    // Keep the configured time span, plus one entry so the full span can actually be reached
+    while (!s_entries.empty() && (s_total_size > s_max_size ||
+                                  (s_entries.size() > 1 &&
+                                   s_newest_ticks - s_entries[1].newer_ticks > s_max_ticks)))
+    {
+      s_total_size -= s_entries.front().delta.size();
+      s_entries.pop_front();
+    }
+  }
+
+  std::lock_guard<std::mutex> lk(s_mutex);
+  --s_pending;
+  s_idle_cv.notify_all();
+}
+
+void Init()
+{
+  const u32 seconds = Config::Get(Config::MAIN_REWIND_SECONDS);
+  s_enabled = seconds != 0;
+  if (!s_enabled)
+    return;
+
+  s_interval = std::max(Config::Get(Config::MAIN_REWIND_INTERVAL), 1u);
+  s_max_ticks = u64(seconds) * SystemTimers::GetTicksPerSecond();
+  s_max_size = size_t(Config::Get(Config::MAIN_REWIND_MAX_SIZE_MB)) * 1024 * 1024;
+  s_fields_until_capture = s_interval;
+  s_work_memory.resize(LZO1X_1_MEM_COMPRESS);
+  s_worker.Reset(ProcessCapture);
+  INFO_LOG_FMT(CORE, "Rewind: keeping {} seconds, one state every {} fields", seconds, s_interval);
+}
+
+void Shutdown()
+{
+  if (!s_enabled)
+    return;
+
+  {
+    std::lock_guard<std::mutex> lk(s_mutex);
+    s_enabled = false;
+  }
+  s_worker.Cancel();
+
+  std::lock_guard<std::mutex> lk(s_mutex);
+  s_capture_queued = false;
+  s_pending = 0;
+  std::vector<u8>().swap(s_newest);
+  s_entries.clear();
+  s_total_size = 0;
+  std::vector<u8>().swap(s_work_memory);
+}
+
+static void CaptureState()
+{
+  {
+    std::lock_guard<std::mutex> lk(s_mutex);
+    s_capture_queued = false;
+    // Don't pile up captures if the worker can't keep up, skip this one instead
+    if (!s_enabled || s_pending != 0)
+      return;
+    ++s_pending;
+  }
+
+  Capture capture;
+  capture.ticks = CoreTiming::GetTicks();
+  State::SaveToBuffer(capture.state);
+  s_worker.EmplaceItem(std::move(capture));
+}
+
+void OnFrameEnd()
+{
+  if (!s_enabled || --s_fields_until_capture != 0)
+    return;
+  s_fields_until_capture = s_interval;
+
+  {
+    std::lock_guard<std::mutex> lk(s_mutex);
+    if (s_capture_queued || s_pending != 0)
+      return;
+    s_capture_queued = true;
+  }
+
+  // This is called from the VI event, while CoreTiming and the VI are in the middle of an update.
+  // Save the state once the CPU thread is between slices again, like a regular savestate.
+  Core::QueueHostJob([] { Core::RunOnCPUThread(CaptureState, false); });
+}
+
+u32 GetNumEntries()
+{
+  std::lock_guard<std::mutex> lk(s_mutex);
+  return s_newest.empty() ? 0 : static_cast<u32>(s_entries.size() + 1);
+}
+
+bool RewindSteps(u32 steps)
+{
+  if (!s_enabled)
+    return false;
+
+  bool success = false;
+  Core::RunOnCPUThread(
+      [&] {
+        std::unique_lock<std::mutex> lk(s_mutex);
+        // The CPU thread is the only producer, so once idle the worker stays idle
+        s_idle_cv.wait(lk, [] { return s_pending == 0; });
+        if (s_newest.empty() || steps > s_entries.size())
+          return;
+
+        std::vector<u8> state = s_newest;
+        std::vector<u8> delta;
+        for (u32 i = 0; i < steps; ++i)
+        {
+          const Entry& entry = s_entries[s_entries.size() - 1 - i];
+          delta.resize(entry.delta_size);
+          lzo_uint delta_size = entry.delta_size;
+          if (lzo1x_decompress_safe(entry.delta.data(), entry.delta.size(), delta.data(),
+                                    &delta_size, nullptr) != LZO_E_OK ||
+              delta_size != entry.delta_size)
+          {
+            ERROR_LOG_FMT(CORE, "Rewind: decompression failed");
+            return;
+          }
+          XorInto(state, delta);
+          state.resize(entry.size);
+        }
+
+        for (u32 i = 0; i < steps; ++i)
+        {
+          s_total_size -= s_entries.back().delta.size();
+          s_newest_ticks = s_entries.back().newer_ticks;
+          s_entries.pop_back();
+        }
+        s_newest = state;
+        s_fields_until_capture = s_interval;
+        lk.unlock();
+
+        State::LoadFromBuffer(state);
+        success = true;
+      },
+      true);
+
+  return success;
+}
+}  // namespace Rewind
@@ -0,0 +1,33 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// In-memory rewind buffer.
+//
+// While enabled (Core.RewindSeconds), a state is captured with State::SaveToBuffer every
+// Core.RewindInterval fields. Only the newest state is kept as is; every older one is stored as
+// the LZO compressed XOR of itself and its successor, which is mostly zeros. Computing and
+// compressing these deltas happens on a worker thread, so the CPU thread only pays for
+// serializing the state. Old entries are dropped once the buffer covers more than the configured
+// number of seconds or grows beyond Core.RewindMaxSizeMB.
+
+#pragma once
+
+#include "Common/CommonTypes.h"
+
+namespace Rewind
+{
+void Init();
+void Shutdown();
+
+// Called by the CPU thread at every field boundary. Queues the capture, which runs once the CPU
+// thread is outside of the VI event.
+void OnFrameEnd();
+
+// Returns the number of states that can be rewound to.
+u32 GetNumEntries();
+
+// Loads the state that was captured `steps` captures before the newest one, and drops all
+// newer states. Returns false if there aren't that many states.
+bool RewindSteps(u32 steps);
+}  // namespace Rewind
@@ -4,15 +4,21 @@
 
 #include "Core/State.h"
 
+#include <algorithm>
+#include <cstring>
 #include <lzo/lzo1x.h>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
 #include <utility>
 #include <vector>
 
 #include <fmt/format.h>
+#include <zlib.h>
+#include <zstd.h>
 
 #include "Common/ChunkFile.h"
 #include "Common/CommonTypes.h"
@@ -25,6 +31,7 @@
 #include "Common/Timer.h"
 #include "Common/Version.h"
 
+#include "Core/Config/MainSettings.h"
 #include "Core/ConfigManager.h"
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
@@ -37,6 +44,8 @@
 #include "Core/NetPlayClient.h"
 #include "Core/PowerPC/PowerPC.h"
 
+#include "DiscIO/MultithreadedCompressor.h"
+
 #include "VideoCommon/FrameDump.h"
 #include "VideoCommon/OnScreenDisplay.h"
 #include "VideoCommon/VideoBackendBase.h"
@@ -73,8 +82,77 @@ static Common::Event g_compressAndDumpStateSyncEvent;
 
 static std::thread g_save_thread;
 
+// DoState splits the state into sections, which incremental states diff separately, so that one
+// section changing its size doesn't move the pages of all the sections after it. Emulated RAM has
+// a section of its own, which incremental states diff against emulated memory directly.
+constexpr size_t NUM_STATE_SECTIONS = 7;
+constexpr size_t RAM_SECTION = 4;
+
+// Base for incremental savestates, see SaveBaseAs
+struct IncrementalBase
+{
+  std::vector<u8> buffer;
+  // Where each section of DoState ends in buffer
+  std::vector<size_t> section_ends;
+  std::string filename;
+  u32 crc = 0;
+  // What Memory::TrackWrites returned for MEM1 and MEM2 right before the RAM section of buffer
+  // was written, if emulated RAM was tracked since then
+  std::optional<u64> mem1_write_count;
+  std::optional<u64> mem2_write_count;
+};
+static IncrementalBase s_incremental_base;
+static std::mutex s_incremental_base_mutex;
+
+// Incremental states are stored as regular (compressed) state files, with a payload that starts
+// with an IncrementalHeader instead of the version cookie of DoStateVersion. The header is followed
+// by the file name of the base state and by the sections of the state, each of which is an
+// IncrementalSection followed by the pages that changed, each prefixed by its u32 index within
+// the section.
+constexpr u32 INCREMENTAL_MAGIC = 0x494E4344;  // "INCD"
+constexpr u32 INCREMENTAL_PAGE_SIZE = 4096;
+constexpr u32 INCREMENTAL_MAX_PAGE_SIZE = 1024 * 1024;
+constexpr u32 INCREMENTAL_MAX_SECTIONS = 64;
+
+struct IncrementalHeader
+{
+  u32 magic;
+  u32 page_size;
+  u64 base_size;
+  u32 base_crc;
+  u32 base_filename_size;
+  u32 num_sections;
+  u32 padding;
+};
+
+struct IncrementalSection
+{
+  u64 base_size;
+  u64 size;
+  u32 num_pages;
+  u32 padding;
+};
+
+// States compressed with zstd are split into independently compressed chunks, so that both saving
+// and loading can use all cores. Right after the StateHeader, such a file has a ChunkedHeader, then
+// the compressed size of every chunk as u32, then the chunks. The magic is larger than any chunk
+// size of an LZO compressed state, which is what follows the StateHeader in that format.
+constexpr u32 ZSTD_CHUNKED_MAGIC = 0x5A535443;  // "CTSZ"
+constexpr u32 ZSTD_CHUNK_SIZE = 1024 * 1024;
+constexpr u32 ZSTD_MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+constexpr int ZSTD_COMPRESSION_LEVEL = 1;
+static_assert(ZSTD_CHUNKED_MAGIC > OUT_LEN);
+
+struct ChunkedHeader
+{
+  u32 magic;
+  u32 chunk_size;
+  u32 num_chunks;
+  u32 padding;
+};
+
 // Don't forget to increase this after doing changes on the savestate system
-constexpr u32 STATE_VERSION = 124;  // Last changed in PR 9097
+constexpr u32 STATE_VERSION = 125;  // Last changed for incremental savestates
 
 // Maps savestate versions to Dolphin versions.
 // Versions after 42 don't need to be added to this list,
@@ -146,8 +224,17 @@ static bool DoStateVersion(PointerWrap& p, std::string* version_created_by)
   return true;
 }
 
-static void DoState(PointerWrap& p)
+// Emulated RAM is left out if include_ram is false. In MODE_MEASURE, section_ends receives where
+// each of the NUM_STATE_SECTIONS sections ends, if it isn't null.
+static void DoState(PointerWrap& p, bool include_ram = true,
+                    std::vector<size_t>* section_ends = nullptr)
 {
+  // While measuring, the pointer holds the number of bytes so far
+  const auto end_section = [&] {
+    if (section_ends && p.GetMode() == PointerWrap::MODE_MEASURE)
+      section_ends->push_back(reinterpret_cast<size_t>(*p.ptr));
+  };
+
   std::string version_created_by;
   if (!DoStateVersion(p, &version_created_by))
   {
@@ -194,25 +281,35 @@ static void DoState(PointerWrap& p)
   // state load, and the frame number must be up-to-date.
   Movie::DoState(p);
   p.DoMarker("Movie");
+  end_section();
 
   // Begin with video backend, so that it gets a chance to clear its caches and writeback modified
   // things to RAM
   g_video_backend->DoState(p);
   p.DoMarker("video_backend");
+  end_section();
 
   PowerPC::DoState(p);
   p.DoMarker("PowerPC");
+  end_section();
   // CoreTiming needs to be restored before restoring Hardware because
   // the controller code might need to schedule an event if the controller has changed.
   CoreTiming::DoState(p);
   p.DoMarker("CoreTiming");
+  end_section();
+  if (include_ram)
+    Memory::DoRAMState(p);
+  end_section();
+  p.DoMarker("RAM");
   HW::DoState(p);
   p.DoMarker("HW");
+  end_section();
   if (SConfig::GetInstance().bWii)
     Wiimote::DoState(p);
   p.DoMarker("Wiimote");
   Gecko::DoState(p);
   p.DoMarker("Gecko");
+  end_section();
 }
 
 void LoadFromBuffer(std::vector<u8>& buffer)
@@ -297,14 +394,317 @@ static std::map<double, int> GetSavedStates()
   return m;
 }
 
+enum class SaveMode
+{
+  Regular,
+  Base,
+  Incremental,
+};
+
 struct CompressAndDumpState_args
 {
   std::vector<u8>* buffer_vector;
   std::mutex* buffer_mutex;
   std::string filename;
   bool wait;
+  SaveMode mode = SaveMode::Regular;
+  // Where the sections of the state end in buffer_vector, for SaveMode::Base and Incremental
+  std::vector<size_t> section_ends;
+  // For SaveMode::Base, see IncrementalBase
+  std::optional<u64> mem1_write_count;
+  std::optional<u64> mem2_write_count;
+  // For SaveMode::Incremental, the changed pages of the RAM section, which buffer_vector lacks
+  std::vector<u8> ram_pages;
+  u32 num_ram_pages = 0;
+};
+
+static u32 ComputeCRC(const std::vector<u8>& buffer)
+{
+  u32 crc = crc32(0L, Z_NULL, 0);
+  for (size_t i = 0; i < buffer.size(); i += IN_LEN)
+  {
+    const size_t len = std::min<size_t>(IN_LEN, buffer.size() - i);
+    crc = crc32(crc, buffer.data() + i, static_cast<u32>(len));
+  }
+  return crc;
+}
+
+static bool IsIncremental(const std::vector<u8>& buffer)
+{
+  u32 magic;
+  if (buffer.size() < sizeof(IncrementalHeader))
+    return false;
+  std::memcpy(&magic, buffer.data(), sizeof(magic));
+  return magic == INCREMENTAL_MAGIC;
+}
+
+static size_t GetSectionStart(const std::vector<size_t>& section_ends, size_t section)
+{
+  return section == 0 ? 0 : section_ends[section - 1];
+}
+
+static size_t GetRAMSectionSize()
+{
+  return size_t(Memory::GetRamSize()) + (SConfig::GetInstance().bWii ? Memory::GetExRamSize() : 0);
+}
+
+// Whether an incremental state can be saved relative to base. A base that was loaded from a file
+// doesn't have to match the current memory sizes, since loading it may have failed.
+static bool CanSaveIncremental(const IncrementalBase& base)
+{
+  return base.section_ends.size() == NUM_STATE_SECTIONS &&
+         base.section_ends[RAM_SECTION] - GetSectionStart(base.section_ends, RAM_SECTION) ==
+             GetRAMSectionSize();
+}
+
+static void AppendPage(std::vector<u8>& delta, u32 index, const u8* data, size_t size)
+{
+  const u8* index_ptr = reinterpret_cast<const u8*>(&index);
+  delta.insert(delta.end(), index_ptr, index_ptr + sizeof(index));
+  delta.insert(delta.end(), data, data + size);
+}
+
+// Appends the pages of emulated RAM that differ from the RAM section of base to pages, and returns
+// how many there are. Pages that write tracking knows weren't written to aren't even compared.
+static u32 DiffRAM(const IncrementalBase& base, std::vector<u8>& pages)
+{
+  const u8* const base_ram = base.buffer.data() + GetSectionStart(base.section_ends, RAM_SECTION);
+  const size_t mem1_size = Memory::GetRamSize();
+  const size_t ram_size = GetRAMSectionSize();
+
+  u32 num_pages = 0;
+  for (size_t offset = 0; offset < ram_size; offset += INCREMENTAL_PAGE_SIZE)
+  {
+    const bool is_mem1 = offset < mem1_size;
+    const size_t mem_offset = is_mem1 ? offset : offset - mem1_size;
+    const std::optional<u64>& write_count =
+        is_mem1 ? base.mem1_write_count : base.mem2_write_count;
+    const size_t len = std::min<size_t>(INCREMENTAL_PAGE_SIZE, ram_size - offset);
+    const u32 address = static_cast<u32>(is_mem1 ? mem_offset : 0x10000000 + mem_offset);
+    if (write_count && !Memory::WrittenSince(address, static_cast<u32>(len), *write_count))
+      continue;
+
+    const u8* const data = (is_mem1 ? Memory::m_pRAM : Memory::m_pEXRAM) + mem_offset;
+    if (std::memcmp(data, base_ram + offset, len) == 0)
+      continue;
+
+    AppendPage(pages, static_cast<u32>(offset / INCREMENTAL_PAGE_SIZE), data, len);
+    ++num_pages;
+  }
+  return num_pages;
+}
+
+// Builds the payload of an incremental state from the pages of each section of the state that
+// differ from the same section of base. The RAM section was already diffed by DiffRAM.
+static std::vector<u8> MakeIncremental(const CompressAndDumpState_args& args,
+                                       const IncrementalBase& base)
+{
+  const std::vector<u8>& buffer = *args.buffer_vector;
+
+  std::vector<u8> delta(sizeof(IncrementalHeader));
+  delta.insert(delta.end(), base.filename.begin(), base.filename.end());
+
+  for (size_t i = 0; i < args.section_ends.size(); ++i)
+  {
+    const size_t base_start = GetSectionStart(base.section_ends, i);
+    const size_t start = GetSectionStart(args.section_ends, i);
+
+    IncrementalSection section{};
+    section.base_size = base.section_ends[i] - base_start;
+    section.size = args.section_ends[i] - start;
+
+    const size_t section_pos = delta.size();
+    delta.resize(delta.size() + sizeof(section));
+    if (i == RAM_SECTION)
+    {
+      section.size = section.base_size;
+      section.num_pages = args.num_ram_pages;
+      delta.insert(delta.end(), args.ram_pages.begin(), args.ram_pages.end());
+    }
+    else
+    {
+      for (size_t offset = 0; offset < section.size; offset += INCREMENTAL_PAGE_SIZE)
+      {
+        const size_t len = std::min<size_t>(INCREMENTAL_PAGE_SIZE, section.size - offset);
+        if (offset + len <= section.base_size &&
+            std::memcmp(buffer.data() + start + offset, base.buffer.data() + base_start + offset,
+                        len) == 0)
+        {
+          continue;
+        }
+
+        AppendPage(delta, static_cast<u32>(offset / INCREMENTAL_PAGE_SIZE),
+                   buffer.data() + start + offset, len);
+        ++section.num_pages;
+      }
+    }
+    std::memcpy(delta.data() + section_pos, &section, sizeof(section));
+  }
+
+  IncrementalHeader header{};
+  header.magic = INCREMENTAL_MAGIC;
+  header.page_size = INCREMENTAL_PAGE_SIZE;
+  header.base_size = base.buffer.size();
+  header.base_crc = base.crc;
+  header.base_filename_size = static_cast<u32>(base.filename.size());
+  header.num_sections = static_cast<u32>(args.section_ends.size());
+  std::memcpy(delta.data(), &header, sizeof(header));
+  return delta;
+}
+
+namespace ZstdChunks
+{
+using DiscIO::ConversionResult;
+using DiscIO::ConversionResultCode;
+
+struct CompressThreadState
+{
+  std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> context{nullptr, ZSTD_freeCCtx};
+};
+
+struct DecompressThreadState
+{
+  std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context{nullptr, ZSTD_freeDCtx};
+};
+
+struct ChunkParameters
+{
+  u32 index = 0;
+  const u8* data = nullptr;
+  size_t size = 0;
 };
 
+struct OutputParameters
+{
+  u32 index = 0;
+  std::vector<u8> data;
+};
+
+static bool Write(File::IOFile& f, const u8* data, size_t size)
+{
+  ChunkedHeader header{};
+  header.magic = ZSTD_CHUNKED_MAGIC;
+  header.chunk_size = ZSTD_CHUNK_SIZE;
+  header.num_chunks = static_cast<u32>((size + ZSTD_CHUNK_SIZE - 1) / ZSTD_CHUNK_SIZE);
+
+  // The chunk sizes are only known once everything is compressed, so they get written last
+  std::vector<u32> chunk_sizes(header.num_chunks);
+  const u64 index_position = f.Tell() + sizeof(header);
+  f.WriteArray(&header, 1);
+  f.Seek(sizeof(u32) * header.num_chunks, SEEK_CUR);
+
+  const auto set_up = [](CompressThreadState* state) {
+    state->context.reset(ZSTD_createCCtx());
+    return state->context ? ConversionResultCode::Success : ConversionResultCode::InternalError;
+  };
+
+  const auto compress = [](CompressThreadState* state,
+                           ChunkParameters parameters) -> ConversionResult<OutputParameters> {
+    OutputParameters output{parameters.index, std::vector<u8>(ZSTD_compressBound(parameters.size))};
+    const size_t result =
+        ZSTD_compressCCtx(state->context.get(), output.data.data(), output.data.size(),
+                          parameters.data, parameters.size, ZSTD_COMPRESSION_LEVEL);
+    if (ZSTD_isError(result))
+      return ConversionResultCode::InternalError;
+    output.data.resize(result);
+    return output;
+  };
+
+  // The output thread receives the chunks in order
+  const auto output = [&](OutputParameters parameters) {
+    chunk_sizes[parameters.index] = static_cast<u32>(parameters.data.size());
+    return f.WriteBytes(parameters.data.data(), parameters.data.size()) ?
+               ConversionResultCode::Success :
+               ConversionResultCode::WriteFailed;
+  };
+
+  DiscIO::MultithreadedCompressor<CompressThreadState, ChunkParameters, OutputParameters>
+      compressor(set_up, compress, output);
+  for (u32 i = 0; i < header.num_chunks; ++i)
+  {
+    const size_t offset = size_t(i) * ZSTD_CHUNK_SIZE;
+    const size_t chunk_size = std::min<size_t>(ZSTD_CHUNK_SIZE, size - offset);
+    compressor.CompressAndWrite({i, data + offset, chunk_size});
+  }
+  compressor.Shutdown();
+
+  if (compressor.GetStatus() != ConversionResultCode::Success)
+    return false;
+
+  f.Seek(index_position, SEEK_SET);
+  return f.WriteArray(chunk_sizes.data(), chunk_sizes.size());
+}
+
+// Expects f to be positioned right after the StateHeader of a compressed state.
+static bool IsChunked(File::IOFile& f)
+{
+  const u64 position = f.Tell();
+  u32 magic = 0;
+  f.ReadArray(&magic, 1);
+  f.Seek(position, SEEK_SET);
+  return magic == ZSTD_CHUNKED_MAGIC;
+}
+
+// Expects f to be positioned right after the StateHeader. buffer must already have the
+// uncompressed size that is stored in the StateHeader.
+static bool Read(File::IOFile& f, std::vector<u8>& buffer)
+{
+  ChunkedHeader header;
+  if (!f.ReadArray(&header, 1) || header.magic != ZSTD_CHUNKED_MAGIC || header.chunk_size == 0 ||
+      header.chunk_size > ZSTD_MAX_CHUNK_SIZE ||
+      header.num_chunks != (buffer.size() + header.chunk_size - 1) / header.chunk_size)
+  {
+    return false;
+  }
+
+  std::vector<u32> chunk_sizes(header.num_chunks);
+  if (!f.ReadArray(chunk_sizes.data(), chunk_sizes.size()))
+    return false;
+
+  std::vector<size_t> chunk_offsets(header.num_chunks);
+  size_t compressed_size = 0;
+  for (u32 i = 0; i < header.num_chunks; ++i)
+  {
+    chunk_offsets[i] = compressed_size;
+    compressed_size += chunk_sizes[i];
+  }
+  if (compressed_size != f.GetSize() - f.Tell())
+    return false;
+
+  std::vector<u8> compressed(compressed_size);
+  if (!f.ReadBytes(compressed.data(), compressed.size()))
+    return false;
+
+  // Only the thread pool of MultithreadedCompressor is needed here: every chunk is decompressed
+  // straight into its place in the buffer, so there is nothing left to do for the output thread.
+  const auto set_up = [](DecompressThreadState* state) {
+    state->context.reset(ZSTD_createDCtx());
+    return state->context ? ConversionResultCode::Success : ConversionResultCode::InternalError;
+  };
+
+  const auto decompress = [&](DecompressThreadState* state,
+                              ChunkParameters parameters) -> ConversionResult<u32> {
+    const size_t offset = size_t(parameters.index) * header.chunk_size;
+    const size_t size = std::min<size_t>(header.chunk_size, buffer.size() - offset);
+    const size_t result = ZSTD_decompressDCtx(state->context.get(), buffer.data() + offset, size,
+                                              parameters.data, parameters.size);
+    if (ZSTD_isError(result) || result != size)
+      return ConversionResultCode::InternalError;
+    return parameters.index;
+  };
+
+  const auto output = [](u32) { return ConversionResultCode::Success; };
+
+  DiscIO::MultithreadedCompressor<DecompressThreadState, ChunkParameters, u32> decompressor(
+      set_up, decompress, output);
+  for (u32 i = 0; i < header.num_chunks; ++i)
+    decompressor.CompressAndWrite({i, compressed.data() + chunk_offsets[i], chunk_sizes[i]});
+  decompressor.Shutdown();
+
+  return decompressor.GetStatus() == ConversionResultCode::Success;
+}
+}  // namespace ZstdChunks
+
 static void CompressAndDumpState(CompressAndDumpState_args save_args)
 {
   std::lock_guard<std::mutex> lk(*save_args.buffer_mutex);
@@ -322,13 +722,33 @@ static void CompressAndDumpState(CompressAndDumpState_args save_args)
   if (!save_args.wait)
     on_exit.Exit();
 
-  const u8* const buffer_data = &(*(save_args.buffer_vector))[0];
-  const size_t buffer_size = (save_args.buffer_vector)->size();
   std::string& filename = save_args.filename;
 
   // For easy debugging
   Common::SetCurrentThreadName("SaveState thread");
 
+  std::vector<u8> incremental_buffer;
+  if (save_args.mode == SaveMode::Incremental)
+  {
+    std::lock_guard<std::mutex> base_lk(s_incremental_base_mutex);
+    incremental_buffer = MakeIncremental(save_args, s_incremental_base);
+  }
+  else if (save_args.mode == SaveMode::Base)
+  {
+    std::lock_guard<std::mutex> base_lk(s_incremental_base_mutex);
+    s_incremental_base.buffer = *save_args.buffer_vector;
+    s_incremental_base.section_ends = std::move(save_args.section_ends);
+    s_incremental_base.filename = filename;
+    s_incremental_base.crc = ComputeCRC(s_incremental_base.buffer);
+    s_incremental_base.mem1_write_count = save_args.mem1_write_count;
+    s_incremental_base.mem2_write_count = save_args.mem2_write_count;
+  }
+
+  const std::vector<u8>& buffer =
+      incremental_buffer.empty() ? *save_args.buffer_vector : incremental_buffer;
+  const u8* const buffer_data = buffer.data();
+  const size_t buffer_size = buffer.size();
+
   // Moving to last overwritten save-state
   if (File::Exists(filename))
   {
@@ -363,7 +783,17 @@ static void CompressAndDumpState(CompressAndDumpState_args save_args)
 
   f.WriteArray(&header, 1);
 
-  if (header.size != 0)  // non-zero header size means the state is compressed
+  if (header.size != 0 && Config::Get(Config::MAIN_SAVESTATE_ZSTD))
+  {
+    if (!ZstdChunks::Write(f, buffer_data, buffer_size))
+    {
+      f.Close();
+      File::Delete(filename);
+      Core::DisplayMessage("Could not save state", 2000);
+      return;
+    }
+  }
+  else if (header.size != 0)  // non-zero header size means the state is compressed
   {
     lzo_uint i = 0;
     while (true)
@@ -402,7 +832,7 @@ static void CompressAndDumpState(CompressAndDumpState_args save_args)
   Host_UpdateMainFrame();
 }
 
-void SaveAs(const std::string& filename, bool wait)
+static void SaveAs(const std::string& filename, bool wait, SaveMode mode)
 {
   if (s_load_or_save_in_progress)
     return;
@@ -411,33 +841,60 @@ void SaveAs(const std::string& filename, bool wait)
 
   Core::RunOnCPUThread(
       [&] {
+        CompressAndDumpState_args save_args;
+        save_args.mode = mode;
+
+        // Emulated RAM is diffed right here, while it can't change, and left out of the state
+        if (mode == SaveMode::Incremental)
+        {
+          // The save thread of a previous save may still be setting the base
+          Flush();
+          std::lock_guard<std::mutex> lk(s_incremental_base_mutex);
+          if (CanSaveIncremental(s_incremental_base))
+            save_args.num_ram_pages = DiffRAM(s_incremental_base, save_args.ram_pages);
+          else
+            save_args.mode = SaveMode::Base;
+        }
+        const bool include_ram = save_args.mode != SaveMode::Incremental;
+
         // Measure the size of the buffer.
         u8* ptr = nullptr;
         PointerWrap p(&ptr, PointerWrap::MODE_MEASURE);
-        DoState(p);
+        DoState(p, include_ram, &save_args.section_ends);
         const size_t buffer_size = reinterpret_cast<size_t>(ptr);
 
+        // Writes to RAM after this are caught, so that the next incremental state can skip
+        // comparing the pages of RAM that weren't written to
+        if (save_args.mode == SaveMode::Base)
+        {
+          save_args.mem1_write_count = Memory::TrackWrites(0, Memory::GetRamSizeReal());
+          if (SConfig::GetInstance().bWii)
+          {
+            save_args.mem2_write_count =
+                Memory::TrackWrites(0x10000000, Memory::GetExRamSizeReal());
+          }
+        }
+
         // Then actually do the write.
         {
           std::lock_guard<std::mutex> lk(g_cs_current_buffer);
           g_current_buffer.resize(buffer_size);
           ptr = &g_current_buffer[0];
           p.SetMode(PointerWrap::MODE_WRITE);
-          DoState(p);
+          DoState(p, include_ram);
         }
 
         if (p.GetMode() == PointerWrap::MODE_WRITE)
         {
           Core::DisplayMessage("Saving State...", 1000);
 
-          CompressAndDumpState_args save_args;
           save_args.buffer_vector = &g_current_buffer;
           save_args.buffer_mutex = &g_cs_current_buffer;
           save_args.filename = filename;
           save_args.wait = wait;
 
           Flush();
-          g_save_thread = std::thread(CompressAndDumpState, save_args);
+          g_save_thread = std::thread(CompressAndDumpState, std::move(save_args));
           g_compressAndDumpStateSyncEvent.Wait();
         }
         else
@@ -451,6 +908,21 @@ void SaveAs(const std::string& filename, bool wait)
   s_load_or_save_in_progress = false;
 }
 
+void SaveAs(const std::string& filename, bool wait)
+{
+  SaveAs(filename, wait, SaveMode::Regular);
+}
+
+void SaveBaseAs(const std::string& filename, bool wait)
+{
+  SaveAs(filename, wait, SaveMode::Base);
+}
+
+void SaveIncrementalAs(const std::string& filename, bool wait)
+{
+  SaveAs(filename, wait, SaveMode::Incremental);
+}
+
 bool ReadHeader(const std::string& filename, StateHeader& header)
 {
   Flush();
@@ -489,7 +961,133 @@ u64 GetUnixTimeOfSlot(int slot)
          (Common::Timer::DOUBLE_TIME_OFFSET * MS_PER_SEC);
 }
 
-static void LoadFileStateData(const std::string& filename, std::vector<u8>& ret_data)
+static void LoadFileStateData(const std::string& filename, std::vector<u8>& ret_data,
+                              bool allow_incremental = true);
+
+// Rebuilds the full state from the sections of an incremental state and from its base. If
+// base_section_ends isn't null, it receives where the sections end in the base.
+static bool ApplySections(const std::vector<u8>& delta, const IncrementalHeader& header,
+                          const std::vector<u8>& base, std::vector<u8>& state,
+                          std::vector<size_t>* base_section_ends)
+{
+  size_t pos = sizeof(header) + header.base_filename_size;
+  size_t base_pos = 0;
+  state.clear();
+  state.reserve(base.size());
+  for (u32 i = 0; i < header.num_sections; ++i)
+  {
+    IncrementalSection section;
+    if (delta.size() - pos < sizeof(section))
+      return false;
+    std::memcpy(&section, delta.data() + pos, sizeof(section));
+    pos += sizeof(section);
+
+    // The sections have to add up to the base, and can only grow by the pages that follow them
+    if (section.base_size > base.size() - base_pos ||
+        (section.size > section.base_size && section.size - section.base_size > delta.size() - pos))
+    {
+      return false;
+    }
+
+    const size_t start = state.size();
+    const size_t size = static_cast<size_t>(section.size);
+    const size_t copy_size = static_cast<size_t>(std::min(section.base_size, section.size));
+    state.insert(state.end(), base.begin() + base_pos, base.begin() + base_pos + copy_size);
+    state.resize(start + size);
+    base_pos += static_cast<size_t>(section.base_size);
+    if (base_section_ends)
+      base_section_ends->push_back(base_pos);
+
+    for (u32 j = 0; j < section.num_pages; ++j)
+    {
+      u32 index;
+      if (delta.size() - pos < sizeof(index))
+        return false;
+      std::memcpy(&index, delta.data() + pos, sizeof(index));
+      pos += sizeof(index);
+
+      const size_t offset = size_t(index) * header.page_size;
+      if (offset >= size)
+        return false;
+      const size_t len = std::min<size_t>(header.page_size, size - offset);
+      if (delta.size() - pos < len)
+        return false;
+      std::memcpy(state.data() + start + offset, delta.data() + pos, len);
+      pos += len;
+    }
+  }
+
+  return base_pos == base.size() && pos == delta.size();
+}
+
+// Turns the payload of an incremental state back into the full state, using its base state.
+static bool ApplyIncremental(std::vector<u8>& buffer)
+{
+  IncrementalHeader header;
+  std::memcpy(&header, buffer.data(), sizeof(header));
+  if (header.page_size == 0 || header.page_size > INCREMENTAL_MAX_PAGE_SIZE ||
+      header.num_sections > INCREMENTAL_MAX_SECTIONS ||
+      buffer.size() - sizeof(header) < header.base_filename_size)
+  {
+    Core::DisplayMessage("Invalid incremental state", 2000);
+    return false;
+  }
+
+  const std::string base_filename(
+      reinterpret_cast<const char*>(buffer.data() + sizeof(header)), header.base_filename_size);
+
+  std::vector<u8> state;
+  {
+    // Usually the base is still in memory, from saving it or from loading a previous state
+    std::lock_guard<std::mutex> lk(s_incremental_base_mutex);
+    if (s_incremental_base.filename == base_filename &&
+        s_incremental_base.crc == header.base_crc &&
+        s_incremental_base.buffer.size() == header.base_size)
+    {
+      if (!ApplySections(buffer, header, s_incremental_base.buffer, state, nullptr))
+      {
+        Core::DisplayMessage("Invalid incremental state", 2000);
+        return false;
+      }
+      buffer.swap(state);
+      return true;
+    }
+  }
+
+  IncrementalBase base;
+  LoadFileStateData(base_filename, base.buffer, false);
+  if (base.buffer.empty())
+  {
+    Core::DisplayMessage(fmt::format("Could not load the base state {}", base_filename), 2000);
+    return false;
+  }
+  base.crc = ComputeCRC(base.buffer);
+  if (base.buffer.size() != header.base_size || base.crc != header.base_crc)
+  {
+    Core::DisplayMessage(
+        fmt::format("The base state {} was changed since saving this state", base_filename),
+        2000);
+    return false;
+  }
+  if (!ApplySections(buffer, header, base.buffer, state, &base.section_ends))
+  {
+    Core::DisplayMessage("Invalid incremental state", 2000);
+    return false;
+  }
+  base.filename = base_filename;
+
+  {
+    // Nothing is known about which parts of RAM were written since this base was saved
+    std::lock_guard<std::mutex> lk(s_incremental_base_mutex);
+    s_incremental_base = std::move(base);
+  }
+
+  buffer.swap(state);
+  return true;
+}
+
+static void LoadFileStateData(const std::string& filename, std::vector<u8>& ret_data,
+                              bool allow_incremental)
 {
   Flush();
   File::IOFile f(filename, "rb");
@@ -512,7 +1110,18 @@ static void LoadFileStateData(const std::string& filename, std::vector<u8>& ret_
 
   std::vector<u8> buffer;
 
-  if (header.size != 0)  // non-zero size means the state is compressed
+  if (header.size != 0 && ZstdChunks::IsChunked(f))
+  {
+    Core::DisplayMessage("Decompressing State...", 500);
+
+    buffer.resize(header.size);
+    if (!ZstdChunks::Read(f, buffer))
+    {
+      Core::DisplayMessage("Could not decompress the state, it may be corrupted", 2000);
+      return;
+    }
+  }
+  else if (header.size != 0)  // non-zero size means the state is compressed
   {
     Core::DisplayMessage("Decompressing State...", 500);
 
@@ -553,6 +1162,15 @@ static void LoadFileStateData(const std::string& filename, std::vector<u8>& ret_
     }
   }
 
+  if (IsIncremental(buffer))
+  {
+    // The base of an incremental state must be a full state
+    if (!allow_incremental)
+      return;
+    if (!ApplyIncremental(buffer))
+      return;
+  }
+
   // all good
   ret_data.swap(buffer);
 }
@@ -660,6 +1278,11 @@ void Shutdown()
     std::lock_guard<std::mutex> lk(g_cs_undo_load_buffer);
     std::vector<u8>().swap(g_undo_load_buffer);
   }
+
+  {
+    std::lock_guard<std::mutex> lk(s_incremental_base_mutex);
+    s_incremental_base = {};
+  }
 }
 
 static std::string MakeStateFilename(int number)
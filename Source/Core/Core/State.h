@@ -50,6 +50,17 @@ void Load(int slot);
 void SaveAs(const std::string& filename, bool wait = false);
 bool LoadAs(const std::string& filename);
 
+// Incremental savestates only store the pages of the state that changed since a base state,
+// plus a reference to the file of that base state, which makes frequent checkpoints cheap.
+// Emulated RAM isn't serialized for them at all; when memory write tracking is available, only
+// the pages of RAM that were written to since the base are compared.
+// SaveBaseAs saves a regular state and keeps it in memory as the base for following calls to
+// SaveIncrementalAs. If there is no base yet, SaveIncrementalAs saves a base instead.
+// Incremental states are loaded with LoadAs like any other state, as long as their base state
+// file still exists and hasn't been overwritten.
+void SaveBaseAs(const std::string& filename, bool wait = false);
+void SaveIncrementalAs(const std::string& filename, bool wait = false);
+
 void SaveToBuffer(std::vector<u8>& buffer);
 void LoadFromBuffer(std::vector<u8>& buffer);
 
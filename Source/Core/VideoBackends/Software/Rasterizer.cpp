@@ -5,12 +5,23 @@
 #include "VideoBackends/Software/Rasterizer.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "Common/CommonTypes.h"
+#include "Common/Thread.h"
 #include "VideoBackends/Software/EfbInterface.h"
 #include "VideoBackends/Software/NativeVertexFormat.h"
 #include "VideoBackends/Software/Tev.h"
+#include "VideoBackends/Software/TevJit.h"
+#include "VideoBackends/Software/TextureSampler.h"
+#include "VideoCommon/BoundingBox.h"
 #include "VideoCommon/PerfQueryBase.h"
 #include "VideoCommon/Statistics.h"
 #include "VideoCommon/VideoCommon.h"
@@ -21,22 +32,107 @@ namespace Rasterizer
 {
 static constexpr int BLOCK_SIZE = 2;
 
+// Tiles are aligned to blocks, so all pixels of a block belong to the same tile.
+static constexpr int TILE_SIZE = 32;
+static constexpr int NUM_TILES_X = (EFB_WIDTH + TILE_SIZE - 1) / TILE_SIZE;
+static constexpr int NUM_TILES_Y = (EFB_HEIGHT + TILE_SIZE - 1) / TILE_SIZE;
+static_assert(TILE_SIZE % BLOCK_SIZE == 0);
+
+// Waking up the worker threads isn't worth it for small batches, which are common (e.g. HUD
+// elements). This is the bounding box area of all triangles in a batch.
+static constexpr u32 MIN_PIXELS_FOR_THREADING = 4 * TILE_SIZE * TILE_SIZE;
+static constexpr u32 MAX_THREADS = 16;
+
+// Everything needed to draw a triangle, so that it doesn't depend on the triangles set up after it
+struct Triangle
+{
+  Slope ZSlope;
+  Slope WSlope;
+  Slope ColorSlopes[2][4];
+  Slope TexSlopes[8][3];
+
+  s32 vertex0X;
+  s32 vertex0Y;
+  float vertexOffsetX;
+  float vertexOffsetY;
+
+  // Half-edge constants and deltas
+  s32 C1, C2, C3;
+  s32 DX12, DX23, DX31;
+  s32 DY12, DY23, DY31;
+
+  // Bounding rectangle, minx and miny are aligned to the block size
+  s32 minx, maxx, miny, maxy;
+};
+
+// State of a thread drawing tiles
+struct DrawContext
+{
+  Tev tev;
+  RasterBlock rasterBlock;
+  u32 rasterized_pixels = 0;
+  std::array<u32, PQ_NUM_MEMBERS> perf_query_pixels{};
+};
+
+// Kept across triangles for zfreeze
 static Slope ZSlope;
-static Slope WSlope;
-static Slope ColorSlopes[2][4];
-static Slope TexSlopes[8][3];
 
-static s32 vertex0X;
-static s32 vertex0Y;
-static float vertexOffsetX;
-static float vertexOffsetY;
+static std::vector<Triangle> s_triangles;
+static std::array<std::vector<u32>, NUM_TILES_X * NUM_TILES_Y> s_tile_triangles;
+static std::vector<u32> s_used_tiles;
+static u32 s_pixels_to_draw;
+
+// Context 0 belongs to the GPU thread, the others to the worker threads
+static std::vector<std::unique_ptr<DrawContext>> s_contexts;
+static std::vector<std::thread> s_workers;
+static std::mutex s_work_mutex;
+static std::condition_variable s_work_cv;
+static std::condition_variable s_done_cv;
+static u32 s_work_generation;
+static u32 s_busy_workers;
+static bool s_exit_workers;
+static std::atomic<u32> s_next_tile;
+
+static void DrawTiles(DrawContext& context);
+
+static void WorkerThread(u32 context_index)
+{
+  Common::SetCurrentThreadName("SW Rasterizer");
+
+  DrawContext& context = *s_contexts[context_index];
+  u32 generation = 0;
+
+  std::unique_lock<std::mutex> lk(s_work_mutex);
+  while (true)
+  {
+    s_work_cv.wait(lk, [&] { return s_exit_workers || s_work_generation != generation; });
+    if (s_exit_workers)
+      return;
+    generation = s_work_generation;
+
+    lk.unlock();
+    DrawTiles(context);
+    lk.lock();
 
-static Tev tev;
-static RasterBlock rasterBlock;
+    if (--s_busy_workers == 0)
+      s_done_cv.notify_one();
+  }
+}
 
-void Init()
+void Init(u32 num_threads)
 {
-  tev.Init();
+  if (num_threads == 0)
+    num_threads = std::thread::hardware_concurrency();
+  num_threads = std::clamp<u32>(num_threads, 1, MAX_THREADS);
+  for (u32 i = 0; i < num_threads; i++)
+  {
+    s_contexts.push_back(std::make_unique<DrawContext>());
+    s_contexts.back()->tev.Init();
+  }
+
+  s_exit_workers = false;
+  for (u32 i = 1; i < num_threads; i++)
+    s_workers.emplace_back(WorkerThread, i);
 
   // Set initial z reference plane in the unlikely case that zfreeze is enabled when drawing the
   // first primitive.
@@ -45,6 +141,28 @@ void Init()
   ZSlope.f0 = 1.f;
 }
 
+void Shutdown()
+{
+  {
+    std::lock_guard<std::mutex> lk(s_work_mutex);
+    s_exit_workers = true;
+  }
+  s_work_cv.notify_all();
+  for (std::thread& worker : s_workers)
+    worker.join();
+
+  s_workers.clear();
+  s_contexts.clear();
+  s_triangles.clear();
+  for (std::vector<u32>& triangles : s_tile_triangles)
+    triangles.clear();
+  s_used_tiles.clear();
+  s_pixels_to_draw = 0;
+
+  TevJit::Shutdown();
+  TextureSampler::Shutdown();
+}
+
 // Returns approximation of log2(f) in s28.4
 // results are close enough to use for LOD
 static s32 FixedLog2(float f)
@@ -69,48 +187,53 @@ static inline int iround(float x)
 
 void SetTevReg(int reg, int comp, s16 color)
 {
-  tev.SetRegColor(reg, comp, color);
+  Flush();
+
+  for (auto& context : s_contexts)
+    context->tev.SetRegColor(reg, comp, color);
 }
 
-static void Draw(s32 x, s32 y, s32 xi, s32 yi)
+// Computes the inputs of a pixel for the TEV. Returns false if the pixel fails the early depth test.
+static bool SetupPixel(DrawContext& context, const Triangle& tri, s32 x, s32 y, s32 xi, s32 yi,
+                       Tev::QuadPixel* out)
 {
-  INCSTAT(g_stats.this_frame.rasterized_pixels);
+  context.rasterized_pixels++;
 
-  float dx = vertexOffsetX + (float)(x - vertex0X);
-  float dy = vertexOffsetY + (float)(y - vertex0Y);
+  float dx = tri.vertexOffsetX + (float)(x - tri.vertex0X);
+  float dy = tri.vertexOffsetY + (float)(y - tri.vertex0Y);
 
-  s32 z = (s32)std::clamp<float>(ZSlope.GetValue(dx, dy), 0.0f, 16777215.0f);
+  s32 z = (s32)std::clamp<float>(tri.ZSlope.GetValue(dx, dy), 0.0f, 16777215.0f);
 
   if (bpmem.UseEarlyDepthTest() && g_ActiveConfig.bZComploc)
   {
     // TODO: Test if perf regs are incremented even if test is disabled
-    EfbInterface::IncPerfCounterQuadCount(PQ_ZCOMP_INPUT_ZCOMPLOC);
+    context.perf_query_pixels[PQ_ZCOMP_INPUT_ZCOMPLOC]++;
     if (bpmem.zmode.testenable)
     {
       // early z
       if (!EfbInterface::ZCompare(x, y, z))
-        return;
+        return false;
     }
-    EfbInterface::IncPerfCounterQuadCount(PQ_ZCOMP_OUTPUT_ZCOMPLOC);
+    context.perf_query_pixels[PQ_ZCOMP_OUTPUT_ZCOMPLOC]++;
   }
 
-  RasterBlockPixel& pixel = rasterBlock.Pixel[xi][yi];
+  const RasterBlockPixel& pixel = context.rasterBlock.Pixel[xi][yi];
 
-  tev.Position[0] = x;
-  tev.Position[1] = y;
-  tev.Position[2] = z;
+  out->Position[0] = x;
+  out->Position[1] = y;
+  out->Position[2] = z;
 
   //  colors
   for (unsigned int i = 0; i < bpmem.genMode.numcolchans; i++)
   {
     for (int comp = 0; comp < 4; comp++)
     {
-      u16 color = (u16)ColorSlopes[i][comp].GetValue(dx, dy);
+      u16 color = (u16)tri.ColorSlopes[i][comp].GetValue(dx, dy);
 
       // clamp color value to 0
       u16 mask = ~(color >> 8);
 
-      tev.Color[i][comp] = color & mask;
+      out->Color[i][comp] = color & mask;
     }
   }
 
@@ -118,10 +241,22 @@ static void Draw(s32 x, s32 y, s32 xi, s32 yi)
   for (unsigned int i = 0; i < bpmem.genMode.numtexgens; i++)
   {
     // multiply by 128 because TEV stores UVs as s17.7
-    tev.Uv[i].s = (s32)(pixel.Uv[i][0] * 128);
-    tev.Uv[i].t = (s32)(pixel.Uv[i][1] * 128);
+    out->Uv[i].s = (s32)(pixel.Uv[i][0] * 128);
+    out->Uv[i].t = (s32)(pixel.Uv[i][1] * 128);
   }
 
+  return true;
+}
+
+// Shades the pixels of the current block which were set up with SetupPixel
+static void DrawQuad(DrawContext& context, u32 num_pixels)
+{
+  if (num_pixels == 0)
+    return;
+
+  Tev& tev = context.tev;
+  const RasterBlock& rasterBlock = context.rasterBlock;
+
   for (unsigned int i = 0; i < bpmem.genMode.numindstages; i++)
   {
     tev.IndirectLod[i] = rasterBlock.IndirectLod[i];
@@ -134,19 +269,19 @@ static void Draw(s32 x, s32 y, s32 xi, s32 yi)
     tev.TextureLinear[i] = rasterBlock.TextureLinear[i];
   }
 
-  tev.Draw();
+  tev.DrawQuad(num_pixels);
 }
 
-static void InitTriangle(float X1, float Y1, s32 xi, s32 yi)
+static void InitTriangle(Triangle* tri, float X1, float Y1, s32 xi, s32 yi)
 {
-  vertex0X = xi;
-  vertex0Y = yi;
+  tri->vertex0X = xi;
+  tri->vertex0Y = yi;
 
   // adjust a little less than 0.5
   const float adjust = 0.495f;
 
-  vertexOffsetX = ((float)xi - X1) + adjust;
-  vertexOffsetY = ((float)yi - Y1) + adjust;
+  tri->vertexOffsetX = ((float)xi - X1) + adjust;
+  tri->vertexOffsetY = ((float)yi - Y1) + adjust;
 }
 
 static void InitSlope(Slope* slope, float f1, float f2, float f3, float DX31, float DX12,
@@ -162,7 +297,8 @@ static void InitSlope(Slope* slope, float f1, float f2, float f3, float DX31, fl
   slope->f0 = f1;
 }
 
-static inline void CalculateLOD(s32* lodp, bool* linear, u32 texmap, u32 texcoord)
+static inline void CalculateLOD(const RasterBlock& rasterBlock, s32* lodp, bool* linear, u32 texmap,
+                                u32 texcoord)
 {
   const FourTexUnits& texUnit = bpmem.tex[(texmap >> 2) & 1];
   const u8 subTexmap = texmap & 3;
@@ -175,17 +311,17 @@ static inline void CalculateLOD(s32* lodp, bool* linear, u32 texmap, u32 texcoor
   float sDelta, tDelta;
   if (tm0.diag_lod)
   {
-    float* uv0 = rasterBlock.Pixel[0][0].Uv[texcoord];
-    float* uv1 = rasterBlock.Pixel[1][1].Uv[texcoord];
+    const float* uv0 = rasterBlock.Pixel[0][0].Uv[texcoord];
+    const float* uv1 = rasterBlock.Pixel[1][1].Uv[texcoord];
 
     sDelta = fabsf(uv0[0] - uv1[0]);
     tDelta = fabsf(uv0[1] - uv1[1]);
   }
   else
   {
-    float* uv0 = rasterBlock.Pixel[0][0].Uv[texcoord];
-    float* uv1 = rasterBlock.Pixel[1][0].Uv[texcoord];
-    float* uv2 = rasterBlock.Pixel[0][1].Uv[texcoord];
+    const float* uv0 = rasterBlock.Pixel[0][0].Uv[texcoord];
+    const float* uv1 = rasterBlock.Pixel[1][0].Uv[texcoord];
+    const float* uv2 = rasterBlock.Pixel[0][1].Uv[texcoord];
 
     sDelta = std::max(fabsf(uv0[0] - uv1[0]), fabsf(uv0[0] - uv2[0]));
     tDelta = std::max(fabsf(uv0[1] - uv1[1]), fabsf(uv0[1] - uv2[1]));
@@ -210,7 +346,7 @@ static inline void CalculateLOD(s32* lodp, bool* linear, u32 texmap, u32 texcoor
   *lodp = lod;
 }
 
-static void BuildBlock(s32 blockX, s32 blockY)
+static void BuildBlock(RasterBlock& rasterBlock, const Triangle& tri, s32 blockX, s32 blockY)
 {
   for (s32 yi = 0; yi < BLOCK_SIZE; yi++)
   {
@@ -218,10 +354,10 @@ static void BuildBlock(s32 blockX, s32 blockY)
     {
       RasterBlockPixel& pixel = rasterBlock.Pixel[xi][yi];
 
-      float dx = vertexOffsetX + (float)(xi + blockX - vertex0X);
-      float dy = vertexOffsetY + (float)(yi + blockY - vertex0Y);
+      float dx = tri.vertexOffsetX + (float)(xi + blockX - tri.vertex0X);
+      float dy = tri.vertexOffsetY + (float)(yi + blockY - tri.vertex0Y);
 
-      float invW = 1.0f / WSlope.GetValue(dx, dy);
+      float invW = 1.0f / tri.WSlope.GetValue(dx, dy);
       pixel.InvW = invW;
 
       // tex coords
@@ -230,13 +366,13 @@ static void BuildBlock(s32 blockX, s32 blockY)
         float projection = invW;
         if (xfmem.texMtxInfo[i].projection)
         {
-          float q = TexSlopes[i][2].GetValue(dx, dy) * invW;
+          float q = tri.TexSlopes[i][2].GetValue(dx, dy) * invW;
           if (q != 0.0f)
             projection = invW / q;
         }
 
-        pixel.Uv[i][0] = TexSlopes[i][0].GetValue(dx, dy) * projection;
-        pixel.Uv[i][1] = TexSlopes[i][1].GetValue(dx, dy) * projection;
+        pixel.Uv[i][0] = tri.TexSlopes[i][0].GetValue(dx, dy) * projection;
+        pixel.Uv[i][1] = tri.TexSlopes[i][1].GetValue(dx, dy) * projection;
       }
     }
   }
@@ -249,7 +385,8 @@ static void BuildBlock(s32 blockX, s32 blockY)
     u32 texcoord = indref & 3;
     indref >>= 3;
 
-    CalculateLOD(&rasterBlock.IndirectLod[i], &rasterBlock.IndirectLinear[i], texmap, texcoord);
+    CalculateLOD(rasterBlock, &rasterBlock.IndirectLod[i], &rasterBlock.IndirectLinear[i], texmap,
+                 texcoord);
   }
 
   for (unsigned int i = 0; i <= bpmem.genMode.numtevstages; i++)
@@ -261,7 +398,8 @@ static void BuildBlock(s32 blockX, s32 blockY)
       u32 texmap = order.getTexMap(stageOdd);
       u32 texcoord = order.getTexCoord(stageOdd);
 
-      CalculateLOD(&rasterBlock.TextureLod[i], &rasterBlock.TextureLinear[i], texmap, texcoord);
+      CalculateLOD(rasterBlock, &rasterBlock.TextureLod[i], &rasterBlock.TextureLinear[i], texmap,
+                   texcoord);
     }
   }
 }
@@ -292,15 +430,6 @@ void DrawTriangleFrontFace(const OutputVertexData* v0, const OutputVertexData* v
   const s32 DY23 = Y2 - Y3;
   const s32 DY31 = Y3 - Y1;
 
-  // Fixed-pos32 deltas
-  const s32 FDX12 = DX12 * 16;
-  const s32 FDX23 = DX23 * 16;
-  const s32 FDX31 = DX31 * 16;
-
-  const s32 FDY12 = DY12 * 16;
-  const s32 FDY23 = DY23 * 16;
-  const s32 FDY31 = DY31 * 16;
-
   // Bounding rectangle
   s32 minx = (std::min(std::min(X1, X2), X3) + 0xF) >> 4;
   s32 maxx = (std::max(std::max(X1, X2), X3) + 0xF) >> 4;
@@ -335,6 +464,8 @@ void DrawTriangleFrontFace(const OutputVertexData* v0, const OutputVertexData* v
   if (minx >= maxx || miny >= maxy)
     return;
 
+  Triangle& tri = s_triangles.emplace_back();
+
   // Setup slopes
   float fltx1 = v0->screenPosition.x;
   float flty1 = v0->screenPosition.y;
@@ -343,11 +474,11 @@ void DrawTriangleFrontFace(const OutputVertexData* v0, const OutputVertexData* v
   float fltdy12 = flty1 - v1->screenPosition.y;
   float fltdy31 = v2->screenPosition.y - flty1;
 
-  InitTriangle(fltx1, flty1, (X1 + 0xF) >> 4, (Y1 + 0xF) >> 4);
+  InitTriangle(&tri, fltx1, flty1, (X1 + 0xF) >> 4, (Y1 + 0xF) >> 4);
 
   float w[3] = {1.0f / v0->projectedPosition.w, 1.0f / v1->projectedPosition.w,
                 1.0f / v2->projectedPosition.w};
-  InitSlope(&WSlope, w[0], w[1], w[2], fltdx31, fltdx12, fltdy12, fltdy31);
+  InitSlope(&tri.WSlope, w[0], w[1], w[2], fltdx31, fltdx12, fltdy12, fltdy31);
 
   // TODO: The zfreeze emulation is not quite correct, yet!
   // Many things might prevent us from reaching this line (culling, clipping, scissoring).
@@ -358,19 +489,21 @@ void DrawTriangleFrontFace(const OutputVertexData* v0, const OutputVertexData* v
   if (!bpmem.genMode.zfreeze || !g_ActiveConfig.bZFreeze)
     InitSlope(&ZSlope, v0->screenPosition[2], v1->screenPosition[2], v2->screenPosition[2], fltdx31,
               fltdx12, fltdy12, fltdy31);
+  tri.ZSlope = ZSlope;
 
   for (unsigned int i = 0; i < bpmem.genMode.numcolchans; i++)
   {
     for (int comp = 0; comp < 4; comp++)
-      InitSlope(&ColorSlopes[i][comp], v0->color[i][comp], v1->color[i][comp], v2->color[i][comp],
-                fltdx31, fltdx12, fltdy12, fltdy31);
+      InitSlope(&tri.ColorSlopes[i][comp], v0->color[i][comp], v1->color[i][comp],
+                v2->color[i][comp], fltdx31, fltdx12, fltdy12, fltdy31);
   }
 
   for (unsigned int i = 0; i < bpmem.genMode.numtexgens; i++)
   {
     for (int comp = 0; comp < 3; comp++)
-      InitSlope(&TexSlopes[i][comp], v0->texCoords[i][comp] * w[0], v1->texCoords[i][comp] * w[1],
-                v2->texCoords[i][comp] * w[2], fltdx31, fltdx12, fltdy12, fltdy31);
+      InitSlope(&tri.TexSlopes[i][comp], v0->texCoords[i][comp] * w[0],
+                v1->texCoords[i][comp] * w[1], v2->texCoords[i][comp] * w[2], fltdx31, fltdx12,
+                fltdy12, fltdy31);
   }
 
   // Half-edge constants
@@ -386,9 +519,49 @@ void DrawTriangleFrontFace(const OutputVertexData* v0, const OutputVertexData* v
   if (DY31 < 0 || (DY31 == 0 && DX31 > 0))
     C3++;
 
+  tri.C1 = C1;
+  tri.C2 = C2;
+  tri.C3 = C3;
+  tri.DX12 = DX12;
+  tri.DX23 = DX23;
+  tri.DX31 = DX31;
+  tri.DY12 = DY12;
+  tri.DY23 = DY23;
+  tri.DY31 = DY31;
+
   // Start in corner of 8x8 block
-  minx &= ~(BLOCK_SIZE - 1);
-  miny &= ~(BLOCK_SIZE - 1);
+  tri.minx = minx & ~(BLOCK_SIZE - 1);
+  tri.miny = miny & ~(BLOCK_SIZE - 1);
+  tri.maxx = maxx;
+  tri.maxy = maxy;
+
+  // Bin the triangle into all tiles its bounding box touches
+  const u32 index = static_cast<u32>(s_triangles.size() - 1);
+  for (s32 tile_y = tri.miny / TILE_SIZE; tile_y <= (tri.maxy - 1) / TILE_SIZE; tile_y++)
+  {
+    for (s32 tile_x = tri.minx / TILE_SIZE; tile_x <= (tri.maxx - 1) / TILE_SIZE; tile_x++)
+    {
+      const u32 tile = tile_y * NUM_TILES_X + tile_x;
+      if (s_tile_triangles[tile].empty())
+        s_used_tiles.push_back(tile);
+      s_tile_triangles[tile].push_back(index);
+    }
+  }
+  s_pixels_to_draw += (tri.maxx - tri.minx) * (tri.maxy - tri.miny);
+}
+
+// Draws the blocks of a triangle within the given rectangle, which must be aligned to blocks
+static void DrawBlocks(DrawContext& context, const Triangle& tri, s32 minx, s32 maxx, s32 miny,
+                       s32 maxy)
+{
+  // Fixed-pos32 deltas
+  const s32 FDX12 = tri.DX12 * 16;
+  const s32 FDX23 = tri.DX23 * 16;
+  const s32 FDX31 = tri.DX31 * 16;
+
+  const s32 FDY12 = tri.DY12 * 16;
+  const s32 FDY23 = tri.DY23 * 16;
+  const s32 FDY31 = tri.DY31 * 16;
 
   // Loop through blocks
   for (s32 y = miny; y < maxy; y += BLOCK_SIZE)
@@ -402,29 +575,33 @@ void DrawTriangleFrontFace(const OutputVertexData* v0, const OutputVertexData* v
       s32 y1 = (y + BLOCK_SIZE - 1) << 4;
 
       // Evaluate half-space functions
-      bool a00 = C1 + DX12 * y0 - DY12 * x0 > 0;
-      bool a10 = C1 + DX12 * y0 - DY12 * x1 > 0;
-      bool a01 = C1 + DX12 * y1 - DY12 * x0 > 0;
-      bool a11 = C1 + DX12 * y1 - DY12 * x1 > 0;
+      bool a00 = tri.C1 + tri.DX12 * y0 - tri.DY12 * x0 > 0;
+      bool a10 = tri.C1 + tri.DX12 * y0 - tri.DY12 * x1 > 0;
+      bool a01 = tri.C1 + tri.DX12 * y1 - tri.DY12 * x0 > 0;
+      bool a11 = tri.C1 + tri.DX12 * y1 - tri.DY12 * x1 > 0;
       int a = (a00 << 0) | (a10 << 1) | (a01 << 2) | (a11 << 3);
 
-      bool b00 = C2 + DX23 * y0 - DY23 * x0 > 0;
-      bool b10 = C2 + DX23 * y0 - DY23 * x1 > 0;
-      bool b01 = C2 + DX23 * y1 - DY23 * x0 > 0;
-      bool b11 = C2 + DX23 * y1 - DY23 * x1 > 0;
+      bool b00 = tri.C2 + tri.DX23 * y0 - tri.DY23 * x0 > 0;
+      bool b10 = tri.C2 + tri.DX23 * y0 - tri.DY23 * x1 > 0;
+      bool b01 = tri.C2 + tri.DX23 * y1 - tri.DY23 * x0 > 0;
+      bool b11 = tri.C2 + tri.DX23 * y1 - tri.DY23 * x1 > 0;
       int b = (b00 << 0) | (b10 << 1) | (b01 << 2) | (b11 << 3);
 
-      bool c00 = C3 + DX31 * y0 - DY31 * x0 > 0;
-      bool c10 = C3 + DX31 * y0 - DY31 * x1 > 0;
-      bool c01 = C3 + DX31 * y1 - DY31 * x0 > 0;
-      bool c11 = C3 + DX31 * y1 - DY31 * x1 > 0;
+      bool c00 = tri.C3 + tri.DX31 * y0 - tri.DY31 * x0 > 0;
+      bool c10 = tri.C3 + tri.DX31 * y0 - tri.DY31 * x1 > 0;
+      bool c01 = tri.C3 + tri.DX31 * y1 - tri.DY31 * x0 > 0;
+      bool c11 = tri.C3 + tri.DX31 * y1 - tri.DY31 * x1 > 0;
       int c = (c00 << 0) | (c10 << 1) | (c01 << 2) | (c11 << 3);
 
       // Skip block when outside an edge
       if (a == 0x0 || b == 0x0 || c == 0x0)
         continue;
 
-      BuildBlock(x, y);
+      BuildBlock(context.rasterBlock, tri, x, y);
+
+      // The pixels of a block don't depend on each other, so the early depth test can be done for
+      // all of them before shading them together.
+      u32 num_pixels = 0;
 
       // Accept whole block when totally covered
       if (a == 0xF && b == 0xF && c == 0xF)
@@ -433,15 +610,16 @@ void DrawTriangleFrontFace(const OutputVertexData* v0, const OutputVertexData* v
         {
           for (s32 ix = 0; ix < BLOCK_SIZE; ix++)
           {
-            Draw(x + ix, y + iy, ix, iy);
+            if (SetupPixel(context, tri, x + ix, y + iy, ix, iy, &context.tev.Quad[num_pixels]))
+              num_pixels++;
           }
         }
       }
       else  // Partially covered block
       {
-        s32 CY1 = C1 + DX12 * y0 - DY12 * x0;
-        s32 CY2 = C2 + DX23 * y0 - DY23 * x0;
-        s32 CY3 = C3 + DX31 * y0 - DY31 * x0;
+        s32 CY1 = tri.C1 + tri.DX12 * y0 - tri.DY12 * x0;
+        s32 CY2 = tri.C2 + tri.DX23 * y0 - tri.DY23 * x0;
+        s32 CY3 = tri.C3 + tri.DX31 * y0 - tri.DY31 * x0;
 
         for (s32 iy = 0; iy < BLOCK_SIZE; iy++)
         {
@@ -453,7 +631,8 @@ void DrawTriangleFrontFace(const OutputVertexData* v0, const OutputVertexData* v
           {
             if (CX1 > 0 && CX2 > 0 && CX3 > 0)
             {
-              Draw(x + ix, y + iy, ix, iy);
+              if (SetupPixel(context, tri, x + ix, y + iy, ix, iy, &context.tev.Quad[num_pixels]))
+                num_pixels++;
             }
 
             CX1 -= FDY12;
@@ -466,7 +645,98 @@ void DrawTriangleFrontFace(const OutputVertexData* v0, const OutputVertexData* v
           CY3 += FDX31;
         }
       }
+
+      DrawQuad(context, num_pixels);
     }
   }
 }
+
+static void DrawTile(DrawContext& context, u32 tile)
+{
+  const s32 tile_x = static_cast<s32>(tile % NUM_TILES_X) * TILE_SIZE;
+  const s32 tile_y = static_cast<s32>(tile / NUM_TILES_X) * TILE_SIZE;
+
+  for (u32 index : s_tile_triangles[tile])
+  {
+    const Triangle& tri = s_triangles[index];
+    DrawBlocks(context, tri, std::max(tri.minx, tile_x), std::min(tri.maxx, tile_x + TILE_SIZE),
+               std::max(tri.miny, tile_y), std::min(tri.maxy, tile_y + TILE_SIZE));
+  }
+}
+
+static void DrawTiles(DrawContext& context)
+{
+  const u32 num_tiles = static_cast<u32>(s_used_tiles.size());
+  for (u32 i = s_next_tile.fetch_add(1); i < num_tiles; i = s_next_tile.fetch_add(1))
+    DrawTile(context, s_used_tiles[i]);
+}
+
+void Flush()
+{
+  if (s_triangles.empty())
+    return;
+
+  // The debug dumps of the TEV stages use shared buffers
+  const bool use_workers = !s_workers.empty() && s_used_tiles.size() > 1 &&
+                           s_pixels_to_draw >= MIN_PIXELS_FOR_THREADING &&
+                           !g_ActiveConfig.bDumpTevStages && !g_ActiveConfig.bDumpTevTextureFetches;
+
+  // bpmem doesn't change until the batch is done
+  const TevJit::Pipeline pipeline = TevJit::GetPipeline();
+  for (auto& context : s_contexts)
+    context->tev.SetPipeline(pipeline);
+  TextureSampler::PrepareTextures();
+
+  s_next_tile.store(0);
+  if (use_workers)
+  {
+    {
+      std::lock_guard<std::mutex> lk(s_work_mutex);
+      s_work_generation++;
+      s_busy_workers = static_cast<u32>(s_workers.size());
+    }
+    s_work_cv.notify_all();
+
+    DrawTiles(*s_contexts[0]);
+
+    std::unique_lock<std::mutex> lk(s_work_mutex);
+    s_done_cv.wait(lk, [] { return s_busy_workers == 0; });
+  }
+  else
+  {
+    DrawTiles(*s_contexts[0]);
+  }
+  TextureSampler::ReleaseTextures();
+
+  for (auto& context : s_contexts)
+  {
+    const Tev::Counters& counters = context->tev.counters;
+    ADDSTAT(g_stats.this_frame.rasterized_pixels, context->rasterized_pixels);
+    ADDSTAT(g_stats.this_frame.tev_pixels_in, counters.tev_pixels_in);
+    ADDSTAT(g_stats.this_frame.tev_pixels_out, counters.tev_pixels_out);
+
+    for (u32 i = 0; i < PQ_NUM_MEMBERS; i++)
+    {
+      const u32 num_pixels = context->perf_query_pixels[i] + counters.perf_query_pixels[i];
+      if (num_pixels != 0)
+        EfbInterface::IncPerfCounterQuadCount(static_cast<PerfQueryType>(i), num_pixels);
+    }
+
+    if (counters.bbox_left <= counters.bbox_right)
+    {
+      BoundingBox::Update(counters.bbox_left, counters.bbox_right, counters.bbox_top,
+                          counters.bbox_bottom);
+    }
+
+    context->rasterized_pixels = 0;
+    context->perf_query_pixels = {};
+    context->tev.ResetCounters();
+  }
+
+  for (u32 tile : s_used_tiles)
+    s_tile_triangles[tile].clear();
+  s_used_tiles.clear();
+  s_triangles.clear();
+  s_pixels_to_draw = 0;
+}
 }  // namespace Rasterizer
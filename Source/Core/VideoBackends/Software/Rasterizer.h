@@ -10,11 +10,19 @@ struct OutputVertexData;
 
 namespace Rasterizer
 {
-void Init();
+// Draws with the given number of threads, or with one per hardware thread if it is 0.
+void Init(u32 num_threads = 0);
+void Shutdown();
 
+// Triangles are only set up here, and get drawn by Flush.
 void DrawTriangleFrontFace(const OutputVertexData* v0, const OutputVertexData* v1,
                            const OutputVertexData* v2);
 
+// Draws all triangles since the last flush. The EFB is split into tiles which are drawn in
+// parallel, each one drawing its triangles in order, so the result is the same as when drawing the
+// triangles one after another. Must be called before any state used for drawing changes.
+void Flush();
+
 void SetTevReg(int reg, int comp, s16 color);
 
 struct Slope
@@ -65,32 +65,35 @@ void SWVertexLoader::DrawCurrentBatch(u32 base_index, u32 num_indices, u32 base_
     Rasterizer::SetTevReg(i, Tev::ALP_C, PixelShaderManager::constants.kcolors[i][3]);
   }
 
-  for (u32 i = 0; i < m_index_generator.GetIndexLen(); i++)
+  // parse the videocommon format to our own struct format (m_input_vertices)
+  memset(static_cast<void*>(&m_vertex), 0, sizeof(m_vertex));
+  SetFormat(g_main_cp_state.last_id, primitiveType);
+  const PortableVertexDeclaration& vdec =
+      VertexLoaderManager::GetCurrentVertexFormat()->GetVertexDeclaration();
+  const u32 num_vertices = m_index_generator.GetNumVerts();
+  m_input_vertices.resize(num_vertices);
+  for (u32 i = 0; i < num_vertices; i++)
   {
-    const u16 index = m_cpu_index_buffer[i];
-    memset(static_cast<void*>(&m_vertex), 0, sizeof(m_vertex));
-
-    // parse the videocommon format to our own struct format (m_vertex)
-    SetFormat(g_main_cp_state.last_id, primitiveType);
-    ParseVertex(VertexLoaderManager::GetCurrentVertexFormat()->GetVertexDeclaration(), index);
-
-    // transform this vertex so that it can be used for rasterization (outVertex)
-    OutputVertexData* outVertex = m_setup_unit.GetVertex();
-    TransformUnit::TransformPosition(&m_vertex, outVertex);
-    outVertex->normal = {};
-    if (VertexLoaderManager::g_current_components & VB_HAS_NRM0)
-    {
-      TransformUnit::TransformNormal(
-          &m_vertex, (VertexLoaderManager::g_current_components & VB_HAS_NRM2) != 0, outVertex);
-    }
-    TransformUnit::TransformColor(&m_vertex, outVertex);
-    TransformUnit::TransformTexCoord(&m_vertex, outVertex, m_tex_gen_special_case);
+    m_input_vertices[i] = m_vertex;
+    ParseVertex(vdec, i, &m_input_vertices[i]);
+  }
 
-    // assemble and rasterize the primitive
-    m_setup_unit.SetupVertex();
+  // transform all vertices so that they can be used for rasterization (m_output_vertices),
+  // vertices that are shared by several primitives are only transformed once
+  m_output_vertices.resize(num_vertices);
+  TransformUnit::TransformVertices(
+      m_input_vertices.data(), m_output_vertices.data(), num_vertices,
+      (VertexLoaderManager::g_current_components & VB_HAS_NRM0) != 0,
+      (VertexLoaderManager::g_current_components & VB_HAS_NRM2) != 0, m_tex_gen_special_case);
 
-    INCSTAT(g_stats.this_frame.num_vertices_loaded)
-  }
+  // assemble and rasterize the primitives
+  const u32 num_indices_used = m_index_generator.GetIndexLen();
+  for (u32 i = 0; i < num_indices_used; i++)
+    m_setup_unit.SetupVertex(&m_output_vertices[m_cpu_index_buffer[i]]);
+
+  ADDSTAT(g_stats.this_frame.num_vertices_loaded, num_indices_used);
+
+  Rasterizer::Flush();
 
   DebugUtil::OnObjectEnd();
 }
@@ -215,31 +218,32 @@ static void ParseColorAttributes(InputVertexData* dst, DataReader& src,
   }
 }
 
-void SWVertexLoader::ParseVertex(const PortableVertexDeclaration& vdec, int index)
+void SWVertexLoader::ParseVertex(const PortableVertexDeclaration& vdec, int index,
+                                 InputVertexData* vertex)
 {
   DataReader src(m_cpu_vertex_buffer.data(),
                  m_cpu_vertex_buffer.data() + m_cpu_vertex_buffer.size());
   src.Skip(index * vdec.stride);
 
-  ReadVertexAttribute<float>(&m_vertex.position[0], src, vdec.position, 0, 3, false);
+  ReadVertexAttribute<float>(&vertex->position[0], src, vdec.position, 0, 3, false);
 
-  for (std::size_t i = 0; i < m_vertex.normal.size(); i++)
+  for (std::size_t i = 0; i < vertex->normal.size(); i++)
   {
-    ReadVertexAttribute<float>(&m_vertex.normal[i][0], src, vdec.normals[i], 0, 3, false);
+    ReadVertexAttribute<float>(&vertex->normal[i][0], src, vdec.normals[i], 0, 3, false);
   }
 
-  ParseColorAttributes(&m_vertex, src, vdec);
+  ParseColorAttributes(vertex, src, vdec);
 
-  for (std::size_t i = 0; i < m_vertex.texCoords.size(); i++)
+  for (std::size_t i = 0; i < vertex->texCoords.size(); i++)
   {
-    ReadVertexAttribute<float>(m_vertex.texCoords[i].data(), src, vdec.texcoords[i], 0, 2, false);
+    ReadVertexAttribute<float>(vertex->texCoords[i].data(), src, vdec.texcoords[i], 0, 2, false);
 
     // the texmtr is stored as third component of the texCoord
     if (vdec.texcoords[i].components >= 3)
     {
-      ReadVertexAttribute<u8>(&m_vertex.texMtx[i], src, vdec.texcoords[i], 2, 1, false);
+      ReadVertexAttribute<u8>(&vertex->texMtx[i], src, vdec.texcoords[i], 2, 1, false);
     }
   }
 
-  ReadVertexAttribute<u8>(&m_vertex.posMtx, src, vdec.posmtx, 0, 1, false);
+  ReadVertexAttribute<u8>(&vertex->posMtx, src, vdec.posmtx, 0, 1, false);
 }
@@ -24,9 +24,12 @@ protected:
   void DrawCurrentBatch(u32 base_index, u32 num_indices, u32 base_vertex) override;
 
   void SetFormat(u8 attributeIndex, u8 primitiveType);
-  void ParseVertex(const PortableVertexDeclaration& vdec, int index);
+  void ParseVertex(const PortableVertexDeclaration& vdec, int index, InputVertexData* vertex);
 
+  // The matrix indices from SetFormat, used as the defaults of every vertex
   InputVertexData m_vertex;
+  std::vector<InputVertexData> m_input_vertices;
+  std::vector<OutputVertexData> m_output_vertices;
   SetupUnit m_setup_unit;
 
   bool m_tex_gen_special_case;
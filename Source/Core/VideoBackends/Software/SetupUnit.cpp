@@ -2,8 +2,6 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
-#include <cstring>
-
 #include "VideoBackends/Software/SetupUnit.h"
 
 #include "Common/Logging/Log.h"
@@ -23,14 +21,10 @@ void SetupUnit::Init(u8 primitiveType)
   m_VertWritePointer = m_VertPointer[0];
 }
 
-OutputVertexData* SetupUnit::GetVertex()
+void SetupUnit::SetupVertex(OutputVertexData* vertex)
 {
-  memset(m_VertWritePointer, 0, sizeof(*m_VertWritePointer));
-  return m_VertWritePointer;
-}
+  *m_VertWritePointer = vertex;
 
-void SetupUnit::SetupVertex()
-{
   switch (m_PrimType)
   {
   case OpcodeDecoder::GX_DRAW_QUADS:
@@ -70,12 +64,12 @@ void SetupUnit::SetupQuad()
     return;
   }
 
-  Clipper::ProcessTriangle(m_VertPointer[0], m_VertPointer[1], m_VertPointer[2]);
+  Clipper::ProcessTriangle(*m_VertPointer[0], *m_VertPointer[1], *m_VertPointer[2]);
 
   m_VertexCounter++;
   m_VertexCounter &= 3;
   m_VertWritePointer = &m_Vertices[m_VertexCounter & 1];
-  OutputVertexData* temp = m_VertPointer[1];
+  OutputVertexData** temp = m_VertPointer[1];
   m_VertPointer[1] = m_VertPointer[2];
   m_VertPointer[2] = temp;
 }
@@ -89,7 +83,7 @@ void SetupUnit::SetupTriangle()
     return;
   }
 
-  Clipper::ProcessTriangle(m_VertPointer[0], m_VertPointer[1], m_VertPointer[2]);
+  Clipper::ProcessTriangle(*m_VertPointer[0], *m_VertPointer[1], *m_VertPointer[2]);
 
   m_VertexCounter = 0;
   m_VertWritePointer = m_VertPointer[0];
@@ -104,7 +98,7 @@ void SetupUnit::SetupTriStrip()
     return;
   }
 
-  Clipper::ProcessTriangle(m_VertPointer[0], m_VertPointer[1], m_VertPointer[2]);
+  Clipper::ProcessTriangle(*m_VertPointer[0], *m_VertPointer[1], *m_VertPointer[2]);
 
   m_VertexCounter++;
   m_VertPointer[2 - (m_VertexCounter & 1)] = m_VertPointer[0];
@@ -122,7 +116,7 @@ void SetupUnit::SetupTriFan()
     return;
   }
 
-  Clipper::ProcessTriangle(m_VertPointer[0], m_VertPointer[1], m_VertPointer[2]);
+  Clipper::ProcessTriangle(*m_VertPointer[0], *m_VertPointer[1], *m_VertPointer[2]);
 
   m_VertexCounter++;
   m_VertPointer[1] = m_VertPointer[2];
@@ -140,7 +134,7 @@ void SetupUnit::SetupLine()
     return;
   }
 
-  Clipper::ProcessLine(m_VertPointer[0], m_VertPointer[1]);
+  Clipper::ProcessLine(*m_VertPointer[0], *m_VertPointer[1]);
 
   m_VertexCounter = 0;
   m_VertWritePointer = m_VertPointer[0];
@@ -157,7 +151,7 @@ void SetupUnit::SetupLineStrip()
 
   m_VertexCounter++;
 
-  Clipper::ProcessLine(m_VertPointer[0], m_VertPointer[1]);
+  Clipper::ProcessLine(*m_VertPointer[0], *m_VertPointer[1]);
 
   m_VertWritePointer = m_VertPointer[0];
 
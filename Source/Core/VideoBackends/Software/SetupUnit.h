@@ -12,9 +12,11 @@ class SetupUnit
   u8 m_PrimType;
   int m_VertexCounter;
 
-  OutputVertexData m_Vertices[3];
-  OutputVertexData* m_VertPointer[3];
-  OutputVertexData* m_VertWritePointer;
+  // The vertices of the current primitive are owned by the vertex loader, these slots only point
+  // to them
+  OutputVertexData* m_Vertices[3];
+  OutputVertexData** m_VertPointer[3];
+  OutputVertexData** m_VertWritePointer;
 
   void SetupQuad();
   void SetupTriangle();
@@ -27,7 +29,6 @@ class SetupUnit
 public:
   void Init(u8 primitiveType);
 
-  OutputVertexData* GetVertex();
-
-  void SetupVertex();
+  // The vertex has to stay valid until the primitive has been drawn
+  void SetupVertex(OutputVertexData* vertex);
 };
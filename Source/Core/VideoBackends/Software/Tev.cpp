@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <iterator>
 
 #include "Common/ChunkFile.h"
 #include "Common/CommonTypes.h"
@@ -13,10 +14,8 @@
 #include "VideoBackends/Software/EfbInterface.h"
 #include "VideoBackends/Software/TextureSampler.h"
 
-#include "VideoCommon/BoundingBox.h"
 #include "VideoCommon/PerfQueryBase.h"
 #include "VideoCommon/PixelShaderManager.h"
-#include "VideoCommon/Statistics.h"
 #include "VideoCommon/VideoCommon.h"
 #include "VideoCommon/VideoConfig.h"
 #include "VideoCommon/XFMemory.h"
@@ -160,6 +159,8 @@ void Tev::Init()
   m_ScaleRShiftLUT[1] = 0;
   m_ScaleRShiftLUT[2] = 0;
   m_ScaleRShiftLUT[3] = 1;
+
+  ResetCounters();
 }
 
 static inline s16 Clamp255(s16 in)
@@ -402,7 +403,7 @@ static bool AlphaCompare(int alpha, int ref, AlphaTest::CompareMode comp)
   }
 }
 
-static bool TevAlphaTest(int alpha)
+bool Tev::PassesAlphaTest(u8 alpha)
 {
   const bool comp0 = AlphaCompare(alpha, bpmem.alpha_test.ref0, bpmem.alpha_test.comp0);
   const bool comp1 = AlphaCompare(alpha, bpmem.alpha_test.ref1, bpmem.alpha_test.comp1);
@@ -565,22 +566,8 @@ void Tev::Indirect(unsigned int stageNum, s32 s, s32 t)
   }
 }
 
-void Tev::Draw()
+void Tev::SampleIndirect()
 {
-  ASSERT(Position[0] >= 0 && Position[0] < s32(EFB_WIDTH));
-  ASSERT(Position[1] >= 0 && Position[1] < s32(EFB_HEIGHT));
-
-  INCSTAT(g_stats.this_frame.tev_pixels_in);
-
-  // initial color values
-  for (int i = 0; i < 4; i++)
-  {
-    Reg[i][RED_C] = PixelShaderManager::constants.colors[i][0];
-    Reg[i][GRN_C] = PixelShaderManager::constants.colors[i][1];
-    Reg[i][BLU_C] = PixelShaderManager::constants.colors[i][2];
-    Reg[i][ALP_C] = PixelShaderManager::constants.colors[i][3];
-  }
-
   for (unsigned int stageNum = 0; stageNum < bpmem.genMode.numindstages; stageNum++)
   {
     const int stageNum2 = stageNum >> 1;
@@ -607,45 +594,71 @@ void Tev::Draw()
     }
 #endif
   }
+}
+
+void Tev::PrepareStage(unsigned int stageNum)
+{
+  const int stageNum2 = stageNum >> 1;
+  const int stageOdd = stageNum & 1;
+  const TwoTevStageOrders& order = bpmem.tevorders[stageNum2];
+  const TevStageCombiner::AlphaCombiner& ac = bpmem.combiners[stageNum].alphaC;
+
+  const int texcoordSel = order.getTexCoord(stageOdd);
+  const int texmap = order.getTexMap(stageOdd);
+
+  Indirect(stageNum, Uv[texcoordSel].s, Uv[texcoordSel].t);
+
+  // sample texture
+  if (order.getEnable(stageOdd))
+  {
+    // RGBA
+    u8 texel[4];
+
+    TextureSampler::Sample(TexCoord.s, TexCoord.t, TextureLod[stageNum], TextureLinear[stageNum],
+                           texmap, texel);
+
+#if ALLOW_TEV_DUMPS
+    if (g_ActiveConfig.bDumpTevTextureFetches)
+      DebugUtil::DrawTempBuffer(texel, DIRECT_TFETCH + stageNum);
+#endif
+
+    int swaptable = ac.tswap * 2;
+
+    TexColor[RED_C] = texel[bpmem.tevksel[swaptable].swap1];
+    TexColor[GRN_C] = texel[bpmem.tevksel[swaptable].swap2];
+    swaptable++;
+    TexColor[BLU_C] = texel[bpmem.tevksel[swaptable].swap1];
+    TexColor[ALP_C] = texel[bpmem.tevksel[swaptable].swap2];
+  }
+
+  // set color
+  SetRasColor(order.getColorChan(stageOdd), ac.rswap * 2);
+}
+
+void Tev::ShadePixel(u8 output[4], s16 tex_color[4])
+{
+  // initial color values
+  for (int i = 0; i < 4; i++)
+  {
+    Reg[i][RED_C] = PixelShaderManager::constants.colors[i][0];
+    Reg[i][GRN_C] = PixelShaderManager::constants.colors[i][1];
+    Reg[i][BLU_C] = PixelShaderManager::constants.colors[i][2];
+    Reg[i][ALP_C] = PixelShaderManager::constants.colors[i][3];
+  }
+
+  SampleIndirect();
 
   for (unsigned int stageNum = 0; stageNum <= bpmem.genMode.numtevstages; stageNum++)
   {
     const int stageNum2 = stageNum >> 1;
     const int stageOdd = stageNum & 1;
-    const TwoTevStageOrders& order = bpmem.tevorders[stageNum2];
     const TevKSel& kSel = bpmem.tevksel[stageNum2];
 
     // stage combiners
     const TevStageCombiner::ColorCombiner& cc = bpmem.combiners[stageNum].colorC;
     const TevStageCombiner::AlphaCombiner& ac = bpmem.combiners[stageNum].alphaC;
 
-    const int texcoordSel = order.getTexCoord(stageOdd);
-    const int texmap = order.getTexMap(stageOdd);
-
-    Indirect(stageNum, Uv[texcoordSel].s, Uv[texcoordSel].t);
-
-    // sample texture
-    if (order.getEnable(stageOdd))
-    {
-      // RGBA
-      u8 texel[4];
-
-      TextureSampler::Sample(TexCoord.s, TexCoord.t, TextureLod[stageNum], TextureLinear[stageNum],
-                             texmap, texel);
-
-#if ALLOW_TEV_DUMPS
-      if (g_ActiveConfig.bDumpTevTextureFetches)
-        DebugUtil::DrawTempBuffer(texel, DIRECT_TFETCH + stageNum);
-#endif
-
-      int swaptable = ac.tswap * 2;
-
-      TexColor[RED_C] = texel[bpmem.tevksel[swaptable].swap1];
-      TexColor[GRN_C] = texel[bpmem.tevksel[swaptable].swap2];
-      swaptable++;
-      TexColor[BLU_C] = texel[bpmem.tevksel[swaptable].swap1];
-      TexColor[ALP_C] = texel[bpmem.tevksel[swaptable].swap2];
-    }
+    PrepareStage(stageNum);
 
     // set konst for this stage
     const int kc = kSel.getKC(stageOdd);
@@ -655,9 +668,6 @@ void Tev::Draw()
     StageKonst[BLU_C] = *(m_KonstLUT[kc][BLU_C]);
     StageKonst[ALP_C] = *(m_KonstLUT[ka][ALP_C]);
 
-    // set color
-    SetRasColor(order.getColorChan(stageOdd), ac.rswap * 2);
-
     // combine inputs
     InputRegType inputs[4];
     for (int i = 0; i < 3; i++)
@@ -714,10 +724,22 @@ void Tev::Draw()
   // regardless of the used destination register - TODO: Verify!
   const u32 color_index = bpmem.combiners[bpmem.genMode.numtevstages].colorC.dest;
   const u32 alpha_index = bpmem.combiners[bpmem.genMode.numtevstages].alphaC.dest;
-  u8 output[4] = {(u8)Reg[alpha_index][ALP_C], (u8)Reg[color_index][BLU_C],
-                  (u8)Reg[color_index][GRN_C], (u8)Reg[color_index][RED_C]};
+  output[ALP_C] = (u8)Reg[alpha_index][ALP_C];
+  output[BLU_C] = (u8)Reg[color_index][BLU_C];
+  output[GRN_C] = (u8)Reg[color_index][GRN_C];
+  output[RED_C] = (u8)Reg[color_index][RED_C];
 
-  if (!TevAlphaTest(output[ALP_C]))
+  std::copy(std::begin(TexColor), std::end(TexColor), tex_color);
+}
+
+void Tev::OutputPixel(u8 output[4], const s16 tex_color[4], bool alpha_pass)
+{
+  ASSERT(Position[0] >= 0 && Position[0] < s32(EFB_WIDTH));
+  ASSERT(Position[1] >= 0 && Position[1] < s32(EFB_HEIGHT));
+
+  counters.tev_pixels_in++;
+
+  if (!alpha_pass)
     return;
 
   // z texture
@@ -727,13 +749,13 @@ void Tev::Draw()
     switch (bpmem.ztex2.type)
     {
     case 0:  // 8 bit
-      ztex += TexColor[ALP_C];
+      ztex += tex_color[ALP_C];
       break;
     case 1:  // 16 bit
-      ztex += TexColor[ALP_C] << 8 | TexColor[RED_C];
+      ztex += tex_color[ALP_C] << 8 | tex_color[RED_C];
       break;
     case 2:  // 24 bit
-      ztex += TexColor[RED_C] << 16 | TexColor[GRN_C] << 8 | TexColor[BLU_C];
+      ztex += tex_color[RED_C] << 16 | tex_color[GRN_C] << 8 | tex_color[BLU_C];
       break;
     }
 
@@ -833,16 +855,18 @@ void Tev::Draw()
   if (late_ztest && bpmem.zmode.testenable)
   {
     // TODO: Check against hw if these values get incremented even if depth testing is disabled
-    EfbInterface::IncPerfCounterQuadCount(PQ_ZCOMP_INPUT);
+    counters.perf_query_pixels[PQ_ZCOMP_INPUT]++;
 
     if (!EfbInterface::ZCompare(Position[0], Position[1], Position[2]))
       return;
 
-    EfbInterface::IncPerfCounterQuadCount(PQ_ZCOMP_OUTPUT);
+    counters.perf_query_pixels[PQ_ZCOMP_OUTPUT]++;
   }
 
-  BoundingBox::Update(static_cast<u16>(Position[0]), static_cast<u16>(Position[0]),
-                      static_cast<u16>(Position[1]), static_cast<u16>(Position[1]));
+  counters.bbox_left = std::min(counters.bbox_left, static_cast<u16>(Position[0]));
+  counters.bbox_right = std::max(counters.bbox_right, static_cast<u16>(Position[0]));
+  counters.bbox_top = std::min(counters.bbox_top, static_cast<u16>(Position[1]));
+  counters.bbox_bottom = std::max(counters.bbox_bottom, static_cast<u16>(Position[1]));
 
 #if ALLOW_TEV_DUMPS
   if (g_ActiveConfig.bDumpTevStages)
@@ -864,12 +888,69 @@ void Tev::Draw()
   }
 #endif
 
-  INCSTAT(g_stats.this_frame.tev_pixels_out);
-  EfbInterface::IncPerfCounterQuadCount(PQ_BLEND_INPUT);
+  counters.tev_pixels_out++;
+  counters.perf_query_pixels[PQ_BLEND_INPUT]++;
 
   EfbInterface::BlendTev(Position[0], Position[1], output);
 }
 
+void Tev::Draw()
+{
+  u8 output[4];
+  s16 tex_color[4];
+  ShadePixel(output, tex_color);
+  OutputPixel(output, tex_color, PassesAlphaTest(output[ALP_C]));
+}
+
+void Tev::LoadQuadPixel(u32 index)
+{
+  // Like the rasterizer does for Draw, only set the inputs which are in use
+  const QuadPixel& pixel = Quad[index];
+  std::copy(std::begin(pixel.Position), std::end(pixel.Position), Position);
+  for (u32 i = 0; i < std::min<u32>(bpmem.genMode.numcolchans, 2); i++)
+    std::copy(std::begin(pixel.Color[i]), std::end(pixel.Color[i]), Color[i]);
+  for (u32 i = 0; i < bpmem.genMode.numtexgens; i++)
+    Uv[i] = pixel.Uv[i];
+}
+
+void Tev::DrawQuad(u32 num_pixels)
+{
+#if ALLOW_TEV_DUMPS
+  // The dumps are written per pixel and stage
+  if (g_ActiveConfig.bDumpTevStages || g_ActiveConfig.bDumpTevTextureFetches)
+  {
+    for (u32 i = 0; i < num_pixels; i++)
+    {
+      LoadQuadPixel(i);
+      Draw();
+    }
+    return;
+  }
+#endif
+
+  u8 output[4][4];
+  s16 tex_color[4][4];
+  bool alpha_pass[4];
+  ShadeQuad(num_pixels, output, tex_color, alpha_pass);
+
+  for (u32 i = 0; i < num_pixels; i++)
+  {
+    std::copy(std::begin(Quad[i].Position), std::end(Quad[i].Position), Position);
+    OutputPixel(output[i], tex_color[i], alpha_pass[i]);
+  }
+}
+
+void Tev::ResetCounters()
+{
+  counters.tev_pixels_in = 0;
+  counters.tev_pixels_out = 0;
+  counters.perf_query_pixels = {};
+  counters.bbox_left = 0xFFFF;
+  counters.bbox_right = 0;
+  counters.bbox_top = 0xFFFF;
+  counters.bbox_bottom = 0;
+}
+
 void Tev::SetRegColor(int reg, int comp, s16 color)
 {
   KonstantColors[reg][comp] = color;
@@ -4,7 +4,11 @@
 
 #pragma once
 
+#include <array>
+
+#include "VideoBackends/Software/TevJit.h"
 #include "VideoCommon/BPMemory.h"
+#include "VideoCommon/PerfQueryBase.h"
 
 class Tev
 {
@@ -42,6 +46,8 @@ class Tev
   u8 m_ScaleLShiftLUT[4];
   u8 m_ScaleRShiftLUT[4];
 
+  TevJit::Pipeline m_pipeline = nullptr;
+
   // enumeration for color input LUT
   enum
   {
@@ -66,6 +72,14 @@ class Tev
 
   void Indirect(unsigned int stageNum, s32 s, s32 t);
 
+  // Per pixel parts of the TEV stages, which aren't vectorized
+  void SampleIndirect();
+  void PrepareStage(unsigned int stageNum);
+  void LoadQuadPixel(u32 index);
+
+  // Z texture, fog, depth test and blending of a pixel that went through the alpha test
+  void OutputPixel(u8 output[4], const s16 tex_color[4], bool alpha_pass);
+
 public:
   s32 Position[3];
   u8 Color[2][4];  // must be RGBA for correct swap table ordering
@@ -75,6 +89,20 @@ public:
   s32 TextureLod[16];
   bool TextureLinear[16];
 
+  // Statistics of the pixels drawn by this instance. The rasterizer draws with one instance per
+  // thread, and adds these to the global counters once a batch is done.
+  struct Counters
+  {
+    u32 tev_pixels_in;
+    u32 tev_pixels_out;
+    std::array<u32, PQ_NUM_MEMBERS> perf_query_pixels;
+    u16 bbox_left;
+    u16 bbox_right;
+    u16 bbox_top;
+    u16 bbox_bottom;
+  };
+  Counters counters;
+
   enum
   {
     ALP_C,
@@ -83,9 +111,32 @@ public:
     RED_C
   };
 
+  // Inputs of the pixels of a quad for DrawQuad, in drawing order
+  struct QuadPixel
+  {
+    s32 Position[3];
+    u8 Color[2][4];
+    TextureCoordinateType Uv[8];
+  };
+  QuadPixel Quad[4];
+
   void Init();
 
   void Draw();
+  // Draws the first num_pixels pixels of Quad, with the same result as calling Draw for each of
+  // them. The lod inputs are shared. The TEV stages are evaluated for all pixels at once.
+  void DrawQuad(u32 num_pixels);
+
+  // Only evaluate the TEV stages of Draw and DrawQuad respectively. The outputs are ABGR, tex_color
+  // is the texture color of the last stage. ShadeQuad also does the alpha test.
+  void ShadePixel(u8 output[4], s16 tex_color[4]);
+  void ShadeQuad(u32 num_pixels, u8 output[4][4], s16 tex_color[4][4], bool alpha_pass[4]);
+  static bool PassesAlphaTest(u8 alpha);
+
+  // Pipeline for the current TEV configuration, used by ShadeQuad. nullptr uses generic code.
+  void SetPipeline(TevJit::Pipeline pipeline) { m_pipeline = pipeline; }
+
+  void ResetCounters();
 
   void SetRegColor(int reg, int comp, s16 color);
 };
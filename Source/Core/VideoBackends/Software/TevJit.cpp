@@ -0,0 +1,68 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "VideoBackends/Software/TevJit.h"
+
+#include <memory>
+#include <unordered_map>
+
+#include "Common/CommonTypes.h"
+#include "VideoCommon/BPMemory.h"
+
+#ifdef _M_X86_64
+#include "VideoBackends/Software/TevJitX64.h"
+#endif
+
+TevPipelineUID::TevPipelineUID(const BPMemory& bp)
+{
+  // Registers of unused stages are left zero, so that they don't cause recompiles
+  m_words[0] = bp.genMode.numtevstages;
+  for (u32 i = 0; i < GetNumStages(); i++)
+  {
+    m_words[1 + i * 2] = bp.combiners[i].colorC.hex & 0xffffff;
+    // The swap tables are applied before the combiners
+    m_words[2 + i * 2] = bp.combiners[i].alphaC.hex & 0xfffff0;
+  }
+  m_words[33] = bp.alpha_test.hex & 0xffffff;
+
+  size_t h = SIZE_MAX;
+  for (u32 word : m_words)
+    h = h * 137 + word;
+  m_hash = h;
+}
+
+namespace TevJit
+{
+#ifdef _M_X86_64
+// Only a handful of configurations are used per frame, but games can go through thousands of them.
+// The cache is simply cleared once it's full.
+constexpr size_t MAX_PIPELINES = 1024;
+
+static std::unordered_map<TevPipelineUID, std::unique_ptr<TevJitX64>> s_pipelines;
+#endif
+
+Pipeline GetPipeline()
+{
+#ifdef _M_X86_64
+  const TevPipelineUID uid(bpmem);
+  auto iter = s_pipelines.find(uid);
+  if (iter == s_pipelines.end())
+  {
+    if (s_pipelines.size() >= MAX_PIPELINES)
+      s_pipelines.clear();
+    iter = s_pipelines.emplace(uid, std::make_unique<TevJitX64>(uid)).first;
+  }
+  return iter->second->GetPipeline();
+#else
+  return nullptr;
+#endif
+}
+
+void Shutdown()
+{
+#ifdef _M_X86_64
+  s_pipelines.clear();
+#endif
+}
+}  // namespace TevJit
@@ -0,0 +1,80 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// Pixel pipelines for the TEV combiner stages and the alpha test of a quad (see Tev::ShadeQuad),
+// compiled for one configuration of the TEV registers in bpmem. All selectors, operations, clamps
+// and comparisons are resolved at compile time, which leaves straight-line SIMD code without any
+// per-stage dispatch. Pipelines are cached by the registers they depend on.
+//
+// Only x86-64 hosts are supported, elsewhere the generic code in TevQuad.cpp is used.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <functional>
+
+#include "Common/CommonTypes.h"
+
+struct BPMemory;
+
+// Inputs and outputs of the combiner stages of a quad, with one pixel per vector lane.
+// Components are in ABGR order, like in Tev.
+struct TevQuadData
+{
+  // Texture and rasterized colors, [stage][component][pixel]
+  alignas(16) s32 tex[16][4][4];
+  alignas(16) s32 ras[16][4][4];
+  // Konstant color selected by each stage, [stage][component]
+  s32 konst[16][4];
+  // Initial values of the TEV registers, [register][component]
+  s32 reg_init[4][4];
+  // Working copy of the TEV registers, [register][component][pixel]
+  alignas(16) s32 reg[4][4][4];
+
+  // Output color, [component][pixel]
+  alignas(16) s32 color[4][4];
+  // All bits set if the pixel passed the alpha test
+  alignas(16) s32 alpha_pass[4];
+};
+
+// The bpmem state a pipeline depends on
+class TevPipelineUID
+{
+public:
+  explicit TevPipelineUID(const BPMemory& bp);
+
+  bool operator==(const TevPipelineUID& rh) const { return m_words == rh.m_words; }
+  size_t GetHash() const { return m_hash; }
+
+  u32 GetNumStages() const { return m_words[0] + 1; }
+  u32 GetColorCombiner(u32 stage) const { return m_words[1 + stage * 2]; }
+  u32 GetAlphaCombiner(u32 stage) const { return m_words[2 + stage * 2]; }
+  u32 GetAlphaTest() const { return m_words[33]; }
+
+private:
+  std::array<u32, 34> m_words{};
+  size_t m_hash = 0;
+};
+
+namespace std
+{
+template <>
+struct hash<TevPipelineUID>
+{
+  size_t operator()(const TevPipelineUID& uid) const { return uid.GetHash(); }
+};
+}  // namespace std
+
+namespace TevJit
+{
+using Pipeline = void (*)(TevQuadData* data);
+
+// Returns the pipeline for the current TEV configuration, compiling it on first use. Returns
+// nullptr if pipelines aren't supported on this host. Must not be called while drawing, since all
+// pipelines get freed when too many have been compiled.
+Pipeline GetPipeline();
+
+void Shutdown();
+}  // namespace TevJit
@@ -0,0 +1,526 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "VideoBackends/Software/TevJitX64.h"
+
+#include <cstddef>
+
+#include "Common/BitSet.h"
+#include "Common/CommonTypes.h"
+#include "Common/JitRegister.h"
+#include "Common/x64ABI.h"
+#include "Common/x64Emitter.h"
+#include "VideoCommon/BPMemory.h"
+
+using namespace Gen;
+
+static const X64Reg data_reg = ABI_PARAM1;
+static const X64Reg scratch_reg = RAX;
+
+// Constants, loaded once in the prologue
+static const X64Reg mask_u8 = XMM15;  // 0xff in every dword
+static const X64Reg const_256 = XMM14;
+static const X64Reg zero = XMM13;
+static const X64Reg max_s11 = XMM12;  // 1023 in every word
+static const X64Reg min_s11 = XMM7;   // -1024 in every word
+
+// The results of the current stage are kept in XMM8 to XMM11 until all of its inputs have been
+// read. Each result is computed in XMM5, since the emitter can't encode the arithmetic shifts for
+// XMM8 and up. XMM0 to XMM4 are scratch registers.
+static const X64Reg combine_reg = XMM5;
+static X64Reg ResultReg(int comp)
+{
+  return static_cast<X64Reg>(XMM8 + comp);
+}
+
+// color order: ABGR, like Tev
+enum
+{
+  ALP_C,
+  BLU_C,
+  GRN_C,
+  RED_C
+};
+
+static s32 TexOffset(u32 stage, int comp)
+{
+  return static_cast<s32>(offsetof(TevQuadData, tex) + (stage * 4 + comp) * 16);
+}
+
+static s32 RasOffset(u32 stage, int comp)
+{
+  return static_cast<s32>(offsetof(TevQuadData, ras) + (stage * 4 + comp) * 16);
+}
+
+static s32 KonstOffset(u32 stage, int comp)
+{
+  return static_cast<s32>(offsetof(TevQuadData, konst) + (stage * 4 + comp) * 4);
+}
+
+static s32 RegInitOffset(u32 reg, int comp)
+{
+  return static_cast<s32>(offsetof(TevQuadData, reg_init) + (reg * 4 + comp) * 4);
+}
+
+static s32 RegOffset(u32 reg, int comp)
+{
+  return static_cast<s32>(offsetof(TevQuadData, reg) + (reg * 4 + comp) * 16);
+}
+
+static s32 ColorOffset(int comp)
+{
+  return static_cast<s32>(offsetof(TevQuadData, color) + comp * 16);
+}
+
+TevJitX64::TevJitX64(const TevPipelineUID& uid) : m_uid(uid)
+{
+  // A stage takes less than 1.5 KiB even with the longest input selections
+  AllocCodeSpace(1024 + uid.GetNumStages() * 2048);
+  ClearCodeSpace();
+  m_pipeline = reinterpret_cast<TevJit::Pipeline>(region);
+  GeneratePipeline();
+  WriteProtect();
+
+  JitRegister::Register(region, GetCodePtr(), "SWTevPipeline_%016zx", uid.GetHash());
+}
+
+TevJitX64::Operand TevJitX64::GetOperand(u32 stage, int comp, int input) const
+{
+  const auto reg_operand = [this](u32 reg, int reg_comp) -> Operand {
+    // Registers that haven't been written yet still hold their initial value in every lane
+    if (m_reg_written[reg][reg_comp])
+      return {Operand::Type::Vector, RegOffset(reg, reg_comp), false};
+    return {Operand::Type::Scalar, RegInitOffset(reg, reg_comp), false};
+  };
+
+  if (comp == ALP_C)
+  {
+    TevStageCombiner::AlphaCombiner ac;
+    ac.hex = m_uid.GetAlphaCombiner(stage);
+    const u32 selects[4] = {ac.a, ac.b, ac.c, ac.d};
+    switch (selects[input])
+    {
+    case TEVALPHAARG_TEXA:
+      return {Operand::Type::Vector, TexOffset(stage, ALP_C), true};
+    case TEVALPHAARG_RASA:
+      return {Operand::Type::Vector, RasOffset(stage, ALP_C), true};
+    case TEVALPHAARG_KONST:
+      return {Operand::Type::Scalar, KonstOffset(stage, ALP_C), false};
+    case TEVALPHAARG_ZERO:
+      return {Operand::Type::Constant, 0, true};
+    default:
+      return reg_operand(selects[input], ALP_C);
+    }
+  }
+
+  TevStageCombiner::ColorCombiner cc;
+  cc.hex = m_uid.GetColorCombiner(stage);
+  const u32 selects[4] = {cc.a, cc.b, cc.c, cc.d};
+  switch (selects[input])
+  {
+  case TEVCOLORARG_TEXC:
+    return {Operand::Type::Vector, TexOffset(stage, comp), true};
+  case TEVCOLORARG_TEXA:
+    return {Operand::Type::Vector, TexOffset(stage, ALP_C), true};
+  case TEVCOLORARG_RASC:
+    return {Operand::Type::Vector, RasOffset(stage, comp), true};
+  case TEVCOLORARG_RASA:
+    return {Operand::Type::Vector, RasOffset(stage, ALP_C), true};
+  case TEVCOLORARG_ONE:
+    return {Operand::Type::Constant, 255, true};
+  case TEVCOLORARG_HALF:
+    return {Operand::Type::Constant, 128, true};
+  case TEVCOLORARG_KONST:
+    return {Operand::Type::Scalar, KonstOffset(stage, comp), false};
+  case TEVCOLORARG_ZERO:
+    return {Operand::Type::Constant, 0, true};
+  default:
+    return reg_operand(selects[input] >> 1, (selects[input] & 1) ? ALP_C : comp);
+  }
+}
+
+void TevJitX64::LoadConstant(X64Reg reg, s32 value)
+{
+  if (value == 0)
+  {
+    PXOR(reg, R(reg));
+    return;
+  }
+  MOV(32, R(scratch_reg), Imm32(static_cast<u32>(value)));
+  MOVD_xmm(reg, R(scratch_reg));
+  PSHUFD(reg, R(reg), 0);
+}
+
+void TevJitX64::LoadInput(X64Reg reg, const Operand& operand, bool is_d)
+{
+  switch (operand.type)
+  {
+  case Operand::Type::Constant:
+    LoadConstant(reg, is_d ? static_cast<s32>(static_cast<u32>(operand.value) << 21) >> 21 :
+                             operand.value & 0xff);
+    return;
+  case Operand::Type::Vector:
+    MOVDQA(reg, MDisp(data_reg, operand.value));
+    break;
+  case Operand::Type::Scalar:
+    MOVD_xmm(reg, MDisp(data_reg, operand.value));
+    PSHUFD(reg, R(reg), 0);
+    break;
+  }
+
+  if (operand.is_u8)
+    return;
+
+  if (is_d)
+  {
+    // 11 bit signed
+    PSLLD(reg, 21);
+    PSRAD(reg, 21);
+  }
+  else
+  {
+    PAND(reg, R(mask_u8));
+  }
+}
+
+// Same as Tev::DrawColorRegular and Tev::DrawAlphaRegular
+void TevJitX64::CombineRegular(X64Reg dest, u32 stage, int comp)
+{
+  static constexpr int lshift[4] = {0, 1, 2, 0};
+  static constexpr int rshift[4] = {0, 0, 0, 1};
+  static constexpr s32 bias_values[4] = {0, 128, -128, 0};
+
+  const bool is_alpha = comp == ALP_C;
+  TevStageCombiner::ColorCombiner cc;
+  cc.hex = m_uid.GetColorCombiner(stage);
+  TevStageCombiner::AlphaCombiner ac;
+  ac.hex = m_uid.GetAlphaCombiner(stage);
+  const u32 bias = is_alpha ? ac.bias : cc.bias;
+  const u32 op = is_alpha ? ac.op : cc.op;
+  const u32 shift = is_alpha ? ac.shift : cc.shift;
+
+  // The rounding of the alpha combiner differs
+  s32 rounding;
+  if (is_alpha)
+    rounding = (shift != 3) ? 0 : (op == 1) ? 127 : 128;
+  else
+    rounding = (shift == 3) ? 0 : (op == 1) ? 127 : 128;
+
+  const Operand a = GetOperand(stage, comp, 0);
+  const Operand b = GetOperand(stage, comp, 1);
+  const Operand c = GetOperand(stage, comp, 2);
+
+  // temp = a * (256 - c) + b * c, rounded. Folded if all of it is constant, so temp_value is
+  // valid if temp_is_constant and XMM0 otherwise.
+  const bool temp_is_constant = a.type == Operand::Type::Constant &&
+                                b.type == Operand::Type::Constant &&
+                                c.type == Operand::Type::Constant;
+  s32 temp_value = 0;
+  if (temp_is_constant)
+  {
+    const s32 c_value = c.value + (c.value >> 7);
+    s32 temp = (a.value * (256 - c_value) + b.value * c_value) << lshift[shift];
+    temp += rounding;
+    if (is_alpha)
+      temp_value = op ? -temp >> 8 : temp >> 8;
+    else
+      temp_value = op ? -(temp >> 8) : temp >> 8;
+  }
+  else
+  {
+    if (c.type == Operand::Type::Constant)
+    {
+      const s32 c_value = c.value + (c.value >> 7);
+      if (c_value == 0)
+      {
+        LoadInput(XMM0, a, false);
+        PSLLD(XMM0, 8);
+      }
+      else if (c_value == 256)
+      {
+        LoadInput(XMM0, b, false);
+        PSLLD(XMM0, 8);
+      }
+      else
+      {
+        LoadInput(XMM0, a, false);
+        LoadInput(XMM1, b, false);
+        PSLLD(XMM1, 16);
+        POR(XMM0, R(XMM1));
+        LoadConstant(XMM2, (256 - c_value) | (c_value << 16));
+        PMADDWD(XMM0, R(XMM2));
+      }
+    }
+    else
+    {
+      LoadInput(XMM0, a, false);
+      LoadInput(XMM1, b, false);
+      LoadInput(XMM2, c, false);
+      // c += c >> 7
+      MOVDQA(XMM3, R(XMM2));
+      PSRLD(XMM3, 7);
+      PADDD(XMM2, R(XMM3));
+      // The words of each dword hold (a, b) and (256 - c, c)
+      PSLLD(XMM1, 16);
+      POR(XMM0, R(XMM1));
+      MOVDQA(XMM3, R(const_256));
+      PSUBD(XMM3, R(XMM2));
+      PSLLD(XMM2, 16);
+      POR(XMM3, R(XMM2));
+      PMADDWD(XMM0, R(XMM3));
+    }
+
+    if (lshift[shift] != 0)
+      PSLLD(XMM0, lshift[shift]);
+    if (rounding != 0)
+    {
+      LoadConstant(XMM1, rounding);
+      PADDD(XMM0, R(XMM1));
+    }
+    if (is_alpha && op)
+    {
+      MOVDQA(XMM1, R(zero));
+      PSUBD(XMM1, R(XMM0));
+      MOVDQA(XMM0, R(XMM1));
+    }
+    PSRAD(XMM0, 8);
+  }
+
+  LoadInput(dest, GetOperand(stage, comp, 3), true);
+  if (bias_values[bias] != 0)
+  {
+    LoadConstant(XMM1, bias_values[bias]);
+    PADDD(dest, R(XMM1));
+  }
+  if (lshift[shift] != 0)
+    PSLLD(dest, lshift[shift]);
+
+  if (temp_is_constant)
+  {
+    if (temp_value != 0)
+    {
+      LoadConstant(XMM1, temp_value);
+      PADDD(dest, R(XMM1));
+    }
+  }
+  else if (!is_alpha && op)
+  {
+    PSUBD(dest, R(XMM0));
+  }
+  else
+  {
+    PADDD(dest, R(XMM0));
+  }
+
+  if (rshift[shift] != 0)
+    PSRAD(dest, rshift[shift]);
+}
+
+// Same as Tev::DrawColorCompare and Tev::DrawAlphaCompare
+void TevJitX64::CombineCompare(X64Reg dest, u32 stage, int comp)
+{
+  u32 mode;
+  if (comp == ALP_C)
+  {
+    TevStageCombiner::AlphaCombiner ac;
+    ac.hex = m_uid.GetAlphaCombiner(stage);
+    mode = (ac.shift << 1) | ac.op;
+  }
+  else
+  {
+    TevStageCombiner::ColorCombiner cc;
+    cc.hex = m_uid.GetColorCombiner(stage);
+    mode = (cc.shift << 1) | cc.op;
+  }
+
+  // Input a or b of the compared components, the alpha combiner compares the color inputs too
+  const auto load_compared = [&](X64Reg reg, int input) {
+    switch (mode >> 1)
+    {
+    case TEVCMP_R8:
+      LoadInput(reg, GetOperand(stage, RED_C, input), false);
+      break;
+    case TEVCMP_GR16:
+      LoadInput(reg, GetOperand(stage, GRN_C, input), false);
+      PSLLD(reg, 8);
+      LoadInput(XMM3, GetOperand(stage, RED_C, input), false);
+      POR(reg, R(XMM3));
+      break;
+    case TEVCMP_BGR24:
+      LoadInput(reg, GetOperand(stage, BLU_C, input), false);
+      PSLLD(reg, 8);
+      LoadInput(XMM3, GetOperand(stage, GRN_C, input), false);
+      POR(reg, R(XMM3));
+      PSLLD(reg, 8);
+      LoadInput(XMM3, GetOperand(stage, RED_C, input), false);
+      POR(reg, R(XMM3));
+      break;
+    default:  // TEVCMP_RGB8 and TEVCMP_A8
+      LoadInput(reg, GetOperand(stage, comp, input), false);
+      break;
+    }
+  };
+
+  load_compared(XMM0, 0);
+  load_compared(XMM1, 1);
+  if (mode & 1)
+    PCMPEQD(XMM0, R(XMM1));
+  else
+    PCMPGTD(XMM0, R(XMM1));
+
+  LoadInput(XMM2, GetOperand(stage, comp, 2), false);
+  PAND(XMM0, R(XMM2));
+  LoadInput(dest, GetOperand(stage, comp, 3), true);
+  PADDD(dest, R(XMM0));
+}
+
+void TevJitX64::ClampResult(X64Reg dest, bool clamp)
+{
+  // The registers of Tev are 16 bit
+  PSLLD(dest, 16);
+  PSRAD(dest, 16);
+  PACKSSDW(dest, R(dest));
+
+  if (clamp)
+  {
+    // Saturate to [0, 255] and zero extend again
+    PACKUSWB(dest, R(dest));
+    PUNPCKLBW(dest, R(zero));
+    PUNPCKLWD(dest, R(zero));
+  }
+  else
+  {
+    PMINSW(dest, R(max_s11));
+    PMAXSW(dest, R(min_s11));
+    PUNPCKLWD(dest, R(dest));
+    PSRAD(dest, 16);
+  }
+}
+
+// Same as AlphaCompare in Tev.cpp. Clobbers XMM4.
+void TevJitX64::AlphaCompare(X64Reg dest, X64Reg alpha, u32 comp, u32 ref)
+{
+  switch (comp)
+  {
+  case AlphaTest::NEVER:
+    PXOR(dest, R(dest));
+    break;
+  case AlphaTest::LESS:
+    LoadConstant(dest, ref);
+    PCMPGTD(dest, R(alpha));
+    break;
+  case AlphaTest::LEQUAL:
+    LoadConstant(dest, ref + 1);
+    PCMPGTD(dest, R(alpha));
+    break;
+  case AlphaTest::GREATER:
+    MOVDQA(dest, R(alpha));
+    LoadConstant(XMM4, ref);
+    PCMPGTD(dest, R(XMM4));
+    break;
+  case AlphaTest::GEQUAL:
+    MOVDQA(dest, R(alpha));
+    LoadConstant(XMM4, static_cast<s32>(ref) - 1);
+    PCMPGTD(dest, R(XMM4));
+    break;
+  case AlphaTest::EQUAL:
+  case AlphaTest::NEQUAL:
+    MOVDQA(dest, R(alpha));
+    LoadConstant(XMM4, ref);
+    PCMPEQD(dest, R(XMM4));
+    if (comp == AlphaTest::NEQUAL)
+    {
+      PCMPEQD(XMM4, R(XMM4));
+      PXOR(dest, R(XMM4));
+    }
+    break;
+  default:  // ALWAYS
+    PCMPEQD(dest, R(dest));
+    break;
+  }
+}
+
+void TevJitX64::GeneratePipeline()
+{
+  // XMM6 to XMM15 are callee saved on Windows
+  const BitSet32 used_regs = ABI_ALL_CALLEE_SAVED & BitSet32{XMM7 + 16,  XMM8 + 16,  XMM9 + 16,
+                                                             XMM10 + 16, XMM11 + 16, XMM12 + 16,
+                                                             XMM13 + 16, XMM14 + 16, XMM15 + 16};
+  ABI_PushRegistersAndAdjustStack(used_regs, 8);
+
+  LoadConstant(mask_u8, 0xff);
+  LoadConstant(const_256, 256);
+  PXOR(zero, R(zero));
+  LoadConstant(max_s11, 0x03ff03ff);
+  LoadConstant(min_s11, static_cast<s32>(0xfc00fc00));
+
+  const u32 num_stages = m_uid.GetNumStages();
+  for (u32 stage = 0; stage < num_stages; stage++)
+  {
+    TevStageCombiner::ColorCombiner cc;
+    cc.hex = m_uid.GetColorCombiner(stage);
+    TevStageCombiner::AlphaCombiner ac;
+    ac.hex = m_uid.GetAlphaCombiner(stage);
+
+    for (int comp = BLU_C; comp <= RED_C; comp++)
+    {
+      if (cc.bias != TEVBIAS_COMPARE)
+        CombineRegular(combine_reg, stage, comp);
+      else
+        CombineCompare(combine_reg, stage, comp);
+      ClampResult(combine_reg, cc.clamp);
+      MOVDQA(ResultReg(comp), R(combine_reg));
+    }
+    if (ac.bias != TEVBIAS_COMPARE)
+      CombineRegular(combine_reg, stage, ALP_C);
+    else
+      CombineCompare(combine_reg, stage, ALP_C);
+    ClampResult(combine_reg, ac.clamp);
+    MOVDQA(ResultReg(ALP_C), R(combine_reg));
+
+    // The last stage goes straight to the output
+    if (stage == num_stages - 1)
+      break;
+
+    for (int comp = BLU_C; comp <= RED_C; comp++)
+    {
+      MOVDQA(MDisp(data_reg, RegOffset(cc.dest, comp)), ResultReg(comp));
+      m_reg_written[cc.dest][comp] = true;
+    }
+    MOVDQA(MDisp(data_reg, RegOffset(ac.dest, ALP_C)), ResultReg(ALP_C));
+    m_reg_written[ac.dest][ALP_C] = true;
+  }
+
+  for (int comp = 0; comp < 4; comp++)
+    MOVDQA(MDisp(data_reg, ColorOffset(comp)), ResultReg(comp));
+
+  // The alpha test sees the output alpha converted to 8 bits
+  AlphaTest alpha_test;
+  alpha_test.hex = m_uid.GetAlphaTest();
+  MOVDQA(XMM0, R(ResultReg(ALP_C)));
+  PAND(XMM0, R(mask_u8));
+  AlphaCompare(XMM1, XMM0, alpha_test.comp0, alpha_test.ref0);
+  AlphaCompare(XMM2, XMM0, alpha_test.comp1, alpha_test.ref1);
+  switch (alpha_test.logic)
+  {
+  case AlphaTest::AND:
+    PAND(XMM1, R(XMM2));
+    break;
+  case AlphaTest::OR:
+    POR(XMM1, R(XMM2));
+    break;
+  case AlphaTest::XOR:
+    PXOR(XMM1, R(XMM2));
+    break;
+  case AlphaTest::XNOR:
+    PXOR(XMM1, R(XMM2));
+    PCMPEQD(XMM2, R(XMM2));
+    PXOR(XMM1, R(XMM2));
+    break;
+  }
+  MOVDQA(MDisp(data_reg, static_cast<s32>(offsetof(TevQuadData, alpha_pass))), XMM1);
+
+  ABI_PopRegistersAndAdjustStack(used_regs, 8);
+  RET();
+}
@@ -0,0 +1,52 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+
+#include "Common/CommonTypes.h"
+#include "Common/x64Emitter.h"
+#include "VideoBackends/Software/TevJit.h"
+
+class TevJitX64 : public Gen::X64CodeBlock
+{
+public:
+  explicit TevJitX64(const TevPipelineUID& uid);
+
+  TevJit::Pipeline GetPipeline() const { return m_pipeline; }
+
+private:
+  // Where a combiner input comes from
+  struct Operand
+  {
+    enum class Type
+    {
+      Constant,  // value is the constant
+      Vector,    // value is the offset of a vector in TevQuadData
+      Scalar,    // value is the offset of a scalar in TevQuadData, broadcast to all lanes
+    };
+    Type type;
+    s32 value;
+    // The value is known to be in [0, 255], so it needs no masking
+    bool is_u8;
+  };
+
+  // input: 0 to 3 for a to d. The alpha component uses the alpha combiner.
+  Operand GetOperand(u32 stage, int comp, int input) const;
+  void LoadConstant(Gen::X64Reg reg, s32 value);
+  // Loads an input with the same range as Tev::InputRegType
+  void LoadInput(Gen::X64Reg reg, const Operand& operand, bool is_d);
+
+  void CombineRegular(Gen::X64Reg dest, u32 stage, int comp);
+  void CombineCompare(Gen::X64Reg dest, u32 stage, int comp);
+  void ClampResult(Gen::X64Reg dest, bool clamp);
+  void AlphaCompare(Gen::X64Reg dest, Gen::X64Reg alpha, u32 comp, u32 ref);
+  void GeneratePipeline();
+
+  TevPipelineUID m_uid;
+  // Whether a component of a TEV register was written by a previous stage, [register][component]
+  std::array<std::array<bool, 4>, 4> m_reg_written{};
+  TevJit::Pipeline m_pipeline = nullptr;
+};
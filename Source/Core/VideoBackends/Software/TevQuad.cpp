@@ -0,0 +1,535 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// Vectorized TEV stage evaluation for the pixels of a quad, see Tev::ShadeQuad. Every vector lane
+// holds one pixel, so all operations are uniform and the stage configuration only has to be decoded
+// once per quad. This has to match the scalar code in Tev.cpp bit for bit.
+//
+// The combiner stages and the alpha test are done by a pipeline compiled for the current TEV
+// configuration if the host supports that (see TevJit), and by CombineQuad otherwise.
+
+#include "VideoBackends/Software/Tev.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "Common/CommonTypes.h"
+#include "VideoCommon/BPMemory.h"
+#include "VideoCommon/PixelShaderManager.h"
+
+#if defined(_M_X86)
+#include "Common/Intrinsics.h"
+#elif defined(_M_ARM_64)
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+// Only SSE2 is used on x86, which every x64 CPU supports, so there is no need for a runtime check.
+#if defined(_M_X86)
+using Vec = __m128i;
+
+Vec Set(s32 value)
+{
+  return _mm_set1_epi32(value);
+}
+Vec Load(const s32* src)
+{
+  return _mm_load_si128(reinterpret_cast<const __m128i*>(src));
+}
+void Store(s32* dst, Vec v)
+{
+  _mm_store_si128(reinterpret_cast<__m128i*>(dst), v);
+}
+Vec Add(Vec a, Vec b)
+{
+  return _mm_add_epi32(a, b);
+}
+Vec Sub(Vec a, Vec b)
+{
+  return _mm_sub_epi32(a, b);
+}
+Vec And(Vec a, Vec b)
+{
+  return _mm_and_si128(a, b);
+}
+Vec Or(Vec a, Vec b)
+{
+  return _mm_or_si128(a, b);
+}
+Vec ShiftLeft(Vec v, int shift)
+{
+  return _mm_sll_epi32(v, _mm_cvtsi32_si128(shift));
+}
+// Arithmetic shift
+Vec ShiftRight(Vec v, int shift)
+{
+  return _mm_sra_epi32(v, _mm_cvtsi32_si128(shift));
+}
+Vec Greater(Vec a, Vec b)
+{
+  return _mm_cmpgt_epi32(a, b);
+}
+Vec Equal(Vec a, Vec b)
+{
+  return _mm_cmpeq_epi32(a, b);
+}
+Vec Select(Vec mask, Vec a, Vec b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+// a * b + c * d, all inputs must be in [0, 0x7fff]
+Vec MultiplyAdd(Vec a, Vec b, Vec c, Vec d)
+{
+  // Each 32 bit lane holds the pair (a, c) and (b, d) as 16 bit values
+  return _mm_madd_epi16(_mm_or_si128(a, _mm_slli_epi32(c, 16)),
+                        _mm_or_si128(b, _mm_slli_epi32(d, 16)));
+}
+#elif defined(_M_ARM_64)
+using Vec = int32x4_t;
+
+Vec Set(s32 value)
+{
+  return vdupq_n_s32(value);
+}
+Vec Load(const s32* src)
+{
+  return vld1q_s32(src);
+}
+void Store(s32* dst, Vec v)
+{
+  vst1q_s32(dst, v);
+}
+Vec Add(Vec a, Vec b)
+{
+  return vaddq_s32(a, b);
+}
+Vec Sub(Vec a, Vec b)
+{
+  return vsubq_s32(a, b);
+}
+Vec And(Vec a, Vec b)
+{
+  return vandq_s32(a, b);
+}
+Vec Or(Vec a, Vec b)
+{
+  return vorrq_s32(a, b);
+}
+Vec ShiftLeft(Vec v, int shift)
+{
+  return vshlq_s32(v, vdupq_n_s32(shift));
+}
+// Arithmetic shift
+Vec ShiftRight(Vec v, int shift)
+{
+  return vshlq_s32(v, vdupq_n_s32(-shift));
+}
+Vec Greater(Vec a, Vec b)
+{
+  return vreinterpretq_s32_u32(vcgtq_s32(a, b));
+}
+Vec Equal(Vec a, Vec b)
+{
+  return vreinterpretq_s32_u32(vceqq_s32(a, b));
+}
+Vec Select(Vec mask, Vec a, Vec b)
+{
+  return vbslq_s32(vreinterpretq_u32_s32(mask), a, b);
+}
+// a * b + c * d, all inputs must be in [0, 0x7fff]
+Vec MultiplyAdd(Vec a, Vec b, Vec c, Vec d)
+{
+  return vmlaq_s32(vmulq_s32(a, b), c, d);
+}
+#else
+struct Vec
+{
+  s32 lanes[4];
+};
+
+template <typename F>
+Vec Map(Vec a, Vec b, F f)
+{
+  Vec result;
+  for (int i = 0; i < 4; i++)
+    result.lanes[i] = f(a.lanes[i], b.lanes[i]);
+  return result;
+}
+
+Vec Set(s32 value)
+{
+  return {{value, value, value, value}};
+}
+Vec Load(const s32* src)
+{
+  return {{src[0], src[1], src[2], src[3]}};
+}
+void Store(s32* dst, Vec v)
+{
+  std::copy(std::begin(v.lanes), std::end(v.lanes), dst);
+}
+Vec Add(Vec a, Vec b)
+{
+  return Map(a, b, [](s32 x, s32 y) { return static_cast<s32>(static_cast<u32>(x) + y); });
+}
+Vec Sub(Vec a, Vec b)
+{
+  return Map(a, b, [](s32 x, s32 y) { return static_cast<s32>(static_cast<u32>(x) - y); });
+}
+Vec And(Vec a, Vec b)
+{
+  return Map(a, b, [](s32 x, s32 y) { return x & y; });
+}
+Vec Or(Vec a, Vec b)
+{
+  return Map(a, b, [](s32 x, s32 y) { return x | y; });
+}
+Vec ShiftLeft(Vec v, int shift)
+{
+  return Map(v, v, [shift](s32 x, s32) { return static_cast<s32>(static_cast<u32>(x) << shift); });
+}
+// Arithmetic shift
+Vec ShiftRight(Vec v, int shift)
+{
+  return Map(v, v, [shift](s32 x, s32) { return x >> shift; });
+}
+Vec Greater(Vec a, Vec b)
+{
+  return Map(a, b, [](s32 x, s32 y) { return x > y ? -1 : 0; });
+}
+Vec Equal(Vec a, Vec b)
+{
+  return Map(a, b, [](s32 x, s32 y) { return x == y ? -1 : 0; });
+}
+Vec Select(Vec mask, Vec a, Vec b)
+{
+  return Or(And(mask, a), Map(mask, b, [](s32 m, s32 y) { return ~m & y; }));
+}
+// a * b + c * d, all inputs must be in [0, 0x7fff]
+Vec MultiplyAdd(Vec a, Vec b, Vec c, Vec d)
+{
+  return Add(Map(a, b, [](s32 x, s32 y) { return x * y; }),
+             Map(c, d, [](s32 x, s32 y) { return x * y; }));
+}
+#endif
+
+Vec Negate(Vec v)
+{
+  return Sub(Set(0), v);
+}
+
+Vec Clamp(Vec v, s32 min, s32 max)
+{
+  v = Select(Greater(v, Set(max)), Set(max), v);
+  return Select(Greater(Set(min), v), Set(min), v);
+}
+
+// Like storing to a bitfield of the given width
+Vec SignExtend(Vec v, int bits)
+{
+  return ShiftRight(ShiftLeft(v, 32 - bits), 32 - bits);
+}
+
+// Inputs of a combiner, with the same ranges as Tev::InputRegType
+struct Inputs
+{
+  Vec a;
+  Vec b;
+  Vec c;
+  Vec d;
+};
+
+// color order: ABGR, like Tev
+enum
+{
+  ALP_C,
+  BLU_C,
+  GRN_C,
+  RED_C
+};
+
+Vec CombineRegular(const Inputs& in, u32 bias, u32 op, u32 shift, bool is_alpha)
+{
+  static constexpr int lshift[4] = {0, 1, 2, 0};
+  static constexpr int rshift[4] = {0, 0, 0, 1};
+  static constexpr s32 bias_values[4] = {0, 128, -128, 0};
+
+  const Vec c = Add(in.c, ShiftRight(in.c, 7));
+
+  Vec temp = MultiplyAdd(in.a, Sub(Set(256), c), in.b, c);
+  temp = ShiftLeft(temp, lshift[shift]);
+  // The rounding of the alpha combiner differs, see Tev::DrawAlphaRegular
+  if (is_alpha)
+  {
+    temp = Add(temp, Set((shift != 3) ? 0 : (op == 1) ? 127 : 128));
+    temp = op ? ShiftRight(Negate(temp), 8) : ShiftRight(temp, 8);
+  }
+  else
+  {
+    temp = Add(temp, Set((shift == 3) ? 0 : (op == 1) ? 127 : 128));
+    temp = ShiftRight(temp, 8);
+    temp = op ? Negate(temp) : temp;
+  }
+
+  const Vec result = Add(ShiftLeft(Add(in.d, Set(bias_values[bias])), lshift[shift]), temp);
+  return ShiftRight(result, rshift[shift]);
+}
+
+Vec CompareMask(const Inputs in[4], int comp, u32 mode)
+{
+  Vec a, b;
+  switch (mode >> 1)
+  {
+  case TEVCMP_R8:
+    a = in[RED_C].a;
+    b = in[RED_C].b;
+    break;
+  case TEVCMP_GR16:
+    a = Or(ShiftLeft(in[GRN_C].a, 8), in[RED_C].a);
+    b = Or(ShiftLeft(in[GRN_C].b, 8), in[RED_C].b);
+    break;
+  case TEVCMP_BGR24:
+    a = Or(Or(ShiftLeft(in[BLU_C].a, 16), ShiftLeft(in[GRN_C].a, 8)), in[RED_C].a);
+    b = Or(Or(ShiftLeft(in[BLU_C].b, 16), ShiftLeft(in[GRN_C].b, 8)), in[RED_C].b);
+    break;
+  default:  // TEVCMP_RGB8 and TEVCMP_A8
+    a = in[comp].a;
+    b = in[comp].b;
+    break;
+  }
+  return (mode & 1) ? Equal(a, b) : Greater(a, b);
+}
+
+Vec AlphaCompare(Vec alpha, u32 ref, AlphaTest::CompareMode comp)
+{
+  switch (comp)
+  {
+  case AlphaTest::NEVER:
+    return Set(0);
+  case AlphaTest::LEQUAL:
+    return Greater(Set(ref + 1), alpha);
+  case AlphaTest::LESS:
+    return Greater(Set(ref), alpha);
+  case AlphaTest::GEQUAL:
+    return Greater(alpha, Set(static_cast<s32>(ref) - 1));
+  case AlphaTest::GREATER:
+    return Greater(alpha, Set(ref));
+  case AlphaTest::EQUAL:
+    return Equal(alpha, Set(ref));
+  case AlphaTest::NEQUAL:
+    return Equal(Equal(alpha, Set(ref)), Set(0));
+  default:
+    return Set(-1);
+  }
+}
+
+// Same as TevAlphaTest in Tev.cpp, the masks are all bits set for passing pixels
+Vec AlphaTestMask(Vec alpha)
+{
+  const Vec comp0 = AlphaCompare(alpha, bpmem.alpha_test.ref0, bpmem.alpha_test.comp0);
+  const Vec comp1 = AlphaCompare(alpha, bpmem.alpha_test.ref1, bpmem.alpha_test.comp1);
+
+  switch (bpmem.alpha_test.logic)
+  {
+  case AlphaTest::AND:
+    return And(comp0, comp1);
+  case AlphaTest::OR:
+    return Or(comp0, comp1);
+  case AlphaTest::XOR:
+    return Equal(Equal(comp0, comp1), Set(0));
+  case AlphaTest::XNOR:
+    return Equal(comp0, comp1);
+  default:
+    return Set(-1);
+  }
+}
+
+// Generic version of the pipelines in TevJit
+void CombineQuad(TevQuadData* data)
+{
+  const u32 num_stages = bpmem.genMode.numtevstages + 1;
+
+  Vec reg[4][4];
+  for (int i = 0; i < 4; i++)
+  {
+    for (int comp = 0; comp < 4; comp++)
+      reg[i][comp] = Set(data->reg_init[i][comp]);
+  }
+
+  for (u32 stageNum = 0; stageNum < num_stages; stageNum++)
+  {
+    const TevStageCombiner::ColorCombiner& cc = bpmem.combiners[stageNum].colorC;
+    const TevStageCombiner::AlphaCombiner& ac = bpmem.combiners[stageNum].alphaC;
+
+    Vec tex_v[4], ras_v[4], konst[4];
+    for (int comp = 0; comp < 4; comp++)
+    {
+      tex_v[comp] = Load(data->tex[stageNum][comp]);
+      ras_v[comp] = Load(data->ras[stageNum][comp]);
+      konst[comp] = Set(data->konst[stageNum][comp]);
+    }
+
+    // Same as m_ColorInputLUT and m_AlphaInputLUT
+    const auto color_input = [&](u32 sel, int comp) {
+      switch (sel)
+      {
+      case 8:
+        return tex_v[comp];
+      case 9:
+        return tex_v[ALP_C];
+      case 10:
+        return ras_v[comp];
+      case 11:
+        return ras_v[ALP_C];
+      case 12:
+        return Set(255);
+      case 13:
+        return Set(128);
+      case 14:
+        return konst[comp];
+      case 15:
+        return Set(0);
+      default:
+        return reg[sel >> 1][(sel & 1) ? ALP_C : comp];
+      }
+    };
+    const auto alpha_input = [&](u32 sel) {
+      switch (sel)
+      {
+      case 4:
+        return tex_v[ALP_C];
+      case 5:
+        return ras_v[ALP_C];
+      case 6:
+        return konst[ALP_C];
+      case 7:
+        return Set(0);
+      default:
+        return reg[sel][ALP_C];
+      }
+    };
+
+    // combine inputs
+    const Vec mask_u8 = Set(0xff);
+    Inputs inputs[4];
+    for (int comp = BLU_C; comp <= RED_C; comp++)
+    {
+      inputs[comp].a = And(color_input(cc.a, comp), mask_u8);
+      inputs[comp].b = And(color_input(cc.b, comp), mask_u8);
+      inputs[comp].c = And(color_input(cc.c, comp), mask_u8);
+      inputs[comp].d = SignExtend(color_input(cc.d, comp), 11);
+    }
+    inputs[ALP_C].a = And(alpha_input(ac.a), mask_u8);
+    inputs[ALP_C].b = And(alpha_input(ac.b), mask_u8);
+    inputs[ALP_C].c = And(alpha_input(ac.c), mask_u8);
+    inputs[ALP_C].d = SignExtend(alpha_input(ac.d), 11);
+
+    const u32 color_mode = (cc.shift << 1) | cc.op;
+    for (int comp = BLU_C; comp <= RED_C; comp++)
+    {
+      Vec result;
+      if (cc.bias != 3)
+      {
+        result = CombineRegular(inputs[comp], cc.bias, cc.op, cc.shift, false);
+      }
+      else
+      {
+        result =
+            Add(inputs[comp].d, And(CompareMask(inputs, comp, color_mode), inputs[comp].c));
+      }
+      result = SignExtend(result, 16);
+      reg[cc.dest][comp] = cc.clamp ? Clamp(result, 0, 255) : Clamp(result, -1024, 1023);
+    }
+
+    Vec result;
+    if (ac.bias != 3)
+    {
+      result = CombineRegular(inputs[ALP_C], ac.bias, ac.op, ac.shift, true);
+    }
+    else
+    {
+      const u32 alpha_mode = (ac.shift << 1) | ac.op;
+      result = Add(inputs[ALP_C].d, And(CompareMask(inputs, ALP_C, alpha_mode), inputs[ALP_C].c));
+    }
+    result = SignExtend(result, 16);
+    reg[ac.dest][ALP_C] = ac.clamp ? Clamp(result, 0, 255) : Clamp(result, -1024, 1023);
+  }
+
+  // convert to 8 bits per component
+  const u32 color_index = bpmem.combiners[bpmem.genMode.numtevstages].colorC.dest;
+  const u32 alpha_index = bpmem.combiners[bpmem.genMode.numtevstages].alphaC.dest;
+  Store(data->color[ALP_C], reg[alpha_index][ALP_C]);
+  Store(data->color[BLU_C], reg[color_index][BLU_C]);
+  Store(data->color[GRN_C], reg[color_index][GRN_C]);
+  Store(data->color[RED_C], reg[color_index][RED_C]);
+
+  Store(data->alpha_pass, AlphaTestMask(And(reg[alpha_index][ALP_C], Set(0xff))));
+}
+}  // namespace
+
+void Tev::ShadeQuad(u32 num_pixels, u8 output[4][4], s16 tex_color[4][4], bool alpha_pass[4])
+{
+  const u32 num_stages = bpmem.genMode.numtevstages + 1;
+  TevQuadData data;
+
+  // Texture lookups, indirect stages and rasterized colors are done pixel by pixel first, in
+  // drawing order, since some of that state carries over from one pixel to the next.
+  for (u32 i = 0; i < num_pixels; i++)
+  {
+    LoadQuadPixel(i);
+    SampleIndirect();
+    for (u32 stageNum = 0; stageNum < num_stages; stageNum++)
+    {
+      PrepareStage(stageNum);
+      for (int comp = 0; comp < 4; comp++)
+      {
+        data.tex[stageNum][comp][i] = TexColor[comp];
+        data.ras[stageNum][comp][i] = RasColor[comp];
+      }
+    }
+  }
+  for (u32 i = num_pixels; i < 4; i++)
+  {
+    for (u32 stageNum = 0; stageNum < num_stages; stageNum++)
+    {
+      for (int comp = 0; comp < 4; comp++)
+        data.tex[stageNum][comp][i] = data.ras[stageNum][comp][i] = 0;
+    }
+  }
+
+  for (u32 stageNum = 0; stageNum < num_stages; stageNum++)
+  {
+    const int stageOdd = stageNum & 1;
+    const TevKSel& kSel = bpmem.tevksel[stageNum >> 1];
+    const int kc = kSel.getKC(stageOdd);
+    const int ka = kSel.getKA(stageOdd);
+    data.konst[stageNum][RED_C] = *m_KonstLUT[kc][RED_C];
+    data.konst[stageNum][GRN_C] = *m_KonstLUT[kc][GRN_C];
+    data.konst[stageNum][BLU_C] = *m_KonstLUT[kc][BLU_C];
+    data.konst[stageNum][ALP_C] = *m_KonstLUT[ka][ALP_C];
+  }
+  for (int i = 0; i < 4; i++)
+  {
+    data.reg_init[i][RED_C] = static_cast<s16>(PixelShaderManager::constants.colors[i][0]);
+    data.reg_init[i][GRN_C] = static_cast<s16>(PixelShaderManager::constants.colors[i][1]);
+    data.reg_init[i][BLU_C] = static_cast<s16>(PixelShaderManager::constants.colors[i][2]);
+    data.reg_init[i][ALP_C] = static_cast<s16>(PixelShaderManager::constants.colors[i][3]);
+  }
+
+  if (m_pipeline)
+    m_pipeline(&data);
+  else
+    CombineQuad(&data);
+
+  for (u32 i = 0; i < num_pixels; i++)
+  {
+    for (int comp = 0; comp < 4; comp++)
+    {
+      output[i][comp] = static_cast<u8>(data.color[comp][i]);
+      tex_color[i][comp] = static_cast<s16>(data.tex[num_stages - 1][comp][i]);
+    }
+    alpha_pass[i] = data.alpha_pass[i] != 0;
+  }
+}
@@ -5,9 +5,15 @@
 #include "VideoBackends/Software/TextureSampler.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstring>
+#include <map>
+#include <tuple>
+#include <vector>
 
 #include "Common/CommonTypes.h"
+#include "Common/Hash.h"
 #include "Core/HW/Memmap.h"
 
 #include "VideoCommon/BPMemory.h"
@@ -59,6 +65,267 @@ static inline void AddTexel(const u8* inTexel, u32* outTexel, u32 fract)
   outTexel[3] += inTexel[3] * fract;
 }
 
+namespace
+{
+// Decoded textures are dropped when they take more memory than this
+constexpr size_t MAX_CACHE_SIZE = 64 * 1024 * 1024;
+// A 1024x1024 texture has 11 levels, smaller levels would all be 1x1
+constexpr u32 MAX_LEVELS = 11;
+
+struct TextureKey
+{
+  bool from_tmem;
+  // In RAM, or in TMEM for preloaded textures
+  u32 address;
+  // The odd TMEM lines of preloaded RGBA8 textures
+  u32 address_odd;
+  u32 tlut_address;
+  TextureFormat format;
+  TLUTFormat tlut_format;
+  u32 width;
+  u32 height;
+  u32 num_levels;
+
+  bool operator<(const TextureKey& other) const
+  {
+    return std::tie(from_tmem, address, address_odd, tlut_address, format, tlut_format, width,
+                    height, num_levels) <
+           std::tie(other.from_tmem, other.address, other.address_odd, other.tlut_address,
+                    other.format, other.tlut_format, other.width, other.height, other.num_levels);
+  }
+};
+
+struct DecodedLevel
+{
+  // The image size used for wrapping the coordinates, in texels minus one
+  s32 max_s;
+  s32 max_t;
+  // The width rounded up to whole blocks
+  u32 stride;
+  // Same layout as the output of TexDecoder_DecodeTexel
+  std::vector<u32> texels;
+};
+
+struct DecodedTexture
+{
+  u64 hash;
+  std::vector<DecodedLevel> levels;
+};
+}  // namespace
+
+static std::map<TextureKey, DecodedTexture> s_decoded_textures;
+static size_t s_cache_size = 0;
+// The decoded textures of the texture maps, if they could be decoded ahead
+static std::array<const DecodedTexture*, 8> s_bound_textures{};
+
+static bool IsDecodableFormat(TextureFormat format)
+{
+  switch (format)
+  {
+  case TextureFormat::I4:
+  case TextureFormat::I8:
+  case TextureFormat::IA4:
+  case TextureFormat::IA8:
+  case TextureFormat::RGB565:
+  case TextureFormat::RGB5A3:
+  case TextureFormat::RGBA8:
+  case TextureFormat::C4:
+  case TextureFormat::C8:
+  case TextureFormat::C14X2:
+  case TextureFormat::CMPR:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Returns nullptr if the range isn't in TMEM or RAM
+static const u8* GetSourcePointer(bool from_tmem, u32 address, u32 size)
+{
+  const u64 end = static_cast<u64>(address) + size;
+  if (from_tmem)
+    return end <= TMEM_SIZE ? &texMem[address] : nullptr;
+
+  // Same as Memory::GetPointer, which can't check the size
+  address &= 0x3FFFFFFF;
+  if (static_cast<u64>(address) + size <= Memory::GetRamSizeReal())
+    return Memory::m_pRAM + address;
+  if (Memory::m_pEXRAM && (address >> 28) == 0x1 &&
+      static_cast<u64>(address & 0x0fffffff) + size <= Memory::GetExRamSizeReal())
+  {
+    return Memory::m_pEXRAM + (address & Memory::GetExRamMask());
+  }
+  return nullptr;
+}
+
+static const DecodedTexture* DecodeTexture(u32 texmap)
+{
+  const FourTexUnits& texUnit = bpmem.tex[(texmap >> 2) & 1];
+  const u8 subTexmap = texmap & 3;
+  const TexMode0& tm0 = texUnit.texMode0[subTexmap];
+  const TexMode1& tm1 = texUnit.texMode1[subTexmap];
+  const TexImage0& ti0 = texUnit.texImage0[subTexmap];
+  const TexTLUT& texTlut = texUnit.texTlut[subTexmap];
+
+  TextureKey key;
+  key.from_tmem = texUnit.texImage1[subTexmap].image_type;
+  key.format = static_cast<TextureFormat>(ti0.format);
+  key.tlut_format = static_cast<TLUTFormat>(texTlut.tlut_format);
+  if (!IsDecodableFormat(key.format) ||
+      (IsColorIndexed(key.format) && !IsValidTLUTFormat(key.tlut_format)))
+  {
+    return nullptr;
+  }
+
+  key.address = key.from_tmem ? texUnit.texImage1[subTexmap].tmem_even * TMEM_LINE_SIZE :
+                                texUnit.texImage3[subTexmap].image_base << 5;
+  const bool split_rgba8 = key.from_tmem && key.format == TextureFormat::RGBA8;
+  key.address_odd = split_rgba8 ? texUnit.texImage2[subTexmap].tmem_odd * TMEM_LINE_SIZE : 0;
+  if (IsColorIndexed(key.format))
+  {
+    key.tlut_address = texTlut.tmem_offset << 9;
+  }
+  else
+  {
+    // The palette doesn't matter
+    key.tlut_address = 0;
+    key.tlut_format = TLUTFormat::IA8;
+  }
+  key.width = ti0.width;
+  key.height = ti0.height;
+  // The LOD is clamped to max_lod, and linear mipmap filtering reads the level after it
+  key.num_levels = SamplerCommon::AreBpTexMode0MipmapsEnabled(tm0) ?
+                       std::min<u32>(((tm1.max_lod + 15) >> 4) + 1, MAX_LEVELS) :
+                       1;
+
+  // The levels are located like in SampleMip, and read in whole blocks like TexDecoder_DecodeTexel
+  const int fmtWidth = TexDecoder_GetBlockWidthInTexels(key.format);
+  const int fmtHeight = TexDecoder_GetBlockHeightInTexels(key.format);
+  const int fmtDepth = TexDecoder_GetTexelSizeInNibbles(key.format);
+  std::array<u32, MAX_LEVELS> level_offsets;
+  u32 data_size = 0;
+  u32 odd_data_size = 0;
+  u32 offset = 0;
+  int mipWidth = key.width + 1;
+  int mipHeight = key.height + 1;
+  for (u32 level = 0; level < key.num_levels; level++)
+  {
+    const int stride = ((key.width >> level) / fmtWidth + 1) * fmtWidth;
+    const int rows = ((key.height >> level) / fmtHeight + 1) * fmtHeight;
+    const u32 size = TexDecoder_GetTextureSizeInBytes(stride, rows, key.format);
+    level_offsets[level] = offset;
+    if (split_rgba8)
+    {
+      // The AR and GB halves are in separate banks, and only the AR half moves to the mipmap
+      data_size = std::max(data_size, offset + size / 2);
+      odd_data_size = std::max(odd_data_size, size / 2);
+    }
+    else
+    {
+      data_size = std::max(data_size, offset + size);
+    }
+
+    mipWidth = std::max(mipWidth, fmtWidth);
+    mipHeight = std::max(mipHeight, fmtHeight);
+    offset += (mipWidth * mipHeight * fmtDepth) >> 1;
+    mipWidth >>= 1;
+    mipHeight >>= 1;
+  }
+
+  const u8* src = GetSourcePointer(key.from_tmem, key.address, data_size);
+  const u8* src_odd =
+      split_rgba8 ? GetSourcePointer(true, key.address_odd, odd_data_size) : nullptr;
+  const u32 tlut_size = TexDecoder_GetPaletteSize(key.format);
+  const u8* tlut = GetSourcePointer(true, key.tlut_address, tlut_size);
+  if (!src || (split_rgba8 && !src_odd) || !tlut)
+    return nullptr;
+
+  u64 hash = Common::GetHash64(src, data_size, 0);
+  if (split_rgba8)
+    hash ^= Common::GetHash64(src_odd, odd_data_size, 0);
+  if (tlut_size != 0)
+    hash ^= Common::GetHash64(tlut, tlut_size, 0);
+
+  auto iter = s_decoded_textures.find(key);
+  if (iter == s_decoded_textures.end())
+  {
+    iter = s_decoded_textures.emplace(key, DecodedTexture{}).first;
+    iter->second.levels.resize(key.num_levels);
+  }
+  else if (iter->second.hash == hash)
+  {
+    return &iter->second;
+  }
+
+  DecodedTexture& texture = iter->second;
+  texture.hash = hash;
+  for (u32 level = 0; level < key.num_levels; level++)
+  {
+    DecodedLevel& decoded = texture.levels[level];
+    decoded.max_s = key.width >> level;
+    decoded.max_t = key.height >> level;
+    decoded.stride = (decoded.max_s / fmtWidth + 1) * fmtWidth;
+    const u32 rows = (decoded.max_t / fmtHeight + 1) * fmtHeight;
+    if (decoded.texels.empty())
+    {
+      decoded.texels.resize(decoded.stride * rows);
+      s_cache_size += decoded.texels.size() * sizeof(u32);
+    }
+
+    u8* dst = reinterpret_cast<u8*>(decoded.texels.data());
+    if (split_rgba8)
+    {
+      TexDecoder_DecodeRGBA8FromTmem(dst, src + level_offsets[level], src_odd, decoded.stride,
+                                     rows);
+    }
+    else
+    {
+      TexDecoder_Decode(dst, src + level_offsets[level], decoded.stride, rows, key.format, tlut,
+                        key.tlut_format);
+    }
+  }
+
+  return &texture;
+}
+
+static void PrepareTexture(u32 texmap)
+{
+  if (!s_bound_textures[texmap])
+    s_bound_textures[texmap] = DecodeTexture(texmap);
+}
+
+void PrepareTextures()
+{
+  // Nothing is bound at this point, so there are no pointers to the entries
+  if (s_cache_size > MAX_CACHE_SIZE)
+  {
+    s_decoded_textures.clear();
+    s_cache_size = 0;
+  }
+
+  for (u32 stage = 0; stage < bpmem.genMode.numindstages; stage++)
+    PrepareTexture(bpmem.tevindref.getTexMap(stage));
+
+  for (u32 stage = 0; stage <= bpmem.genMode.numtevstages; stage++)
+  {
+    const TwoTevStageOrders& order = bpmem.tevorders[stage >> 1];
+    if (order.getEnable(stage & 1))
+      PrepareTexture(order.getTexMap(stage & 1));
+  }
+}
+
+void ReleaseTextures()
+{
+  s_bound_textures.fill(nullptr);
+}
+
+void Shutdown()
+{
+  ReleaseTextures();
+  s_decoded_textures.clear();
+  s_cache_size = 0;
+}
+
 void Sample(s32 s, s32 t, s32 lod, bool linear, u8 texmap, u8* sample)
 {
   int baseMip = 0;
@@ -103,12 +370,68 @@ void Sample(s32 s, s32 t, s32 lod, bool linear, u8 texmap, u8* sample)
   }
 }
 
+// Same as the sampling in SampleMip, with the texels looked up in the decoded level
+static void SampleDecodedLevel(s32 s, s32 t, const DecodedLevel& level, bool linear,
+                               const TexMode0& tm0, u8* sample)
+{
+  const auto get_texel = [&level](int imageS, int imageT) {
+    return reinterpret_cast<const u8*>(&level.texels[imageT * level.stride + imageS]);
+  };
+
+  if (linear)
+  {
+    s -= 64;
+    t -= 64;
+
+    int imageS = s >> 7;
+    int imageT = t >> 7;
+    int imageSPlus1 = imageS + 1;
+    const int fractS = s & 0x7f;
+    int imageTPlus1 = imageT + 1;
+    const int fractT = t & 0x7f;
+
+    WrapCoord(&imageS, tm0.wrap_s, level.max_s);
+    WrapCoord(&imageT, tm0.wrap_t, level.max_t);
+    WrapCoord(&imageSPlus1, tm0.wrap_s, level.max_s);
+    WrapCoord(&imageTPlus1, tm0.wrap_t, level.max_t);
+
+    u32 texel[4];
+    SetTexel(get_texel(imageS, imageT), texel, (128 - fractS) * (128 - fractT));
+    AddTexel(get_texel(imageSPlus1, imageT), texel, (fractS) * (128 - fractT));
+    AddTexel(get_texel(imageS, imageTPlus1), texel, (128 - fractS) * (fractT));
+    AddTexel(get_texel(imageSPlus1, imageTPlus1), texel, (fractS) * (fractT));
+
+    sample[0] = (u8)(texel[0] >> 14);
+    sample[1] = (u8)(texel[1] >> 14);
+    sample[2] = (u8)(texel[2] >> 14);
+    sample[3] = (u8)(texel[3] >> 14);
+  }
+  else
+  {
+    int imageS = s >> 7;
+    int imageT = t >> 7;
+
+    WrapCoord(&imageS, tm0.wrap_s, level.max_s);
+    WrapCoord(&imageT, tm0.wrap_t, level.max_t);
+
+    std::memcpy(sample, get_texel(imageS, imageT), 4);
+  }
+}
+
 void SampleMip(s32 s, s32 t, s32 mip, bool linear, u8 texmap, u8* sample)
 {
   const FourTexUnits& texUnit = bpmem.tex[(texmap >> 2) & 1];
   const u8 subTexmap = texmap & 3;
 
   const TexMode0& tm0 = texUnit.texMode0[subTexmap];
+
+  const DecodedTexture* decoded = s_bound_textures[texmap];
+  if (decoded && static_cast<u32>(mip) < decoded->levels.size())
+  {
+    SampleDecodedLevel(s >> mip, t >> mip, decoded->levels[mip], linear, tm0, sample);
+    return;
+  }
+
   const TexImage0& ti0 = texUnit.texImage0[subTexmap];
   const TexTLUT& texTlut = texUnit.texTlut[subTexmap];
   const TextureFormat texfmt = static_cast<TextureFormat>(ti0.format);
@@ -8,6 +8,15 @@
 
 namespace TextureSampler
 {
+// Decodes the textures used by the current TEV configuration ahead of drawing, after which
+// sampling them is a lookup in the decoded texels. Decoded textures are cached, and validated by a
+// hash of their data and palette like in TextureCacheBase. Textures that can't be decoded ahead
+// are sampled from their encoded data as before.
+// ReleaseTextures must be called before the texture registers in bpmem change.
+void PrepareTextures();
+void ReleaseTextures();
+void Shutdown();
+
 void Sample(s32 s, s32 t, s32 lod, bool linear, u8 texmap, u8* sample);
 
 void SampleMip(s32 s, s32 t, s32 mip, bool linear, u8 texmap, u8* sample);
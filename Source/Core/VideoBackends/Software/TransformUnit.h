@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "Common/CommonTypes.h"
+
 struct InputVertexData;
 struct OutputVertexData;
 
@@ -13,4 +15,9 @@ void TransformPosition(const InputVertexData* src, OutputVertexData* dst);
 void TransformNormal(const InputVertexData* src, bool nbt, OutputVertexData* dst);
 void TransformColor(const InputVertexData* src, OutputVertexData* dst);
 void TransformTexCoord(const InputVertexData* src, OutputVertexData* dst, bool specialCase);
+
+// Transforms count vertices like the functions above, several at once. Gives the same results as
+// calling them for every vertex, with dst zeroed beforehand.
+void TransformVertices(const InputVertexData* src, OutputVertexData* dst, u32 count,
+                       bool has_normal, bool nbt, bool specialCase);
 }  // namespace TransformUnit
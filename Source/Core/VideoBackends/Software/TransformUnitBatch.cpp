@@ -0,0 +1,839 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// Vectorized transformation of the vertices of a batch, see TransformUnit::TransformVertices.
+// Every vector lane holds one vertex, so the matrices and the lighting state are loaded once for
+// four vertices. This has to match the per-vertex functions in TransformUnit.cpp bit for bit, so
+// all floating point operations are done in the same order as there.
+
+#include "VideoBackends/Software/TransformUnit.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "Common/Assert.h"
+#include "Common/CommonTypes.h"
+#include "Common/Logging/Log.h"
+#include "Common/Swap.h"
+
+#include "VideoBackends/Software/NativeVertexFormat.h"
+#include "VideoBackends/Software/Vec3.h"
+
+#include "VideoCommon/BPMemory.h"
+#include "VideoCommon/XFMemory.h"
+
+#if defined(_M_X86)
+#include "Common/Intrinsics.h"
+#elif defined(_M_ARM_64)
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+constexpr u32 LANES = 4;
+
+// Only SSE2 is used on x86, which every x64 CPU supports, so there is no need for a runtime check.
+#if defined(_M_X86)
+using Vec = __m128;
+using Mask = __m128;
+
+Vec Set(float value)
+{
+  return _mm_set1_ps(value);
+}
+Vec Load(const float* src)
+{
+  return _mm_load_ps(src);
+}
+void Store(float* dst, Vec v)
+{
+  _mm_store_ps(dst, v);
+}
+Vec Add(Vec a, Vec b)
+{
+  return _mm_add_ps(a, b);
+}
+Vec Sub(Vec a, Vec b)
+{
+  return _mm_sub_ps(a, b);
+}
+Vec Mul(Vec a, Vec b)
+{
+  return _mm_mul_ps(a, b);
+}
+Vec Div(Vec a, Vec b)
+{
+  return _mm_div_ps(a, b);
+}
+Vec Sqrt(Vec v)
+{
+  return _mm_sqrt_ps(v);
+}
+Vec Negate(Vec v)
+{
+  return _mm_xor_ps(v, _mm_set1_ps(-0.0f));
+}
+Mask Greater(Vec a, Vec b)
+{
+  return _mm_cmpgt_ps(a, b);
+}
+Mask GreaterEqual(Vec a, Vec b)
+{
+  return _mm_cmpge_ps(a, b);
+}
+Mask Equal(Vec a, Vec b)
+{
+  return _mm_cmpeq_ps(a, b);
+}
+Mask And(Mask a, Mask b)
+{
+  return _mm_and_ps(a, b);
+}
+Vec Select(Mask mask, Vec a, Vec b)
+{
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#elif defined(_M_ARM_64)
+using Vec = float32x4_t;
+using Mask = uint32x4_t;
+
+Vec Set(float value)
+{
+  return vdupq_n_f32(value);
+}
+Vec Load(const float* src)
+{
+  return vld1q_f32(src);
+}
+void Store(float* dst, Vec v)
+{
+  vst1q_f32(dst, v);
+}
+Vec Add(Vec a, Vec b)
+{
+  return vaddq_f32(a, b);
+}
+Vec Sub(Vec a, Vec b)
+{
+  return vsubq_f32(a, b);
+}
+Vec Mul(Vec a, Vec b)
+{
+  return vmulq_f32(a, b);
+}
+Vec Div(Vec a, Vec b)
+{
+  return vdivq_f32(a, b);
+}
+Vec Sqrt(Vec v)
+{
+  return vsqrtq_f32(v);
+}
+Vec Negate(Vec v)
+{
+  return vnegq_f32(v);
+}
+Mask Greater(Vec a, Vec b)
+{
+  return vcgtq_f32(a, b);
+}
+Mask GreaterEqual(Vec a, Vec b)
+{
+  return vcgeq_f32(a, b);
+}
+Mask Equal(Vec a, Vec b)
+{
+  return vceqq_f32(a, b);
+}
+Mask And(Mask a, Mask b)
+{
+  return vandq_u32(a, b);
+}
+Vec Select(Mask mask, Vec a, Vec b)
+{
+  return vbslq_f32(mask, a, b);
+}
+#else
+struct Vec
+{
+  float lanes[LANES];
+};
+
+struct Mask
+{
+  bool lanes[LANES];
+};
+
+template <typename T, typename F>
+T Map(Vec a, Vec b, F f)
+{
+  T result;
+  for (u32 i = 0; i < LANES; i++)
+    result.lanes[i] = f(a.lanes[i], b.lanes[i]);
+  return result;
+}
+
+Vec Set(float value)
+{
+  return {{value, value, value, value}};
+}
+Vec Load(const float* src)
+{
+  return {{src[0], src[1], src[2], src[3]}};
+}
+void Store(float* dst, Vec v)
+{
+  std::copy(std::begin(v.lanes), std::end(v.lanes), dst);
+}
+Vec Add(Vec a, Vec b)
+{
+  return Map<Vec>(a, b, [](float x, float y) { return x + y; });
+}
+Vec Sub(Vec a, Vec b)
+{
+  return Map<Vec>(a, b, [](float x, float y) { return x - y; });
+}
+Vec Mul(Vec a, Vec b)
+{
+  return Map<Vec>(a, b, [](float x, float y) { return x * y; });
+}
+Vec Div(Vec a, Vec b)
+{
+  return Map<Vec>(a, b, [](float x, float y) { return x / y; });
+}
+Vec Sqrt(Vec v)
+{
+  return Map<Vec>(v, v, [](float x, float) { return sqrtf(x); });
+}
+Vec Negate(Vec v)
+{
+  return Map<Vec>(v, v, [](float x, float) { return -x; });
+}
+Mask Greater(Vec a, Vec b)
+{
+  return Map<Mask>(a, b, [](float x, float y) { return x > y; });
+}
+Mask GreaterEqual(Vec a, Vec b)
+{
+  return Map<Mask>(a, b, [](float x, float y) { return x >= y; });
+}
+Mask Equal(Vec a, Vec b)
+{
+  return Map<Mask>(a, b, [](float x, float y) { return x == y; });
+}
+Mask And(Mask a, Mask b)
+{
+  Mask result;
+  for (u32 i = 0; i < LANES; i++)
+    result.lanes[i] = a.lanes[i] && b.lanes[i];
+  return result;
+}
+Vec Select(Mask mask, Vec a, Vec b)
+{
+  Vec result;
+  for (u32 i = 0; i < LANES; i++)
+    result.lanes[i] = mask.lanes[i] ? a.lanes[i] : b.lanes[i];
+  return result;
+}
+#endif
+
+// Same as std::max(0.0f, v)
+Vec MaxZero(Vec v)
+{
+  return Select(Greater(v, Set(0.0f)), v, Set(0.0f));
+}
+
+// Same as SafeDivide in TransformUnit.cpp
+Vec SafeDivide(Vec n, Vec d)
+{
+  const Vec zero = Set(0.0f);
+  return Select(Equal(d, zero), Select(Greater(n, zero), Set(1.0f), zero), Div(n, d));
+}
+
+// A Vec3 of every lane
+struct Vec3x4
+{
+  Vec x;
+  Vec y;
+  Vec z;
+};
+
+Vec3x4 Set3(float x, float y, float z)
+{
+  return {Set(x), Set(y), Set(z)};
+}
+Vec3x4 Set3(const float* v)
+{
+  return Set3(v[0], v[1], v[2]);
+}
+Vec3x4 Sub3(const Vec3x4& a, const Vec3x4& b)
+{
+  return {Sub(a.x, b.x), Sub(a.y, b.y), Sub(a.z, b.z)};
+}
+Vec3x4 Select3(Mask mask, const Vec3x4& a, const Vec3x4& b)
+{
+  return {Select(mask, a.x, b.x), Select(mask, a.y, b.y), Select(mask, a.z, b.z)};
+}
+// Same as Vec3::operator*(const Vec3&)
+Vec Dot(const Vec3x4& a, const Vec3x4& b)
+{
+  return Add(Add(Mul(a.x, b.x), Mul(a.y, b.y)), Mul(a.z, b.z));
+}
+// Same as Vec3::Normalized
+Vec3x4 Normalized(const Vec3x4& v)
+{
+  const Vec inverse = Div(Set(1.0f), Sqrt(Dot(v, v)));
+  return {Mul(v.x, inverse), Mul(v.y, inverse), Mul(v.z, inverse)};
+}
+
+// The vertices of the lanes
+struct Lanes
+{
+  std::array<const InputVertexData*, LANES> in;
+  std::array<OutputVertexData*, LANES> out;
+};
+
+template <typename F>
+Vec Gather(F get)
+{
+  alignas(16) float values[LANES];
+  for (u32 i = 0; i < LANES; i++)
+    values[i] = get(i);
+  return Load(values);
+}
+
+template <typename F>
+Vec3x4 Gather3(F get)
+{
+  alignas(16) float values[3][LANES];
+  for (u32 i = 0; i < LANES; i++)
+  {
+    const Vec3 v = get(i);
+    values[0][i] = v.x;
+    values[1][i] = v.y;
+    values[2][i] = v.z;
+  }
+  return {Load(values[0]), Load(values[1]), Load(values[2])};
+}
+
+template <typename F>
+void Scatter3(const Vec3x4& v, F set)
+{
+  alignas(16) float values[3][LANES];
+  Store(values[0], v.x);
+  Store(values[1], v.y);
+  Store(values[2], v.z);
+  for (u32 i = 0; i < LANES; i++)
+    set(i, Vec3(values[0][i], values[1][i], values[2][i]));
+}
+
+// Loads the first size elements of the matrix of every lane
+void LoadMatrix(const std::array<const float*, LANES>& matrices, u32 size, Vec* m)
+{
+  const bool uniform = std::all_of(matrices.begin(), matrices.end(),
+                                   [&](const float* matrix) { return matrix == matrices[0]; });
+  for (u32 i = 0; i < size; i++)
+  {
+    if (uniform)
+      m[i] = Set(matrices[0][i]);
+    else
+      m[i] = Gather([&](u32 lane) { return matrices[lane][i]; });
+  }
+}
+
+// Same as MultiplyVec2Mat24 and MultiplyVec2Mat34
+Vec MultiplyVec2Row(const Vec3x4& v, const Vec* row)
+{
+  return Add(Add(Add(Mul(row[0], v.x), Mul(row[1], v.y)), row[2]), row[3]);
+}
+
+// Same as MultiplyVec3Mat24 and MultiplyVec3Mat34
+Vec MultiplyVec3Row(const Vec3x4& v, const Vec* row)
+{
+  return Add(Add(Add(Mul(row[0], v.x), Mul(row[1], v.y)), Mul(row[2], v.z)), row[3]);
+}
+
+Vec3x4 MultiplyVec3Mat34(const Vec3x4& v, const Vec* m)
+{
+  return {MultiplyVec3Row(v, &m[0]), MultiplyVec3Row(v, &m[4]), MultiplyVec3Row(v, &m[8])};
+}
+
+Vec3x4 MultiplyVec3Mat33(const Vec3x4& v, const Vec* m)
+{
+  return {Add(Add(Mul(m[0], v.x), Mul(m[1], v.y)), Mul(m[2], v.z)),
+          Add(Add(Mul(m[3], v.x), Mul(m[4], v.y)), Mul(m[5], v.z)),
+          Add(Add(Mul(m[6], v.x), Mul(m[7], v.y)), Mul(m[8], v.z))};
+}
+
+void TransformPositions(const Lanes& lanes, Vec3x4* mv_position)
+{
+  std::array<const float*, LANES> matrices;
+  for (u32 i = 0; i < LANES; i++)
+    matrices[i] = &xfmem.posMatrices[lanes.in[i]->posMtx * 4];
+  Vec m[12];
+  LoadMatrix(matrices, 12, m);
+
+  const Vec3x4 position = Gather3([&](u32 i) { return lanes.in[i]->position; });
+  *mv_position = MultiplyVec3Mat34(position, m);
+
+  const Projection::Raw& proj = xfmem.projection.rawProjection;
+  const Vec3x4& mv = *mv_position;
+  Vec3x4 projected;
+  Vec projected_w;
+  if (xfmem.projection.type == GX_PERSPECTIVE)
+  {
+    projected.x = Add(Mul(Set(proj[0]), mv.x), Mul(Set(proj[1]), mv.z));
+    projected.y = Add(Mul(Set(proj[2]), mv.y), Mul(Set(proj[3]), mv.z));
+    projected.z =
+        Mul(Add(Mul(Set(proj[4]), mv.z), Set(proj[5])), Set(1.0f - static_cast<float>(1e-7)));
+    projected_w = Negate(mv.z);
+  }
+  else
+  {
+    projected.x = Add(Mul(Set(proj[0]), mv.x), Set(proj[1]));
+    projected.y = Add(Mul(Set(proj[2]), mv.y), Set(proj[3]));
+    projected.z = Add(Mul(Set(proj[4]), mv.z), Set(proj[5]));
+    projected_w = Set(1.0f);
+  }
+
+  Scatter3(mv, [&](u32 i, const Vec3& v) { lanes.out[i]->mvPosition = v; });
+  alignas(16) float w[LANES];
+  Store(w, projected_w);
+  Scatter3(projected, [&](u32 i, const Vec3& v) {
+    lanes.out[i]->projectedPosition = {v.x, v.y, v.z, w[i]};
+  });
+}
+
+void TransformNormals(const Lanes& lanes, bool nbt, std::array<Vec3x4, 3>* normals)
+{
+  std::array<const float*, LANES> matrices;
+  for (u32 i = 0; i < LANES; i++)
+    matrices[i] = &xfmem.normalMatrices[(lanes.in[i]->posMtx & 31) * 3];
+  Vec m[9];
+  LoadMatrix(matrices, 9, m);
+
+  const u32 num_normals = nbt ? 3 : 1;
+  for (u32 n = 0; n < num_normals; n++)
+  {
+    const Vec3x4 normal = Gather3([&](u32 i) { return lanes.in[i]->normal[n]; });
+    (*normals)[n] = MultiplyVec3Mat33(normal, m);
+  }
+  (*normals)[0] = Normalized((*normals)[0]);
+
+  for (u32 n = 0; n < num_normals; n++)
+    Scatter3((*normals)[n], [&](u32 i, const Vec3& v) { lanes.out[i]->normal[n] = v; });
+}
+
+// Same as CalculateLightAttn in TransformUnit.cpp
+Vec CalculateLightAttn(const Light& light, Vec3x4* ldir, const Vec3x4& normal,
+                       const LitChannel& chan)
+{
+  const Vec zero = Set(0.0f);
+
+  switch (chan.attnfunc)
+  {
+  case LIGHTATTN_NONE:
+  case LIGHTATTN_DIR:
+  {
+    *ldir = Normalized(*ldir);
+    const Mask is_zero =
+        And(And(Equal(ldir->x, zero), Equal(ldir->y, zero)), Equal(ldir->z, zero));
+    *ldir = Select3(is_zero, normal, *ldir);
+    return Set(1.0f);
+  }
+  case LIGHTATTN_SPEC:
+  {
+    *ldir = Normalized(*ldir);
+    const Vec attn = Select(GreaterEqual(Dot(*ldir, normal), zero),
+                            MaxZero(Dot(Set3(light.ddir), normal)), zero);
+    Vec3 dist_attn(light.distatt[0], light.distatt[1], light.distatt[2]);
+    if (chan.diffusefunc != LIGHTDIF_NONE)
+      dist_attn = dist_attn.Normalized();
+
+    // The attenuation vector is (1, attn, attn * attn)
+    const Vec attn2 = Mul(attn, attn);
+    const Vec cos_attn = Add(Add(Set(1.0f * light.cosatt[0]), Mul(attn, Set(light.cosatt[1]))),
+                             Mul(attn2, Set(light.cosatt[2])));
+    const Vec dist = Add(Add(Set(1.0f * dist_attn.x), Mul(attn, Set(dist_attn.y))),
+                         Mul(attn2, Set(dist_attn.z)));
+    return SafeDivide(MaxZero(cos_attn), dist);
+  }
+  case LIGHTATTN_SPOT:
+  {
+    const Vec dist2 = Dot(*ldir, *ldir);
+    const Vec dist = Sqrt(dist2);
+    const Vec inverse = Div(Set(1.0f), dist);
+    *ldir = {Mul(ldir->x, inverse), Mul(ldir->y, inverse), Mul(ldir->z, inverse)};
+    const Vec attn = MaxZero(Dot(*ldir, Set3(light.ddir)));
+
+    const Vec cos_attn = Add(Add(Set(light.cosatt[0]), Mul(Set(light.cosatt[1]), attn)),
+                             Mul(Mul(Set(light.cosatt[2]), attn), attn));
+    const Vec dist_attn = Add(Add(Set(light.distatt[0]), Mul(Set(light.distatt[1]), dist)),
+                              Mul(Set(light.distatt[2]), dist2));
+    return SafeDivide(MaxZero(cos_attn), dist_attn);
+  }
+  default:
+    // Not reachable with a two bit field
+    return Set(1.0f);
+  }
+}
+
+// Same as LightColor in TransformUnit.cpp
+void LightColor(const Vec3x4& pos, const Vec3x4& normal, u32 light_num, const LitChannel& chan,
+                Vec3x4* light_col)
+{
+  const Light& light = xfmem.lights[light_num];
+
+  Vec3x4 ldir = Sub3(Set3(light.dpos), pos);
+  const Vec attn = CalculateLightAttn(light, &ldir, normal, chan);
+  Vec dif_attn = Dot(ldir, normal);
+
+  Vec scale;
+  switch (chan.diffusefunc)
+  {
+  case LIGHTDIF_NONE:
+    scale = attn;
+    break;
+  case LIGHTDIF_SIGN:
+    scale = Mul(attn, dif_attn);
+    break;
+  case LIGHTDIF_CLAMP:
+    dif_attn = MaxZero(dif_attn);
+    scale = Mul(attn, dif_attn);
+    break;
+  default:
+    return;
+  }
+
+  light_col->x = Add(light_col->x, Mul(Set(light.color[1]), scale));
+  light_col->y = Add(light_col->y, Mul(Set(light.color[2]), scale));
+  light_col->z = Add(light_col->z, Mul(Set(light.color[3]), scale));
+}
+
+// Same as LightAlpha in TransformUnit.cpp
+void LightAlpha(const Vec3x4& pos, const Vec3x4& normal, u32 light_num, const LitChannel& chan,
+                Vec* light_col)
+{
+  const Light& light = xfmem.lights[light_num];
+
+  Vec3x4 ldir = Sub3(Set3(light.dpos), pos);
+  const Vec attn = CalculateLightAttn(light, &ldir, normal, chan);
+  Vec dif_attn = Dot(ldir, normal);
+
+  switch (chan.diffusefunc)
+  {
+  case LIGHTDIF_NONE:
+    *light_col = Add(*light_col, Mul(Set(light.color[0]), attn));
+    break;
+  case LIGHTDIF_SIGN:
+    *light_col = Add(*light_col, Mul(Mul(Set(light.color[0]), attn), dif_attn));
+    break;
+  case LIGHTDIF_CLAMP:
+    dif_attn = MaxZero(dif_attn);
+    *light_col = Add(*light_col, Mul(Mul(Set(light.color[0]), attn), dif_attn));
+    break;
+  default:
+    break;
+  }
+}
+
+// Same as TransformUnit::TransformColor. The lights are accumulated for all lanes, and the
+// integer math on the result is done per vertex.
+void TransformColors(const Lanes& lanes, const Vec3x4& pos, const Vec3x4& normal)
+{
+  for (u32 chan = 0; chan < NUM_XF_COLOR_CHANNELS; chan++)
+  {
+    const LitChannel& colorchan = xfmem.color[chan];
+    const LitChannel& alphachan = xfmem.alpha[chan];
+    const u8* amb_color = reinterpret_cast<const u8*>(&xfmem.ambColor[chan]);
+
+    alignas(16) float light_rgb[3][LANES];
+    if (colorchan.enablelighting)
+    {
+      Vec3x4 light_col;
+      if (colorchan.ambsource)
+      {
+        light_col.x = Gather([&](u32 i) { return lanes.in[i]->color[chan][1]; });
+        light_col.y = Gather([&](u32 i) { return lanes.in[i]->color[chan][2]; });
+        light_col.z = Gather([&](u32 i) { return lanes.in[i]->color[chan][3]; });
+      }
+      else
+      {
+        light_col = Set3(amb_color[1], amb_color[2], amb_color[3]);
+      }
+
+      const u8 mask = colorchan.GetFullLightMask();
+      for (u32 i = 0; i < 8; ++i)
+      {
+        if (mask & (1 << i))
+          LightColor(pos, normal, i, colorchan, &light_col);
+      }
+
+      Store(light_rgb[0], light_col.x);
+      Store(light_rgb[1], light_col.y);
+      Store(light_rgb[2], light_col.z);
+    }
+
+    alignas(16) float light_alpha[LANES];
+    if (alphachan.enablelighting)
+    {
+      Vec light_col;
+      if (alphachan.ambsource)
+        light_col = Gather([&](u32 i) { return lanes.in[i]->color[chan][0]; });
+      else
+        light_col = Set(static_cast<float>(xfmem.ambColor[chan] & 0xff));
+
+      const u8 mask = alphachan.GetFullLightMask();
+      for (u32 i = 0; i < 8; ++i)
+      {
+        if (mask & (1 << i))
+          LightAlpha(pos, normal, i, alphachan, &light_col);
+      }
+
+      Store(light_alpha, light_col);
+    }
+
+    for (u32 lane = 0; lane < LANES; lane++)
+    {
+      const InputVertexData* src = lanes.in[lane];
+
+      // abgr
+      std::array<u8, 4> matcolor;
+      std::array<u8, 4> chancolor;
+
+      if (colorchan.matsource)
+        matcolor = src->color[chan];
+      else
+        std::memcpy(matcolor.data(), &xfmem.matColor[chan], sizeof(u32));
+
+      if (colorchan.enablelighting)
+      {
+        const int light_x = std::clamp(static_cast<int>(light_rgb[0][lane]), 0, 255);
+        const int light_y = std::clamp(static_cast<int>(light_rgb[1][lane]), 0, 255);
+        const int light_z = std::clamp(static_cast<int>(light_rgb[2][lane]), 0, 255);
+        chancolor[1] = (matcolor[1] * (light_x + (light_x >> 7))) >> 8;
+        chancolor[2] = (matcolor[2] * (light_y + (light_y >> 7))) >> 8;
+        chancolor[3] = (matcolor[3] * (light_z + (light_z >> 7))) >> 8;
+      }
+      else
+      {
+        chancolor = matcolor;
+      }
+
+      if (alphachan.matsource)
+        matcolor[0] = src->color[chan][0];
+      else
+        matcolor[0] = xfmem.matColor[chan] & 0xff;
+
+      if (alphachan.enablelighting)
+      {
+        const int light_a = std::clamp(static_cast<int>(light_alpha[lane]), 0, 255);
+        chancolor[0] = (matcolor[0] * (light_a + (light_a >> 7))) >> 8;
+      }
+      else
+      {
+        chancolor[0] = matcolor[0];
+      }
+
+      // abgr -> rgba
+      const u32 rgba_color = Common::swap32(chancolor.data());
+      std::memcpy(lanes.out[lane]->color[chan].data(), &rgba_color, sizeof(u32));
+    }
+  }
+}
+
+// Same as TransformTexCoordRegular in TransformUnit.cpp
+void TransformTexCoordRegular(const Lanes& lanes, const TexMtxInfo& texinfo, u32 coord_num,
+                              bool special_case)
+{
+  Vec3x4 src;
+  switch (texinfo.sourcerow)
+  {
+  case XF_SRCGEOM_INROW:
+    src = Gather3([&](u32 i) { return lanes.in[i]->position; });
+    break;
+  case XF_SRCNORMAL_INROW:
+    src = Gather3([&](u32 i) { return lanes.in[i]->normal[0]; });
+    break;
+  case XF_SRCBINORMAL_T_INROW:
+    src = Gather3([&](u32 i) { return lanes.in[i]->normal[1]; });
+    break;
+  case XF_SRCBINORMAL_B_INROW:
+    src = Gather3([&](u32 i) { return lanes.in[i]->normal[2]; });
+    break;
+  default:
+  {
+    ASSERT(texinfo.sourcerow >= XF_SRCTEX0_INROW && texinfo.sourcerow <= XF_SRCTEX7_INROW);
+    const u32 row = std::clamp<u32>(texinfo.sourcerow, XF_SRCTEX0_INROW, XF_SRCTEX7_INROW) -
+                    XF_SRCTEX0_INROW;
+    src.x = Gather([&](u32 i) { return lanes.in[i]->texCoords[row][0]; });
+    src.y = Gather([&](u32 i) { return lanes.in[i]->texCoords[row][1]; });
+    src.z = Set(1.0f);
+    break;
+  }
+  }
+
+  std::array<const float*, LANES> matrices;
+  for (u32 i = 0; i < LANES; i++)
+    matrices[i] = &xfmem.posMatrices[lanes.in[i]->texMtx[coord_num] * 4];
+  Vec m[12];
+
+  Vec3x4 dst;
+  if (texinfo.projection == XF_TEXPROJ_ST)
+  {
+    LoadMatrix(matrices, 8, m);
+    if (texinfo.inputform == XF_TEXINPUT_AB11 || special_case)
+    {
+      dst.x = MultiplyVec2Row(src, &m[0]);
+      dst.y = MultiplyVec2Row(src, &m[4]);
+    }
+    else
+    {
+      dst.x = MultiplyVec3Row(src, &m[0]);
+      dst.y = MultiplyVec3Row(src, &m[4]);
+    }
+    dst.z = Set(1.0f);
+  }
+  else
+  {
+    ASSERT(!special_case);
+
+    LoadMatrix(matrices, 12, m);
+    if (texinfo.inputform == XF_TEXINPUT_AB11)
+    {
+      dst = {MultiplyVec2Row(src, &m[0]), MultiplyVec2Row(src, &m[4]),
+             MultiplyVec2Row(src, &m[8])};
+    }
+    else
+    {
+      dst = MultiplyVec3Mat34(src, m);
+    }
+  }
+
+  if (xfmem.dualTexTrans.enabled)
+  {
+    const PostMtxInfo& postInfo = xfmem.postMtxInfo[coord_num];
+    const float* post_mat = &xfmem.postMatrices[postInfo.index * 4];
+    Vec pm[12];
+    for (u32 i = 0; i < 12; i++)
+      pm[i] = Set(post_mat[i]);
+
+    if (special_case)
+    {
+      // no normalization, q of input is 1
+      dst = {MultiplyVec2Row(dst, &pm[0]), MultiplyVec2Row(dst, &pm[4]), Set(1.0f)};
+    }
+    else
+    {
+      dst = MultiplyVec3Mat34(postInfo.normalize ? Normalized(dst) : dst, pm);
+    }
+  }
+
+  // The special case for q = 0, see TransformTexCoordRegular
+  const Mask q_is_zero = Equal(dst.z, Set(0.0f));
+  const auto clamp = [](Vec v) {
+    v = Div(v, Set(2.0f));
+    v = Select(Greater(Set(-1.0f), v), Set(-1.0f), v);
+    return Select(Greater(v, Set(1.0f)), Set(1.0f), v);
+  };
+  dst.x = Select(q_is_zero, clamp(dst.x), dst.x);
+  dst.y = Select(q_is_zero, clamp(dst.y), dst.y);
+
+  Scatter3(dst, [&](u32 i, const Vec3& v) { lanes.out[i]->texCoords[coord_num] = v; });
+}
+
+// Same as TransformUnit::TransformTexCoord
+void TransformTexCoords(const Lanes& lanes, const Vec3x4& mv_position,
+                        const std::array<Vec3x4, 3>& normals, bool special_case)
+{
+  for (u32 coord_num = 0; coord_num < xfmem.numTexGen.numTexGens; coord_num++)
+  {
+    const TexMtxInfo& texinfo = xfmem.texMtxInfo[coord_num];
+
+    switch (texinfo.texgentype)
+    {
+    case XF_TEXGEN_REGULAR:
+      TransformTexCoordRegular(lanes, texinfo, coord_num, special_case);
+      break;
+    case XF_TEXGEN_EMBOSS_MAP:
+    {
+      const Light& light = xfmem.lights[texinfo.embosslightshift];
+
+      const Vec3x4 ldir = Normalized(Sub3(Set3(light.dpos), mv_position));
+      const Vec d1 = Dot(ldir, normals[1]);
+      const Vec d2 = Dot(ldir, normals[2]);
+
+      const u32 source = texinfo.embosssourceshift;
+      const Vec3x4 src = Gather3([&](u32 i) { return lanes.out[i]->texCoords[source]; });
+      const Vec3x4 dst = {Add(src.x, d1), Add(src.y, d2), src.z};
+      Scatter3(dst, [&](u32 i, const Vec3& v) { lanes.out[i]->texCoords[coord_num] = v; });
+    }
+    break;
+    case XF_TEXGEN_COLOR_STRGBC0:
+    case XF_TEXGEN_COLOR_STRGBC1:
+    {
+      ASSERT(texinfo.sourcerow == XF_SRCCOLORS_INROW);
+      ASSERT(texinfo.inputform == XF_TEXINPUT_AB11);
+      const u32 chan = texinfo.texgentype == XF_TEXGEN_COLOR_STRGBC0 ? 0 : 1;
+      for (OutputVertexData* dst : lanes.out)
+      {
+        dst->texCoords[coord_num].x = (float)dst->color[chan][0] / 255.0f;
+        dst->texCoords[coord_num].y = (float)dst->color[chan][1] / 255.0f;
+        dst->texCoords[coord_num].z = 1.0f;
+      }
+    }
+    break;
+    default:
+      ERROR_LOG_FMT(VIDEO, "Bad tex gen type {}", texinfo.texgentype.Value());
+      break;
+    }
+  }
+
+  for (u32 coord_num = 0; coord_num < xfmem.numTexGen.numTexGens; coord_num++)
+  {
+    const float scale_s = static_cast<float>(bpmem.texcoords[coord_num].s.scale_minus_1 + 1);
+    const float scale_t = static_cast<float>(bpmem.texcoords[coord_num].t.scale_minus_1 + 1);
+    for (OutputVertexData* dst : lanes.out)
+    {
+      dst->texCoords[coord_num][0] *= scale_s;
+      dst->texCoords[coord_num][1] *= scale_t;
+    }
+  }
+}
+}  // namespace
+
+namespace TransformUnit
+{
+void TransformVertices(const InputVertexData* src, OutputVertexData* dst, u32 count,
+                       bool has_normal, bool nbt, bool specialCase)
+{
+  for (u32 base = 0; base < count; base += LANES)
+  {
+    const u32 num_lanes = std::min(count - base, LANES);
+
+    // Unused lanes repeat the last vertex, their results are written to scratch space since some
+    // stages update the outputs in place
+    std::array<OutputVertexData, LANES> unused_lanes;
+    Lanes lanes;
+    for (u32 i = 0; i < LANES; i++)
+    {
+      lanes.in[i] = &src[base + std::min(i, num_lanes - 1)];
+      lanes.out[i] = i < num_lanes ? &dst[base + i] : &unused_lanes[i];
+      std::memset(static_cast<void*>(lanes.out[i]), 0, sizeof(OutputVertexData));
+    }
+
+    Vec3x4 mv_position;
+    TransformPositions(lanes, &mv_position);
+
+    std::array<Vec3x4, 3> normals;
+    normals.fill(Set3(0.0f, 0.0f, 0.0f));
+    if (has_normal)
+      TransformNormals(lanes, nbt, &normals);
+
+    TransformColors(lanes, mv_position, normals[0]);
+    TransformTexCoords(lanes, mv_position, normals, specialCase);
+  }
+}
+}  // namespace TransformUnit
@@ -0,0 +1,381 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "VideoCommon/DisplayListCache.h"
+
+#include <unordered_map>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/Hash.h"
+#include "Common/Logging/Log.h"
+#include "VideoCommon/BPMemory.h"
+#include "VideoCommon/CPMemory.h"
+#include "VideoCommon/DataReader.h"
+#include "VideoCommon/OpcodeDecoding.h"
+#include "VideoCommon/Statistics.h"
+#include "VideoCommon/VertexLoaderManager.h"
+#include "VideoCommon/XFMemory.h"
+
+namespace DisplayListCache
+{
+namespace
+{
+// All cached lists are dropped when they take up more memory than this
+constexpr size_t MAX_CACHE_SIZE = 32 * 1024 * 1024;
+
+// A decoded command of a display list. Commands that only take cycles are left out.
+struct Command
+{
+  enum class Type : u8
+  {
+    LoadCP,
+    LoadXF,
+    LoadIndexedXF,
+    LoadBP,
+    Primitive,
+  };
+
+  Type type;
+  // LoadCP: the sub command, LoadIndexedXF: the ref array, Primitive: the command byte
+  u8 sub_cmd;
+  // LoadXF: the transfer size, Primitive: the vertex count
+  u16 count;
+  // LoadXF: the XF address, Primitive: the index in CachedList::primitives, else the value
+  u32 value;
+  // LoadXF, Primitive: offset of the data in the list
+  u32 offset;
+  // Cycles taken by the list up to and including this command
+  u32 end_cycles;
+};
+
+// A primitive command as it was run while recording
+struct RecordedPrimitive
+{
+  // Offset of the vertex data in the list
+  u32 offset;
+  // Returned by RunVertices
+  int bytes;
+  VertexLoaderManager::ConvertedVertices vertices;
+};
+
+enum class State
+{
+  Seen,         // Called once, is recorded on the next call
+  Cached,       // Recorded and decoded
+  Uncacheable,  // Contains commands that can't be cached
+};
+
+struct CachedList
+{
+  u64 hash = 0;
+  State state = State::Seen;
+  std::vector<Command> commands;
+  std::vector<RecordedPrimitive> primitives;
+  u32 cycles = 0;
+  size_t size = 0;
+};
+
+// Lists by address and size
+std::unordered_map<u64, CachedList> s_lists;
+size_t s_cache_size = 0;
+
+// The list that is being recorded, and its contents
+CachedList* s_recording = nullptr;
+const u8* s_recording_data = nullptr;
+
+void Forget(CachedList* list)
+{
+  s_cache_size -= list->size;
+  *list = {};
+}
+
+u32 Interpret(u8* data, u32 size)
+{
+  u32 cycles = 0;
+  OpcodeDecoder::Run(DataReader(data, data + size), &cycles, true);
+  return cycles;
+}
+
+// Decodes the commands of a list that was just interpreted, in the same way as OpcodeDecoder::Run.
+// The sizes of the primitive commands come from the recorded primitives.
+bool Decode(u8* data, u32 size, CachedList* list)
+{
+  DataReader src(data, data + size);
+  u32 cycles = 0;
+  size_t next_primitive = 0;
+
+  const auto finish_up = [list, &cycles, &next_primitive] {
+    list->cycles = cycles;
+    return next_primitive == list->primitives.size();
+  };
+
+  while (true)
+  {
+    if (!src.size())
+      return finish_up();
+
+    Command command{};
+    const u8 cmd_byte = src.Read<u8>();
+    switch (cmd_byte)
+    {
+    case OpcodeDecoder::GX_NOP:
+    case OpcodeDecoder::GX_UNKNOWN_RESET:
+    case OpcodeDecoder::GX_CMD_UNKNOWN_METRICS:
+    case OpcodeDecoder::GX_CMD_INVL_VC:
+      cycles += 6;
+      continue;
+
+    case OpcodeDecoder::GX_LOAD_CP_REG:
+      if (src.size() < 1 + 4)
+        return finish_up();
+
+      cycles += 12;
+      command.type = Command::Type::LoadCP;
+      command.sub_cmd = src.Read<u8>();
+      command.value = src.Read<u32>();
+      break;
+
+    case OpcodeDecoder::GX_LOAD_XF_REG:
+    {
+      if (src.size() < 4)
+        return finish_up();
+
+      const u32 cmd2 = src.Read<u32>();
+      const u32 transfer_size = ((cmd2 >> 16) & 15) + 1;
+      if (src.size() < transfer_size * sizeof(u32))
+        return finish_up();
+
+      cycles += 18 + 6 * transfer_size;
+      command.type = Command::Type::LoadXF;
+      command.count = transfer_size;
+      command.value = cmd2 & 0xFFFF;
+      command.offset = static_cast<u32>(src.GetPointer() - data);
+      src.Skip<u32>(transfer_size);
+    }
+    break;
+
+    case OpcodeDecoder::GX_LOAD_INDX_A:
+    case OpcodeDecoder::GX_LOAD_INDX_B:
+    case OpcodeDecoder::GX_LOAD_INDX_C:
+    case OpcodeDecoder::GX_LOAD_INDX_D:
+      if (src.size() < 4)
+        return finish_up();
+
+      cycles += 6;
+      command.type = Command::Type::LoadIndexedXF;
+      command.sub_cmd = (cmd_byte / 8) + 8;
+      command.value = src.Read<u32>();
+      break;
+
+    case OpcodeDecoder::GX_CMD_CALL_DL:
+      if (src.size() < 8)
+        return finish_up();
+
+      // Display lists can't be called from display lists
+      cycles += 6;
+      src.Skip<u32>(2);
+      continue;
+
+    case OpcodeDecoder::GX_LOAD_BP_REG:
+      if (src.size() < 4)
+        return finish_up();
+
+      cycles += 12;
+      command.type = Command::Type::LoadBP;
+      command.value = src.Read<u32>();
+      break;
+
+    default:
+    {
+      // Unknown opcodes are reported every time
+      if ((cmd_byte & 0xC0) != 0x80)
+        return false;
+
+      if (src.size() < 2)
+        return finish_up();
+
+      const u16 num_vertices = src.Read<u16>();
+      const u32 offset = static_cast<u32>(src.GetPointer() - data);
+      if (next_primitive >= list->primitives.size() ||
+          list->primitives[next_primitive].offset != offset)
+      {
+        return false;
+      }
+
+      command.type = Command::Type::Primitive;
+      command.sub_cmd = cmd_byte;
+      command.count = num_vertices;
+      command.value = static_cast<u32>(next_primitive);
+      command.offset = offset;
+
+      const int bytes = list->primitives[next_primitive++].bytes;
+      if (bytes < 0)
+      {
+        // Keep the command, so that replaying it stops at the same point
+        command.end_cycles = cycles;
+        list->commands.push_back(command);
+        return finish_up();
+      }
+
+      src.Skip(bytes);
+      cycles += num_vertices * 4 * 3 + 6;
+    }
+    break;
+    }
+
+    command.end_cycles = cycles;
+    list->commands.push_back(command);
+  }
+}
+
+u32 Record(CachedList* list, u8* data, u32 size)
+{
+  s_recording = list;
+  s_recording_data = data;
+  const u32 cycles = Interpret(data, size);
+  s_recording = nullptr;
+
+  if (!Decode(data, size, list) || list->cycles != cycles)
+  {
+    list->commands = {};
+    list->primitives = {};
+    list->state = State::Uncacheable;
+    return cycles;
+  }
+
+  list->commands.shrink_to_fit();
+  list->size = list->commands.size() * sizeof(Command);
+  for (const RecordedPrimitive& primitive : list->primitives)
+    list->size += sizeof(primitive) + primitive.vertices.data.size();
+  s_cache_size += list->size;
+  list->state = State::Cached;
+  return cycles;
+}
+
+// Returns false if the list has to be recorded again
+bool Replay(const CachedList& list, u8* data, u32 size, u32* cycles)
+{
+  u8* const end = data + size;
+
+  for (const Command& command : list.commands)
+  {
+    switch (command.type)
+    {
+    case Command::Type::LoadCP:
+      LoadCPReg(command.sub_cmd, command.value, false);
+      INCSTAT(g_stats.this_frame.num_cp_loads);
+      break;
+
+    case Command::Type::LoadXF:
+      LoadXFReg(command.count, command.value, DataReader(data + command.offset, end));
+      INCSTAT(g_stats.this_frame.num_xf_loads);
+      break;
+
+    case Command::Type::LoadIndexedXF:
+      LoadIndexedXF(command.value, command.sub_cmd);
+      break;
+
+    case Command::Type::LoadBP:
+      LoadBPReg(command.value);
+      INCSTAT(g_stats.this_frame.num_bp_loads);
+      break;
+
+    case Command::Type::Primitive:
+    {
+      const RecordedPrimitive& primitive = list.primitives[command.value];
+      const int bytes = VertexLoaderManager::ReplayVertices(
+          command.sub_cmd & OpcodeDecoder::GX_VAT_MASK,
+          (command.sub_cmd & OpcodeDecoder::GX_PRIMITIVE_MASK) >> OpcodeDecoder::GX_PRIMITIVE_SHIFT,
+          command.count, DataReader(data + command.offset, end), primitive.vertices);
+      if (bytes == primitive.bytes)
+        break;
+
+      // The vertex format isn't the same as when the list was recorded, so the vertices have a
+      // different size and the rest of the list has to be interpreted.
+      const u32 primitive_cycles = command.count * 4 * 3 + 6;
+      const u32 start_cycles = command.end_cycles - (primitive.bytes < 0 ? 0 : primitive_cycles);
+      if (bytes < 0)
+      {
+        *cycles = start_cycles;
+      }
+      else
+      {
+        const u32 rest_offset = command.offset + bytes;
+        *cycles = start_cycles + primitive_cycles + Interpret(data + rest_offset, size - rest_offset);
+      }
+      return false;
+    }
+    }
+  }
+
+  *cycles = list.cycles;
+  return true;
+}
+}  // Anonymous namespace
+
+void Init()
+{
+  // The hash function is shared with the texture cache
+  Common::SetHash64Function();
+}
+
+void Shutdown()
+{
+  s_lists.clear();
+  s_cache_size = 0;
+}
+
+u32 Run(u32 address, u8* data, u32 size)
+{
+  if (s_cache_size + s_lists.size() * sizeof(CachedList) > MAX_CACHE_SIZE)
+  {
+    INFO_LOG_FMT(VIDEO, "Display list cache is full, clearing it");
+    Shutdown();
+  }
+
+  const u64 hash = Common::GetHash64(data, size, 0);
+  const auto [iter, inserted] = s_lists.try_emplace((u64(address) << 32) | size);
+  CachedList& list = iter->second;
+  if (inserted || list.hash != hash)
+  {
+    Forget(&list);
+    list.hash = hash;
+    return Interpret(data, size);
+  }
+
+  switch (list.state)
+  {
+  case State::Seen:
+    return Record(&list, data, size);
+
+  case State::Cached:
+  {
+    u32 cycles;
+    if (!Replay(list, data, size, &cycles))
+    {
+      Forget(&list);
+      list.hash = hash;
+    }
+    return cycles;
+  }
+
+  case State::Uncacheable:
+  default:
+    return Interpret(data, size);
+  }
+}
+
+int RunVertices(int vtx_attr_group, int primitive, int count, DataReader src)
+{
+  if (!s_recording)
+    return VertexLoaderManager::RunVertices(vtx_attr_group, primitive, count, src, false);
+
+  RecordedPrimitive& recorded = s_recording->primitives.emplace_back();
+  recorded.offset = static_cast<u32>(src.GetPointer() - s_recording_data);
+  recorded.bytes =
+      VertexLoaderManager::RecordVertices(vtx_attr_group, primitive, count, src, &recorded.vertices);
+  return recorded.bytes;
+}
+}  // namespace DisplayListCache
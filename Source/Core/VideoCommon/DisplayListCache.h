@@ -0,0 +1,32 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// Games call the same display lists every frame. Instead of parsing them again on every call, the
+// commands of a display list are decoded once into a list of register writes and primitives, with
+// the vertices already converted to the native format where they only depend on the display list.
+// Lists are looked up by address and size, and a hash of their contents catches changes to them.
+//
+// Vertex sizes depend on the vertex format at the time of the call, so they can't be known before
+// a list has been interpreted. Lists are therefore recorded while they are interpreted, and when
+// the vertex format is different on a later call, the rest of the list is interpreted normally.
+
+#pragma once
+
+#include "Common/CommonTypes.h"
+
+class DataReader;
+
+namespace DisplayListCache
+{
+void Init();
+void Shutdown();
+
+// Interprets the display list at address, like OpcodeDecoder::Run does. data points to its
+// contents. Returns the cycles it took.
+u32 Run(u32 address, u8* data, u32 size);
+
+// Used by OpcodeDecoder::Run for the primitive commands in display lists, same as
+// VertexLoaderManager::RunVertices
+int RunVertices(int vtx_attr_group, int primitive, int count, DataReader src);
+}  // namespace DisplayListCache
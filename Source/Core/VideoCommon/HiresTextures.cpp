@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <thread>
@@ -32,6 +33,8 @@
 #include "Core/Config/GraphicsSettings.h"
 #include "Core/ConfigManager.h"
 #include "VideoCommon/OnScreenDisplay.h"
+#include "VideoCommon/TextureDecoder.h"
+#include "VideoCommon/TexturePackArchive.h"
 #include "VideoCommon/VideoConfig.h"
 
 struct DiskTexture
@@ -42,7 +45,12 @@ struct DiskTexture
 
 constexpr std::string_view s_format_prefix{"tex1_"};
 
+// Number of textures that are prefetched between checks for aborting and the memory limit
+constexpr size_t PREFETCH_BATCH_SIZE = 32;
+
 static std::unordered_map<std::string, DiskTexture> s_textureMap;
+// Searched for textures that aren't in s_textureMap
+static std::vector<std::shared_ptr<TexturePackArchive>> s_archives;
 static std::unordered_map<std::string, std::shared_ptr<HiresTexture>> s_textureCache;
 static std::mutex s_textureCacheMutex;
 static Common::Flag s_textureCacheAbortLoading;
@@ -63,9 +71,36 @@ void HiresTexture::Shutdown()
   }
 
   s_textureMap.clear();
+  s_archives.clear();
   s_textureCache.clear();
 }
 
+// Whether there is a custom texture with this name, either as a file or in an archive
+static bool HasCustomTexture(const std::string& name)
+{
+  return s_textureMap.find(name) != s_textureMap.end() ||
+         std::any_of(s_archives.begin(), s_archives.end(),
+                     [&name](const auto& archive) { return archive->Contains(name); });
+}
+
+// Adds a custom texture file to the map, returning false if it already has one with the same name
+static bool AddTextureFile(const std::string& path,
+                           std::unordered_map<std::string, DiskTexture>* files)
+{
+  std::string filename;
+  SplitPath(path, nullptr, &filename, nullptr);
+
+  if (filename.substr(0, s_format_prefix.length()) != s_format_prefix)
+    return true;
+
+  const size_t arb_index = filename.rfind("_arb");
+  const bool has_arbitrary_mipmaps = arb_index != std::string::npos;
+  if (has_arbitrary_mipmaps)
+    filename.erase(arb_index, 4);
+
+  return files->try_emplace(filename, DiskTexture{path, has_arbitrary_mipmaps}).second;
+}
+
 void HiresTexture::Update()
 {
   if (s_prefetcher.joinable())
@@ -88,8 +123,10 @@ void HiresTexture::Update()
   const std::string& game_id = SConfig::GetInstance().GetGameID();
   const std::set<std::string> texture_directories =
       GetTextureDirectoriesWithGameId(File::GetUserPath(D_HIRESTEXTURES_IDX), game_id);
-  const std::vector<std::string> extensions{".png", ".dds"};
+  const std::vector<std::string> extensions{".png", ".dds",
+                                            std::string(TexturePackArchive::EXTENSION)};
 
+  s_archives.clear();
   for (const auto& texture_directory : texture_directories)
   {
     const auto texture_paths =
@@ -98,23 +135,20 @@ void HiresTexture::Update()
     bool failed_insert = false;
     for (auto& path : texture_paths)
     {
-      std::string filename;
-      SplitPath(path, nullptr, &filename, nullptr);
-
-      if (filename.substr(0, s_format_prefix.length()) == s_format_prefix)
+      if (StringEndsWith(path, TexturePackArchive::EXTENSION))
       {
-        const size_t arb_index = filename.rfind("_arb");
-        const bool has_arbitrary_mipmaps = arb_index != std::string::npos;
-        if (has_arbitrary_mipmaps)
-          filename.erase(arb_index, 4);
-
-        const auto [it, inserted] =
-            s_textureMap.try_emplace(filename, DiskTexture{path, has_arbitrary_mipmaps});
-        if (!inserted)
+        auto archive = std::make_shared<TexturePackArchive>();
+        if (archive->Open(path))
         {
-          failed_insert = true;
+          INFO_LOG_FMT(VIDEO, "Using {} custom textures from {}", archive->GetTextureCount(),
+                       path);
+          s_archives.push_back(std::move(archive));
         }
       }
+      else if (!AddTextureFile(path, &s_textureMap))
+      {
+        failed_insert = true;
+      }
     }
 
     if (failed_insert)
@@ -130,7 +164,7 @@ void HiresTexture::Update()
     auto iter = s_textureCache.begin();
     while (iter != s_textureCache.end())
     {
-      if (s_textureMap.find(iter->first) == s_textureMap.end())
+      if (!HasCustomTexture(iter->first))
       {
         iter = s_textureCache.erase(iter);
       }
@@ -148,6 +182,7 @@ void HiresTexture::Update()
 void HiresTexture::Clear()
 {
   s_textureMap.clear();
+  s_archives.clear();
   s_textureCache.clear();
 }
 
@@ -162,34 +197,50 @@ void HiresTexture::Prefetch()
   const size_t max_mem =
       (sys_mem / 2 < recommended_min_mem) ? (sys_mem / 2) : (sys_mem - recommended_min_mem);
 
-  const u32 start_time = Common::Timer::GetTimeMs();
+  // Textures are loaded in batches, each spread across the texture decoding workers, so that
+  // aborting and the memory limit are still checked regularly.
+  std::vector<const std::string*> base_filenames;
   for (const auto& entry : s_textureMap)
   {
-    const std::string& base_filename = entry.first;
+    if (entry.first.find("_mip") == std::string::npos)
+      base_filenames.push_back(&entry.first);
+  }
 
-    if (base_filename.find("_mip") == std::string::npos)
-    {
-      std::unique_lock<std::mutex> lk(s_textureCacheMutex);
+  const u32 start_time = Common::Timer::GetTimeMs();
+  std::vector<std::unique_ptr<HiresTexture>> textures;
+  for (size_t batch = 0; batch < base_filenames.size(); batch += PREFETCH_BATCH_SIZE)
+  {
+    const size_t batch_size = std::min(PREFETCH_BATCH_SIZE, base_filenames.size() - batch);
+    textures.clear();
+    textures.resize(batch_size);
+
+    // The cache isn't locked while loading. This may result in a race condition where we'll load
+    // a texture twice, but it reduces the stuttering a lot.
+    TexDecoder_ParallelFor(batch_size, [&](size_t i) {
+      const std::string& base_filename = *base_filenames[batch + i];
+      {
+        std::lock_guard<std::mutex> lk(s_textureCacheMutex);
+        if (s_textureCache.find(base_filename) != s_textureCache.end())
+          return;
+      }
+      textures[i] = Load(base_filename, 0, 0);
+    });
 
-      auto iter = s_textureCache.find(base_filename);
-      if (iter == s_textureCache.end())
+    {
+      std::lock_guard<std::mutex> lk(s_textureCacheMutex);
+      for (size_t i = 0; i < batch_size; ++i)
       {
-        // unlock while loading a texture. This may result in a race condition where
-        // we'll load a texture twice, but it reduces the stuttering a lot.
-        lk.unlock();
-        std::unique_ptr<HiresTexture> texture = Load(base_filename, 0, 0);
-        lk.lock();
-        if (texture)
+        const std::string& base_filename = *base_filenames[batch + i];
+        auto iter = s_textureCache.find(base_filename);
+        if (iter == s_textureCache.end() && textures[i])
+          iter = s_textureCache.emplace(base_filename, std::move(textures[i])).first;
+
+        if (iter != s_textureCache.end())
         {
-          std::shared_ptr<HiresTexture> ptr(std::move(texture));
-          iter = s_textureCache.insert(iter, std::make_pair(base_filename, ptr));
+          for (const Level& l : iter->second->m_levels)
+            size_sum += l.data.size();
         }
       }
-      if (iter != s_textureCache.end())
-      {
-        for (const Level& l : iter->second->m_levels)
-          size_sum += l.data.size();
-      }
     }
 
     if (s_textureCacheAbortLoading.IsSet())
@@ -220,7 +271,7 @@ std::string HiresTexture::GenBaseName(const u8* texture, size_t texture_size, co
                                       size_t tlut_size, u32 width, u32 height, TextureFormat format,
                                       bool has_mipmaps, bool dump)
 {
-  if (!dump && s_textureMap.empty())
+  if (!dump && s_textureMap.empty() && s_archives.empty())
     return "";
 
   // checking for min/max on paletted textures
@@ -280,12 +331,12 @@ std::string HiresTexture::GenBaseName(const u8* texture, size_t texture_size, co
   if (!dump)
   {
     const std::string texture_name = fmt::format("{}_${}", base_name, format_name);
-    if (s_textureMap.find(texture_name) != s_textureMap.end())
+    if (HasCustomTexture(texture_name))
       return texture_name;
   }
 
   // else generate the complete texture
-  if (dump || s_textureMap.find(full_name) != s_textureMap.end())
+  if (dump || HasCustomTexture(full_name))
     return full_name;
 
   return "";
@@ -334,51 +385,124 @@ std::shared_ptr<HiresTexture> HiresTexture::Search(const u8* texture, size_t tex
 
 std::unique_ptr<HiresTexture> HiresTexture::Load(const std::string& base_filename, u32 width,
                                                  u32 height)
+{
+  // Can't use make_unique due to private constructor.
+  std::unique_ptr<HiresTexture> ret = std::unique_ptr<HiresTexture>(new HiresTexture());
+
+  // Loose files take precedence over texture pack archives, so that packed textures can be
+  // replaced without repacking.
+  const auto filename_iter = s_textureMap.find(base_filename);
+  if (filename_iter != s_textureMap.end())
+  {
+    LoadFromFiles(ret.get(), s_textureMap, base_filename);
+    return VerifyLevels(std::move(ret), filename_iter->second.path, width, height);
+  }
+
+  if (LoadFromArchives(ret.get(), base_filename))
+    return VerifyLevels(std::move(ret), base_filename, width, height);
+
+  return nullptr;
+}
+
+bool HiresTexture::LoadFromArchives(HiresTexture* tex, const std::string& base_filename)
+{
+  for (const std::shared_ptr<TexturePackArchive>& archive : s_archives)
+  {
+    std::optional<TexturePackArchive::Texture> texture = archive->Find(base_filename);
+    if (!texture)
+      continue;
+
+    // The levels point into the archive, which is kept mapped while the texture is alive
+    tex->m_archive = archive;
+    tex->m_has_arbitrary_mipmaps = texture->has_arbitrary_mipmaps;
+    for (const TexturePackArchive::Level& archive_level : texture->levels)
+    {
+      Level& level = tex->m_levels.emplace_back();
+      level.archive_data = archive_level.data;
+      level.archive_data_size = archive_level.size;
+      level.format = archive_level.format;
+      level.width = archive_level.width;
+      level.height = archive_level.height;
+      level.row_length = archive_level.row_length;
+    }
+    return true;
+  }
+
+  return false;
+}
+
+void HiresTexture::LoadFromFiles(HiresTexture* tex, const TextureFileMap& files,
+                                 const std::string& base_filename)
 {
   // We need to have a level 0 custom texture to even consider loading.
-  auto filename_iter = s_textureMap.find(base_filename);
-  if (filename_iter == s_textureMap.end())
-    return nullptr;
+  auto filename_iter = files.find(base_filename);
+  if (filename_iter == files.end())
+    return;
 
   // Try to load level 0 (and any mipmaps) from a DDS file.
   // If this fails, it's fine, we'll just load level0 again using SOIL.
-  // Can't use make_unique due to private constructor.
-  std::unique_ptr<HiresTexture> ret = std::unique_ptr<HiresTexture>(new HiresTexture());
   const DiskTexture& first_mip_file = filename_iter->second;
-  ret->m_has_arbitrary_mipmaps = first_mip_file.has_arbitrary_mipmaps;
-  LoadDDSTexture(ret.get(), first_mip_file.path);
+  tex->m_has_arbitrary_mipmaps = first_mip_file.has_arbitrary_mipmaps;
+  LoadDDSTexture(tex, first_mip_file.path);
 
-  // Load remaining mip levels, or from the start if it's not a DDS texture.
-  for (u32 mip_level = static_cast<u32>(ret->m_levels.size());; mip_level++)
+  // Find the remaining mip levels, or all of them if it's not a DDS texture, and load them in
+  // parallel.
+  struct PendingLevel
+  {
+    std::string filename;
+    const std::string* path;
+    Level level;
+    bool loaded = false;
+  };
+  std::vector<PendingLevel> pending_levels;
+  for (u32 mip_level = static_cast<u32>(tex->m_levels.size());; mip_level++)
   {
     std::string filename = base_filename;
     if (mip_level != 0)
       filename += fmt::format("_mip{}", mip_level);
 
-    filename_iter = s_textureMap.find(filename);
-    if (filename_iter == s_textureMap.end())
+    filename_iter = files.find(filename);
+    if (filename_iter == files.end())
       break;
 
+    pending_levels.push_back({std::move(filename), &filename_iter->second.path});
+  }
+
+  const u32 first_pending_level = static_cast<u32>(tex->m_levels.size());
+  TexDecoder_ParallelFor(pending_levels.size(), [&](size_t i) {
+    PendingLevel& pending = pending_levels[i];
+
     // Try loading DDS textures first, that way we maintain compression of DXT formats.
     // TODO: Reduce the number of open() calls here. We could use one fd.
-    Level level;
-    if (!LoadDDSTexture(level, filename_iter->second.path, mip_level))
+    pending.loaded = LoadDDSTexture(pending.level, *pending.path,
+                                    first_pending_level + static_cast<u32>(i));
+    if (!pending.loaded)
     {
       File::IOFile file;
-      file.Open(filename_iter->second.path, "rb");
+      file.Open(*pending.path, "rb");
       std::vector<u8> buffer(file.GetSize());
       file.ReadBytes(buffer.data(), file.GetSize());
 
-      if (!LoadTexture(level, buffer))
-      {
-        ERROR_LOG_FMT(VIDEO, "Custom texture {} failed to load", filename);
-        break;
-      }
+      pending.loaded = LoadTexture(pending.level, buffer);
     }
+  });
 
-    ret->m_levels.push_back(std::move(level));
+  for (PendingLevel& pending : pending_levels)
+  {
+    if (!pending.loaded)
+    {
+      ERROR_LOG_FMT(VIDEO, "Custom texture {} failed to load", pending.filename);
+      break;
+    }
+
+    tex->m_levels.push_back(std::move(pending.level));
   }
+}
 
+std::unique_ptr<HiresTexture> HiresTexture::VerifyLevels(std::unique_ptr<HiresTexture> ret,
+                                                         std::string_view source, u32 width,
+                                                         u32 height)
+{
   // If we failed to load any mip levels, we can't use this texture at all.
   if (ret->m_levels.empty())
     return nullptr;
@@ -390,7 +514,7 @@ std::unique_ptr<HiresTexture> HiresTexture::Load(const std::string& base_filenam
     ERROR_LOG_FMT(VIDEO,
                   "Invalid custom texture size {}x{} for texture {}. The aspect differs "
                   "from the native size {}x{}.",
-                  first_mip.width, first_mip.height, first_mip_file.path, width, height);
+                  first_mip.width, first_mip.height, source, width, height);
   }
 
   // Same deal if the custom texture isn't a multiple of the native size.
@@ -399,7 +523,7 @@ std::unique_ptr<HiresTexture> HiresTexture::Load(const std::string& base_filenam
     ERROR_LOG_FMT(VIDEO,
                   "Invalid custom texture size {}x{} for texture {}. Please use an integer "
                   "upscaling factor based on the native size {}x{}.",
-                  first_mip.width, first_mip.height, first_mip_file.path, width, height);
+                  first_mip.width, first_mip.height, source, width, height);
   }
 
   // Verify that each mip level is the correct size (divide by 2 each time).
@@ -418,14 +542,14 @@ std::unique_ptr<HiresTexture> HiresTexture::Load(const std::string& base_filenam
 
       ERROR_LOG_FMT(
           VIDEO, "Invalid custom texture size {}x{} for texture {}. Mipmap level {} must be {}x{}.",
-          level.width, level.height, first_mip_file.path, mip_level, current_mip_width,
+          level.width, level.height, source, mip_level, current_mip_width,
           current_mip_height);
     }
     else
     {
       // It is invalid to have more than a single 1x1 mipmap.
       ERROR_LOG_FMT(VIDEO, "Custom texture {} has too many 1x1 mipmaps. Skipping extra levels.",
-                    first_mip_file.path);
+                    source);
     }
 
     // Drop this mip level and any others after it.
@@ -438,7 +562,7 @@ std::unique_ptr<HiresTexture> HiresTexture::Load(const std::string& base_filenam
                   [&ret](const Level& l) { return l.format != ret->m_levels[0].format; }))
   {
     ERROR_LOG_FMT(VIDEO, "Custom texture {} has inconsistent formats across mip levels.",
-                  first_mip_file.path);
+                  source);
 
     return nullptr;
   }
@@ -446,6 +570,79 @@ std::unique_ptr<HiresTexture> HiresTexture::Load(const std::string& base_filenam
   return ret;
 }
 
+bool HiresTexture::WriteArchive(const std::string& texture_directory,
+                                const std::string& archive_path)
+{
+  TextureFileMap files;
+  for (const std::string& path :
+       Common::DoFileSearch({texture_directory}, {".png", ".dds"}, /*recursive*/ true))
+  {
+    if (!AddTextureFile(path, &files))
+      ERROR_LOG_FMT(VIDEO, "Custom texture {} is in the directory more than once", path);
+  }
+
+  // Sorted so that packing the same directory again gives the same archive
+  std::vector<std::string> base_filenames;
+  for (const auto& entry : files)
+  {
+    if (entry.first.find("_mip") == std::string::npos)
+      base_filenames.push_back(entry.first);
+  }
+  std::sort(base_filenames.begin(), base_filenames.end());
+
+  TexturePackArchiveWriter writer;
+  if (!writer.Open(archive_path))
+  {
+    ERROR_LOG_FMT(VIDEO, "Failed to create {}", archive_path);
+    return false;
+  }
+
+  // PNGs are packed decoded, and DDS files keep their block compression, so that nothing but the
+  // upload is left to do when a texture is used.
+  std::vector<std::unique_ptr<HiresTexture>> textures;
+  for (size_t batch = 0; batch < base_filenames.size(); batch += PREFETCH_BATCH_SIZE)
+  {
+    const size_t batch_size = std::min(PREFETCH_BATCH_SIZE, base_filenames.size() - batch);
+    textures.clear();
+    textures.resize(batch_size);
+
+    TexDecoder_ParallelFor(batch_size, [&](size_t i) {
+      const std::string& base_filename = base_filenames[batch + i];
+      std::unique_ptr<HiresTexture> texture = std::unique_ptr<HiresTexture>(new HiresTexture());
+      LoadFromFiles(texture.get(), files, base_filename);
+      textures[i] = VerifyLevels(std::move(texture), files.at(base_filename).path, 0, 0);
+    });
+
+    for (size_t i = 0; i < batch_size; ++i)
+    {
+      if (!textures[i])
+        continue;
+
+      std::vector<TexturePackArchive::Level> levels;
+      for (const Level& level : textures[i]->m_levels)
+      {
+        levels.push_back({level.GetData(), level.GetDataSize(), level.width, level.height,
+                          level.row_length, level.format});
+      }
+
+      if (!writer.AddTexture(base_filenames[batch + i], textures[i]->m_has_arbitrary_mipmaps,
+                             levels))
+      {
+        ERROR_LOG_FMT(VIDEO, "Failed to write {}", archive_path);
+        return false;
+      }
+    }
+  }
+
+  if (!writer.Finish())
+  {
+    ERROR_LOG_FMT(VIDEO, "Failed to write {}", archive_path);
+    return false;
+  }
+
+  return true;
+}
+
 bool HiresTexture::LoadTexture(Level& level, const std::vector<u8>& buffer)
 {
   if (!Common::LoadPNG(buffer, &level.data, &level.width, &level.height))
@@ -7,12 +7,16 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "Common/CommonTypes.h"
 #include "VideoCommon/TextureConfig.h"
 
 enum class TextureFormat;
+struct DiskTexture;
+class TexturePackArchive;
 
 std::set<std::string> GetTextureDirectoriesWithGameId(const std::string& root_directory,
                                                       const std::string& game_id);
@@ -35,6 +39,10 @@ public:
 
   static u32 CalculateMipCount(u32 width, u32 height);
 
+  // Packs the custom textures in a directory into a single archive, which is mapped into memory
+  // instead of being loaded file by file.
+  static bool WriteArchive(const std::string& texture_directory, const std::string& archive_path);
+
   ~HiresTexture();
 
   AbstractTextureFormat GetFormat() const;
@@ -42,7 +50,13 @@ public:
 
   struct Level
   {
+    const u8* GetData() const { return archive_data ? archive_data : data.data(); }
+    size_t GetDataSize() const { return archive_data ? archive_data_size : data.size(); }
+
     std::vector<u8> data;
+    // Used instead of data for levels that are in a texture pack archive
+    const u8* archive_data = nullptr;
+    size_t archive_data_size = 0;
     AbstractTextureFormat format = AbstractTextureFormat::RGBA8;
     u32 width = 0;
     u32 height = 0;
@@ -51,8 +65,16 @@ public:
   std::vector<Level> m_levels;
 
 private:
+  using TextureFileMap = std::unordered_map<std::string, DiskTexture>;
+
   static std::unique_ptr<HiresTexture> Load(const std::string& base_filename, u32 width,
                                             u32 height);
+  static void LoadFromFiles(HiresTexture* tex, const TextureFileMap& files,
+                            const std::string& base_filename);
+  static bool LoadFromArchives(HiresTexture* tex, const std::string& base_filename);
+  static std::unique_ptr<HiresTexture> VerifyLevels(std::unique_ptr<HiresTexture> tex,
+                                                    std::string_view source, u32 width,
+                                                    u32 height);
   static bool LoadDDSTexture(HiresTexture* tex, const std::string& filename);
   static bool LoadDDSTexture(Level& level, const std::string& filename, u32 mip_level);
   static bool LoadTexture(Level& level, const std::vector<u8>& buffer);
@@ -60,4 +82,5 @@ private:
 
   HiresTexture() {}
   bool m_has_arbitrary_mipmaps;
+  std::shared_ptr<const TexturePackArchive> m_archive;
 };
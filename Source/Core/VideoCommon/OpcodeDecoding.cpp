@@ -11,7 +11,7 @@
 // Note that it IS NOT GENERALLY POSSIBLE to precompile display lists! You can compile them as they
 // are while interpreting them, and hope that the vertex format doesn't change, though, if you do
 // it right when they are called. The reason is that the vertex format affects the sizes of the
-// vertices.
+// vertices. DisplayListCache does this.
 
 #include "VideoCommon/OpcodeDecoding.h"
 
@@ -23,6 +23,7 @@
 #include "VideoCommon/CPMemory.h"
 #include "VideoCommon/CommandProcessor.h"
 #include "VideoCommon/DataReader.h"
+#include "VideoCommon/DisplayListCache.h"
 #include "VideoCommon/Fifo.h"
 #include "VideoCommon/Statistics.h"
 #include "VideoCommon/VertexLoaderManager.h"
@@ -51,7 +52,11 @@ u32 InterpretDisplayList(u32 address, u32 size)
     // temporarily swap dl and non-dl (small "hack" for the stats)
     g_stats.SwapDL();
 
-    Run(DataReader(start_address, start_address + size), &cycles, true);
+    // The recorder needs to see every command of the list
+    if (g_record_fifo_data)
+      Run(DataReader(start_address, start_address + size), &cycles, true);
+    else
+      cycles = DisplayListCache::Run(address, start_address, size);
     INCSTAT(g_stats.this_frame.num_dlists_called);
 
     // un-swap
@@ -241,9 +246,18 @@ u8* Run(DataReader src, u32* cycles, bool in_display_list)
           return finish_up();
 
         const u16 num_vertices = src.Read<u16>();
-        const int bytes = VertexLoaderManager::RunVertices(
-            cmd_byte & GX_VAT_MASK,  // Vertex loader index (0 - 7)
-            (cmd_byte & GX_PRIMITIVE_MASK) >> GX_PRIMITIVE_SHIFT, num_vertices, src, is_preprocess);
+        const int vtx_attr_group = cmd_byte & GX_VAT_MASK;  // Vertex loader index (0 - 7)
+        const int primitive = (cmd_byte & GX_PRIMITIVE_MASK) >> GX_PRIMITIVE_SHIFT;
+        int bytes;
+        if (in_display_list && !is_preprocess)
+        {
+          bytes = DisplayListCache::RunVertices(vtx_attr_group, primitive, num_vertices, src);
+        }
+        else
+        {
+          bytes = VertexLoaderManager::RunVertices(vtx_attr_group, primitive, num_vertices, src,
+                                                   is_preprocess);
+        }
 
         if (bytes < 0)
           return finish_up();
@@ -7,7 +7,9 @@
 #include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -55,6 +57,7 @@ static const u64 TEXHASH_INVALID = 0;
 // Sonic the Fighters (inside Sonic Gems Collection) loops a 64 frames animation
 static const int TEXTURE_KILL_THRESHOLD = 64;
 static const int TEXTURE_POOL_KILL_THRESHOLD = 3;
+static const size_t MAX_TRACKED_HASHES = 65536;
 
 std::unique_ptr<TextureCacheBase> g_texture_cache;
 
@@ -68,8 +71,11 @@ TextureCacheBase::TCacheEntry::TCacheEntry(std::unique_ptr<AbstractTexture> tex,
 
 TextureCacheBase::TCacheEntry::~TCacheEntry()
 {
-  for (auto& reference : references)
-    reference->references.erase(this);
+  for (TCacheEntry* reference : references)
+  {
+    auto& other_references = reference->references;
+    other_references.erase(std::find(other_references.begin(), other_references.end(), this));
+  }
 }
 
 void TextureCacheBase::CheckTempSize(size_t required_size)
@@ -127,14 +133,12 @@ void TextureCacheBase::Invalidate()
   InvalidateAllBindPoints();
 
   bound_textures.fill(nullptr);
-  for (auto& tex : textures_by_address)
-  {
-    delete tex.second;
-  }
-  textures_by_address.clear();
-  textures_by_hash.clear();
+  textures_by_address.ForEach([](u32, TCacheEntry* entry) { delete entry; });
+  textures_by_address.Clear();
+  textures_by_hash.Clear();
+  tracked_hashes.clear();
 
-  texture_pool.clear();
+  texture_pool.Clear();
 }
 
 void TextureCacheBase::ForceReload()
@@ -174,65 +178,59 @@ void TextureCacheBase::OnConfigChanged(const VideoConfig& config)
 
 void TextureCacheBase::Cleanup(int _frameCount)
 {
-  TexAddrCache::iterator iter = textures_by_address.begin();
-  TexAddrCache::iterator tcend = textures_by_address.end();
-  while (iter != tcend)
-  {
-    if (iter->second->tmem_only)
+  // The indices can't be modified while iterating over them, so the entries are invalidated
+  // afterwards
+  std::vector<TCacheEntry*> invalidated_entries;
+  textures_by_address.ForEach([&](u32, TCacheEntry* entry) {
+    if (entry->tmem_only)
     {
-      iter = InvalidateTexture(iter);
+      invalidated_entries.push_back(entry);
     }
-    else if (iter->second->frameCount == FRAMECOUNT_INVALID)
+    else if (entry->frameCount == FRAMECOUNT_INVALID)
     {
-      iter->second->frameCount = _frameCount;
-      ++iter;
+      entry->frameCount = _frameCount;
     }
-    else if (_frameCount > TEXTURE_KILL_THRESHOLD + iter->second->frameCount)
+    else if (_frameCount > TEXTURE_KILL_THRESHOLD + entry->frameCount)
     {
-      if (iter->second->IsCopy())
+      if (entry->IsCopy())
       {
         // Only remove EFB copies when they wouldn't be used anymore(changed hash), because EFB
         // copies living on the
         // host GPU are unrecoverable. Perform this check only every TEXTURE_KILL_THRESHOLD for
         // performance reasons
-        if ((_frameCount - iter->second->frameCount) % TEXTURE_KILL_THRESHOLD == 1 &&
-            iter->second->hash != iter->second->CalculateHash())
+        if ((_frameCount - entry->frameCount) % TEXTURE_KILL_THRESHOLD == 1 &&
+            entry->hash != entry->CalculateHash())
         {
-          iter = InvalidateTexture(iter);
-        }
-        else
-        {
-          ++iter;
+          invalidated_entries.push_back(entry);
         }
       }
       else
       {
-        iter = InvalidateTexture(iter);
+        invalidated_entries.push_back(entry);
       }
     }
-    else
-    {
-      ++iter;
-    }
-  }
+  });
+  for (TCacheEntry* entry : invalidated_entries)
+    InvalidateTexture(entry);
 
-  TexPool::iterator iter2 = texture_pool.begin();
-  TexPool::iterator tcend2 = texture_pool.end();
-  while (iter2 != tcend2)
-  {
-    if (iter2->second.frameCount == FRAMECOUNT_INVALID)
+  std::vector<TextureConfig> empty_configs;
+  texture_pool.ForEach([&](const TextureConfig& config, std::vector<TexPoolEntry>& entries) {
+    for (TexPoolEntry& entry : entries)
     {
-      iter2->second.frameCount = _frameCount;
+      if (entry.frameCount == FRAMECOUNT_INVALID)
+        entry.frameCount = _frameCount;
     }
-    if (_frameCount > TEXTURE_POOL_KILL_THRESHOLD + iter2->second.frameCount)
-    {
-      iter2 = texture_pool.erase(iter2);
-    }
-    else
-    {
-      ++iter2;
-    }
-  }
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [_frameCount](const TexPoolEntry& entry) {
+                                   return _frameCount >
+                                          TEXTURE_POOL_KILL_THRESHOLD + entry.frameCount;
+                                 }),
+                  entries.end());
+    if (entries.empty())
+      empty_configs.push_back(config);
+  });
+  for (const TextureConfig& config : empty_configs)
+    texture_pool.Erase(config);
 }
 
 bool TextureCacheBase::TCacheEntry::OverlapsMemoryRange(u32 range_address, u32 range_size) const
@@ -325,7 +323,7 @@ TextureCacheBase::ApplyPaletteToEntry(TCacheEntry* entry, u8* palette, TLUTForma
     g_renderer->EndUtilityDrawing();
   }
 
-  textures_by_address.emplace(decoded_entry->addr, decoded_entry);
+  textures_by_address.Insert(decoded_entry->addr, decoded_entry);
 
   return decoded_entry;
 }
@@ -372,7 +370,7 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::ReinterpretEntry(const TCacheEn
   g_renderer->EndUtilityDrawing();
   reinterpreted_entry->texture->FinishedRendering();
 
-  textures_by_address.emplace(reinterpreted_entry->addr, reinterpreted_entry);
+  textures_by_address.Insert(reinterpreted_entry->addr, reinterpreted_entry);
 
   return reinterpreted_entry;
 }
@@ -411,8 +409,8 @@ void TextureCacheBase::ScaleTextureCacheEntryTo(TextureCacheBase::TCacheEntry* e
   // At this point new_texture has the old texture in it,
   // we can potentially reuse this, so let's move it back to the pool
   auto config = new_texture->texture->GetConfig();
-  texture_pool.emplace(
-      config, TexPoolEntry(std::move(new_texture->texture), std::move(new_texture->framebuffer)));
+  texture_pool[config].emplace_back(std::move(new_texture->texture),
+                                    std::move(new_texture->framebuffer));
 }
 
 bool TextureCacheBase::CheckReadbackTexture(u32 width, u32 height, AbstractTextureFormat format)
@@ -558,22 +556,20 @@ void TextureCacheBase::DoSaveState(PointerWrap& p)
   std::vector<std::pair<u64, u32>> textures_by_hash_list;
   if (Config::Get(Config::GFX_SAVE_TEXTURE_CACHE_TO_STATE))
   {
-    for (const auto& it : textures_by_address)
-    {
-      if (ShouldSaveEntry(it.second))
+    textures_by_address.ForEach([&](u32 addr, TCacheEntry* entry) {
+      if (ShouldSaveEntry(entry))
       {
-        const u32 id = AddCacheEntryToMap(it.second);
-        textures_by_address_list.emplace_back(it.first, id);
+        const u32 id = AddCacheEntryToMap(entry);
+        textures_by_address_list.emplace_back(addr, id);
       }
-    }
-    for (const auto& it : textures_by_hash)
-    {
-      if (ShouldSaveEntry(it.second))
+    });
+    textures_by_hash.ForEach([&](u64 hash, TCacheEntry* entry) {
+      if (ShouldSaveEntry(entry))
       {
-        const u32 id = AddCacheEntryToMap(it.second);
-        textures_by_hash_list.emplace_back(it.first, id);
+        const u32 id = AddCacheEntryToMap(entry);
+        textures_by_hash_list.emplace_back(hash, id);
       }
-    }
+    });
   }
 
   // Save the texture cache entries out in the order the were referenced.
@@ -663,7 +659,6 @@ void TextureCacheBase::DoLoadState(PointerWrap& p)
     // to update the point in the state state. We'll just throw it away if it's invalid.
     auto tex = DeserializeTexture(p);
     TCacheEntry* entry = new TCacheEntry(std::move(tex->texture), std::move(tex->framebuffer));
-    entry->textures_by_hash_iter = textures_by_hash.end();
     entry->DoState(p);
     if (entry->texture && commit_state)
       id_map.emplace(i, entry);
@@ -696,7 +691,7 @@ void TextureCacheBase::DoLoadState(PointerWrap& p)
 
     TCacheEntry* entry = GetEntry(id);
     if (entry)
-      textures_by_address.emplace(addr, entry);
+      textures_by_address.Insert(addr, entry);
   }
 
   // Fill in hash map.
@@ -710,7 +705,10 @@ void TextureCacheBase::DoLoadState(PointerWrap& p)
 
     TCacheEntry* entry = GetEntry(id);
     if (entry)
-      entry->textures_by_hash_iter = textures_by_hash.emplace(hash, entry);
+    {
+      textures_by_hash.Insert(hash, entry);
+      entry->textures_by_hash_key = hash;
+    }
   }
 }
 
@@ -763,12 +761,12 @@ TextureCacheBase::DoPartialTextureUpdates(TCacheEntry* entry_to_update, u8* pale
 
   u32 numBlocksX = (entry_to_update->native_width + block_width - 1) / block_width;
 
-  auto iter = FindOverlappingTextures(entry_to_update->addr, entry_to_update->size_in_bytes);
-  while (iter.first != iter.second)
+  for (TCacheEntry* overlapping_entry :
+       FindOverlappingTextures(entry_to_update->addr, entry_to_update->size_in_bytes))
   {
-    TCacheEntry* entry = iter.first->second;
+    TCacheEntry* entry = overlapping_entry;
     if (entry != entry_to_update && entry->IsCopy() && !entry->tmem_only &&
-        entry->references.count(entry_to_update) == 0 &&
+        !entry->HasReference(entry_to_update) &&
         entry->OverlapsMemoryRange(entry_to_update->addr, entry_to_update->size_in_bytes) &&
         entry->memory_stride == numBlocksX * block_size)
     {
@@ -779,7 +777,6 @@ TextureCacheBase::DoPartialTextureUpdates(TCacheEntry* entry_to_update, u8* pale
         {
           if (!CanReinterpretTextureOnGPU(entry_to_update->format.texfmt, entry->format.texfmt))
           {
-            ++iter.first;
             continue;
           }
 
@@ -803,7 +800,6 @@ TextureCacheBase::DoPartialTextureUpdates(TCacheEntry* entry_to_update, u8* pale
           }
           else
           {
-            ++iter.first;
             continue;
           }
         }
@@ -865,7 +861,6 @@ TextureCacheBase::DoPartialTextureUpdates(TCacheEntry* entry_to_update, u8* pale
             static_cast<u32>(dst_x + copy_width) > entry_to_update->GetWidth() ||
             static_cast<u32>(dst_y + copy_height) > entry_to_update->GetHeight())
         {
-          ++iter.first;
           continue;
         }
 
@@ -891,8 +886,7 @@ TextureCacheBase::DoPartialTextureUpdates(TCacheEntry* entry_to_update, u8* pale
         {
           // Remove the temporary converted texture, it won't be used anywhere else
           // TODO: It would be nice to convert and copy in one step, but this code path isn't common
-          iter.first = InvalidateTexture(iter.first);
-          continue;
+          InvalidateTexture(overlapping_entry);
         }
         else
         {
@@ -905,11 +899,9 @@ TextureCacheBase::DoPartialTextureUpdates(TCacheEntry* entry_to_update, u8* pale
       else
       {
         // If the hash does not match, this EFB copy will not be used for anything, so remove it
-        iter.first = InvalidateTexture(iter.first);
-        continue;
+        InvalidateTexture(overlapping_entry);
       }
     }
-    ++iter.first;
   }
 
   return entry_to_update;
@@ -1213,6 +1205,34 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
   return entry;
 }
 
+u64 TextureCacheBase::GetTrackedTextureHash(u32 address, const u8* src_data, u32 size,
+                                            int samples)
+{
+  // Every texture address ever used stays in here, so don't let it grow forever
+  if (tracked_hashes.size() >= MAX_TRACKED_HASHES)
+    tracked_hashes.clear();
+
+  TrackedHash& tracked = tracked_hashes[address];
+  const bool same_data = tracked.size == size && tracked.samples == samples;
+  if (same_data && tracked.write_count &&
+      !Memory::WrittenSince(address, size, *tracked.write_count))
+  {
+    return tracked.hash;
+  }
+
+  // The pages have to be protected before hashing, or a write in between could be missed
+  const std::optional<u64> write_count =
+      same_data && tracked.stable ? Memory::TrackWrites(address, size) : std::nullopt;
+  const u64 hash = Common::GetHash64(src_data, size, samples);
+
+  tracked.stable = same_data && hash == tracked.hash;
+  tracked.size = size;
+  tracked.samples = samples;
+  tracked.hash = hash;
+  tracked.write_count = write_count;
+  return hash;
+}
+
 TextureCacheBase::TCacheEntry*
 TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFormat texformat,
                              const int textureCacheSafetyColorSampleSize, u32 tlutaddr,
@@ -1287,7 +1307,15 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
 
   // TODO: This doesn't hash GB tiles for preloaded RGBA8 textures (instead, it's hashing more data
   // from the low tmem bank than it should)
-  base_hash = Common::GetHash64(src_data, texture_size, textureCacheSafetyColorSampleSize);
+  if (g_ActiveConfig.bTextureWriteTracking && !from_tmem)
+  {
+    base_hash =
+        GetTrackedTextureHash(address, src_data, texture_size, textureCacheSafetyColorSampleSize);
+  }
+  else
+  {
+    base_hash = Common::GetHash64(src_data, texture_size, textureCacheSafetyColorSampleSize);
+  }
   u32 palette_size = 0;
   if (isPaletteTexture)
   {
@@ -1339,23 +1367,16 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
   // For efb copies, the entry created in CopyRenderTargetToTexture always has to be used, or else
   // it was
   // done in vain.
-  auto iter_range = textures_by_address.equal_range(address);
-  TexAddrCache::iterator iter = iter_range.first;
-  TexAddrCache::iterator oldest_entry = iter;
+  TCacheEntry* oldest_entry = nullptr;
   int temp_frameCount = 0x7fffffff;
-  TexAddrCache::iterator unconverted_copy = textures_by_address.end();
-  TexAddrCache::iterator unreinterpreted_copy = textures_by_address.end();
+  TCacheEntry* unconverted_copy = nullptr;
+  TCacheEntry* unreinterpreted_copy = nullptr;
 
-  while (iter != iter_range.second)
+  for (TCacheEntry* entry : textures_by_address.Find(address))
   {
-    TCacheEntry* entry = iter->second;
-
     // Skip entries that are only left in our texture cache for the tmem cache emulation
     if (entry->tmem_only)
-    {
-      ++iter;
       continue;
-    }
 
     // TODO: Some games (Rogue Squadron 3, Twin Snakes) seem to load a previously made XFB
     // copy as a regular texture. You can see this particularly well in RS3 whenever the
@@ -1386,21 +1407,20 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
           {
             // Delay the conversion until afterwards, it's possible this texture has already been
             // converted.
-            unreinterpreted_copy = iter++;
+            unreinterpreted_copy = entry;
             continue;
           }
           else
           {
             // If the EFB copies are in a different format and are not reinterpretable, use the RAM
             // copy.
-            ++iter;
             continue;
           }
         }
         else
         {
           // Prefer the already-converted copy.
-          unconverted_copy = textures_by_address.end();
+          unconverted_copy = nullptr;
         }
 
         // TODO: We should check width/height/levels for EFB copies. I'm not sure what effect
@@ -1412,7 +1432,7 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
         // perform the conversion later.  Currently, we only convert EFB copies to
         // palette textures; we could do other conversions if it proved to be
         // beneficial.
-        unconverted_copy = iter;
+        unconverted_copy = entry;
       }
       else
       {
@@ -1420,7 +1440,7 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
         // never be useful again.  It's theoretically possible for a game to do
         // something weird where the copy could become useful in the future, but in
         // practice it doesn't happen.
-        iter = InvalidateTexture(iter);
+        InvalidateTexture(entry);
         continue;
       }
     }
@@ -1431,7 +1451,7 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
           entry->native_levels >= tex_levels && entry->native_width == nativeW &&
           entry->native_height == nativeH)
       {
-        entry = DoPartialTextureUpdates(iter->second, &texMem[tlutaddr], tlutfmt);
+        entry = DoPartialTextureUpdates(entry, &texMem[tlutaddr], tlutfmt);
         entry->texture->FinishedRendering();
         return entry;
       }
@@ -1448,14 +1468,13 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
         !entry->IsCopy() && !(isPaletteTexture && entry->base_hash == base_hash))
     {
       temp_frameCount = entry->frameCount;
-      oldest_entry = iter;
+      oldest_entry = entry;
     }
-    ++iter;
   }
 
-  if (unreinterpreted_copy != textures_by_address.end())
+  if (unreinterpreted_copy)
   {
-    TCacheEntry* decoded_entry = ReinterpretEntry(unreinterpreted_copy->second, texformat);
+    TCacheEntry* decoded_entry = ReinterpretEntry(unreinterpreted_copy, texformat);
 
     // It's possible to combine reinterpreted textures + palettes.
     if (unreinterpreted_copy == unconverted_copy && decoded_entry)
@@ -1465,10 +1484,9 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
       return decoded_entry;
   }
 
-  if (unconverted_copy != textures_by_address.end())
+  if (unconverted_copy)
   {
-    TCacheEntry* decoded_entry =
-        ApplyPaletteToEntry(unconverted_copy->second, &texMem[tlutaddr], tlutfmt);
+    TCacheEntry* decoded_entry = ApplyPaletteToEntry(unconverted_copy, &texMem[tlutaddr], tlutfmt);
 
     if (decoded_entry)
     {
@@ -1485,20 +1503,19 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
   if (textureCacheSafetyColorSampleSize == 0 ||
       std::max(texture_size, palette_size) <= (u32)textureCacheSafetyColorSampleSize * 8)
   {
-    auto hash_range = textures_by_hash.equal_range(full_hash);
-    TexHashCache::iterator hash_iter = hash_range.first;
-    while (hash_iter != hash_range.second)
+    if (const TexHashCache::Entries* hash_entries = textures_by_hash.Find(full_hash))
     {
-      TCacheEntry* entry = hash_iter->second;
-      // All parameters, except the address, need to match here
-      if (entry->format == full_format && entry->native_levels >= tex_levels &&
-          entry->native_width == nativeW && entry->native_height == nativeH)
+      for (TCacheEntry* entry : *hash_entries)
       {
-        entry = DoPartialTextureUpdates(hash_iter->second, &texMem[tlutaddr], tlutfmt);
-        entry->texture->FinishedRendering();
-        return entry;
+        // All parameters, except the address, need to match here
+        if (entry->format == full_format && entry->native_levels >= tex_levels &&
+            entry->native_width == nativeW && entry->native_height == nativeH)
+        {
+          entry = DoPartialTextureUpdates(entry, &texMem[tlutaddr], tlutfmt);
+          entry->texture->FinishedRendering();
+          return entry;
+        }
       }
-      ++hash_iter;
     }
   }
 
@@ -1551,8 +1568,8 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
   if (hires_tex)
   {
     const auto& level = hires_tex->m_levels[0];
-    entry->texture->Load(0, level.width, level.height, level.row_length, level.data.data(),
-                         level.data.size());
+    entry->texture->Load(0, level.width, level.height, level.row_length, level.GetData(),
+                         level.GetDataSize());
   }
 
   // Initialized to null because only software loading uses this buffer
@@ -1605,11 +1622,12 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
     }
   }
 
-  iter = textures_by_address.emplace(address, entry);
+  textures_by_address.Insert(address, entry);
   if (textureCacheSafetyColorSampleSize == 0 ||
       std::max(texture_size, palette_size) <= (u32)textureCacheSafetyColorSampleSize * 8)
   {
-    entry->textures_by_hash_iter = textures_by_hash.emplace(full_hash, entry);
+    textures_by_hash.Insert(full_hash, entry);
+    entry->textures_by_hash_key = full_hash;
   }
 
   entry->SetGeneralParameters(address, texture_size, full_format, false);
@@ -1632,7 +1650,7 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
     {
       const auto& level = hires_tex->m_levels[level_index];
       entry->texture->Load(level_index, level.width, level.height, level.row_length,
-                           level.data.data(), level.data.size());
+                           level.GetData(), level.GetDataSize());
     }
   }
   else
@@ -1648,6 +1666,19 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
       ptr_odd = &texMem[tmem_address_odd];
     }
 
+    struct CPUDecodedLevel
+    {
+      u32 level;
+      u32 width;
+      u32 height;
+      u32 expanded_width;
+      u32 expanded_height;
+      u32 decoded_size;
+      const u8* src;
+      u8* dst;
+    };
+    Common::SmallVector<CPUDecodedLevel, 11> cpu_levels;
+
     for (u32 level = 1; level != texLevels; ++level)
     {
       const u32 mip_width = CalculateLevelSize(width, level);
@@ -1666,18 +1697,27 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
       {
         // No need to call CheckTempSize here, as the whole buffer is preallocated at the beginning
         const u32 decoded_mip_size = expanded_mip_width * sizeof(u32) * expanded_mip_height;
-        TexDecoder_Decode(dst_buffer, mip_src_data, expanded_mip_width, expanded_mip_height,
-                          texformat, tlut, tlutfmt);
-        entry->texture->Load(level, mip_width, mip_height, expanded_mip_width, dst_buffer,
-                             decoded_mip_size);
-
-        arbitrary_mip_detector.AddLevel(mip_width, mip_height, expanded_mip_width, dst_buffer);
-
+        cpu_levels.push_back({level, mip_width, mip_height, expanded_mip_width,
+                              expanded_mip_height, decoded_mip_size, mip_src_data, dst_buffer});
         dst_buffer += decoded_mip_size;
       }
 
       mip_src_data += mip_size;
     }
+
+    // Most levels are too small to be split into bands, so decode them alongside each other
+    TexDecoder_ParallelFor(cpu_levels.size(), [&](size_t i) {
+      const CPUDecodedLevel& mip = cpu_levels[i];
+      TexDecoder_Decode(mip.dst, mip.src, mip.expanded_width, mip.expanded_height, texformat, tlut,
+                        tlutfmt);
+    });
+
+    for (const CPUDecodedLevel& mip : cpu_levels)
+    {
+      entry->texture->Load(mip.level, mip.width, mip.height, mip.expanded_width, mip.dst,
+                           mip.decoded_size);
+      arbitrary_mip_detector.AddLevel(mip.width, mip.height, mip.expanded_width, mip.dst);
+    }
   }
 
   entry->has_arbitrary_mips = hires_tex ? hires_tex->HasArbitraryMipmaps() :
@@ -1692,9 +1732,9 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
   }
 
   INCSTAT(g_stats.num_textures_uploaded);
-  SETSTAT(g_stats.num_textures_alive, static_cast<int>(textures_by_address.size()));
+  SETSTAT(g_stats.num_textures_alive, static_cast<int>(textures_by_address.Size()));
 
-  entry = DoPartialTextureUpdates(iter->second, &texMem[tlutaddr], tlutfmt);
+  entry = DoPartialTextureUpdates(entry, &texMem[tlutaddr], tlutfmt);
 
   // This should only be needed if the texture was updated, or used GPU decoding.
   entry->texture->FinishedRendering();
@@ -1767,8 +1807,8 @@ TextureCacheBase::GetXFBTexture(u32 address, u32 width, u32 height, u32 stride,
   entry->texture->FinishedRendering();
 
   // Insert into the texture cache so we can re-use it next frame, if needed.
-  textures_by_address.emplace(entry->addr, entry);
-  SETSTAT(g_stats.num_textures_alive, static_cast<int>(textures_by_address.size()));
+  textures_by_address.Insert(entry->addr, entry);
+  SETSTAT(g_stats.num_textures_alive, static_cast<int>(textures_by_address.Size()));
   INCSTAT(g_stats.num_textures_uploaded);
 
   if (g_ActiveConfig.bDumpXFBTarget)
@@ -1786,13 +1826,8 @@ TextureCacheBase::GetXFBTexture(u32 address, u32 width, u32 height, u32 stride,
 TextureCacheBase::TCacheEntry* TextureCacheBase::GetXFBFromCache(u32 address, u32 width, u32 height,
                                                                  u32 stride, u64 hash)
 {
-  auto iter_range = textures_by_address.equal_range(address);
-  TexAddrCache::iterator iter = iter_range.first;
-
-  while (iter != iter_range.second)
+  for (TCacheEntry* entry : textures_by_address.Find(address))
   {
-    TCacheEntry* entry = iter->second;
-
     // The only thing which has to match exactly is the stride. We can use a partial rectangle if
     // the VI width/height differs from that of the XFB copy.
     if (entry->is_xfb_copy && entry->memory_stride == stride && entry->native_width >= width &&
@@ -1815,12 +1850,9 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::GetXFBFromCache(u32 address, u3
         // At this point, we either have an xfb copy that has changed its hash
         // or an xfb created by stitching or from memory that has been changed
         // we are safe to invalidate this
-        iter = InvalidateTexture(iter);
-        continue;
+        InvalidateTexture(entry);
       }
     }
-
-    ++iter;
   }
 
   return nullptr;
@@ -1837,15 +1869,14 @@ void TextureCacheBase::StitchXFBCopy(TCacheEntry* stitched_entry)
   std::vector<TCacheEntry*> candidates;
   bool create_upscaled_copy = false;
 
-  auto iter = FindOverlappingTextures(stitched_entry->addr, stitched_entry->size_in_bytes);
-  while (iter.first != iter.second)
+  for (TCacheEntry* entry :
+       FindOverlappingTextures(stitched_entry->addr, stitched_entry->size_in_bytes))
   {
     // Currently, this checks the stride of the VRAM copy against the VI request. Therefore, for
     // interlaced modes, VRAM copies won't be considered candidates. This is okay for now, because
     // our force progressive hack means that an XFB copy should always have a matching stride. If
     // the hack is disabled, XFB2RAM should also be enabled. Should we wish to implement interlaced
     // stitching in the future, this would require a shader which grabs every second line.
-    TCacheEntry* entry = iter.first->second;
     if (entry != stitched_entry && entry->IsCopy() && !entry->tmem_only &&
         entry->OverlapsMemoryRange(stitched_entry->addr, stitched_entry->size_in_bytes) &&
         entry->memory_stride == stitched_entry->memory_stride)
@@ -1861,11 +1892,9 @@ void TextureCacheBase::StitchXFBCopy(TCacheEntry* stitched_entry)
       else
       {
         // If the hash does not match, this EFB copy will not be used for anything, so remove it
-        iter.first = InvalidateTexture(iter.first);
-        continue;
+        InvalidateTexture(entry);
       }
     }
-    ++iter.first;
   }
 
   if (candidates.empty())
@@ -2257,14 +2286,12 @@ void TextureCacheBase::CopyRenderTargetToTexture(
   // as our efb copy are marked to check them for partial texture updates.
   // TODO: The logic to detect overlapping strided efb copies is not 100% accurate.
   bool strided_efb_copy = dstStride != bytes_per_row;
-  auto iter = FindOverlappingTextures(dstAddr, covered_range);
-  while (iter.first != iter.second)
+  for (TCacheEntry* overlapping_entry : FindOverlappingTextures(dstAddr, covered_range))
   {
-    TCacheEntry* overlapping_entry = iter.first->second;
 
     if (overlapping_entry->addr == dstAddr && overlapping_entry->is_xfb_copy)
     {
-      for (auto& reference : overlapping_entry->references)
+      for (TCacheEntry* reference : overlapping_entry->references)
       {
         reference->reference_changed = true;
       }
@@ -2282,7 +2309,7 @@ void TextureCacheBase::CopyRenderTargetToTexture(
       {
         // Pending EFB copies which are completely covered by this new copy can simply be tossed,
         // instead of having to flush them later on, since this copy will write over everything.
-        iter.first = InvalidateTexture(iter.first, true);
+        InvalidateTexture(overlapping_entry, true);
         continue;
       }
 
@@ -2306,13 +2333,8 @@ void TextureCacheBase::CopyRenderTargetToTexture(
 
       // Do not load textures by hash, if they were at least partly overwritten by an efb copy.
       // In this case, comparing the hash is not enough to check, if two textures are identical.
-      if (overlapping_entry->textures_by_hash_iter != textures_by_hash.end())
-      {
-        textures_by_hash.erase(overlapping_entry->textures_by_hash_iter);
-        overlapping_entry->textures_by_hash_iter = textures_by_hash.end();
-      }
+      RemoveFromHashCache(overlapping_entry);
     }
-    ++iter.first;
   }
 
   if (OpcodeDecoder::g_record_fifo_data)
@@ -2333,7 +2355,7 @@ void TextureCacheBase::CopyRenderTargetToTexture(
   {
     const u64 hash = entry->CalculateHash();
     entry->SetHashes(hash, hash);
-    textures_by_address.emplace(dstAddr, entry);
+    textures_by_address.Insert(dstAddr, entry);
   }
 }
 
@@ -2381,10 +2403,8 @@ void TextureCacheBase::FlushEFBCopy(TCacheEntry* entry)
   if (entry->is_xfb_copy)
   {
     const u32 covered_range = entry->pending_efb_copy_height * entry->memory_stride;
-    auto range = FindOverlappingTextures(entry->addr, covered_range);
-    for (auto iter = range.first; iter != range.second; ++iter)
+    for (TCacheEntry* overlapping_entry : FindOverlappingTextures(entry->addr, covered_range))
     {
-      TCacheEntry* overlapping_entry = iter->second;
       if (overlapping_entry->may_have_overlapping_textures && overlapping_entry->is_xfb_copy &&
           overlapping_entry->OverlapsMemoryRange(entry->addr, covered_range))
       {
@@ -2468,7 +2488,6 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::AllocateCacheEntry(const Textur
 
   TCacheEntry* cacheEntry =
       new TCacheEntry(std::move(alloc->texture), std::move(alloc->framebuffer));
-  cacheEntry->textures_by_hash_iter = textures_by_hash.end();
   cacheEntry->id = last_entry_id++;
   return cacheEntry;
 }
@@ -2476,13 +2495,9 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::AllocateCacheEntry(const Textur
 std::optional<TextureCacheBase::TexPoolEntry>
 TextureCacheBase::AllocateTexture(const TextureConfig& config)
 {
-  TexPool::iterator iter = FindMatchingTextureFromPool(config);
-  if (iter != texture_pool.end())
-  {
-    auto entry = std::move(iter->second);
-    texture_pool.erase(iter);
-    return std::move(entry);
-  }
+  std::optional<TexPoolEntry> pool_entry = TakeMatchingTextureFromPool(config);
+  if (pool_entry)
+    return pool_entry;
 
   std::unique_ptr<AbstractTexture> texture = g_renderer->CreateTexture(config);
   if (!texture)
@@ -2508,39 +2523,32 @@ TextureCacheBase::AllocateTexture(const TextureConfig& config)
   return TexPoolEntry(std::move(texture), std::move(framebuffer));
 }
 
-TextureCacheBase::TexPool::iterator
-TextureCacheBase::FindMatchingTextureFromPool(const TextureConfig& config)
+std::optional<TextureCacheBase::TexPoolEntry>
+TextureCacheBase::TakeMatchingTextureFromPool(const TextureConfig& config)
 {
+  std::vector<TexPoolEntry>* entries = texture_pool.Find(config);
+  if (!entries)
+    return std::nullopt;
+
   // Find a texture from the pool that does not have a frameCount of FRAMECOUNT_INVALID.
   // This prevents a texture from being used twice in a single frame with different data,
   // which potentially means that a driver has to maintain two copies of the texture anyway.
   // Render-target textures are fine through, as they have to be generated in a seperated pass.
   // As non-render-target textures are usually static, this should not matter much.
-  auto range = texture_pool.equal_range(config);
-  auto matching_iter = std::find_if(range.first, range.second, [](const auto& iter) {
-    return iter.first.IsRenderTarget() || iter.second.frameCount != FRAMECOUNT_INVALID;
-  });
-  return matching_iter != range.second ? matching_iter : texture_pool.end();
-}
+  auto matching_iter =
+      std::find_if(entries->begin(), entries->end(), [&config](const TexPoolEntry& entry) {
+        return config.IsRenderTarget() || entry.frameCount != FRAMECOUNT_INVALID;
+      });
+  if (matching_iter == entries->end())
+    return std::nullopt;
 
-TextureCacheBase::TexAddrCache::iterator
-TextureCacheBase::GetTexCacheIter(TextureCacheBase::TCacheEntry* entry)
-{
-  auto iter_range = textures_by_address.equal_range(entry->addr);
-  TexAddrCache::iterator iter = iter_range.first;
-  while (iter != iter_range.second)
-  {
-    if (iter->second == entry)
-    {
-      return iter;
-    }
-    ++iter;
-  }
-  return textures_by_address.end();
+  std::optional<TexPoolEntry> entry = std::move(*matching_iter);
+  entries->erase(matching_iter);
+  return entry;
 }
 
-std::pair<TextureCacheBase::TexAddrCache::iterator, TextureCacheBase::TexAddrCache::iterator>
-TextureCacheBase::FindOverlappingTextures(u32 addr, u32 size_in_bytes)
+TextureCacheBase::TexAddrCache::Entries
+TextureCacheBase::FindOverlappingTextures(u32 addr, u32 size_in_bytes) const
 {
   // We index by the starting address only, so there is no way to query all textures
   // which end after the given addr. But the GC textures have a limited size, so we
@@ -2550,25 +2558,21 @@ TextureCacheBase::FindOverlappingTextures(u32 addr, u32 size_in_bytes)
   // 1024 x 1024 texel times 8 nibbles per texel
   constexpr u32 max_texture_size = 1024 * 1024 * 4;
   u32 lower_addr = addr > max_texture_size ? addr - max_texture_size : 0;
-  auto begin = textures_by_address.lower_bound(lower_addr);
-  auto end = textures_by_address.upper_bound(addr + size_in_bytes);
-
-  return std::make_pair(begin, end);
+  return textures_by_address.FindInRange(lower_addr, addr + size_in_bytes);
 }
 
-TextureCacheBase::TexAddrCache::iterator
-TextureCacheBase::InvalidateTexture(TexAddrCache::iterator iter, bool discard_pending_efb_copy)
+void TextureCacheBase::RemoveFromHashCache(TCacheEntry* entry)
 {
-  if (iter == textures_by_address.end())
-    return textures_by_address.end();
+  if (!entry->textures_by_hash_key)
+    return;
 
-  TCacheEntry* entry = iter->second;
+  textures_by_hash.Erase(*entry->textures_by_hash_key, entry);
+  entry->textures_by_hash_key.reset();
+}
 
-  if (entry->textures_by_hash_iter != textures_by_hash.end())
-  {
-    textures_by_hash.erase(entry->textures_by_hash_iter);
-    entry->textures_by_hash_iter = textures_by_hash.end();
-  }
+void TextureCacheBase::InvalidateTexture(TCacheEntry* entry, bool discard_pending_efb_copy)
+{
+  RemoveFromHashCache(entry);
 
   for (size_t i = 0; i < bound_textures.size(); ++i)
   {
@@ -2578,7 +2582,7 @@ TextureCacheBase::InvalidateTexture(TexAddrCache::iterator iter, bool discard_pe
     if (bound_textures[i] == entry && IsValidBindPoint(static_cast<u32>(i)))
     {
       bound_textures[i]->tmem_only = true;
-      return ++iter;
+      return;
     }
   }
 
@@ -2608,15 +2612,14 @@ TextureCacheBase::InvalidateTexture(TexAddrCache::iterator iter, bool discard_pe
     }
   }
 
+  textures_by_address.Erase(entry->addr, entry);
+
   auto config = entry->texture->GetConfig();
-  texture_pool.emplace(config,
-                       TexPoolEntry(std::move(entry->texture), std::move(entry->framebuffer)));
+  texture_pool[config].emplace_back(std::move(entry->texture), std::move(entry->framebuffer));
 
   // Don't delete if there's a pending EFB copy, as we need the TCacheEntry alive.
   if (!entry->pending_efb_copy)
     delete entry;
-
-  return textures_by_address.erase(iter);
 }
 
 bool TextureCacheBase::CreateUtilityTextures()
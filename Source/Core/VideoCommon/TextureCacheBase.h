@@ -4,21 +4,23 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <bitset>
-#include <map>
 #include <memory>
 #include <optional>
 #include <string>
 #include <tuple>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
 #include "Common/CommonTypes.h"
+#include "Common/FlatHashMap.h"
 #include "Common/MathUtil.h"
+#include "Common/SmallVector.h"
 #include "VideoCommon/AbstractTexture.h"
 #include "VideoCommon/BPMemory.h"
+#include "VideoCommon/TextureCacheIndex.h"
 #include "VideoCommon/TextureConfig.h"
 #include "VideoCommon/TextureDecoder.h"
 
@@ -115,14 +117,13 @@ public:
     // used to delete textures which haven't been used for TEXTURE_KILL_THRESHOLD frames
     int frameCount = FRAMECOUNT_INVALID;
 
-    // Keep an iterator to the entry in textures_by_hash, so it does not need to be searched when
-    // removing the cache entry
-    std::multimap<u64, TCacheEntry*>::iterator textures_by_hash_iter;
+    // The hash the entry is indexed by in textures_by_hash, if it is in there
+    std::optional<u64> textures_by_hash_key;
 
     // This is used to keep track of both:
     //   * efb copies used by this partially updated texture
     //   * partially updated textures which refer to this efb copy
-    std::unordered_set<TCacheEntry*> references;
+    Common::SmallVector<TCacheEntry*, 4> references;
 
     // Pending EFB copy
     std::unique_ptr<AbstractStagingTexture> pending_efb_copy;
@@ -163,8 +164,16 @@ public:
     void CreateReference(TCacheEntry* other_entry)
     {
       // References are two-way, so they can easily be destroyed later
-      this->references.emplace(other_entry);
-      other_entry->references.emplace(this);
+      if (HasReference(other_entry))
+        return;
+
+      this->references.push_back(other_entry);
+      other_entry->references.push_back(this);
+    }
+
+    bool HasReference(const TCacheEntry* other_entry) const
+    {
+      return std::find(references.begin(), references.end(), other_entry) != references.end();
     }
 
     void SetXfbCopy(u32 stride);
@@ -276,9 +285,9 @@ protected:
   static std::bitset<8> valid_bind_points;
 
 private:
-  using TexAddrCache = std::multimap<u32, TCacheEntry*>;
-  using TexHashCache = std::multimap<u64, TCacheEntry*>;
-  using TexPool = std::unordered_multimap<TextureConfig, TexPoolEntry>;
+  using TexAddrCache = TextureAddressIndex<TCacheEntry>;
+  using TexHashCache = TextureHashIndex<TCacheEntry>;
+  using TexPool = Common::FlatHashMap<TextureConfig, std::vector<TexPoolEntry>>;
 
   bool CreateUtilityTextures();
 
@@ -297,19 +306,24 @@ private:
   void DumpTexture(TCacheEntry* entry, std::string basename, unsigned int level, bool is_arbitrary);
   void CheckTempSize(size_t required_size);
 
+  // Hashes the texture data at address, or returns the last hash if write tracking shows that the
+  // data wasn't written since then
+  u64 GetTrackedTextureHash(u32 address, const u8* src_data, u32 size, int samples);
+
   TCacheEntry* AllocateCacheEntry(const TextureConfig& config);
   std::optional<TexPoolEntry> AllocateTexture(const TextureConfig& config);
-  TexPool::iterator FindMatchingTextureFromPool(const TextureConfig& config);
-  TexAddrCache::iterator GetTexCacheIter(TCacheEntry* entry);
+  std::optional<TexPoolEntry> TakeMatchingTextureFromPool(const TextureConfig& config);
 
-  // Return all possible overlapping textures. As addr+size of the textures is not
-  // indexed, this may return false positives.
-  std::pair<TexAddrCache::iterator, TexAddrCache::iterator>
-  FindOverlappingTextures(u32 addr, u32 size_in_bytes);
+  // Return all possible overlapping textures, sorted by address. As addr+size of the textures is
+  // not indexed, this may return false positives.
+  TexAddrCache::Entries FindOverlappingTextures(u32 addr, u32 size_in_bytes) const;
 
-  // Removes and unlinks texture from texture cache and returns it to the pool
-  TexAddrCache::iterator InvalidateTexture(TexAddrCache::iterator t_iter,
-                                           bool discard_pending_efb_copy = false);
+  // Removes the entry from textures_by_hash, if it is in there
+  void RemoveFromHashCache(TCacheEntry* entry);
+
+  // Removes and unlinks texture from texture cache and returns it to the pool. The entry is
+  // deleted unless it is still bound or has a pending EFB copy.
+  void InvalidateTexture(TCacheEntry* entry, bool discard_pending_efb_copy = false);
 
   void UninitializeXFBMemory(u8* dst, u32 stride, u32 bytes_per_row, u32 num_blocks_y);
 
@@ -339,6 +353,20 @@ private:
   TexPool texture_pool;
   u64 last_entry_id = 0;
 
+  // The last hash of the texture data at an address, for GetTrackedTextureHash
+  struct TrackedHash
+  {
+    u32 size = 0;
+    int samples = 0;
+    u64 hash = 0;
+    // The write count returned by Memory::TrackWrites, if the pages were protected before hashing
+    std::optional<u64> write_count;
+    // Whether the last two hashes were the same. Catching the writes to a texture that changes all
+    // the time costs more than hashing it, so only stable textures have their pages protected.
+    bool stable = false;
+  };
+  std::unordered_map<u32, TrackedHash> tracked_hashes;
+
   // Backup configuration values
   struct BackupConfig
   {
@@ -0,0 +1,166 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// Indices of the texture cache, keeping entries in flat arrays instead of tree nodes, so that a
+// lookup only touches a few cache lines. They only hold pointers, and never own the entries.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/FlatHashMap.h"
+#include "Common/SmallVector.h"
+
+// Entries by their start address. The address space is split into buckets, each holding the
+// entries that start in it sorted by address, so finding the entries in an address range only
+// looks at the buckets overlapping the range. Entries at the same address stay in the order
+// they were inserted in.
+template <typename T>
+class TextureAddressIndex
+{
+public:
+  using Entries = Common::SmallVector<T*, 16>;
+
+  size_t Size() const { return m_size; }
+
+  void Insert(u32 address, T* entry)
+  {
+    std::vector<Item>& bucket = m_buckets[address >> BUCKET_SHIFT];
+    const auto pos = std::upper_bound(bucket.begin(), bucket.end(), address,
+                                      [](u32 addr, const Item& item) { return addr < item.address; });
+    bucket.insert(pos, Item{address, entry});
+    ++m_size;
+  }
+
+  bool Erase(u32 address, T* entry)
+  {
+    std::vector<Item>* bucket = m_buckets.Find(address >> BUCKET_SHIFT);
+    if (!bucket)
+      return false;
+
+    const auto iter = std::find_if(bucket->begin(), bucket->end(), [&](const Item& item) {
+      return item.address == address && item.entry == entry;
+    });
+    if (iter == bucket->end())
+      return false;
+
+    // Empty buckets are kept, as textures tend to be created at the same addresses again
+    bucket->erase(iter);
+    --m_size;
+    return true;
+  }
+
+  void Clear()
+  {
+    m_buckets.Clear();
+    m_size = 0;
+  }
+
+  // Returns the entries at address, in the order they were inserted in
+  Entries Find(u32 address) const
+  {
+    Entries result;
+    const std::vector<Item>* bucket = m_buckets.Find(address >> BUCKET_SHIFT);
+    if (!bucket)
+      return result;
+
+    const auto range = std::equal_range(bucket->begin(), bucket->end(), Item{address, nullptr},
+                                        [](const Item& a, const Item& b) {
+                                          return a.address < b.address;
+                                        });
+    for (auto iter = range.first; iter != range.second; ++iter)
+      result.push_back(iter->entry);
+    return result;
+  }
+
+  // Returns the entries starting in [first, last], sorted by address
+  Entries FindInRange(u32 first, u32 last) const
+  {
+    Entries result;
+    for (u32 index = first >> BUCKET_SHIFT; index <= last >> BUCKET_SHIFT; ++index)
+    {
+      const std::vector<Item>* bucket = m_buckets.Find(index);
+      if (!bucket)
+        continue;
+
+      for (const Item& item : *bucket)
+      {
+        if (item.address >= first && item.address <= last)
+          result.push_back(item.entry);
+      }
+    }
+    return result;
+  }
+
+  // Calls f(u32 address, T* entry) for every entry. The index must not be modified from within f.
+  template <typename F>
+  void ForEach(F f)
+  {
+    m_buckets.ForEach([&f](u32, std::vector<Item>& bucket) {
+      for (const Item& item : bucket)
+        f(item.address, item.entry);
+    });
+  }
+
+private:
+  // 256 KiB, so that the lookback of overlap queries stays at a few buckets
+  static constexpr u32 BUCKET_SHIFT = 18;
+
+  struct Item
+  {
+    u32 address;
+    T* entry;
+  };
+
+  Common::FlatHashMap<u32, std::vector<Item>> m_buckets;
+  size_t m_size = 0;
+};
+
+// Entries by hash. Almost every hash belongs to a single entry, so they are kept inline.
+template <typename T>
+class TextureHashIndex
+{
+public:
+  using Entries = Common::SmallVector<T*, 2>;
+
+  void Insert(u64 hash, T* entry) { m_entries[hash].push_back(entry); }
+
+  bool Erase(u64 hash, T* entry)
+  {
+    Entries* entries = m_entries.Find(hash);
+    if (!entries)
+      return false;
+
+    const auto iter = std::find(entries->begin(), entries->end(), entry);
+    if (iter == entries->end())
+      return false;
+
+    entries->erase(iter);
+    if (entries->empty())
+      m_entries.Erase(hash);
+    return true;
+  }
+
+  void Clear() { m_entries.Clear(); }
+
+  // Returns the entries with hash in the order they were inserted in, or nullptr if there are none.
+  // The result is invalidated by Insert and Erase.
+  const Entries* Find(u64 hash) const { return m_entries.Find(hash); }
+
+  // Calls f(u64 hash, T* entry) for every entry. The index must not be modified from within f.
+  template <typename F>
+  void ForEach(F f)
+  {
+    m_entries.ForEach([&f](u64 hash, Entries& entries) {
+      for (T* entry : entries)
+        f(hash, entry);
+    });
+  }
+
+private:
+  Common::FlatHashMap<u64, Entries> m_entries;
+};
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <cstddef>
+#include <functional>
 #include <tuple>
 #include "Common/CommonTypes.h"
 
@@ -161,6 +163,13 @@ void TexDecoder_DecodeXFB(u8* dst, const u8* src, u32 width, u32 height, u32 str
 
 void TexDecoder_SetTexFmtOverlayOptions(bool enable, bool center);
 
+// Worker threads that large textures and custom textures are decoded on. Until they are started,
+// everything is decoded on the calling thread.
+void TexDecoder_StartWorkers();
+void TexDecoder_StopWorkers();
+// Calls function(i) for every i in [0, count), split between the calling thread and the workers
+void TexDecoder_ParallelFor(size_t count, const std::function<void(size_t)>& function);
+
 /* Internal method, implemented by TextureDecoder_Generic and TextureDecoder_x64. */
 void _TexDecoder_DecodeImpl(u32* dst, const u8* src, int width, int height, TextureFormat texformat,
                             const u8* tlut, TLUTFormat tlutfmt);
@@ -5,10 +5,13 @@
 #include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <thread>
 
+#include "Common/Align.h"
 #include "Common/CommonTypes.h"
 #include "Common/MsgHandler.h"
 #include "Common/Swap.h"
+#include "Common/WorkerPool.h"
 
 #include "VideoCommon/LookUpTables.h"
 #include "VideoCommon/TextureDecoder.h"
@@ -18,6 +21,13 @@
 static bool TexFmt_Overlay_Enable = false;
 static bool TexFmt_Overlay_Center = false;
 
+// Textures with more texels than this are decoded in several bands of rows
+static constexpr int DECODE_BAND_TEXELS = 64 * 1024;
+// Leave some cores for the CPU and GPU threads
+static constexpr unsigned int MAX_DECODE_WORKERS = 8;
+
+static Common::WorkerPool s_decode_workers;
+
 // TRAM
 // STATE_TO_SAVE
 alignas(16) u8 texMem[TMEM_SIZE];
@@ -374,10 +384,46 @@ static void TexDecoder_DrawOverlay(u8* dst, int width, int height, TextureFormat
   }
 }
 
+void TexDecoder_StartWorkers()
+{
+  const unsigned int num_cores = std::thread::hardware_concurrency();
+  const unsigned int num_workers = std::min(num_cores > 2 ? num_cores - 2 : 0, MAX_DECODE_WORKERS);
+  s_decode_workers.Start("Texture Decoder", num_workers);
+}
+
+void TexDecoder_StopWorkers()
+{
+  s_decode_workers.Stop();
+}
+
+void TexDecoder_ParallelFor(size_t count, const std::function<void(size_t)>& function)
+{
+  s_decode_workers.ParallelFor(count, function);
+}
+
 void TexDecoder_Decode(u8* dst, const u8* src, int width, int height, TextureFormat texformat,
                        const u8* tlut, TLUTFormat tlutfmt)
 {
-  _TexDecoder_DecodeImpl((u32*)dst, src, width, height, texformat, tlut, tlutfmt);
+  // Bands are whole rows of blocks, so the source of a band starts right after the blocks of the
+  // bands above it.
+  const u32 block_height = TexDecoder_GetBlockHeightInTexels(texformat);
+  const int band_height = static_cast<int>(
+      Common::AlignUp(static_cast<u32>(std::max(DECODE_BAND_TEXELS / std::max(width, 1), 1)),
+                      block_height));
+  if (height <= band_height)
+  {
+    _TexDecoder_DecodeImpl((u32*)dst, src, width, height, texformat, tlut, tlutfmt);
+  }
+  else
+  {
+    const size_t num_bands = (height + band_height - 1) / band_height;
+    s_decode_workers.ParallelFor(num_bands, [&](size_t band) {
+      const int y = static_cast<int>(band) * band_height;
+      _TexDecoder_DecodeImpl((u32*)dst + y * width,
+                             src + TexDecoder_GetTextureSizeInBytes(width, y, texformat), width,
+                             std::min(band_height, height - y), texformat, tlut, tlutfmt);
+    });
+  }
 
   if (TexFmt_Overlay_Enable)
     TexDecoder_DrawOverlay(dst, width, height, texformat);
@@ -0,0 +1,286 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "VideoCommon/TexturePackArchive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+#include <xxhash.h>
+
+#include "Common/Align.h"
+#include "Common/Logging/Log.h"
+#include "VideoCommon/AbstractTexture.h"
+
+// The values are stored in archives
+static_assert(static_cast<u32>(AbstractTextureFormat::RGBA8) == 0);
+static_assert(static_cast<u32>(AbstractTextureFormat::DXT1) == 2);
+static_assert(static_cast<u32>(AbstractTextureFormat::DXT3) == 3);
+static_assert(static_cast<u32>(AbstractTextureFormat::DXT5) == 4);
+static_assert(static_cast<u32>(AbstractTextureFormat::BPTC) == 5);
+
+u64 TexturePackArchive::HashName(std::string_view name)
+{
+  return XXH64(name.data(), name.size(), 0);
+}
+
+bool TexturePackArchive::IsValidFormat(u32 format)
+{
+  switch (static_cast<AbstractTextureFormat>(format))
+  {
+  case AbstractTextureFormat::RGBA8:
+  case AbstractTextureFormat::DXT1:
+  case AbstractTextureFormat::DXT3:
+  case AbstractTextureFormat::DXT5:
+  case AbstractTextureFormat::BPTC:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool TexturePackArchive::Open(const std::string& path)
+{
+  Close();
+  if (!m_file.Open(path))
+    return false;
+
+  FileHeader header;
+  if (m_file.GetSize() < sizeof(header))
+  {
+    ERROR_LOG_FMT(VIDEO, "Texture pack {} is truncated", path);
+    Close();
+    return false;
+  }
+  std::memcpy(&header, m_file.GetData(), sizeof(header));
+
+  if (header.magic != MAGIC || header.version != VERSION)
+  {
+    ERROR_LOG_FMT(VIDEO, "Texture pack {} has an unsupported format", path);
+    Close();
+    return false;
+  }
+
+  // The tables are aligned by the writer, so they can be used in place
+  const u64 file_size = m_file.GetSize();
+  const auto table_fits = [file_size](u64 offset, u64 size, size_t alignment) {
+    return offset % alignment == 0 && offset <= file_size && size <= file_size - offset;
+  };
+  if (!table_fits(header.textures_offset, u64(header.num_textures) * sizeof(FileTexture),
+                  alignof(FileTexture)) ||
+      !table_fits(header.levels_offset, u64(header.num_levels) * sizeof(FileLevel),
+                  alignof(FileLevel)) ||
+      !table_fits(header.names_offset, header.names_size, 1))
+  {
+    ERROR_LOG_FMT(VIDEO, "Texture pack {} is truncated", path);
+    Close();
+    return false;
+  }
+
+  m_index = reinterpret_cast<const FileTexture*>(m_file.GetData() + header.textures_offset);
+  m_levels = reinterpret_cast<const FileLevel*>(m_file.GetData() + header.levels_offset);
+  m_names = reinterpret_cast<const char*>(m_file.GetData() + header.names_offset);
+  m_num_textures = header.num_textures;
+
+  // Only the tables are read here, the level data stays on disk until it's used
+  if (!Validate(header))
+  {
+    ERROR_LOG_FMT(VIDEO, "Texture pack {} is corrupted", path);
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+bool TexturePackArchive::Validate(const FileHeader& header) const
+{
+  const u64 file_size = m_file.GetSize();
+  for (u32 i = 0; i < header.num_levels; ++i)
+  {
+    const FileLevel& level = m_levels[i];
+    if (level.offset > file_size || level.size > file_size - level.offset ||
+        !IsValidFormat(level.format) || level.width == 0 || level.height == 0 ||
+        level.row_length < level.width)
+    {
+      return false;
+    }
+
+    // The whole size the backends read when uploading the level has to be there
+    const auto format = static_cast<AbstractTextureFormat>(level.format);
+    const u32 block_size = AbstractTexture::GetBlockSizeForFormat(format);
+    const u64 upload_size =
+        u64(AbstractTexture::CalculateStrideForFormat(format, level.row_length)) *
+        (Common::AlignUp(u64(level.height), block_size) / block_size);
+    if (level.size < upload_size)
+      return false;
+  }
+
+  for (u32 i = 0; i < m_num_textures; ++i)
+  {
+    const FileTexture& texture = m_index[i];
+    if (u64(texture.name_offset) + texture.name_size > header.names_size ||
+        u64(texture.first_level) + texture.num_levels > header.num_levels ||
+        texture.num_levels == 0 || HashName(GetName(texture)) != texture.name_hash)
+    {
+      return false;
+    }
+
+    // Lookups depend on the index being sorted
+    if (i != 0 && std::make_tuple(m_index[i - 1].name_hash, GetName(m_index[i - 1])) >=
+                      std::make_tuple(texture.name_hash, GetName(texture)))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void TexturePackArchive::Close()
+{
+  m_file.Close();
+  m_index = nullptr;
+  m_levels = nullptr;
+  m_names = nullptr;
+  m_num_textures = 0;
+}
+
+std::string_view TexturePackArchive::GetName(const FileTexture& texture) const
+{
+  return std::string_view(m_names + texture.name_offset, texture.name_size);
+}
+
+const TexturePackArchive::FileTexture* TexturePackArchive::FindEntry(std::string_view name) const
+{
+  const u64 hash = HashName(name);
+  const FileTexture* const end = m_index + m_num_textures;
+  const FileTexture* it =
+      std::lower_bound(m_index, end, hash, [](const FileTexture& texture, u64 value) {
+        return texture.name_hash < value;
+      });
+
+  for (; it != end && it->name_hash == hash; ++it)
+  {
+    if (GetName(*it) == name)
+      return it;
+  }
+
+  return nullptr;
+}
+
+std::optional<TexturePackArchive::Texture> TexturePackArchive::Find(std::string_view name) const
+{
+  const FileTexture* const entry = FindEntry(name);
+  if (!entry)
+    return std::nullopt;
+
+  Texture texture;
+  texture.has_arbitrary_mipmaps = (entry->flags & FLAG_ARBITRARY_MIPMAPS) != 0;
+  texture.levels.reserve(entry->num_levels);
+  for (u32 i = 0; i < entry->num_levels; ++i)
+  {
+    const FileLevel& level = m_levels[entry->first_level + i];
+    texture.levels.push_back({m_file.GetData() + level.offset, static_cast<size_t>(level.size),
+                              level.width, level.height, level.row_length,
+                              static_cast<AbstractTextureFormat>(level.format)});
+  }
+
+  return texture;
+}
+
+bool TexturePackArchiveWriter::Open(const std::string& path)
+{
+  m_textures.clear();
+  m_levels.clear();
+
+  // The header is written by Finish, once the tables are known
+  const TexturePackArchive::FileHeader header{};
+  m_offset = sizeof(header);
+  return m_file.Open(path, "wb") && m_file.WriteArray(&header, 1);
+}
+
+bool TexturePackArchiveWriter::Pad(size_t alignment)
+{
+  static constexpr u8 zeros[TexturePackArchive::DATA_ALIGNMENT] = {};
+  const u64 padding = Common::AlignUp(m_offset, alignment) - m_offset;
+  m_offset += padding;
+  return m_file.WriteBytes(zeros, padding);
+}
+
+bool TexturePackArchiveWriter::AddTexture(std::string_view name, bool has_arbitrary_mipmaps,
+                                          const std::vector<TexturePackArchive::Level>& levels)
+{
+  if (levels.empty() || levels.size() > 0xFFFF)
+    return false;
+
+  PendingTexture& texture = m_textures.emplace_back();
+  texture.name = name;
+  texture.entry.name_hash = TexturePackArchive::HashName(name);
+  texture.entry.first_level = static_cast<u32>(m_levels.size());
+  texture.entry.num_levels = static_cast<u16>(levels.size());
+  texture.entry.flags = has_arbitrary_mipmaps ? TexturePackArchive::FLAG_ARBITRARY_MIPMAPS : 0;
+
+  for (const TexturePackArchive::Level& level : levels)
+  {
+    if (!TexturePackArchive::IsValidFormat(static_cast<u32>(level.format)) ||
+        !Pad(TexturePackArchive::DATA_ALIGNMENT) || !m_file.WriteBytes(level.data, level.size))
+    {
+      return false;
+    }
+
+    m_levels.push_back({m_offset, level.size, level.width, level.height, level.row_length,
+                        static_cast<u32>(level.format)});
+    m_offset += level.size;
+  }
+
+  return true;
+}
+
+bool TexturePackArchiveWriter::Finish()
+{
+  std::sort(m_textures.begin(), m_textures.end(),
+            [](const PendingTexture& a, const PendingTexture& b) {
+              return std::tie(a.entry.name_hash, a.name) < std::tie(b.entry.name_hash, b.name);
+            });
+
+  std::vector<TexturePackArchive::FileTexture> index;
+  std::string names;
+  for (size_t i = 0; i < m_textures.size(); ++i)
+  {
+    PendingTexture& texture = m_textures[i];
+    if (i != 0 && texture.name == m_textures[i - 1].name)
+    {
+      ERROR_LOG_FMT(VIDEO, "Texture {} was added to the pack twice", texture.name);
+      return false;
+    }
+
+    texture.entry.name_offset = static_cast<u32>(names.size());
+    texture.entry.name_size = static_cast<u32>(texture.name.size());
+    names += texture.name;
+    index.push_back(texture.entry);
+  }
+
+  TexturePackArchive::FileHeader header{};
+  header.magic = TexturePackArchive::MAGIC;
+  header.version = TexturePackArchive::VERSION;
+  header.num_textures = static_cast<u32>(index.size());
+  header.num_levels = static_cast<u32>(m_levels.size());
+
+  if (!Pad(TexturePackArchive::DATA_ALIGNMENT))
+    return false;
+  header.textures_offset = m_offset;
+  m_offset += index.size() * sizeof(TexturePackArchive::FileTexture);
+  header.levels_offset = m_offset;
+  m_offset += m_levels.size() * sizeof(TexturePackArchive::FileLevel);
+  header.names_offset = m_offset;
+  header.names_size = names.size();
+  m_offset += names.size();
+
+  return m_file.WriteArray(index.data(), index.size()) &&
+         m_file.WriteArray(m_levels.data(), m_levels.size()) &&
+         m_file.WriteBytes(names.data(), names.size()) && m_file.Seek(0, SEEK_SET) &&
+         m_file.WriteArray(&header, 1) && m_file.Close();
+}
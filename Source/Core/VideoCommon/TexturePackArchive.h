@@ -0,0 +1,134 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/File.h"
+#include "Common/MappedFile.h"
+#include "VideoCommon/TextureConfig.h"
+
+// A custom texture pack packed into a single file, which is mapped into memory instead of being
+// loaded. The file starts with a header, followed by the level data of all textures, which is
+// stored in the format that is uploaded to the GPU. After that come the texture index, sorted by
+// the hash of the texture name, the level table, and the names.
+class TexturePackArchive
+{
+public:
+  static constexpr std::string_view EXTENSION = ".dtp";
+
+  struct Level
+  {
+    const u8* data;
+    size_t size;
+    u32 width;
+    u32 height;
+    u32 row_length;
+    AbstractTextureFormat format;
+  };
+
+  struct Texture
+  {
+    std::vector<Level> levels;
+    bool has_arbitrary_mipmaps;
+  };
+
+  bool Open(const std::string& path);
+  void Close();
+
+  u32 GetTextureCount() const { return m_num_textures; }
+
+  // The name is the one of the level 0 file the texture was packed from, without the extension
+  // and the _arb suffix
+  bool Contains(std::string_view name) const { return FindEntry(name) != nullptr; }
+  std::optional<Texture> Find(std::string_view name) const;
+
+private:
+  friend class TexturePackArchiveWriter;
+
+  static constexpr u32 MAGIC = 0x50544444;  // "DDTP"
+  static constexpr u32 VERSION = 1;
+  static constexpr size_t DATA_ALIGNMENT = 64;
+
+  struct FileHeader
+  {
+    u32 magic;
+    u32 version;
+    u32 num_textures;
+    u32 num_levels;
+    u64 textures_offset;
+    u64 levels_offset;
+    u64 names_offset;
+    u64 names_size;
+  };
+  static_assert(sizeof(FileHeader) == 48);
+
+  struct FileTexture
+  {
+    u64 name_hash;
+    u32 name_offset;
+    u32 name_size;
+    u32 first_level;
+    u16 num_levels;
+    u16 flags;
+  };
+  static_assert(sizeof(FileTexture) == 24);
+
+  static constexpr u16 FLAG_ARBITRARY_MIPMAPS = 1;
+
+  struct FileLevel
+  {
+    u64 offset;
+    u64 size;
+    u32 width;
+    u32 height;
+    u32 row_length;
+    u32 format;
+  };
+  static_assert(sizeof(FileLevel) == 32);
+
+  static u64 HashName(std::string_view name);
+  static bool IsValidFormat(u32 format);
+
+  bool Validate(const FileHeader& header) const;
+  const FileTexture* FindEntry(std::string_view name) const;
+  std::string_view GetName(const FileTexture& texture) const;
+
+  Common::MappedFile m_file;
+  const FileTexture* m_index = nullptr;
+  const FileLevel* m_levels = nullptr;
+  const char* m_names = nullptr;
+  u32 m_num_textures = 0;
+};
+
+// Writes an archive, streaming the level data to the file as textures are added
+class TexturePackArchiveWriter
+{
+public:
+  bool Open(const std::string& path);
+  bool AddTexture(std::string_view name, bool has_arbitrary_mipmaps,
+                  const std::vector<TexturePackArchive::Level>& levels);
+  // Writes the index. The archive is incomplete until this returns true.
+  bool Finish();
+
+private:
+  struct PendingTexture
+  {
+    TexturePackArchive::FileTexture entry;
+    std::string name;
+  };
+
+  bool Pad(size_t alignment);
+
+  File::IOFile m_file;
+  u64 m_offset = 0;
+  std::vector<PendingTexture> m_textures;
+  std::vector<TexturePackArchive::FileLevel> m_levels;
+};
@@ -5,6 +5,7 @@
 #include "VideoCommon/VertexLoaderManager.h"
 
 #include <algorithm>
+#include <cstring>
 #include <iterator>
 #include <memory>
 #include <mutex>
@@ -249,20 +250,9 @@ static VertexLoaderBase* RefreshLoader(int vtx_attr_group, bool preprocess = fal
   return loader;
 }
 
-int RunVertices(int vtx_attr_group, int primitive, int count, DataReader src, bool is_preprocess)
+// Switches to the native vertex format of loader and returns where count vertices can be written
+static DataReader PrepareForVertices(VertexLoaderBase* loader, int primitive, int count)
 {
-  if (!count)
-    return 0;
-
-  VertexLoaderBase* loader = RefreshLoader(vtx_attr_group, is_preprocess);
-
-  int size = count * loader->m_VertexSize;
-  if ((int)src.size() < size)
-    return -1;
-
-  if (is_preprocess)
-    return size;
-
   // If the native vertex format changed, force a flush.
   if (loader->m_native_vertex_format != s_current_vtx_fmt ||
       loader->m_native_components != g_current_components)
@@ -278,16 +268,102 @@ int RunVertices(int vtx_attr_group, int primitive, int count, DataReader src, bo
   // slope.
   bool cullall = (bpmem.genMode.cullmode == GenMode::CULL_ALL && primitive < 5);
 
-  DataReader dst = g_vertex_manager->PrepareForAdditionalData(
-      primitive, count, loader->m_native_vtx_decl.stride, cullall);
-
-  count = loader->RunVertices(src, dst, count);
+  return g_vertex_manager->PrepareForAdditionalData(primitive, count,
+                                                    loader->m_native_vtx_decl.stride, cullall);
+}
 
+static void FinishVertices(VertexLoaderBase* loader, int primitive, int count)
+{
   g_vertex_manager->AddIndices(primitive, count);
   g_vertex_manager->FlushData(count, loader->m_native_vtx_decl.stride);
 
   ADDSTAT(g_stats.this_frame.num_prims, count);
   INCSTAT(g_stats.this_frame.num_primitive_joins);
+}
+
+int RunVertices(int vtx_attr_group, int primitive, int count, DataReader src, bool is_preprocess)
+{
+  if (!count)
+    return 0;
+
+  VertexLoaderBase* loader = RefreshLoader(vtx_attr_group, is_preprocess);
+
+  int size = count * loader->m_VertexSize;
+  if ((int)src.size() < size)
+    return -1;
+
+  if (is_preprocess)
+    return size;
+
+  DataReader dst = PrepareForVertices(loader, primitive, count);
+  count = loader->RunVertices(src, dst, count);
+  FinishVertices(loader, primitive, count);
+  return size;
+}
+
+int RecordVertices(int vtx_attr_group, int primitive, int count, DataReader src,
+                   ConvertedVertices* converted)
+{
+  if (!count)
+    return 0;
+
+  VertexLoaderBase* loader = RefreshLoader(vtx_attr_group, false);
+
+  int size = count * loader->m_VertexSize;
+  if ((int)src.size() < size)
+    return -1;
+
+  DataReader dst = PrepareForVertices(loader, primitive, count);
+  const u8* const dst_start = dst.GetPointer();
+  count = loader->RunVertices(src, dst, count);
+
+  // Vertices that are loaded from the vertex arrays depend on more than the command
+  bool indexed = false;
+  for (int i = 0; i < 12; i++)
+    indexed |= (g_main_cp_state.vtx_desc.GetVertexArrayStatus(i) & MASK_INDEXED) != 0;
+  if (!indexed)
+  {
+    converted->loader = loader;
+    converted->count = count;
+    converted->data.assign(dst_start, dst_start + count * loader->m_native_vtx_decl.stride);
+    std::memcpy(converted->position_cache, position_cache, sizeof(position_cache));
+    std::memcpy(converted->position_matrix_index, position_matrix_index,
+                sizeof(position_matrix_index));
+  }
+
+  FinishVertices(loader, primitive, count);
+  return size;
+}
+
+int ReplayVertices(int vtx_attr_group, int primitive, int count, DataReader src,
+                   const ConvertedVertices& converted)
+{
+  if (!count)
+    return 0;
+
+  VertexLoaderBase* loader = RefreshLoader(vtx_attr_group, false);
+  if (loader != converted.loader)
+    return RunVertices(vtx_attr_group, primitive, count, src, false);
+
+  int size = count * loader->m_VertexSize;
+  if ((int)src.size() < size)
+    return -1;
+
+  DataReader dst = PrepareForVertices(loader, primitive, count);
+  std::memcpy(dst.GetPointer(), converted.data.data(), converted.data.size());
+  loader->m_numLoadedVertices += converted.count;
+
+  // The zfreeze state the loader leaves behind, it only stores the last three vertices
+  const int stored = std::min(count, 3);
+  if (loader->m_native_vtx_decl.position.enable)
+    std::memcpy(position_cache, converted.position_cache, stored * sizeof(position_cache[0]));
+  if (loader->m_native_components & VB_HAS_POSMTXIDX)
+  {
+    std::memcpy(&position_matrix_index[1], &converted.position_matrix_index[1],
+                stored * sizeof(position_matrix_index[0]));
+  }
+
+  FinishVertices(loader, primitive, converted.count);
   return size;
 }
 
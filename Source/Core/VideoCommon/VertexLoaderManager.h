@@ -7,12 +7,14 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "Common/CommonTypes.h"
 
 class DataReader;
 class NativeVertexFormat;
 struct PortableVertexDeclaration;
+class VertexLoaderBase;
 
 namespace VertexLoaderManager
 {
@@ -37,6 +39,27 @@ NativeVertexFormat* GetUberVertexFormat(const PortableVertexDeclaration& decl);
 // Returns -1 if buf_size is insufficient, else the amount of bytes consumed
 int RunVertices(int vtx_attr_group, int primitive, int count, DataReader src, bool is_preprocess);
 
+// The native vertices of a primitive command, kept by the display list cache
+struct ConvertedVertices
+{
+  // The loader that converted them, nullptr if they depend on more than the command data
+  const VertexLoaderBase* loader = nullptr;
+  int count = 0;
+  std::vector<u8> data;
+  // The zfreeze state after loading them
+  float position_cache[3][4];
+  u32 position_matrix_index[4];
+};
+
+// Same as RunVertices, but keeps a copy of the converted vertices in converted when they can be
+// reused by ReplayVertices.
+int RecordVertices(int vtx_attr_group, int primitive, int count, DataReader src,
+                   ConvertedVertices* converted);
+// Same as RunVertices for the same command data, but copies the converted vertices instead of
+// running the vertex loader if the vertex format is still the same.
+int ReplayVertices(int vtx_attr_group, int primitive, int count, DataReader src,
+                   const ConvertedVertices& converted);
+
 // For debugging
 std::string VertexLoadersToString();
 
@@ -41,6 +41,7 @@
 #include "VideoCommon/BPStructs.h"
 #include "VideoCommon/CPMemory.h"
 #include "VideoCommon/CommandProcessor.h"
+#include "VideoCommon/DisplayListCache.h"
 #include "VideoCommon/Fifo.h"
 #include "VideoCommon/GeometryShaderManager.h"
 #include "VideoCommon/IndexGenerator.h"
@@ -49,6 +50,7 @@
 #include "VideoCommon/PixelShaderManager.h"
 #include "VideoCommon/RenderBase.h"
 #include "VideoCommon/TextureCacheBase.h"
+#include "VideoCommon/TextureDecoder.h"
 #include "VideoCommon/VertexLoaderManager.h"
 #include "VideoCommon/VertexManagerBase.h"
 #include "VideoCommon/VertexShaderManager.h"
@@ -305,12 +307,14 @@ void VideoBackendBase::InitializeShared()
   CommandProcessor::Init();
   Fifo::Init();
   OpcodeDecoder::Init();
+  DisplayListCache::Init();
   PixelEngine::Init();
   BPInit();
   VertexLoaderManager::Init();
   VertexShaderManager::Init();
   GeometryShaderManager::Init();
   PixelShaderManager::Init();
+  TexDecoder_StartWorkers();
 
   g_Config.VerifyValidity();
   UpdateActiveConfig();
@@ -320,6 +324,8 @@ void VideoBackendBase::ShutdownShared()
 {
   m_initialized = false;
 
+  TexDecoder_StopWorkers();
+  DisplayListCache::Shutdown();
   VertexLoaderManager::Clear();
   Fifo::Shutdown();
 }
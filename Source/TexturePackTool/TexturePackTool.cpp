@@ -0,0 +1,46 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// Packs a directory of custom textures into an archive that Dolphin maps into memory instead of
+// loading the textures one by one. The archive is used when it's in the texture directory of a
+// game, in place of or next to the loose files.
+
+#include <cstdio>
+#include <string>
+
+#include <fmt/format.h>
+
+#include "Common/Timer.h"
+#include "VideoCommon/HiresTextures.h"
+#include "VideoCommon/TextureDecoder.h"
+#include "VideoCommon/TexturePackArchive.h"
+
+int main(int argc, const char* argv[])
+{
+  if (argc != 3)
+  {
+    fmt::print(stderr, "USAGE: TexturePackTool <TEXTURE DIRECTORY> <OUTPUT FILE{}>\n",
+               TexturePackArchive::EXTENSION);
+    return 1;
+  }
+
+  const std::string texture_directory = argv[1];
+  const std::string archive_path = argv[2];
+  const u32 start_time = Common::Timer::GetTimeMs();
+
+  TexDecoder_StartWorkers();
+  const bool success = HiresTexture::WriteArchive(texture_directory, archive_path);
+  TexDecoder_StopWorkers();
+
+  TexturePackArchive archive;
+  if (!success || !archive.Open(archive_path))
+  {
+    fmt::print(stderr, "Failed to pack {} into {}\n", texture_directory, archive_path);
+    return 1;
+  }
+
+  fmt::print("Packed {} textures into {} in {:.1f}s\n", archive.GetTextureCount(), archive_path,
+             (Common::Timer::GetTimeMs() - start_time) / 1000.0);
+  return 0;
+}
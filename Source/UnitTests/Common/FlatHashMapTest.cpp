@@ -0,0 +1,91 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/FlatHashMap.h"
+
+TEST(FlatHashMap, Simple)
+{
+  Common::FlatHashMap<u32, int> map;
+
+  EXPECT_TRUE(map.Empty());
+  EXPECT_EQ(nullptr, map.Find(1));
+
+  map[1] = 10;
+  map[2] = 20;
+  EXPECT_EQ(2u, map.Size());
+  ASSERT_NE(nullptr, map.Find(1));
+  EXPECT_EQ(10, *map.Find(1));
+  EXPECT_EQ(20, *map.Find(2));
+
+  map[1] += 5;
+  EXPECT_EQ(15, *map.Find(1));
+  EXPECT_EQ(2u, map.Size());
+
+  EXPECT_TRUE(map.Erase(1));
+  EXPECT_FALSE(map.Erase(1));
+  EXPECT_EQ(nullptr, map.Find(1));
+  EXPECT_EQ(20, *map.Find(2));
+  EXPECT_EQ(1u, map.Size());
+
+  map.Clear();
+  EXPECT_TRUE(map.Empty());
+  EXPECT_EQ(nullptr, map.Find(2));
+}
+
+TEST(FlatHashMap, ValuesAreReset)
+{
+  Common::FlatHashMap<u32, std::vector<int>> map;
+  map[7].push_back(1);
+  map.Erase(7);
+  EXPECT_TRUE(map[7].empty());
+}
+
+TEST(FlatHashMap, MatchesUnorderedMap)
+{
+  // Aligned keys from a small range, to get long probe sequences and lots of backward shifting
+  Common::FlatHashMap<u32, u32> map;
+  std::unordered_map<u32, u32> reference;
+  std::mt19937 rng(1234);
+
+  for (u32 i = 0; i < 200000; ++i)
+  {
+    const u32 key = (rng() % 4096) * 32;
+    switch (rng() % 3)
+    {
+    case 0:
+      map[key] = i;
+      reference[key] = i;
+      break;
+    case 1:
+      EXPECT_EQ(reference.erase(key) != 0, map.Erase(key));
+      break;
+    case 2:
+    {
+      const u32* value = map.Find(key);
+      const auto it = reference.find(key);
+      ASSERT_EQ(it != reference.end(), value != nullptr);
+      if (value)
+      {
+        EXPECT_EQ(it->second, *value);
+      }
+      break;
+    }
+    }
+    ASSERT_EQ(reference.size(), map.Size());
+  }
+
+  size_t count = 0;
+  map.ForEach([&](u32 key, u32 value) {
+    EXPECT_EQ(reference.at(key), value);
+    ++count;
+  });
+  EXPECT_EQ(reference.size(), count);
+}
@@ -0,0 +1,86 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <gtest/gtest.h>
+
+#include <utility>
+#include <vector>
+
+#include "Common/SmallVector.h"
+
+TEST(SmallVector, Simple)
+{
+  Common::SmallVector<int, 4> vec;
+  EXPECT_TRUE(vec.empty());
+  EXPECT_EQ(4u, vec.capacity());
+
+  for (int i = 0; i < 4; ++i)
+    vec.push_back(i);
+  EXPECT_EQ(4u, vec.size());
+  EXPECT_EQ(4u, vec.capacity());
+  EXPECT_EQ(0, vec.front());
+  EXPECT_EQ(3, vec.back());
+
+  vec.pop_back();
+  EXPECT_EQ(3u, vec.size());
+  EXPECT_EQ(2, vec.back());
+
+  vec.clear();
+  EXPECT_TRUE(vec.empty());
+}
+
+TEST(SmallVector, Grow)
+{
+  Common::SmallVector<int, 2> vec;
+  for (int i = 0; i < 100; ++i)
+    vec.push_back(i);
+
+  EXPECT_EQ(100u, vec.size());
+  EXPECT_GE(vec.capacity(), 100u);
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ(i, vec[i]);
+}
+
+TEST(SmallVector, Erase)
+{
+  Common::SmallVector<int, 4> vec;
+  for (int i = 0; i < 6; ++i)
+    vec.push_back(i);
+
+  const int* next = vec.erase(vec.begin() + 2);
+  EXPECT_EQ(3, *next);
+  EXPECT_EQ((std::vector<int>{0, 1, 3, 4, 5}), std::vector<int>(vec.begin(), vec.end()));
+
+  next = vec.erase(vec.end() - 1);
+  EXPECT_EQ(vec.end(), next);
+  EXPECT_EQ((std::vector<int>{0, 1, 3, 4}), std::vector<int>(vec.begin(), vec.end()));
+}
+
+TEST(SmallVector, CopyAndMove)
+{
+  for (int count : {3, 10})
+  {
+    Common::SmallVector<int, 4> vec;
+    for (int i = 0; i < count; ++i)
+      vec.push_back(i);
+    const std::vector<int> expected(vec.begin(), vec.end());
+
+    Common::SmallVector<int, 4> copy = vec;
+    EXPECT_EQ(expected, std::vector<int>(copy.begin(), copy.end()));
+    EXPECT_NE(vec.data(), copy.data());
+
+    Common::SmallVector<int, 4> moved = std::move(vec);
+    EXPECT_EQ(expected, std::vector<int>(moved.begin(), moved.end()));
+    EXPECT_TRUE(vec.empty());
+
+    // The moved from vector is usable again
+    vec.push_back(42);
+    EXPECT_EQ(42, vec[0]);
+
+    copy = moved;
+    moved = std::move(vec);
+    EXPECT_EQ(expected, std::vector<int>(copy.begin(), copy.end()));
+    EXPECT_EQ(1u, moved.size());
+  }
+}
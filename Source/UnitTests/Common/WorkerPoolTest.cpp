@@ -0,0 +1,82 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Common/WorkerPool.h"
+
+TEST(WorkerPool, WithoutThreads)
+{
+  Common::WorkerPool pool;
+  EXPECT_EQ(0u, pool.NumThreads());
+
+  const std::thread::id caller = std::this_thread::get_id();
+  std::vector<int> visits(100);
+  pool.ParallelFor(visits.size(), [&](size_t i) {
+    EXPECT_EQ(caller, std::this_thread::get_id());
+    ++visits[i];
+  });
+  EXPECT_EQ(std::vector<int>(visits.size(), 1), visits);
+}
+
+TEST(WorkerPool, VisitsEveryIndexOnce)
+{
+  Common::WorkerPool pool;
+  pool.Start("WorkerPoolTest", 4);
+  EXPECT_EQ(4u, pool.NumThreads());
+
+  for (size_t count : {0, 1, 2, 3, 100, 10000})
+  {
+    std::vector<std::atomic<int>> visits(count);
+    pool.ParallelFor(count, [&](size_t i) { ++visits[i]; });
+    for (size_t i = 0; i < count; ++i)
+      EXPECT_EQ(1, visits[i].load());
+  }
+
+  pool.Stop();
+  EXPECT_EQ(0u, pool.NumThreads());
+}
+
+TEST(WorkerPool, Nested)
+{
+  Common::WorkerPool pool;
+  pool.Start("WorkerPoolTest", 3);
+
+  std::array<std::array<std::atomic<int>, 50>, 20> visits{};
+  pool.ParallelFor(visits.size(), [&](size_t i) {
+    pool.ParallelFor(visits[i].size(), [&](size_t j) { ++visits[i][j]; });
+  });
+
+  for (const auto& row : visits)
+  {
+    for (const std::atomic<int>& visit : row)
+      EXPECT_EQ(1, visit.load());
+  }
+}
+
+TEST(WorkerPool, ConcurrentCallers)
+{
+  Common::WorkerPool pool;
+  pool.Start("WorkerPoolTest", 2);
+
+  std::array<std::atomic<int>, 4> sums{};
+  std::vector<std::thread> callers;
+  for (size_t caller = 0; caller < sums.size(); ++caller)
+  {
+    callers.emplace_back([&, caller] {
+      for (int loop = 0; loop < 100; ++loop)
+        pool.ParallelFor(100, [&](size_t i) { sums[caller] += static_cast<int>(i); });
+    });
+  }
+  for (std::thread& thread : callers)
+    thread.join();
+
+  for (const std::atomic<int>& sum : sums)
+    EXPECT_EQ(100 * 4950, sum.load());
+}
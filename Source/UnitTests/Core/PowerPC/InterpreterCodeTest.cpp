@@ -0,0 +1,164 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/Config/Config.h"
+#include "Common/FileUtil.h"
+#include "Core/ConfigManager.h"
+#include "Core/PowerPC/CachedInterpreter/InterpreterCode.h"
+#include "Core/PowerPC/Gekko.h"
+#include "Core/PowerPC/Interpreter/Interpreter.h"
+#include "Core/PowerPC/PPCAnalyst.h"
+#include "Core/PowerPC/PPCTables.h"
+#include "Core/PowerPC/PowerPC.h"
+#include "UICommon/UICommon.h"
+
+namespace
+{
+class ScopeInit final
+{
+public:
+  ScopeInit() : m_profile_path(File::CreateTempDir())
+  {
+    UICommon::SetUserDirectory(m_profile_path);
+    Config::Init();
+    SConfig::Init();
+    Interpreter::getInstance()->Init();
+  }
+  ~ScopeInit()
+  {
+    SConfig::Shutdown();
+    Config::Shutdown();
+    File::DeleteDirRecursively(m_profile_path);
+  }
+
+private:
+  std::string m_profile_path;
+};
+
+constexpr u32 BLOCK_START = 0x80003100;
+
+struct State
+{
+  std::array<u32, 32> gpr;
+  std::array<u32, 8> cr;
+  u32 pc;
+  int downcount;
+};
+
+State GetState()
+{
+  State state;
+  std::copy(std::begin(rGPR), std::end(rGPR), state.gpr.begin());
+  for (u32 i = 0; i < 8; ++i)
+    state.cr[i] = PowerPC::ppcState.cr.GetField(i);
+  state.pc = PC;
+  state.downcount = PowerPC::ppcState.downcount;
+  return state;
+}
+
+void SetInputs(u32 r3, u32 r4)
+{
+  std::fill(std::begin(rGPR), std::end(rGPR), 0);
+  rGPR[3] = r3;
+  rGPR[4] = r4;
+  for (u32 i = 0; i < 8; ++i)
+    PowerPC::ppcState.cr.SetField(i, 0);
+  PowerPC::ppcState.downcount = 1000;
+  PC = BLOCK_START;
+}
+
+// Runs the instructions in both the interpreter and as a block of the cached interpreter, which
+// may fuse them.
+void ExpectSameResults(const std::vector<u32>& instructions, u32 r3, u32 r4)
+{
+  PPCAnalyst::CodeBlock block;
+  PPCAnalyst::CodeBuffer buffer(instructions.size());
+  for (size_t i = 0; i < instructions.size(); ++i)
+  {
+    PPCAnalyst::CodeOp& op = buffer[i];
+    op.inst = instructions[i];
+    op.opinfo = PPCTables::GetOpInfo(op.inst);
+    op.address = BLOCK_START + static_cast<u32>(i) * 4;
+    op.branchTo = op.inst.OPCD == 16 ? op.address + SignExt16(op.inst.BD << 2) : UINT32_MAX;
+  }
+  const u32 next_pc = BLOCK_START + static_cast<u32>(instructions.size()) * 4;
+  block.m_num_instructions = static_cast<u32>(instructions.size());
+  block.m_broken = !(buffer.back().opinfo->flags & FL_ENDBLOCK);
+
+  SetInputs(r3, r4);
+  for (const PPCAnalyst::CodeOp& op : buffer)
+  {
+    PC = op.address;
+    NPC = op.address + 4;
+    PPCTables::GetInterpreterOp(op.inst)(op.inst);
+    PowerPC::ppcState.downcount -= op.opinfo->numCycles;
+  }
+  PC = NPC;
+  const State expected = GetState();
+
+  InterpreterCode code;
+  code.Init();
+  const u8* entry = code.GetCodePtr();
+  code.AddBlock(block, buffer, BLOCK_START, next_pc, false);
+
+  SetInputs(r3, r4);
+  InterpreterCode::Execute(entry);
+  const State actual = GetState();
+
+  EXPECT_EQ(expected.gpr, actual.gpr);
+  EXPECT_EQ(expected.cr, actual.cr);
+  EXPECT_EQ(expected.pc, actual.pc);
+  EXPECT_EQ(expected.downcount, actual.downcount);
+}
+}  // namespace
+
+TEST(InterpreterCode, CompareAndBranch)
+{
+  ScopeInit init;
+
+  const std::vector<std::vector<u32>> blocks = {
+      // li r5, 1; cmpwi r3, 5; beq +0x10
+      {0x38a00001, 0x2c030005, 0x41820010},
+      // cmpwi cr7, r4, -1; bne cr7, +8
+      {0x2f84ffff, 0x409e0008},
+      // cmplw r3, r4; blt +12
+      {0x7c032040, 0x4180000c},
+      // cmpw cr1, r3, r4; bgt cr1, -8
+      {0x7c832000, 0x4185fff8},
+  };
+  for (const std::vector<u32>& instructions : blocks)
+  {
+    for (u32 r3 : {0u, 5u, 0xffffffffu, 0x80000000u})
+    {
+      for (u32 r4 : {0u, 5u, 0xffffffffu})
+        ExpectSameResults(instructions, r3, r4);
+    }
+  }
+}
+
+TEST(InterpreterCode, IntegerSuperinstructions)
+{
+  ScopeInit init;
+
+  const std::vector<std::vector<u32>> blocks = {
+      // rlwinm r5, r3, 8, 16, 23; rlwinm r6, r5, 24, 24, 31; addis r7, r3, -2; li r8, -3
+      {0x5465442e, 0x54a6c63e, 0x3ce3fffe, 0x3900fffd},
+      // rlwinm r3, r3, 2, 0, 29; rlwinm r3, r3, 30, 2, 31; addi r4, r4, 0x7fff
+      {0x5463103a, 0x5463f0be, 0x38847fff},
+  };
+  for (const std::vector<u32>& instructions : blocks)
+  {
+    for (u32 r3 : {0u, 0x12345678u, 0xffffffffu})
+      ExpectSameResults(instructions, r3, 0x87654321);
+  }
+}
@@ -0,0 +1,274 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "Common/CommonTypes.h"
+#include "Common/FlatHashMap.h"
+#include "Common/FileUtil.h"
+#include "Core/PowerPC/JitCommon/JitBase.h"
+#include "Core/PowerPC/JitCommon/JitCache.h"
+#include "Core/PowerPC/JitCommon/JitWarmupCache.h"
+
+// Include gtest after the JIT headers, its TEST macro collides with XEmitter::TEST
+#include <gtest/gtest.h>
+
+namespace
+{
+class TestBlockCache final : public JitBaseBlockCache
+{
+public:
+  using JitBaseBlockCache::JitBaseBlockCache;
+
+  // exit -> block it currently jumps to
+  Common::FlatHashMap<const u8*, const JitBlock*> links;
+
+private:
+  void WriteLinkBlock(const JitBlock::LinkData& source, const JitBlock* dest) override
+  {
+    links[source.exitPtrs] = dest;
+  }
+};
+
+class TestJit final : public JitBase
+{
+public:
+  TestJit() : m_block_cache(*this) { m_block_cache.Clear(); }
+
+  void Init() override {}
+  void Shutdown() override {}
+  void ClearCache() override { m_block_cache.Clear(); }
+  void Run() override {}
+  void SingleStep() override {}
+  const char* GetName() const override { return "Test"; }
+  TestBlockCache* GetBlockCache() override { return &m_block_cache; }
+  void Jit(u32) override {}
+  const CommonAsmRoutinesBase* GetAsmRoutines() override { return nullptr; }
+  bool HandleFault(uintptr_t, SContext*) override { return false; }
+
+private:
+  TestBlockCache m_block_cache;
+};
+
+// Stands in for the host code of the blocks, only its addresses are used.
+constexpr size_t FAKE_CODE_SIZE = 0x10000;
+u8 s_fake_code[FAKE_CODE_SIZE + 4];
+
+JitBlock* CompileBlock(TestBlockCache& cache, u32 address, u32 num_instructions,
+                       const std::vector<u32>& exits = {})
+{
+  JitBlock* block = cache.AllocateBlock(address);
+  block->checkedEntry = &s_fake_code[(address >> 2) % FAKE_CODE_SIZE];
+  block->normalEntry = block->checkedEntry;
+  block->originalSize = num_instructions;
+  for (size_t i = 0; i < exits.size(); ++i)
+    block->linkData.push_back({&block->checkedEntry[i + 1], exits[i], false, false});
+
+  std::set<u32> physical_addresses;
+  for (u32 i = 0; i < num_instructions; ++i)
+    physical_addresses.insert(address + i * 4);
+
+  cache.FinalizeBlock(*block, true, physical_addresses);
+  return block;
+}
+}  // namespace
+
+TEST(JitCache, LookupAndInvalidate)
+{
+  TestJit jit;
+  TestBlockCache& cache = *jit.GetBlockCache();
+
+  CompileBlock(cache, 0x80001000, 8);
+  CompileBlock(cache, 0x80001020, 8);
+  CompileBlock(cache, 0x800010f0, 16);  // crosses into the next macro block
+
+  EXPECT_NE(nullptr, cache.GetBlockFromStartAddress(0x80001000, 0));
+  EXPECT_NE(nullptr, cache.GetBlockFromStartAddress(0x80001020, 0));
+  EXPECT_EQ(nullptr, cache.GetBlockFromStartAddress(0x80001004, 0));
+  EXPECT_EQ(nullptr,
+            cache.GetBlockFromStartAddress(0x80001000, JitBaseBlockCache::JIT_CACHE_MSR_MASK));
+
+  cache.InvalidateICache(0x80001020, 32, false);
+  EXPECT_NE(nullptr, cache.GetBlockFromStartAddress(0x80001000, 0));
+  EXPECT_EQ(nullptr, cache.GetBlockFromStartAddress(0x80001020, 0));
+  EXPECT_NE(nullptr, cache.GetBlockFromStartAddress(0x800010f0, 0));
+
+  // Only the part of the third block behind the macro block boundary
+  cache.InvalidateICache(0x80001120, 32, false);
+  EXPECT_EQ(nullptr, cache.GetBlockFromStartAddress(0x800010f0, 0));
+  EXPECT_NE(nullptr, cache.GetBlockFromStartAddress(0x80001000, 0));
+
+  cache.InvalidateICache(0x80000000, 0x01800000, false);
+  EXPECT_EQ(nullptr, cache.GetBlockFromStartAddress(0x80001000, 0));
+}
+
+TEST(JitCache, Linking)
+{
+  TestJit jit;
+  TestBlockCache& cache = *jit.GetBlockCache();
+
+  JitBlock* a = CompileBlock(cache, 0x80002000, 4, {0x80003000});
+  const u8* exit = &a->checkedEntry[1];
+  EXPECT_EQ(nullptr, cache.links[exit]);
+
+  JitBlock* b = CompileBlock(cache, 0x80003000, 4);
+  EXPECT_EQ(b, cache.links[exit]);
+
+  cache.InvalidateICache(0x80003000, 32, false);
+  EXPECT_EQ(nullptr, cache.links[exit]);
+  EXPECT_FALSE(a->linkData[0].linkStatus);
+
+  b = CompileBlock(cache, 0x80003000, 4);
+  EXPECT_EQ(b, cache.links[exit]);
+}
+
+// Replays the kinds of invalidation patterns games produce and checks the cache against a simple
+// model of which blocks should still exist. The timings are printed for comparing changes to the
+// block cache; the patterns are small enough to also run as a regular test.
+TEST(JitCache, ReplayInvalidationPatterns)
+{
+  TestJit jit;
+  TestBlockCache& cache = *jit.GetBlockCache();
+
+  // start address -> number of instructions
+  std::map<u32, u32> model;
+  const auto compile = [&](u32 address, u32 size, std::vector<u32> exits = {}) {
+    CompileBlock(cache, address, size, exits);
+    model[address] = size;
+  };
+  const auto invalidate = [&](u32 address, u32 length) {
+    cache.InvalidateICache(address, length, false);
+    // No block in these patterns is larger than 0x100 bytes
+    for (auto it = model.lower_bound(address >= 0x100 ? address - 0x100 : 0);
+         it != model.end() && it->first < u64(address) + length;)
+    {
+      const u64 end = it->first + u64(it->second) * 4;
+      if (end > address)
+        it = model.erase(it);
+      else
+        ++it;
+    }
+  };
+  const auto verify = [&] {
+    u32 count = 0;
+    cache.RunOnBlocks([&](const JitBlock&) { ++count; });
+    ASSERT_EQ(model.size(), count);
+    for (const auto& [address, size] : model)
+      ASSERT_NE(nullptr, cache.GetBlockFromStartAddress(address, 0));
+  };
+
+  constexpr u32 CODE_BASE = 0x80100000;
+  constexpr u32 CODE_SIZE = 0x80000;
+
+  const auto start = std::chrono::steady_clock::now();
+  auto last = start;
+  const auto report = [&](const char* name) {
+    const auto now = std::chrono::steady_clock::now();
+    fmt::print("{}: {} us\n", name,
+               std::chrono::duration_cast<std::chrono::microseconds>(now - last).count());
+    last = now;
+  };
+
+  // Code overlay: a region full of linked blocks is overwritten by copying new code over it,
+  // invalidating each cache line with dcbi/icbi, and then gets recompiled.
+  for (int round = 0; round < 4; ++round)
+  {
+    for (u32 address = CODE_BASE; address < CODE_BASE + CODE_SIZE; address += 0x100)
+      compile(address + round * 8, 12, {address + 0x100, address + 0x200});
+    for (u32 address = CODE_BASE; address < CODE_BASE + CODE_SIZE; address += 32)
+      invalidate(address, 32);
+  }
+  verify();
+  report("Overlay, cache line invalidation");
+
+  // Module reload: the same, but with a single invalidation of the whole range.
+  for (int round = 0; round < 16; ++round)
+  {
+    for (u32 address = CODE_BASE; address < CODE_BASE + CODE_SIZE; address += 0x100)
+      compile(address, 24, {address + 0x100});
+    invalidate(CODE_BASE, CODE_SIZE);
+  }
+  verify();
+  report("Module reload, range invalidation");
+
+  // Self-modifying code: a hot block that a lot of other blocks branch to gets patched and
+  // recompiled over and over, while the rest of the cache stays populated.
+  constexpr u32 HOT_BLOCK = CODE_BASE + 0x40000;
+  for (u32 address = CODE_BASE; address < CODE_BASE + CODE_SIZE; address += 0x80)
+  {
+    if (address != HOT_BLOCK)
+      compile(address, 8, {HOT_BLOCK});
+  }
+  for (int round = 0; round < 200; ++round)
+  {
+    compile(HOT_BLOCK, 8);
+    invalidate(HOT_BLOCK + 4 * (round % 8), 32);
+  }
+  verify();
+  report("Self-modifying code");
+
+  const auto total = std::chrono::steady_clock::now() - start;
+  fmt::print("Total: {} us\n",
+             std::chrono::duration_cast<std::chrono::microseconds>(total).count());
+}
+
+TEST(JitWarmupCache, SaveAndRearm)
+{
+  const std::string directory = File::CreateTempDir();
+  ASSERT_FALSE(directory.empty());
+  const std::string path = directory + "/GALE01.jitwarmup";
+
+  const u32 translated = JitBaseBlockCache::JIT_CACHE_MSR_MASK;
+  JitWarmupCache cache;
+  cache.Load(path, 1);
+  EXPECT_TRUE(cache.IsEmpty());
+  cache.AddBlock({0x80003000, translated, 0, 8, 0x1234});
+  cache.AddBlock({0x80003100, translated, JitWarmupCache::FLAG_NO_PAIRED_QUANTIZE, 4, 0x5678});
+  cache.AddBlock({0x00003100, 0, 0, 4, 0x9abc});
+  // Recompiling the same code keeps the flags
+  cache.AddBlock({0x80003100, translated, 0, 4, 0x5678});
+  // Blocks compiled in this session aren't compiled again
+  EXPECT_FALSE(cache.PopPending(translated));
+  cache.Save();
+
+  cache.Load(path, 2);
+  EXPECT_TRUE(cache.IsEmpty());
+
+  cache.Load(path, 1);
+  std::map<u32, JitWarmupCache::Entry> pending;
+  while (const auto entry = cache.PopPending(translated))
+    pending[entry->effective_address] = *entry;
+  ASSERT_EQ(2u, pending.size());
+  EXPECT_EQ(0x1234u, pending[0x80003000].hash);
+  EXPECT_EQ(8u, pending[0x80003000].num_instructions);
+  EXPECT_EQ(JitWarmupCache::FLAG_NO_PAIRED_QUANTIZE, pending[0x80003100].flags);
+
+  const auto untranslated = cache.PopPending(0);
+  ASSERT_TRUE(untranslated);
+  EXPECT_EQ(0x00003100u, untranslated->effective_address);
+  EXPECT_FALSE(cache.PopPending(0));
+
+  // Blocks whose code isn't there yet come back once the game invalidates their code
+  cache.Park(pending[0x80003000]);
+  cache.Park(pending[0x80003100]);
+  cache.Rearm(0x80003020, 0x100);
+  const auto rearmed = cache.PopPending(translated);
+  ASSERT_TRUE(rearmed);
+  EXPECT_EQ(0x80003100u, rearmed->effective_address);
+  EXPECT_FALSE(cache.PopPending(translated));
+
+  TestJit jit;
+  jit.GetBlockCache()->GetWarmupCache() = std::move(cache);
+  jit.GetBlockCache()->InvalidateICache(0x80003000, 32, false);
+  EXPECT_TRUE(jit.GetBlockCache()->GetWarmupCache().PopPending(translated));
+
+  File::DeleteDirRecursively(directory);
+}
@@ -0,0 +1,323 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/Config/Config.h"
+#include "Common/FileUtil.h"
+#include "Core/ConfigManager.h"
+#include "Core/PowerPC/Interpreter/Interpreter.h"
+#include "Core/PowerPC/PPCAnalyst.h"
+#include "Core/PowerPC/PPCTables.h"
+#include "UICommon/UICommon.h"
+
+namespace
+{
+class ScopeInit final
+{
+public:
+  ScopeInit() : m_profile_path(File::CreateTempDir())
+  {
+    UICommon::SetUserDirectory(m_profile_path);
+    Config::Init();
+    SConfig::Init();
+    Interpreter::getInstance()->Init();
+  }
+  ~ScopeInit()
+  {
+    SConfig::Shutdown();
+    Config::Shutdown();
+    File::DeleteDirRecursively(m_profile_path);
+  }
+
+private:
+  std::string m_profile_path;
+};
+
+// A block of instructions with the stats Analyze would give them.
+class TestBlock
+{
+public:
+  explicit TestBlock(const std::vector<u32>& instructions) : m_code(instructions.size())
+  {
+    m_gpa.Clear();
+    m_fpa.Clear();
+    m_block.m_stats = &m_stats;
+    m_block.m_gpa = &m_gpa;
+    m_block.m_fpa = &m_fpa;
+    m_block.m_num_instructions = static_cast<u32>(instructions.size());
+    for (u32 i = 0; i < m_block.m_num_instructions; ++i)
+    {
+      PPCAnalyst::CodeOp& op = m_code[i];
+      op.inst = instructions[i];
+      op.opinfo = PPCTables::GetOpInfo(op.inst);
+      op.address = 0x80003000 + i * 4;
+      op.branchTo = UINT32_MAX;
+      m_analyzer.SetInstructionStats(&m_block, &op, op.opinfo, i);
+    }
+  }
+
+  void ForwardStoredValues() { m_analyzer.ForwardStoredValues(&m_block, m_code.data()); }
+  void PropagateConstants() { m_analyzer.PropagateConstants(&m_block, m_code.data()); }
+  void EliminateDeadFlags() { m_analyzer.EliminateDeadFlags(&m_block, m_code.data()); }
+  void EliminateDeadCode()
+  {
+    m_analyzer.EliminateDeadCode(m_block.m_num_instructions, m_code.data());
+  }
+
+  u32 Instruction(size_t index) const { return m_code[index].inst.hex; }
+  bool IsSkipped(size_t index) const { return m_code[index].skip; }
+
+private:
+  PPCAnalyst::PPCAnalyzer m_analyzer;
+  PPCAnalyst::CodeBlock m_block;
+  PPCAnalyst::BlockStats m_stats;
+  PPCAnalyst::BlockRegStats m_gpa;
+  PPCAnalyst::BlockRegStats m_fpa;
+  PPCAnalyst::CodeBuffer m_code;
+};
+}  // namespace
+
+TEST(BranchProfile, NeedsEnoughSamples)
+{
+  PPCAnalyst::BranchProfile profile;
+  EXPECT_FALSE(profile.IsMostlyTaken(0x80003000));
+
+  for (int i = 0; i < 4; ++i)
+    profile.AddOutcome(0x80003000, true);
+  EXPECT_FALSE(profile.IsMostlyTaken(0x80003000));
+
+  for (int i = 0; i < 60; ++i)
+    profile.AddOutcome(0x80003000, true);
+  EXPECT_TRUE(profile.IsMostlyTaken(0x80003000));
+  EXPECT_FALSE(profile.IsMostlyTaken(0x80003004));
+
+  profile.Clear();
+  EXPECT_FALSE(profile.IsMostlyTaken(0x80003000));
+}
+
+TEST(BranchProfile, DominantDirection)
+{
+  PPCAnalyst::BranchProfile profile;
+  for (int i = 0; i < 60; ++i)
+    profile.AddOutcome(0x80003000, true);
+  for (int i = 0; i < 4; ++i)
+    profile.AddOutcome(0x80003000, false);
+  EXPECT_TRUE(profile.IsMostlyTaken(0x80003000));
+
+  // A branch that goes both ways is left to the fall-through path.
+  for (int i = 0; i < 32; ++i)
+  {
+    profile.AddOutcome(0x80004000, true);
+    profile.AddOutcome(0x80004000, i % 2 == 0);
+  }
+  EXPECT_FALSE(profile.IsMostlyTaken(0x80004000));
+
+  for (int i = 0; i < 64; ++i)
+    profile.AddOutcome(0x80005000, false);
+  EXPECT_FALSE(profile.IsMostlyTaken(0x80005000));
+}
+
+TEST(PPCAnalyzer, ForwardStoredValues)
+{
+  ScopeInit init;
+
+  // stw r3, 8(r1); li r4, 1; lwz r5, 8(r1)
+  TestBlock word({0x90610008, 0x38800001, 0x80a10008});
+  word.ForwardStoredValues();
+  EXPECT_EQ(0x7c651b78u, word.Instruction(2));  // mr r5, r3
+
+  // Loads zero-extend, so the stored register is masked like the store truncated it.
+  // sth r3, 8(r1); lhz r5, 8(r1)
+  TestBlock half({0xb0610008, 0xa0a10008});
+  half.ForwardStoredValues();
+  EXPECT_EQ(0x5465043eu, half.Instruction(1));  // clrlwi r5, r3, 16
+
+  // stb r3, 8(r1); lbz r5, 8(r1)
+  TestBlock byte({0x98610008, 0x88a10008});
+  byte.ForwardStoredValues();
+  EXPECT_EQ(0x5465063eu, byte.Instruction(1));  // clrlwi r5, r3, 24
+
+  // Other offsets and base registers are different memory.
+  // stw r3, 8(r1); lwz r5, 12(r1); lwz r6, 8(r4)
+  TestBlock other({0x90610008, 0x80a1000c, 0x80c40008});
+  other.ForwardStoredValues();
+  EXPECT_EQ(0x80a1000cu, other.Instruction(1));
+  EXPECT_EQ(0x80c40008u, other.Instruction(2));
+}
+
+TEST(PPCAnalyzer, ForwardStoredValuesBlocked)
+{
+  ScopeInit init;
+
+  const std::vector<std::vector<u32>> blocks = {
+      // A store in between might overwrite the slot.
+      // stw r3, 8(r1); stw r4, 0(r6); lwz r5, 8(r1)
+      {0x90610008, 0x90860000, 0x80a10008},
+      // stw r3, 8(r1); stwu r1, -16(r1); lwz r5, 8(r1)
+      {0x90610008, 0x9421fff0, 0x80a10008},
+      // The stack pointer moved.
+      // stw r3, 8(r1); addi r1, r1, -16; lwz r5, 8(r1)
+      {0x90610008, 0x3821fff0, 0x80a10008},
+      // The stored register changed.
+      // stw r3, 8(r1); li r3, 0; lwz r5, 8(r1)
+      {0x90610008, 0x38600000, 0x80a10008},
+      // stw r3, 8(r1); lwz r3, 0(r4); lwz r5, 8(r1)
+      {0x90610008, 0x80640000, 0x80a10008},
+  };
+  for (const std::vector<u32>& instructions : blocks)
+  {
+    TestBlock block(instructions);
+    block.ForwardStoredValues();
+    EXPECT_EQ(instructions.back(), block.Instruction(instructions.size() - 1));
+  }
+}
+
+TEST(PPCAnalyzer, PropagateConstants)
+{
+  ScopeInit init;
+
+  // li r3, 8; addi r4, r3, 4; slw r5, r4, r3
+  TestBlock small({0x38600008, 0x38830004, 0x7c851830});
+  small.PropagateConstants();
+  EXPECT_EQ(0x38600008u, small.Instruction(0));
+  EXPECT_EQ(0x3880000cu, small.Instruction(1));  // li r4, 12
+  EXPECT_EQ(0x38a00c00u, small.Instruction(2));  // li r5, 3072
+
+  // li r3, 1; slwi r4, r3, 16
+  TestBlock high({0x38600001, 0x5464801e});
+  high.PropagateConstants();
+  EXPECT_EQ(0x3c800001u, high.Instruction(1));  // lis r4, 1
+
+  // Values that need two instructions are kept, but still known afterwards.
+  // lis r3, 0x1234; ori r3, r3, 0x5678; subf r4, r3, r3
+  TestBlock wide({0x3c601234, 0x60635678, 0x7c831850});
+  wide.PropagateConstants();
+  EXPECT_EQ(0x60635678u, wide.Instruction(1));
+  EXPECT_EQ(0x38800000u, wide.Instruction(2));  // li r4, 0
+}
+
+TEST(PPCAnalyzer, PropagateConstantsKeepsOthers)
+{
+  ScopeInit init;
+
+  const std::vector<std::vector<u32>> blocks = {
+      // The input isn't known.
+      // addi r4, r3, 4
+      {0x38830004},
+      // Writes CR0.
+      // li r3, 1; add. r4, r3, r3
+      {0x38600001, 0x7c831a15},
+      // Writes XER[CA].
+      // li r3, 1; addic r4, r3, 1
+      {0x38600001, 0x30830001},
+      // The load overwrites the constant.
+      // li r3, 1; lwz r3, 0(r4); addi r5, r3, 1
+      {0x38600001, 0x80640000, 0x38a30001},
+  };
+  for (const std::vector<u32>& instructions : blocks)
+  {
+    TestBlock block(instructions);
+    block.PropagateConstants();
+    EXPECT_EQ(instructions.back(), block.Instruction(instructions.size() - 1))
+        << std::hex << instructions.back();
+  }
+}
+
+TEST(PPCAnalyzer, EliminateDeadFlags)
+{
+  ScopeInit init;
+
+  // add. r5, r3, r4; cmpwi r6, 0
+  TestBlock compare({0x7ca32215, 0x2c060000});
+  compare.EliminateDeadFlags();
+  EXPECT_EQ(0x7ca32214u, compare.Instruction(0));  // add r5, r3, r4
+
+  // add. r5, r3, r4; or. r6, r3, r4
+  TestBlock record({0x7ca32215, 0x7c662379});
+  record.EliminateDeadFlags();
+  EXPECT_EQ(0x7ca32214u, record.Instruction(0));
+  // CR0 may be read after the block.
+  EXPECT_EQ(0x7c662379u, record.Instruction(1));
+}
+
+TEST(PPCAnalyzer, EliminateDeadFlagsKeepsRead)
+{
+  ScopeInit init;
+
+  const std::vector<std::vector<u32>> blocks = {
+      // The branch reads CR0.
+      // add. r5, r3, r4; beq +8; cmpwi r6, 0
+      {0x7ca32215, 0x41820008, 0x2c060000},
+      // mfcr reads CR0.
+      // add. r5, r3, r4; mfcr r6; cmpwi r6, 0
+      {0x7ca32215, 0x7cc00026, 0x2c060000},
+      // The handler of a DSI raised by the load sees CR0.
+      // add. r5, r3, r4; lwz r6, 0(r4); cmpwi r6, 0
+      {0x7ca32215, 0x80c40000, 0x2c060000},
+      // Only CR1 is overwritten.
+      // add. r5, r3, r4; cmpwi cr1, r6, 0
+      {0x7ca32215, 0x2c860000},
+  };
+  for (const std::vector<u32>& instructions : blocks)
+  {
+    TestBlock block(instructions);
+    block.EliminateDeadFlags();
+    EXPECT_EQ(instructions[0], block.Instruction(0)) << std::hex << instructions[1];
+  }
+}
+
+TEST(PPCAnalyzer, EliminateDeadCode)
+{
+  ScopeInit init;
+
+  // li r5, 1; add r5, r3, r4; mullw r5, r3, r4; li r5, 2
+  TestBlock overwritten({0x38a00001, 0x7ca32214, 0x7ca321d6, 0x38a00002});
+  overwritten.EliminateDeadCode();
+  EXPECT_TRUE(overwritten.IsSkipped(0));
+  EXPECT_TRUE(overwritten.IsSkipped(1));
+  EXPECT_TRUE(overwritten.IsSkipped(2));
+  // Everything is live at the end of the block.
+  EXPECT_FALSE(overwritten.IsSkipped(3));
+
+  // li r5, 1; add r6, r5, r4; li r5, 2
+  TestBlock read({0x38a00001, 0x7cc52214, 0x38a00002});
+  read.EliminateDeadCode();
+  EXPECT_FALSE(read.IsSkipped(0));
+}
+
+TEST(PPCAnalyzer, EliminateDeadCodeKeepsSideEffects)
+{
+  ScopeInit init;
+
+  const std::vector<std::vector<u32>> blocks = {
+      // Writes CR0.
+      // add. r5, r3, r4; li r5, 0
+      {0x7ca32215, 0x38a00000},
+      // Writes XER[CA].
+      // addc r5, r3, r4; li r5, 0
+      {0x7ca32014, 0x38a00000},
+      // addic r5, r3, 1; li r5, 0
+      {0x30a30001, 0x38a00000},
+      // Writes XER[OV] and XER[SO].
+      // addo r5, r3, r4; li r5, 0
+      {0x7ca32614, 0x38a00000},
+      // The load can raise a DSI, whose handler sees r5.
+      // li r5, 1; lwz r6, 0(r4); li r5, 2
+      {0x38a00001, 0x80c40000, 0x38a00002},
+      // The branch may leave the block with r5.
+      // li r5, 1; beq +8; li r5, 2
+      {0x38a00001, 0x41820008, 0x38a00002},
+  };
+  for (const std::vector<u32>& instructions : blocks)
+  {
+    TestBlock block(instructions);
+    block.EliminateDeadCode();
+    EXPECT_FALSE(block.IsSkipped(0)) << std::hex << instructions[0];
+  }
+}
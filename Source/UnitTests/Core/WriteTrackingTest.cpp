@@ -0,0 +1,121 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <optional>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "Common/CommonTypes.h"
+#include "Common/Config/Config.h"
+#include "Common/FileUtil.h"
+#include "Core/ConfigManager.h"
+#include "Core/HW/Memmap.h"
+#include "Core/MemTools.h"
+#include "UICommon/UICommon.h"
+
+class WriteTrackingTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    // Write tracking isn't supported on this platform
+    if (!EMM::HandlesAllThreads())
+      return;
+
+    m_profile_path = File::CreateTempDir();
+    UICommon::SetUserDirectory(m_profile_path);
+    Config::Init();
+    SConfig::Init();
+    Memory::Init();
+    EMM::InstallExceptionHandler();
+    Memory::EnableWriteTracking();
+  }
+
+  void TearDown() override
+  {
+    if (!EMM::HandlesAllThreads())
+      return;
+
+    Memory::DisableWriteTracking();
+    EMM::UninstallExceptionHandler();
+    Memory::Shutdown();
+    SConfig::Shutdown();
+    Config::Shutdown();
+    File::DeleteDirRecursively(m_profile_path);
+  }
+
+private:
+  std::string m_profile_path;
+};
+
+TEST_F(WriteTrackingTest, CatchesWrites)
+{
+  if (!EMM::HandlesAllThreads())
+    return;
+
+  const std::optional<u64> write_count = Memory::TrackWrites(0x10000, 0x4000);
+  ASSERT_TRUE(write_count);
+  EXPECT_FALSE(Memory::WrittenSince(0x10000, 0x4000, *write_count));
+
+  // Reading doesn't count, and neither does writing to other pages
+  EXPECT_EQ(Memory::Read_U32(0x12000), 0u);
+  Memory::Write_U32(0x12345678, 0x40000);
+  EXPECT_FALSE(Memory::WrittenSince(0x10000, 0x4000, *write_count));
+
+  Memory::Write_U32(0x12345678, 0x12000);
+  EXPECT_TRUE(Memory::WrittenSince(0x10000, 0x4000, *write_count));
+  EXPECT_EQ(Memory::Read_U32(0x12000), 0x12345678u);
+
+  // The page is writable again
+  Memory::Write_U32(0x87654321, 0x12000);
+  EXPECT_EQ(Memory::Read_U32(0x12000), 0x87654321u);
+
+  // Tracking starts over
+  const std::optional<u64> new_write_count = Memory::TrackWrites(0x10000, 0x4000);
+  ASSERT_TRUE(new_write_count);
+  EXPECT_FALSE(Memory::WrittenSince(0x10000, 0x4000, *new_write_count));
+}
+
+TEST_F(WriteTrackingTest, CatchesWritesFromOtherThreads)
+{
+  if (!EMM::HandlesAllThreads())
+    return;
+
+  const std::optional<u64> write_count = Memory::TrackWrites(0x80000, 0x100);
+  ASSERT_TRUE(write_count);
+
+  std::thread([] { Memory::Write_U8(1, 0x80010); }).join();
+  EXPECT_TRUE(Memory::WrittenSince(0x80000, 0x100, *write_count));
+  EXPECT_EQ(Memory::Read_U8(0x80010), 1);
+}
+
+TEST_F(WriteTrackingTest, HostWrites)
+{
+  if (!EMM::HandlesAllThreads())
+    return;
+
+  const std::optional<u64> write_count = Memory::TrackWrites(0x20000, 0x100);
+  ASSERT_TRUE(write_count);
+
+  {
+    const Memory::ScopedHostWrite host_write(0x20000, 0x100);
+    EXPECT_TRUE(Memory::WrittenSince(0x20000, 0x100, *write_count));
+    // Nothing can be protected while the host writes
+    EXPECT_FALSE(Memory::TrackWrites(0x30000, 0x100));
+  }
+
+  EXPECT_TRUE(Memory::TrackWrites(0x30000, 0x100));
+}
+
+TEST_F(WriteTrackingTest, UntrackableRanges)
+{
+  if (!EMM::HandlesAllThreads())
+    return;
+
+  EXPECT_FALSE(Memory::TrackWrites(0x10000, 0));
+  EXPECT_FALSE(Memory::TrackWrites(Memory::GetRamSizeReal() - 0x10, 0x20));
+  EXPECT_TRUE(Memory::WrittenSince(0x10000, 0, 0));
+}
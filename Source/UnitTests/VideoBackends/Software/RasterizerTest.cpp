@@ -0,0 +1,114 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "VideoBackends/Software/EfbInterface.h"
+#include "VideoBackends/Software/NativeVertexFormat.h"
+#include "VideoBackends/Software/Rasterizer.h"
+#include "VideoCommon/BPMemory.h"
+#include "VideoCommon/VideoCommon.h"
+
+namespace
+{
+constexpr u32 NUM_TRIANGLES = 300;
+
+// Draws the rasterized color of the first channel, with depth test and update.
+void SetupBPMemory(PEControl::PixelFormat pixel_format)
+{
+  std::memset(static_cast<void*>(&bpmem), 0, sizeof(bpmem));
+
+  bpmem.genMode.numcolchans = 1;
+  bpmem.combiners[0].colorC.a = TEVCOLORARG_ZERO;
+  bpmem.combiners[0].colorC.b = TEVCOLORARG_ZERO;
+  bpmem.combiners[0].colorC.c = TEVCOLORARG_ZERO;
+  bpmem.combiners[0].colorC.d = TEVCOLORARG_RASC;
+  bpmem.combiners[0].alphaC.a = TEVALPHAARG_ZERO;
+  bpmem.combiners[0].alphaC.b = TEVALPHAARG_ZERO;
+  bpmem.combiners[0].alphaC.c = TEVALPHAARG_ZERO;
+  bpmem.combiners[0].alphaC.d = TEVALPHAARG_RASA;
+  bpmem.alpha_test.comp0 = AlphaTest::ALWAYS;
+  bpmem.alpha_test.comp1 = AlphaTest::ALWAYS;
+
+  bpmem.zmode.testenable = 1;
+  bpmem.zmode.func = ZMode::LEQUAL;
+  bpmem.zmode.updateenable = 1;
+  bpmem.zcontrol.pixel_format = pixel_format;
+  bpmem.blendmode.colorupdate = 1;
+  bpmem.blendmode.alphaupdate = 1;
+
+  // No scissoring
+  bpmem.scissorOffset.x = 171;
+  bpmem.scissorOffset.y = 171;
+  bpmem.scissorTL.x = 342;
+  bpmem.scissorTL.y = 342;
+  bpmem.scissorBR.x = 341 + EFB_WIDTH;
+  bpmem.scissorBR.y = 341 + EFB_HEIGHT;
+}
+
+std::vector<OutputVertexData> RandomTriangles()
+{
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> x(-32.0f, EFB_WIDTH + 32.0f);
+  std::uniform_real_distribution<float> y(-32.0f, EFB_HEIGHT + 32.0f);
+  std::uniform_real_distribution<float> z(0.0f, 16777215.0f);
+
+  std::vector<OutputVertexData> vertices(NUM_TRIANGLES * 3);
+  for (OutputVertexData& vertex : vertices)
+  {
+    vertex.screenPosition = {x(rng), y(rng), z(rng)};
+    vertex.projectedPosition.w = 1.0f;
+    for (u8& component : vertex.color[0])
+      component = static_cast<u8>(rng());
+  }
+  return vertices;
+}
+
+// Returns the contents of the color and depth buffers after drawing the triangles.
+std::vector<u8> Draw(const std::vector<OutputVertexData>& vertices, u32 num_threads)
+{
+  constexpr size_t buffer_size = EFB_WIDTH * EFB_HEIGHT * 3;
+  u8* const color = EfbInterface::GetPixelPointer(0, 0, false);
+  u8* const depth = EfbInterface::GetPixelPointer(0, 0, true);
+  std::memset(color, 0, buffer_size);
+  std::memset(depth, 0xff, buffer_size);
+
+  Rasterizer::Init(num_threads);
+  for (size_t i = 0; i < vertices.size(); i += 3)
+    Rasterizer::DrawTriangleFrontFace(&vertices[i], &vertices[i + 1], &vertices[i + 2]);
+  Rasterizer::Flush();
+  Rasterizer::Shutdown();
+
+  std::vector<u8> efb(color, color + buffer_size);
+  efb.insert(efb.end(), depth, depth + buffer_size);
+  return efb;
+}
+}  // namespace
+
+// Neighboring tiles are drawn by different threads, and pixels along their edges share 4-byte
+// words, so this catches any pixel access that touches more than its own 3 bytes.
+TEST(Rasterizer, ThreadsDrawTheSameAsOneThread)
+{
+  const std::vector<OutputVertexData> vertices = RandomTriangles();
+
+  for (PEControl::PixelFormat format : {PEControl::RGB8_Z24, PEControl::RGBA6_Z24})
+  {
+    SetupBPMemory(format);
+    const std::vector<u8> expected = Draw(vertices, 1);
+    ASSERT_TRUE(std::any_of(expected.begin(), expected.begin() + expected.size() / 2,
+                            [](u8 byte) { return byte != 0; }));
+    for (u32 num_threads : {2, 4, 8})
+    {
+      const std::vector<u8> actual = Draw(vertices, num_threads);
+      EXPECT_TRUE(expected == actual)
+          << "pixel format " << static_cast<u32>(format) << ", " << num_threads << " threads";
+    }
+  }
+}
@@ -0,0 +1,235 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <random>
+
+#include "Common/CommonTypes.h"
+#include "VideoBackends/Software/Tev.h"
+#include "VideoBackends/Software/TevJit.h"
+#include "VideoCommon/BPMemory.h"
+#include "VideoCommon/PixelShaderManager.h"
+#include "VideoCommon/TextureDecoder.h"
+#include "VideoCommon/VideoCommon.h"
+
+namespace
+{
+constexpr std::array<u32, 11> TEXTURE_FORMATS = {0, 1, 2, 3, 4, 5, 6, 8, 9, 10, 14};
+
+void ClearBPMemory()
+{
+  std::memset(static_cast<void*>(&bpmem), 0, sizeof(bpmem));
+}
+
+void RandomizeTevConfig(std::mt19937& rng)
+{
+  ClearBPMemory();
+
+  bpmem.genMode.numtevstages = rng() % 16;
+  bpmem.genMode.numindstages = rng() % 5;
+  bpmem.genMode.numtexgens = rng() % 9;
+  bpmem.genMode.numcolchans = rng() % 3;
+
+  for (auto& combiner : bpmem.combiners)
+  {
+    combiner.colorC.hex = rng() & 0xffffff;
+    combiner.alphaC.hex = rng() & 0xffffff;
+  }
+  for (auto& order : bpmem.tevorders)
+    order.hex = rng() & 0xffffff;
+  for (auto& ksel : bpmem.tevksel)
+    ksel.hex = rng() & 0xffffff;
+  for (auto& ind : bpmem.tevind)
+    ind.hex = rng() & 0x1fffff;
+  for (auto& mtx : bpmem.indmtx)
+  {
+    mtx.col0.hex = rng() & 0xffffff;
+    mtx.col1.hex = rng() & 0xffffff;
+    mtx.col2.hex = rng() & 0xffffff;
+  }
+  for (auto& scale : bpmem.texscale)
+    scale.hex = rng() & 0xffffff;
+  bpmem.tevindref.hex = rng() & 0xffffff;
+  bpmem.alpha_test.hex = rng() & 0xffffff;
+
+  for (auto& units : bpmem.tex)
+  {
+    for (u32 i = 0; i < 4; ++i)
+    {
+      units.texMode0[i].hex = rng() & 0xffffff;
+      units.texMode0[i].wrap_s = rng() % 3;
+      units.texMode0[i].wrap_t = rng() % 3;
+      units.texImage0[i].width = rng() % 64;
+      units.texImage0[i].height = rng() % 64;
+      units.texImage0[i].format = TEXTURE_FORMATS[rng() % TEXTURE_FORMATS.size()];
+      units.texImage1[i].image_type = 1;
+      units.texImage1[i].tmem_even = rng() % 0x1000;
+      units.texImage2[i].tmem_odd = rng() % 0x1000;
+      units.texTlut[i].tmem_offset = rng() % 0x400;
+      units.texTlut[i].tlut_format = rng() % 3;
+    }
+  }
+
+  for (auto& color : PixelShaderManager::constants.colors)
+  {
+    for (auto& component : color)
+      component = static_cast<int>(rng() % 2048) - 1024;
+  }
+}
+
+void RandomizeTevState(std::mt19937& rng, Tev* a, Tev* b)
+{
+  for (int reg = 0; reg < 4; ++reg)
+  {
+    for (int comp = 0; comp < 4; ++comp)
+    {
+      const s16 color = static_cast<s16>(rng() % 256);
+      a->SetRegColor(reg, comp, color);
+      b->SetRegColor(reg, comp, color);
+    }
+  }
+  for (u32 i = 0; i < 4; ++i)
+    a->IndirectLinear[i] = b->IndirectLinear[i] = rng() % 2;
+  for (u32 i = 0; i < 16; ++i)
+    a->TextureLinear[i] = b->TextureLinear[i] = rng() % 2;
+}
+
+Tev::QuadPixel RandomPixel(std::mt19937& rng)
+{
+  Tev::QuadPixel pixel;
+  pixel.Position[0] = rng() % EFB_WIDTH;
+  pixel.Position[1] = rng() % EFB_HEIGHT;
+  pixel.Position[2] = rng() & 0xffffff;
+  for (auto& color : pixel.Color)
+  {
+    for (auto& component : color)
+      component = static_cast<u8>(rng());
+  }
+  for (auto& uv : pixel.Uv)
+  {
+    uv.s = static_cast<s32>(rng() % (1 << 21)) - (1 << 20);
+    uv.t = static_cast<s32>(rng() % (1 << 21)) - (1 << 20);
+  }
+  return pixel;
+}
+
+// Sets up a pixel the same way the rasterizer does, which only sets the used channels.
+void LoadPixel(Tev* tev, const Tev::QuadPixel& pixel)
+{
+  std::copy(std::begin(pixel.Position), std::end(pixel.Position), tev->Position);
+  for (u32 i = 0; i < std::min<u32>(bpmem.genMode.numcolchans, 2); ++i)
+    std::copy(std::begin(pixel.Color[i]), std::end(pixel.Color[i]), tev->Color[i]);
+  for (u32 i = 0; i < bpmem.genMode.numtexgens; ++i)
+    tev->Uv[i] = pixel.Uv[i];
+}
+
+// Draws random quads with random TEV configurations, and compares them to pixel by pixel drawing
+void CompareQuadsWithScalar(bool use_pipelines)
+{
+  std::mt19937 rng(1234);
+  for (u8& byte : texMem)
+    byte = static_cast<u8>(rng());
+
+  auto scalar = std::make_unique<Tev>();
+  auto quad = std::make_unique<Tev>();
+  scalar->Init();
+  quad->Init();
+
+  for (u32 config = 0; config < 2000; ++config)
+  {
+    SCOPED_TRACE(config);
+    RandomizeTevConfig(rng);
+    RandomizeTevState(rng, scalar.get(), quad.get());
+    if (use_pipelines)
+      quad->SetPipeline(TevJit::GetPipeline());
+
+    // Several quads in a row, since some state carries over from one pixel to the next
+    for (u32 run = 0; run < 4; ++run)
+    {
+      const u32 num_pixels = 1 + rng() % 4;
+      for (u32 i = 0; i < num_pixels; ++i)
+        quad->Quad[i] = RandomPixel(rng);
+
+      u8 quad_output[4][4];
+      s16 quad_tex_color[4][4];
+      bool quad_alpha_pass[4];
+      quad->ShadeQuad(num_pixels, quad_output, quad_tex_color, quad_alpha_pass);
+
+      for (u32 i = 0; i < num_pixels; ++i)
+      {
+        LoadPixel(scalar.get(), quad->Quad[i]);
+        u8 output[4];
+        s16 tex_color[4];
+        scalar->ShadePixel(output, tex_color);
+
+        for (u32 comp = 0; comp < 4; ++comp)
+        {
+          ASSERT_EQ(output[comp], quad_output[i][comp]) << "pixel " << i << " comp " << comp;
+          ASSERT_EQ(tex_color[comp], quad_tex_color[i][comp]) << "pixel " << i << " comp " << comp;
+        }
+        // The outputs are ABGR
+        ASSERT_EQ(Tev::PassesAlphaTest(output[0]), quad_alpha_pass[i]) << "pixel " << i;
+      }
+    }
+  }
+
+  TevJit::Shutdown();
+}
+}  // namespace
+
+TEST(SWTev, QuadPassesRasterizedColor)
+{
+  ClearBPMemory();
+  bpmem.genMode.numcolchans = 1;
+  bpmem.tevorders[0].colorchan0 = 0;
+  bpmem.tevksel[0].swap1 = 0;
+  bpmem.tevksel[0].swap2 = 1;
+  bpmem.tevksel[1].swap1 = 2;
+  bpmem.tevksel[1].swap2 = 3;
+  bpmem.combiners[0].colorC.d = TEVCOLORARG_RASC;
+  bpmem.combiners[0].colorC.a = TEVCOLORARG_ZERO;
+  bpmem.combiners[0].colorC.b = TEVCOLORARG_ZERO;
+  bpmem.combiners[0].colorC.c = TEVCOLORARG_ZERO;
+  bpmem.combiners[0].alphaC.d = TEVALPHAARG_RASA;
+  bpmem.combiners[0].alphaC.a = TEVALPHAARG_ZERO;
+  bpmem.combiners[0].alphaC.b = TEVALPHAARG_ZERO;
+  bpmem.combiners[0].alphaC.c = TEVALPHAARG_ZERO;
+
+  auto tev = std::make_unique<Tev>();
+  tev->Init();
+  for (u32 i = 0; i < 4; ++i)
+  {
+    for (u32 comp = 0; comp < 4; ++comp)
+      tev->Quad[i].Color[0][comp] = static_cast<u8>(i * 64 + comp * 16);
+  }
+
+  u8 output[4][4];
+  s16 tex_color[4][4];
+  bool alpha_pass[4];
+  tev->ShadeQuad(4, output, tex_color, alpha_pass);
+
+  // Color is RGBA, the output ABGR
+  for (u32 i = 0; i < 4; ++i)
+  {
+    for (u32 comp = 0; comp < 4; ++comp)
+      EXPECT_EQ(tev->Quad[i].Color[0][comp], output[i][3 - comp]);
+  }
+}
+
+TEST(SWTev, QuadMatchesScalar)
+{
+  CompareQuadsWithScalar(false);
+}
+
+// Without support for pipelines on the host, this is the same as QuadMatchesScalar
+TEST(SWTev, PipelineMatchesScalar)
+{
+  CompareQuadsWithScalar(true);
+}
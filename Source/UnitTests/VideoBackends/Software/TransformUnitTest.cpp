@@ -0,0 +1,196 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "VideoBackends/Software/NativeVertexFormat.h"
+#include "VideoBackends/Software/TransformUnit.h"
+#include "VideoCommon/BPMemory.h"
+#include "VideoCommon/XFMemory.h"
+
+namespace
+{
+// Mostly arbitrary values, with some small integers to get zeros and other degenerate cases
+float RandomFloat(std::mt19937& rng)
+{
+  if (rng() % 4 == 0)
+    return static_cast<float>(static_cast<s32>(rng() % 5) - 2);
+  return std::uniform_real_distribution<float>(-4.0f, 4.0f)(rng);
+}
+
+void RandomizeTransformConfig(std::mt19937& rng)
+{
+  std::memset(static_cast<void*>(&xfmem), 0, sizeof(xfmem));
+  std::memset(static_cast<void*>(&bpmem), 0, sizeof(bpmem));
+
+  for (float& value : xfmem.posMatrices)
+    value = RandomFloat(rng);
+  for (float& value : xfmem.normalMatrices)
+    value = RandomFloat(rng);
+  for (float& value : xfmem.postMatrices)
+    value = RandomFloat(rng);
+  for (float& value : xfmem.projection.rawProjection)
+    value = RandomFloat(rng);
+  xfmem.projection.type = rng() % 2 ? GX_PERSPECTIVE : GX_ORTHOGRAPHIC;
+
+  for (Light& light : xfmem.lights)
+  {
+    for (u8& comp : light.color)
+      comp = static_cast<u8>(rng());
+    for (u32 i = 0; i < 3; i++)
+    {
+      light.cosatt[i] = RandomFloat(rng);
+      light.distatt[i] = RandomFloat(rng);
+      light.dpos[i] = RandomFloat(rng);
+      light.ddir[i] = RandomFloat(rng);
+    }
+  }
+
+  for (u32 chan = 0; chan < NUM_XF_COLOR_CHANNELS; chan++)
+  {
+    xfmem.ambColor[chan] = rng();
+    xfmem.matColor[chan] = rng();
+    for (LitChannel* channel : {&xfmem.color[chan], &xfmem.alpha[chan]})
+    {
+      channel->hex = rng() & 0x7fff;
+      channel->diffusefunc = rng() % 3;
+    }
+  }
+
+  xfmem.dualTexTrans.enabled = rng() % 2;
+  xfmem.numTexGen.numTexGens = rng() % 9;
+  for (u32 i = 0; i < 8; i++)
+  {
+    TexMtxInfo& info = xfmem.texMtxInfo[i];
+    info.hex = rng() & 0x3ffff;
+    info.texgentype = rng() % 4;
+    if (info.texgentype == XF_TEXGEN_COLOR_STRGBC0 || info.texgentype == XF_TEXGEN_COLOR_STRGBC1)
+    {
+      info.sourcerow = XF_SRCCOLORS_INROW;
+      info.inputform = XF_TEXINPUT_AB11;
+    }
+    else
+    {
+      // Every row except the colors
+      info.sourcerow = (rng() % 12 + 3) % 13;
+    }
+
+    xfmem.postMtxInfo[i].hex = rng() & 0x1ff;
+    xfmem.postMtxInfo[i].index = rng() % 62;
+
+    bpmem.texcoords[i].s.scale_minus_1 = rng();
+    bpmem.texcoords[i].t.scale_minus_1 = rng();
+  }
+}
+
+void RandomizeVertex(std::mt19937& rng, bool uniform_matrices, InputVertexData* vertex)
+{
+  // All matrices have to be inside of the matrix memory
+  vertex->posMtx = uniform_matrices ? 0 : rng() % 62;
+  for (u8& mtx : vertex->texMtx)
+    mtx = uniform_matrices ? 3 : rng() % 62;
+
+  vertex->position = Vec3(RandomFloat(rng), RandomFloat(rng), RandomFloat(rng));
+  for (Vec3& normal : vertex->normal)
+    normal = Vec3(RandomFloat(rng), RandomFloat(rng), RandomFloat(rng));
+  for (auto& color : vertex->color)
+  {
+    for (u8& comp : color)
+      comp = static_cast<u8>(rng());
+  }
+  for (auto& coord : vertex->texCoords)
+  {
+    for (float& comp : coord)
+      comp = RandomFloat(rng);
+  }
+}
+
+bool SameFloat(float a, float b)
+{
+  return std::memcmp(&a, &b, sizeof(float)) == 0 || (std::isnan(a) && std::isnan(b));
+}
+
+void CompareVec3(const Vec3& expected, const Vec3& actual, const char* name)
+{
+  for (int i = 0; i < 3; i++)
+  {
+    EXPECT_TRUE(SameFloat(expected[i], actual[i]))
+        << name << "[" << i << "] " << expected[i] << " != " << actual[i];
+  }
+}
+
+void CompareVertices(const OutputVertexData& expected, const OutputVertexData& actual)
+{
+  CompareVec3(expected.mvPosition, actual.mvPosition, "mvPosition");
+  EXPECT_TRUE(SameFloat(expected.projectedPosition.x, actual.projectedPosition.x));
+  EXPECT_TRUE(SameFloat(expected.projectedPosition.y, actual.projectedPosition.y));
+  EXPECT_TRUE(SameFloat(expected.projectedPosition.z, actual.projectedPosition.z));
+  EXPECT_TRUE(SameFloat(expected.projectedPosition.w, actual.projectedPosition.w));
+  for (u32 i = 0; i < 3; i++)
+  {
+    SCOPED_TRACE(i);
+    CompareVec3(expected.normal[i], actual.normal[i], "normal");
+  }
+  EXPECT_EQ(expected.color, actual.color);
+  for (u32 i = 0; i < 8; i++)
+  {
+    SCOPED_TRACE(i);
+    CompareVec3(expected.texCoords[i], actual.texCoords[i], "texCoords");
+  }
+}
+}  // namespace
+
+TEST(SWTransformUnit, BatchMatchesPerVertex)
+{
+  std::mt19937 rng(4321);
+
+  for (u32 config = 0; config < 1000; ++config)
+  {
+    SCOPED_TRACE(config);
+    RandomizeTransformConfig(rng);
+
+    const bool has_normal = rng() % 4 != 0;
+    const bool nbt = has_normal && rng() % 2;
+    // The special case is only valid with ST projection
+    const bool special_case = rng() % 4 == 0;
+    if (special_case)
+    {
+      for (TexMtxInfo& info : xfmem.texMtxInfo)
+        info.projection = XF_TEXPROJ_ST;
+    }
+    const bool uniform_matrices = rng() % 2;
+
+    const u32 count = rng() % 23 + 1;
+    std::vector<InputVertexData> input(count);
+    for (InputVertexData& vertex : input)
+      RandomizeVertex(rng, uniform_matrices, &vertex);
+
+    std::vector<OutputVertexData> batch(count);
+    TransformUnit::TransformVertices(input.data(), batch.data(), count, has_normal, nbt,
+                                     special_case);
+
+    for (u32 i = 0; i < count; i++)
+    {
+      SCOPED_TRACE(i);
+      OutputVertexData expected;
+      std::memset(static_cast<void*>(&expected), 0, sizeof(expected));
+      TransformUnit::TransformPosition(&input[i], &expected);
+      if (has_normal)
+        TransformUnit::TransformNormal(&input[i], nbt, &expected);
+      TransformUnit::TransformColor(&input[i], &expected);
+      TransformUnit::TransformTexCoord(&input[i], &expected, special_case);
+
+      CompareVertices(expected, batch[i]);
+      if (HasFailure())
+        return;
+    }
+  }
+}
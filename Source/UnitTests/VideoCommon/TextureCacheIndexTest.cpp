@@ -0,0 +1,377 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "VideoCommon/TextureCacheIndex.h"
+
+namespace
+{
+struct Entry
+{
+  u32 id;
+  u32 addr;
+  u32 size;
+  u64 hash;
+  int last_used;
+};
+
+// Both indices of the texture cache, with the old tree based containers for comparison
+struct TreeIndex
+{
+  void Insert(Entry* entry)
+  {
+    by_address.emplace(entry->addr, entry);
+    by_hash.emplace(entry->hash, entry);
+  }
+
+  void Erase(Entry* entry)
+  {
+    auto range = by_address.equal_range(entry->addr);
+    by_address.erase(std::find_if(range.first, range.second,
+                                  [entry](const auto& it) { return it.second == entry; }));
+    auto hash_range = by_hash.equal_range(entry->hash);
+    by_hash.erase(std::find_if(hash_range.first, hash_range.second,
+                               [entry](const auto& it) { return it.second == entry; }));
+  }
+
+  std::vector<Entry*> Find(u32 address) const
+  {
+    std::vector<Entry*> result;
+    auto range = by_address.equal_range(address);
+    for (auto it = range.first; it != range.second; ++it)
+      result.push_back(it->second);
+    return result;
+  }
+
+  Entry* FindByHash(u64 hash) const
+  {
+    auto it = by_hash.lower_bound(hash);
+    return it != by_hash.end() && it->first == hash ? it->second : nullptr;
+  }
+
+  std::vector<Entry*> FindInRange(u32 first, u32 last) const
+  {
+    std::vector<Entry*> result;
+    const auto end = by_address.upper_bound(last);
+    for (auto it = by_address.lower_bound(first); it != end; ++it)
+      result.push_back(it->second);
+    return result;
+  }
+
+  template <typename F>
+  void ForEach(F f)
+  {
+    for (const auto& it : by_address)
+      f(it.second);
+  }
+
+  std::multimap<u32, Entry*> by_address;
+  std::multimap<u64, Entry*> by_hash;
+};
+
+struct FlatIndex
+{
+  void Insert(Entry* entry)
+  {
+    by_address.Insert(entry->addr, entry);
+    by_hash.Insert(entry->hash, entry);
+  }
+
+  void Erase(Entry* entry)
+  {
+    EXPECT_TRUE(by_address.Erase(entry->addr, entry));
+    EXPECT_TRUE(by_hash.Erase(entry->hash, entry));
+  }
+
+  TextureAddressIndex<Entry>::Entries Find(u32 address) const { return by_address.Find(address); }
+
+  Entry* FindByHash(u64 hash) const
+  {
+    const auto* entries = by_hash.Find(hash);
+    return entries ? entries->front() : nullptr;
+  }
+
+  TextureAddressIndex<Entry>::Entries FindInRange(u32 first, u32 last) const
+  {
+    return by_address.FindInRange(first, last);
+  }
+
+  template <typename F>
+  void ForEach(F f)
+  {
+    by_address.ForEach([&f](u32, Entry* entry) { f(entry); });
+  }
+
+  TextureAddressIndex<Entry> by_address;
+  TextureHashIndex<Entry> by_hash;
+};
+
+// A texture access trace, modeled on what GetTexture, CopyRenderTargetToTexture and Cleanup do
+// with the indices
+struct Access
+{
+  enum class Type
+  {
+    Load,
+    EFBCopy,
+    EndFrame,
+  };
+
+  Type type;
+  u32 address;
+  u32 size;
+  u64 hash;
+};
+
+std::vector<Access> GenerateTrace(u32 seed, int frames)
+{
+  std::mt19937 rng(seed);
+  std::vector<Access> trace;
+
+  // Textures of a level, some of which are streamed in and out as the scene changes
+  struct Texture
+  {
+    u32 address;
+    u32 size;
+    u64 hash;
+  };
+  std::vector<Texture> textures(3000);
+  for (Texture& texture : textures)
+  {
+    texture.address = (rng() % (24 * 1024 * 1024 / 32)) * 32;
+    texture.size = 32 << (rng() % 14);
+    texture.hash = (u64(rng()) << 32) | rng();
+  }
+
+  // Render targets, copied to every frame and then read back as textures
+  constexpr u32 copy_size = 640 * 528 * 2;
+  const std::vector<u32> copy_addresses = {0x1000000, 0x10A5000, 0x114A000, 0x11EF000, 0x1294000};
+
+  for (int frame = 0; frame < frames; ++frame)
+  {
+    for (int draw = 0; draw < 1500; ++draw)
+    {
+      if (draw % 300 == 0)
+      {
+        const u32 address = copy_addresses[rng() % copy_addresses.size()];
+        trace.push_back({Access::Type::EFBCopy, address, copy_size, (u64(frame) << 32) | draw});
+        continue;
+      }
+
+      // Mostly the same few hundred textures in a frame
+      const size_t index = rng() % 8 ? rng() % 400 : rng() % textures.size();
+      Texture& texture = textures[index];
+      if (rng() % 500 == 0)
+        texture.hash = (u64(rng()) << 32) | rng();
+      trace.push_back({Access::Type::Load, texture.address, texture.size, texture.hash});
+    }
+    trace.push_back({Access::Type::EndFrame, 0, 0, 0});
+  }
+
+  return trace;
+}
+
+// Replays the trace, returning the IDs of the entries that were used, and the number of entries
+// after every frame
+template <typename Index>
+std::vector<u32> Replay(const std::vector<Access>& trace)
+{
+  Index index;
+  std::deque<Entry> entries;
+  std::vector<u32> result;
+  int frame = 0;
+
+  const auto create_entry = [&](u32 address, u32 size, u64 hash) {
+    Entry* entry = &entries.emplace_back(
+        Entry{static_cast<u32>(entries.size()), address, size, hash, frame});
+    index.Insert(entry);
+    return entry;
+  };
+
+  size_t alive = 0;
+  for (const Access& access : trace)
+  {
+    switch (access.type)
+    {
+    case Access::Type::Load:
+    {
+      Entry* found = nullptr;
+      Entry* oldest = nullptr;
+      for (Entry* entry : index.Find(access.address))
+      {
+        if (entry->hash == access.hash && entry->size == access.size)
+        {
+          found = entry;
+          break;
+        }
+        if (entry->last_used < frame && (!oldest || entry->last_used < oldest->last_used))
+          oldest = entry;
+      }
+
+      if (!found)
+      {
+        Entry* by_hash = index.FindByHash(access.hash);
+        if (by_hash && by_hash->size == access.size)
+          found = by_hash;
+      }
+
+      if (!found)
+      {
+        if (oldest)
+        {
+          index.Erase(oldest);
+          --alive;
+        }
+        found = create_entry(access.address, access.size, access.hash);
+        ++alive;
+      }
+
+      found->last_used = frame;
+      result.push_back(found->id);
+      break;
+    }
+
+    case Access::Type::EFBCopy:
+    {
+      constexpr u32 max_texture_size = 1024 * 1024 * 4;
+      const u32 first = access.address > max_texture_size ? access.address - max_texture_size : 0;
+      for (Entry* entry : index.FindInRange(first, access.address + access.size))
+      {
+        if (entry->addr + entry->size > access.address &&
+            entry->addr < access.address + access.size)
+        {
+          result.push_back(entry->id);
+          index.Erase(entry);
+          --alive;
+        }
+      }
+      create_entry(access.address, access.size, access.hash);
+      ++alive;
+      break;
+    }
+
+    case Access::Type::EndFrame:
+    {
+      std::vector<Entry*> expired;
+      index.ForEach([&](Entry* entry) {
+        if (entry->last_used + 10 < frame)
+          expired.push_back(entry);
+      });
+      // The order of ForEach differs between the indices
+      std::sort(expired.begin(), expired.end(),
+                [](const Entry* a, const Entry* b) { return a->id < b->id; });
+      for (Entry* entry : expired)
+      {
+        result.push_back(entry->id);
+        index.Erase(entry);
+        --alive;
+      }
+      result.push_back(static_cast<u32>(alive));
+      ++frame;
+      break;
+    }
+    }
+  }
+
+  return result;
+}
+}  // namespace
+
+TEST(TextureAddressIndex, FindInRange)
+{
+  std::vector<Entry> entries(6);
+  TextureAddressIndex<Entry> index;
+  index.Insert(0x100, &entries[0]);
+  index.Insert(0x80000, &entries[1]);
+  index.Insert(0x100, &entries[2]);
+  index.Insert(0x40, &entries[3]);
+  index.Insert(0x1000000, &entries[4]);
+  index.Insert(0x80000, &entries[5]);
+  EXPECT_EQ(6u, index.Size());
+
+  const auto same_address = index.Find(0x100);
+  EXPECT_EQ((std::vector<Entry*>{&entries[0], &entries[2]}),
+            std::vector<Entry*>(same_address.begin(), same_address.end()));
+  EXPECT_TRUE(index.Find(0x120).empty());
+
+  const auto range = index.FindInRange(0x40, 0x80000);
+  EXPECT_EQ((std::vector<Entry*>{&entries[3], &entries[0], &entries[2], &entries[1], &entries[5]}),
+            std::vector<Entry*>(range.begin(), range.end()));
+
+  EXPECT_TRUE(index.Erase(0x100, &entries[0]));
+  EXPECT_FALSE(index.Erase(0x100, &entries[0]));
+  EXPECT_FALSE(index.Erase(0x40, &entries[1]));
+  EXPECT_EQ(5u, index.Size());
+  const auto after_erase = index.FindInRange(0, 0x100);
+  EXPECT_EQ((std::vector<Entry*>{&entries[3], &entries[2]}),
+            std::vector<Entry*>(after_erase.begin(), after_erase.end()));
+
+  index.Clear();
+  EXPECT_EQ(0u, index.Size());
+  EXPECT_TRUE(index.FindInRange(0, 0xFFFFFFFF).empty());
+}
+
+TEST(TextureHashIndex, Simple)
+{
+  std::vector<Entry> entries(3);
+  TextureHashIndex<Entry> index;
+  EXPECT_EQ(nullptr, index.Find(1));
+
+  index.Insert(1, &entries[0]);
+  index.Insert(2, &entries[1]);
+  index.Insert(1, &entries[2]);
+  ASSERT_NE(nullptr, index.Find(1));
+  EXPECT_EQ((std::vector<Entry*>{&entries[0], &entries[2]}),
+            std::vector<Entry*>(index.Find(1)->begin(), index.Find(1)->end()));
+
+  EXPECT_TRUE(index.Erase(1, &entries[0]));
+  EXPECT_FALSE(index.Erase(2, &entries[0]));
+  EXPECT_EQ(1u, index.Find(1)->size());
+  EXPECT_TRUE(index.Erase(1, &entries[2]));
+  EXPECT_EQ(nullptr, index.Find(1));
+  EXPECT_NE(nullptr, index.Find(2));
+}
+
+TEST(TextureCacheIndex, ReplayTrace)
+{
+  // No recorded traces are available, so this replays a synthetic one. The flat indices have to
+  // find the same entries, in the same order, as the tree based containers they replace.
+  const std::vector<Access> trace = GenerateTrace(1234, 200);
+
+  const std::vector<u32> tree_result = Replay<TreeIndex>(trace);
+  const std::vector<u32> flat_result = Replay<FlatIndex>(trace);
+  EXPECT_EQ(tree_result, flat_result);
+}
+
+// Only prints how long each index takes on a longer trace, for comparing changes to the indices.
+// Like other benchmarks, it is too slow for every test run, so it is disabled unless asked for
+// with --gtest_also_run_disabled_tests.
+TEST(TextureCacheIndex, DISABLED_ReplayTraceSpeed)
+{
+  const std::vector<Access> trace = GenerateTrace(1234, 5000);
+
+  const auto time = [&trace](const char* name, auto replay) {
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<u32> result = replay(trace);
+    const auto duration = std::chrono::steady_clock::now() - start;
+    printf("%s: %lld us\n", name,
+           static_cast<long long>(
+               std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
+    return result;
+  };
+
+  const std::vector<u32> tree_result = time("std::multimap", Replay<TreeIndex>);
+  const std::vector<u32> flat_result = time("Flat indices", Replay<FlatIndex>);
+  EXPECT_EQ(tree_result, flat_result);
+}
@@ -0,0 +1,45 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Common/CommonTypes.h"
+#include "VideoCommon/TextureDecoder.h"
+
+TEST(TextureDecoder, BandsMatchWholeTexture)
+{
+  TexDecoder_StartWorkers();
+
+  std::mt19937 rng(1234);
+  std::vector<u8> tlut(16384 * 2);
+  for (u8& byte : tlut)
+    byte = static_cast<u8>(rng());
+
+  // Large enough to be split into bands, with a height that isn't a multiple of the band height
+  constexpr int width = 512;
+  constexpr int height = 328;
+  std::vector<u8> src(width * height * 4);
+  for (u8& byte : src)
+    byte = static_cast<u8>(rng());
+
+  for (TextureFormat format :
+       {TextureFormat::I4, TextureFormat::I8, TextureFormat::IA4, TextureFormat::IA8,
+        TextureFormat::RGB565, TextureFormat::RGB5A3, TextureFormat::RGBA8, TextureFormat::C4,
+        TextureFormat::C8, TextureFormat::C14X2, TextureFormat::CMPR})
+  {
+    std::vector<u32> expected(width * height);
+    _TexDecoder_DecodeImpl(expected.data(), src.data(), width, height, format, tlut.data(),
+                           TLUTFormat::RGB5A3);
+
+    std::vector<u32> decoded(width * height);
+    TexDecoder_Decode(reinterpret_cast<u8*>(decoded.data()), src.data(), width, height, format,
+                      tlut.data(), TLUTFormat::RGB5A3);
+    EXPECT_EQ(expected, decoded) << "format " << static_cast<int>(format);
+  }
+
+  TexDecoder_StopWorkers();
+}
@@ -0,0 +1,173 @@
+// Copyright 2021 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Common/CommonPaths.h"
+#include "Common/CommonTypes.h"
+#include "Common/Config/Config.h"
+#include "Common/File.h"
+#include "Common/FileUtil.h"
+#include "Core/ConfigManager.h"
+#include "UICommon/UICommon.h"
+#include "VideoCommon/HiresTextures.h"
+#include "VideoCommon/TextureDecoder.h"
+#include "VideoCommon/TexturePackArchive.h"
+#include "VideoCommon/VideoConfig.h"
+
+namespace
+{
+std::vector<u8> MakeData(size_t size, u8 seed)
+{
+  std::vector<u8> data(size);
+  for (size_t i = 0; i < size; ++i)
+    data[i] = static_cast<u8>(seed + i * 7);
+  return data;
+}
+
+std::vector<u8> LevelData(const TexturePackArchive::Level& level)
+{
+  return std::vector<u8>(level.data, level.data + level.size);
+}
+}  // namespace
+
+TEST(TexturePackArchive, WriteAndFind)
+{
+  const std::string directory = File::CreateTempDir();
+  ASSERT_FALSE(directory.empty());
+  const std::string path = directory + "/pack.dtp";
+
+  const std::vector<u8> rgba_0 = MakeData(64 * 32 * 4, 1);
+  const std::vector<u8> rgba_1 = MakeData(32 * 16 * 4, 2);
+  const std::vector<u8> dxt1 = MakeData(16 * 16 / 2, 3);
+
+  TexturePackArchiveWriter writer;
+  ASSERT_TRUE(writer.Open(path));
+  ASSERT_TRUE(writer.AddTexture("tex1_64x32_0123456789abcdef_5", false,
+                                {{rgba_0.data(), rgba_0.size(), 64, 32, 64,
+                                  AbstractTextureFormat::RGBA8},
+                                 {rgba_1.data(), rgba_1.size(), 32, 16, 32,
+                                  AbstractTextureFormat::RGBA8}}));
+  ASSERT_TRUE(writer.AddTexture("tex1_16x16_fedcba9876543210_14", true,
+                                {{dxt1.data(), dxt1.size(), 16, 16, 16,
+                                  AbstractTextureFormat::DXT1}}));
+  ASSERT_TRUE(writer.Finish());
+
+  TexturePackArchive archive;
+  ASSERT_TRUE(archive.Open(path));
+  EXPECT_EQ(2u, archive.GetTextureCount());
+  EXPECT_FALSE(archive.Contains("tex1_64x32_0123456789abcdef"));
+  EXPECT_FALSE(archive.Find("tex1_8x8_0000000000000000_0"));
+
+  const auto rgba = archive.Find("tex1_64x32_0123456789abcdef_5");
+  ASSERT_TRUE(rgba);
+  EXPECT_FALSE(rgba->has_arbitrary_mipmaps);
+  ASSERT_EQ(2u, rgba->levels.size());
+  EXPECT_EQ(64u, rgba->levels[0].width);
+  EXPECT_EQ(32u, rgba->levels[0].height);
+  EXPECT_EQ(AbstractTextureFormat::RGBA8, rgba->levels[0].format);
+  EXPECT_EQ(rgba_0, LevelData(rgba->levels[0]));
+  EXPECT_EQ(16u, rgba->levels[1].height);
+  EXPECT_EQ(rgba_1, LevelData(rgba->levels[1]));
+
+  const auto compressed = archive.Find("tex1_16x16_fedcba9876543210_14");
+  ASSERT_TRUE(compressed);
+  EXPECT_TRUE(compressed->has_arbitrary_mipmaps);
+  ASSERT_EQ(1u, compressed->levels.size());
+  EXPECT_EQ(AbstractTextureFormat::DXT1, compressed->levels[0].format);
+  EXPECT_EQ(dxt1, LevelData(compressed->levels[0]));
+
+  archive.Close();
+
+  // Cutting off the index has to be noticed when opening the archive
+  File::IOFile file(path, "r+b");
+  ASSERT_TRUE(file.Resize(file.GetSize() - 8));
+  file.Close();
+  EXPECT_FALSE(archive.Open(path));
+
+  File::DeleteDirRecursively(directory);
+}
+
+TEST(TexturePackArchive, RejectsLevelsSmallerThanTheirSize)
+{
+  const std::string directory = File::CreateTempDir();
+  ASSERT_FALSE(directory.empty());
+  const std::string path = directory + "/pack.dtp";
+
+  const std::vector<u8> rgba = MakeData(64 * 32 * 4, 1);
+  const std::vector<u8> dxt5 = MakeData(16 * 16, 2);
+  const auto write = [&path](const TexturePackArchive::Level& level) {
+    TexturePackArchiveWriter writer;
+    return writer.Open(path) && writer.AddTexture("tex1_64x32_0123456789abcdef_5", false, {level}) &&
+           writer.Finish();
+  };
+
+  TexturePackArchive archive;
+  ASSERT_TRUE(write({rgba.data(), rgba.size(), 64, 32, 64, AbstractTextureFormat::RGBA8}));
+  EXPECT_TRUE(archive.Open(path));
+  archive.Close();
+
+  // One row short
+  ASSERT_TRUE(write({rgba.data(), rgba.size() - 64 * 4, 64, 32, 64, AbstractTextureFormat::RGBA8}));
+  EXPECT_FALSE(archive.Open(path));
+
+  // Rows shorter than the width
+  ASSERT_TRUE(write({rgba.data(), rgba.size(), 64, 32, 32, AbstractTextureFormat::RGBA8}));
+  EXPECT_FALSE(archive.Open(path));
+
+  // The last row of blocks is missing
+  ASSERT_TRUE(write({dxt5.data(), dxt5.size(), 16, 16, 16, AbstractTextureFormat::DXT5}));
+  EXPECT_TRUE(archive.Open(path));
+  archive.Close();
+  ASSERT_TRUE(write({dxt5.data(), dxt5.size() - 4 * 16, 16, 16, 16, AbstractTextureFormat::DXT5}));
+  EXPECT_FALSE(archive.Open(path));
+
+  File::DeleteDirRecursively(directory);
+}
+
+TEST(TexturePackArchive, LoadedWithoutLooseFiles)
+{
+  const std::string user_directory = File::CreateTempDir();
+  ASSERT_FALSE(user_directory.empty());
+  UICommon::SetUserDirectory(user_directory);
+  Config::Init();
+  SConfig::Init();
+
+  // Custom textures are looked up by the hash of the native texture
+  const std::vector<u8> native = MakeData(8 * 8 * 4, 3);
+  const std::string name = HiresTexture::GenBaseName(native.data(), native.size(), nullptr, 0, 8, 8,
+                                                     TextureFormat::RGBA8, false, true);
+  const std::string texture_directory =
+      File::GetUserPath(D_HIRESTEXTURES_IDX) + SConfig::GetInstance().GetGameID() + DIR_SEP;
+  ASSERT_TRUE(File::CreateFullPath(texture_directory));
+
+  const std::vector<u8> custom = MakeData(16 * 16 * 4, 4);
+  TexturePackArchiveWriter writer;
+  ASSERT_TRUE(writer.Open(texture_directory + "pack.dtp"));
+  ASSERT_TRUE(writer.AddTexture(
+      name, false, {{custom.data(), custom.size(), 16, 16, 16, AbstractTextureFormat::RGBA8}}));
+  ASSERT_TRUE(writer.Finish());
+
+  g_ActiveConfig.bHiresTextures = true;
+  g_ActiveConfig.bCacheHiresTextures = false;
+  HiresTexture::Update();
+
+  const std::shared_ptr<HiresTexture> texture = HiresTexture::Search(
+      native.data(), native.size(), nullptr, 0, 8, 8, TextureFormat::RGBA8, false);
+  ASSERT_NE(nullptr, texture);
+  ASSERT_EQ(1u, texture->m_levels.size());
+  EXPECT_EQ(16u, texture->m_levels[0].width);
+  EXPECT_EQ(custom, std::vector<u8>(texture->m_levels[0].GetData(),
+                                    texture->m_levels[0].GetData() +
+                                        texture->m_levels[0].GetDataSize()));
+
+  HiresTexture::Shutdown();
+  SConfig::Shutdown();
+  Config::Shutdown();
+  File::DeleteDirRecursively(user_directory);
+}